@@ -0,0 +1,406 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com> */
+/* Ryzen SMU Asynchronous Command Queue */
+
+#include <linux/anon_inodes.h>
+#include <linux/fs.h>
+#include <linux/kref.h>
+#include <linux/list.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+
+#include "smu.h"
+#include "drv.h"
+#include "cmdq.h"
+
+/**
+ * Every mailbox has its own list of pending commands drained by its own work item, so a slow
+ *  command only delays those sent to the same mailbox. Completed commands are moved onto the
+ *  completion list of the queue they were submitted to, where they wait to be read back.
+ */
+struct smu_cmdq {
+    struct kref                     ref;
+    struct smu_cmdq_ctx*            ctx;
+    wait_queue_head_t               waitq;
+
+    // Guards everything below.
+    spinlock_t                      lock;
+    struct list_head                completed;
+    // Commands submitted but not yet read back, bounded by RYZEN_SMU_CMDQ_DEPTH.
+    u32                             inflight;
+    int                             closed;
+};
+
+struct smu_cmdq_req {
+    struct list_head                node;
+    struct smu_cmdq*                q;
+    struct ryzen_smu_cmd_async      rec;
+};
+
+struct smu_cmdq_mailbox {
+    struct smu_cmdq_ctx*            ctx;
+    enum smu_mailbox                type;
+    struct work_struct              work;
+
+    // Guards the pending list.
+    spinlock_t                      lock;
+    struct list_head                pending;
+};
+
+// Open queues keep the context alive, as their files may outlive the device.
+struct smu_cmdq_ctx {
+    struct kref                     ref;
+    struct smu_dev*                 smu;
+    struct workqueue_struct*        wq;
+    struct smu_cmdq_mailbox         mb[MAILBOX_TYPE_COUNT];
+    int                             stopped;
+};
+
+static void smu_cmdq_ctx_release(struct kref* ref) {
+    kfree(container_of(ref, struct smu_cmdq_ctx, ref));
+}
+
+static void smu_cmdq_release(struct kref* ref) {
+    struct smu_cmdq* q = container_of(ref, struct smu_cmdq, ref);
+
+    kref_put(&q->ctx->ref, smu_cmdq_ctx_release);
+    kfree(q);
+}
+
+static void smu_cmdq_put(struct smu_cmdq* q) {
+    kref_put(&q->ref, smu_cmdq_release);
+}
+
+static void smu_cmdq_complete(struct smu_cmdq_req* req) {
+    struct smu_cmdq* q = req->q;
+    int closed;
+
+    spin_lock(&q->lock);
+    closed = q->closed;
+    if (!closed)
+        list_add_tail(&req->node, &q->completed);
+    spin_unlock(&q->lock);
+
+    // Nobody is left to read the completion of a closed queue.
+    if (closed)
+        kfree(req);
+    else
+        wake_up_interruptible(&q->waitq);
+
+    smu_cmdq_put(q);
+}
+
+static void smu_cmdq_work(struct work_struct* work) {
+    struct smu_cmdq_mailbox* mb = container_of(work, struct smu_cmdq_mailbox, work);
+    struct smu_cmdq_req* req;
+    smu_req_args_t args;
+
+    for (;;) {
+        spin_lock(&mb->lock);
+        req = list_first_entry_or_null(&mb->pending, struct smu_cmdq_req, node);
+        if (req)
+            list_del(&req->node);
+        spin_unlock(&mb->lock);
+
+        if (!req)
+            break;
+
+        memcpy(args.args, req->rec.cmd.args, sizeof(args.args));
+        req->rec.cmd.status = smu_send_command(mb->ctx->smu, req->rec.cmd.op, &args, mb->type);
+        memcpy(req->rec.cmd.args, args.args, sizeof(req->rec.cmd.args));
+
+        smu_cmdq_complete(req);
+        cond_resched();
+    }
+}
+
+static ssize_t smu_cmdq_write(struct file* filp, const char __user* buf, size_t count,
+    loff_t* ppos) {
+    struct smu_cmdq* q = filp->private_data;
+    struct smu_cmdq_ctx* ctx = q->ctx;
+    struct smu_cmdq_mailbox* mb;
+    struct smu_cmdq_req* req;
+    size_t done = 0;
+    int err;
+
+    if (!count || count % sizeof(req->rec))
+        return -EINVAL;
+
+    while (done < count) {
+        // Reserve a slot first so the depth is never exceeded.
+        spin_lock(&q->lock);
+        err = q->inflight >= RYZEN_SMU_CMDQ_DEPTH;
+        if (!err)
+            q->inflight++;
+        spin_unlock(&q->lock);
+
+        if (err) {
+            if (done)
+                break;
+
+            if (filp->f_flags & O_NONBLOCK)
+                return -EAGAIN;
+
+            err = wait_event_interruptible(q->waitq,
+                READ_ONCE(q->inflight) < RYZEN_SMU_CMDQ_DEPTH || READ_ONCE(ctx->stopped));
+            if (err)
+                return err;
+
+            if (READ_ONCE(ctx->stopped))
+                return -ENODEV;
+
+            continue;
+        }
+
+        req = kzalloc(sizeof(*req), GFP_KERNEL);
+        if (!req || copy_from_user(&req->rec, buf + done, sizeof(req->rec))) {
+            err = req ? -EFAULT : -ENOMEM;
+            kfree(req);
+            goto ERR_UNRESERVE;
+        }
+
+        req->q = q;
+        kref_get(&q->ref);
+        done += sizeof(req->rec);
+
+        // Commands to mailboxes which don't exist complete right away.
+        if (req->rec.cmd.mailbox >= MAILBOX_TYPE_COUNT) {
+            req->rec.cmd.status = SMU_Return_InvalidArgument;
+            smu_cmdq_complete(req);
+            continue;
+        }
+
+        mb = &ctx->mb[req->rec.cmd.mailbox];
+
+        // The worker is queued under the lock so it can't race with the queue being stopped.
+        spin_lock(&mb->lock);
+        err = READ_ONCE(ctx->stopped);
+        if (!err) {
+            list_add_tail(&req->node, &mb->pending);
+            queue_work(ctx->wq, &mb->work);
+        }
+        spin_unlock(&mb->lock);
+
+        if (err) {
+            done -= sizeof(req->rec);
+            smu_cmdq_put(q);
+            kfree(req);
+            err = -ENODEV;
+            goto ERR_UNRESERVE;
+        }
+    }
+
+    return done;
+
+ERR_UNRESERVE:
+    spin_lock(&q->lock);
+    q->inflight--;
+    spin_unlock(&q->lock);
+
+    return done ? done : err;
+}
+
+static ssize_t smu_cmdq_read(struct file* filp, char __user* buf, size_t count, loff_t* ppos) {
+    struct smu_cmdq* q = filp->private_data;
+    struct smu_cmdq_req* req;
+    size_t done = 0;
+    int err;
+
+    if (count < sizeof(req->rec))
+        return -EINVAL;
+
+    while (done + sizeof(req->rec) <= count) {
+        spin_lock(&q->lock);
+        req = list_first_entry_or_null(&q->completed, struct smu_cmdq_req, node);
+        if (req) {
+            list_del(&req->node);
+            q->inflight--;
+        }
+        spin_unlock(&q->lock);
+
+        if (!req) {
+            if (done)
+                break;
+
+            // Once stopped, no further completions will ever arrive.
+            if (READ_ONCE(q->ctx->stopped) && !READ_ONCE(q->inflight))
+                return -ENODEV;
+
+            if (filp->f_flags & O_NONBLOCK)
+                return -EAGAIN;
+
+            err = wait_event_interruptible(q->waitq, !list_empty(&q->completed));
+            if (err)
+                return err;
+
+            continue;
+        }
+
+        // Submitters may be waiting for the slot just freed.
+        wake_up_interruptible(&q->waitq);
+
+        err = copy_to_user(buf + done, &req->rec, sizeof(req->rec));
+        kfree(req);
+
+        if (err)
+            return done ? done : -EFAULT;
+
+        done += sizeof(req->rec);
+    }
+
+    return done;
+}
+
+static __poll_t smu_cmdq_poll(struct file* filp, poll_table* wait) {
+    struct smu_cmdq* q = filp->private_data;
+    __poll_t mask = 0;
+
+    poll_wait(filp, &q->waitq, wait);
+
+    spin_lock(&q->lock);
+    if (!list_empty(&q->completed))
+        mask |= EPOLLIN | EPOLLRDNORM;
+    if (q->inflight < RYZEN_SMU_CMDQ_DEPTH && !READ_ONCE(q->ctx->stopped))
+        mask |= EPOLLOUT | EPOLLWRNORM;
+    spin_unlock(&q->lock);
+
+    return mask;
+}
+
+static int smu_cmdq_file_release(struct inode* inode, struct file* filp) {
+    struct smu_cmdq* q = filp->private_data;
+    struct smu_cmdq_ctx* ctx = q->ctx;
+    struct smu_cmdq_req *req, *tmp;
+    LIST_HEAD(pending);
+    LIST_HEAD(completed);
+    int i;
+
+    // Commands still pending are dropped, the one currently executing if any discards its own
+    //  completion once it notices the queue closed.
+    for (i = 0; i < MAILBOX_TYPE_COUNT; i++) {
+        spin_lock(&ctx->mb[i].lock);
+        list_for_each_entry_safe(req, tmp, &ctx->mb[i].pending, node)
+            if (req->q == q)
+                list_move_tail(&req->node, &pending);
+        spin_unlock(&ctx->mb[i].lock);
+    }
+
+    spin_lock(&q->lock);
+    q->closed = 1;
+    list_splice_tail_init(&q->completed, &completed);
+    spin_unlock(&q->lock);
+
+    // Unlike completed ones, pending commands hold a reference to the queue.
+    list_for_each_entry_safe(req, tmp, &pending, node) {
+        smu_cmdq_put(q);
+        kfree(req);
+    }
+
+    list_for_each_entry_safe(req, tmp, &completed, node)
+        kfree(req);
+
+    smu_cmdq_put(q);
+    return 0;
+}
+
+static const struct file_operations smu_cmdq_fops = {
+    .owner      = THIS_MODULE,
+    .read       = smu_cmdq_read,
+    .write      = smu_cmdq_write,
+    .poll       = smu_cmdq_poll,
+    .release    = smu_cmdq_file_release,
+    .llseek     = noop_llseek,
+};
+
+int smu_cmdq_create(struct smu_cmdq_ctx* ctx) {
+    struct smu_cmdq* q;
+    int fd;
+
+    if (!ctx || READ_ONCE(ctx->stopped))
+        return -ENODEV;
+
+    q = kzalloc(sizeof(*q), GFP_KERNEL);
+    if (!q)
+        return -ENOMEM;
+
+    kref_init(&q->ref);
+    kref_get(&ctx->ref);
+    q->ctx = ctx;
+    init_waitqueue_head(&q->waitq);
+    spin_lock_init(&q->lock);
+    INIT_LIST_HEAD(&q->completed);
+
+    fd = anon_inode_getfd("[ryzen_smu_cmdq]", &smu_cmdq_fops, q, O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+        smu_cmdq_put(q);
+
+    return fd;
+}
+
+struct smu_cmdq_ctx* smu_cmdq_init(struct smu_dev* smu) {
+    struct smu_cmdq_ctx* ctx;
+    int i;
+
+    ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+    if (!ctx)
+        return ERR_PTR(-ENOMEM);
+
+    // One worker per mailbox at most, commands to the same mailbox are executed in order.
+    ctx->wq = alloc_workqueue("ryzen_smu_cmdq", WQ_UNBOUND, MAILBOX_TYPE_COUNT);
+    if (!ctx->wq) {
+        kfree(ctx);
+        return ERR_PTR(-ENOMEM);
+    }
+
+    kref_init(&ctx->ref);
+    ctx->smu = smu;
+
+    for (i = 0; i < MAILBOX_TYPE_COUNT; i++) {
+        ctx->mb[i].ctx = ctx;
+        ctx->mb[i].type = i;
+        spin_lock_init(&ctx->mb[i].lock);
+        INIT_LIST_HEAD(&ctx->mb[i].pending);
+        INIT_WORK(&ctx->mb[i].work, smu_cmdq_work);
+    }
+
+    return ctx;
+}
+
+void smu_cmdq_exit(struct smu_cmdq_ctx* ctx) {
+    struct smu_cmdq_req *req, *tmp;
+    LIST_HEAD(discard);
+    int i;
+
+    if (!ctx)
+        return;
+
+    for (i = 0; i < MAILBOX_TYPE_COUNT; i++) {
+        spin_lock(&ctx->mb[i].lock);
+        WRITE_ONCE(ctx->stopped, 1);
+        list_splice_tail_init(&ctx->mb[i].pending, &discard);
+        spin_unlock(&ctx->mb[i].lock);
+
+        cancel_work_sync(&ctx->mb[i].work);
+    }
+
+    destroy_workqueue(ctx->wq);
+    ctx->wq = NULL;
+
+    // Complete what was dropped so readers are not left waiting forever.
+    list_for_each_entry_safe(req, tmp, &discard, node) {
+        list_del(&req->node);
+        req->rec.cmd.status = SMU_Return_Failed;
+        smu_cmdq_complete(req);
+    }
+}
+
+void smu_cmdq_ctx_put(struct smu_cmdq_ctx* ctx) {
+    // Queues which are still open keep their own reference.
+    if (ctx)
+        kref_put(&ctx->ref, smu_cmdq_ctx_release);
+}
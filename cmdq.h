@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com> */
+/* Ryzen SMU Asynchronous Command Queue */
+
+#ifndef __CMDQ_H__
+#define __CMDQ_H__
+
+#include "smu.h"
+
+struct smu_cmdq_ctx;
+
+/**
+ * Starts or stops the per-mailbox workers executing commands queued to [smu].
+ * Stopping discards any command which has yet to execute, further queues failing to be created.
+ *
+ * Returns the queue context or an ERR_PTR() on failure.
+ */
+struct smu_cmdq_ctx* smu_cmdq_init(struct smu_dev* smu);
+void smu_cmdq_exit(struct smu_cmdq_ctx* ctx);
+
+/**
+ * Drops the reference returned by smu_cmdq_init(), once the context is stopped. It is freed once
+ *  every queue created from it is closed as well.
+ */
+void smu_cmdq_ctx_put(struct smu_cmdq_ctx* ctx);
+
+/**
+ * Creates a new command queue to the SMU of [ctx] and returns a file descriptor to it, or a
+ *  negative error code.
+ */
+int smu_cmdq_create(struct smu_cmdq_ctx* ctx);
+
+#endif /* __CMDQ_H__ */
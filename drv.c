@@ -8,12 +8,31 @@
 #include <linux/errno.h>
 #include <linux/string.h>
 #include <linux/init.h>
+#include <linux/kref.h>
 #include <linux/kobject.h>
 #include <linux/sysfs.h>
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/miscdevice.h>
+#include <linux/mutex.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/topology.h>
+#include <linux/uaccess.h>
+#include <linux/workqueue.h>
 #include <uapi/linux/stat.h>
+#include <asm/processor.h>
 #include <linux/version.h>
 
 #include "smu.h"
+#include "drv.h"
+#include "sampler.h"
+#include "stats.h"
+#include "cmdq.h"
+#include "pm_metrics.h"
+#include "hwmon.h"
+#include "pmu.h"
 
 #ifndef KBUILD_MODNAME
     #define KBUILD_MODNAME "ryzen_smu"
@@ -62,7 +81,8 @@ MODULE_LICENSE("GPL");
 #define PCI_DEVICE_ID_AMD_MI300_DF_F4       0x152c
 #define PCI_DEVICE_ID_AMD_MI300_ROOT        0x14f8
 
-#define MAX_ATTRS_LEN                      13
+#define MAX_ATTRS_LEN                      11
+#define MAX_PM_ATTRS_LEN                   8
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4, 19, 0)
     #error "Unsupported kernel version. Minimum: v4.19"
@@ -76,38 +96,137 @@ MODULE_LICENSE("GPL");
     static struct kobj_attribute dev_attr_##attr = \
         __ATTR(attr, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH, attr##_show, attr##_store);
 
-static struct ryzen_smu_data {
+/* Upper bound of sockets, each of which is driven through its own root complex. */
+#define RYZEN_SMU_MAX_NODES                8
+
+/* Set in the driver data of the ID table's root complexes, the only devices creating nodes. */
+#define RYZEN_SMU_DEV_ROOT                 (1 << 0)
+
+struct ryzen_smu_node;
+
+/* Files of a table other than the PM table, found under the tables/ directory of its node. */
+struct ryzen_smu_table_attrs {
+    struct kobj_attribute   data;
+    struct kobj_attribute   refresh_policy;
+    char                    data_name[16];
+    char                    refresh_policy_name[32];
+    u32                     id;
+};
+
+/* A character device of a node. misc_open() points the file at the embedded miscdevice. */
+struct ryzen_smu_chrdev {
+    struct miscdevice       misc;
+    struct ryzen_smu_node*  node;
+    char                    name[32];
+    int                     registered;
+};
+
+/* Everything owned by the SMU of a single socket. */
+struct ryzen_smu_node {
+    struct kref             ref;
     struct pci_dev*         device;
-    struct kobject*         drv_kobj;
+    struct smu_dev*         smu;
+    int                     socket;
+
+    struct kobject*         kobj;
+    struct attribute*       attrs[MAX_ATTRS_LEN];
+    struct attribute_group  attr_group;
 
     char                    smu_version[64];
+    struct ryzen_smu_info   info;
     smu_req_args_t          smu_args;
     u32                     smu_rsp;
 
     u32                     smn_result;
 
-    u8*                     pm_table;
+    // Size of the table(s) read at once, zero if PM tables are unsupported.
     u32                     pm_table_version;
     size_t                  pm_table_read_size;
-} g_driver = {
-    .device               = NULL,
 
-    .drv_kobj             = NULL,
+    // Probes the PM table after the node is registered, then creates its files.
+    struct work_struct      pm_work;
+    struct attribute*       pm_attrs[MAX_PM_ATTRS_LEN];
+    u32                     pm_attr_count;
+    struct attribute_group  pm_group;
+    int                     pm_group_root;
+
+    // Metrics derived from the PM table & their consumers, present if the table layout is known.
+    struct smu_pm_metrics*  pm_metrics;
+    struct smu_hwmon*       hwmon;
+    struct smu_pmu*         pmu;
+
+    struct smu_sampler*     sampler;
+    struct smu_cmdq_ctx*    cmdq;
+
+    // Tables other than the PM table, zero if there are none.
+    u32                     table_count;
+    struct ryzen_smu_table_attrs tables[RYZEN_SMU_TABLE_MAX];
+    struct attribute*       table_attrs[RYZEN_SMU_TABLE_MAX * 2 + 1];
+    struct attribute_group  table_group;
+
+    struct ryzen_smu_chrdev chrdev;
+    struct dentry*          debugfs_dir;
+};
+
+static struct ryzen_smu_data {
+    // Parent of the per-node directories. For compatibility, it also carries the attributes of
+    //  the primary node, which is the first one probed & also backs /dev/ryzen_smu.
+    struct kobject*         drv_kobj;
+    struct ryzen_smu_node*  primary;
+    struct ryzen_smu_chrdev chrdev;
+
+    struct dentry*          debugfs_dir;
 
-    .smu_version          = { 0 },
-    .smu_args             = { .args = { 0, 0, 0, 0, 0, 0 } },
-    .smu_rsp              = SMU_Return_OK,
+    // Indexed by socket, guarded by nodes_lock. Bit N of [claimed] is set from the start of the
+    //  probe of socket N until it is removed.
+    struct ryzen_smu_node*  nodes[RYZEN_SMU_MAX_NODES];
+    unsigned long           claimed;
+} g_driver = {
+    .drv_kobj             = NULL,
+    .primary              = NULL,
 
-    .smn_result           = 0,
+    .debugfs_dir          = NULL,
 
-    .pm_table             = NULL,
-    .pm_table_version     = 0,
-    .pm_table_read_size   = PM_TABLE_MAX_SIZE,
+    .nodes                = { NULL },
 };
 
+static DEFINE_MUTEX(nodes_lock);
+
 /* SMU Command Parameters. */
 uint smu_timeout_attempts = 8192;
 
+/* PM Table Refresh Parameters. */
+uint pm_refresh_policy = SMU_PM_REFRESH_INTERVAL;
+uint pm_refresh_interval_us = 1000;
+
+/* PM Table Sampler Parameters. */
+static uint pm_sample_interval_us = 0;
+static uint pm_sample_slots = 64;
+
+/* PM Table Mapping Parameters. */
+uint pm_idle_timeout_ms = 0;
+
+/* State kept for every open file of the character device. */
+struct ryzen_smu_file {
+    struct ryzen_smu_node*  node;
+    struct smu_sampler*     sampler;
+    u64                     sample_cursor;
+};
+
+static struct ryzen_smu_node* ryzen_smu_kobj_node(struct kobject* kobj) {
+    int i;
+
+    if (kobj == g_driver.drv_kobj)
+        return g_driver.primary;
+
+    // Attributes only exist while their node is registered so this always finds it.
+    for (i = 0; i < RYZEN_SMU_MAX_NODES; i++)
+        if (g_driver.nodes[i] && g_driver.nodes[i]->kobj == kobj)
+            return g_driver.nodes[i];
+
+    return NULL;
+}
+
 static ssize_t attr_store_null(struct kobject *kobj, struct kobj_attribute *attr, const char *buff, size_t count) {
     return 0;
 }
@@ -117,47 +236,213 @@ static ssize_t drv_version_show(struct kobject *kobj, struct kobj_attribute *att
 }
 
 static ssize_t version_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
-    return sprintf(buff, "%s\n", g_driver.smu_version);
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+
+    return sprintf(buff, "%s\n", node->smu_version);
 }
 
 static ssize_t mp1_if_version_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
-    return sprintf(buff, "%d\n", smu_get_mp1_if_version());
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+
+    return sprintf(buff, "%d\n", smu_get_mp1_if_version(node->smu));
 }
 
 static ssize_t codename_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
-    return sprintf(buff, "%02d\n", smu_get_codename());
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+
+    return sprintf(buff, "%02d\n", smu_get_codename(node->smu));
+}
+
+static ssize_t info_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+
+    // The PM table fields are only known once it was probed.
+    flush_work(&node->pm_work);
+
+    memcpy(buff, &node->info, sizeof(node->info));
+    return sizeof(node->info);
 }
 
 static ssize_t pm_table_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
-    if (smu_read_pm_table(g_driver.device, g_driver.pm_table, &g_driver.pm_table_read_size) != SMU_Return_OK)
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    size_t len = node->pm_table_read_size;
+
+    // Share the sampler's transfers rather than issuing another one.
+    if (node->sampler && !smu_sampler_copy_latest(node->sampler, buff))
+        return len;
+
+    if (smu_read_pm_table(node->smu, buff, &len) != SMU_Return_OK)
         return 0;
 
-    memcpy(buff, g_driver.pm_table, g_driver.pm_table_read_size);
-    return g_driver.pm_table_read_size;
+    return len;
+}
+
+static ssize_t pm_table_generation_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    struct ryzen_smu_pm_table_gen gen;
+
+    // The sampler keeps the table up to date already.
+    if (!node->sampler && smu_refresh_pm_table(node->smu, 0) != SMU_Return_OK)
+        return 0;
+
+    if (smu_get_pm_table_generation(node->smu, &gen) != SMU_Return_OK)
+        return 0;
+
+    memcpy(buff, &gen, sizeof(gen));
+    return sizeof(gen);
+}
+
+static ssize_t pm_metrics_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    int err;
+
+    err = smu_pm_metrics_get(node->pm_metrics, (struct ryzen_smu_pm_metrics *)buff, NULL);
+    if (err)
+        return err;
+
+    return sizeof(struct ryzen_smu_pm_metrics);
+}
+
+static ssize_t pm_core_metrics_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    int err;
+
+    err = smu_pm_metrics_get(node->pm_metrics, NULL, (struct ryzen_smu_pm_core *)buff);
+    if (err)
+        return err;
+
+    return smu_pm_metrics_cores(node->pm_metrics) * sizeof(struct ryzen_smu_pm_core);
+}
+
+static ssize_t ryzen_smu_refresh_policy_format(char *buff, enum smu_pm_refresh_policy policy,
+    u32 interval_us) {
+    if (policy == SMU_PM_REFRESH_INTERVAL)
+        return sprintf(buff, "%s %u\n", smu_get_pm_refresh_policy_name(policy), interval_us);
+
+    return sprintf(buff, "%s\n", smu_get_pm_refresh_policy_name(policy));
+}
+
+// Either "<policy>" or "interval <us>", the interval being kept if omitted.
+static int ryzen_smu_refresh_policy_parse(const char *buff, enum smu_pm_refresh_policy *policy,
+    u32 *interval_us) {
+    char name[16];
+    int n;
+
+    n = sscanf(buff, "%15s %u", name, interval_us);
+    if (n < 1)
+        return -EINVAL;
+
+    for (*policy = 0; *policy < SMU_PM_REFRESH_COUNT; (*policy)++)
+        if (!strcmp(name, smu_get_pm_refresh_policy_name(*policy)))
+            break;
+
+    if (*policy == SMU_PM_REFRESH_COUNT || (n > 1 && *policy != SMU_PM_REFRESH_INTERVAL))
+        return -EINVAL;
+
+    if (*interval_us > SMU_PM_REFRESH_INTERVAL_MAX_US)
+        return -EINVAL;
+
+    return 0;
+}
+
+static ssize_t pm_refresh_policy_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    enum smu_pm_refresh_policy policy;
+    u32 interval_us;
+
+    smu_get_pm_refresh_policy(node->smu, &policy, &interval_us);
+
+    return ryzen_smu_refresh_policy_format(buff, policy, interval_us);
+}
+
+static ssize_t pm_refresh_policy_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buff, size_t count) {
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    enum smu_pm_refresh_policy policy;
+    u32 interval_us;
+    int err;
+
+    smu_get_pm_refresh_policy(node->smu, &policy, &interval_us);
+
+    err = ryzen_smu_refresh_policy_parse(buff, &policy, &interval_us);
+    if (err)
+        return err;
+
+    smu_set_pm_refresh_policy(node->smu, policy, interval_us);
+    return count;
+}
+
+static ssize_t table_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
+    struct ryzen_smu_table_attrs *t = container_of(attr, struct ryzen_smu_table_attrs, data);
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    size_t len = PAGE_SIZE;
+
+    if (smu_read_table(node->smu, t->id, buff, &len) != SMU_Return_OK)
+        return 0;
+
+    return len;
+}
+
+static ssize_t table_refresh_policy_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
+    struct ryzen_smu_table_attrs *t =
+        container_of(attr, struct ryzen_smu_table_attrs, refresh_policy);
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    struct ryzen_smu_table_info info;
+
+    if (smu_get_table_info(node->smu, t->id, &info) != SMU_Return_OK)
+        return -ENODEV;
+
+    return ryzen_smu_refresh_policy_format(buff, info.refresh_policy, info.refresh_interval_us);
+}
+
+static ssize_t table_refresh_policy_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buff, size_t count) {
+    struct ryzen_smu_table_attrs *t =
+        container_of(attr, struct ryzen_smu_table_attrs, refresh_policy);
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    struct ryzen_smu_table_info info;
+    enum smu_pm_refresh_policy policy;
+    u32 interval_us;
+    int err;
+
+    if (smu_get_table_info(node->smu, t->id, &info) != SMU_Return_OK)
+        return -ENODEV;
+
+    policy = info.refresh_policy;
+    interval_us = info.refresh_interval_us;
+
+    err = ryzen_smu_refresh_policy_parse(buff, &policy, &interval_us);
+    if (err)
+        return err;
+
+    smu_set_table_refresh_policy(node->smu, t->id, policy, interval_us);
+    return count;
 }
 
 static ssize_t pm_table_version_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
-    ssize_t sz = sizeof(g_driver.pm_table_version);
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    ssize_t sz = sizeof(node->pm_table_version);
 
-    memcpy(buff, &g_driver.pm_table_version, sz);
+    memcpy(buff, &node->pm_table_version, sz);
     return sz;
 }
 
 static ssize_t pm_table_size_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
-    ssize_t sz = sizeof(g_driver.pm_table_read_size);
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    ssize_t sz = sizeof(node->pm_table_read_size);
 
-    memcpy(buff, &g_driver.pm_table_read_size, sz);
+    memcpy(buff, &node->pm_table_read_size, sz);
     return sz;
 }
 
 static ssize_t rsmu_cmd_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
-    ssize_t sz = sizeof(g_driver.smu_rsp);
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    ssize_t sz = sizeof(node->smu_rsp);
 
-    memcpy(buff, &g_driver.smu_rsp, sz);
+    memcpy(buff, &node->smu_rsp, sz);
     return sz;
 }
 
 static ssize_t rsmu_cmd_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buff, size_t count) {
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
     u32 op;
 
     // To date, there has never been a command that actually exceeds FFh
@@ -173,18 +458,20 @@ static ssize_t rsmu_cmd_store(struct kobject *kobj, struct kobj_attribute *attr,
             return 0;
     }
 
-    g_driver.smu_rsp = smu_send_command(g_driver.device, op, &g_driver.smu_args, MAILBOX_TYPE_RSMU);
+    node->smu_rsp = smu_send_command(node->smu, op, &node->smu_args, MAILBOX_TYPE_RSMU);
     return count;
 }
 
 static ssize_t mp1_smu_cmd_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
-    ssize_t sz = sizeof(g_driver.smu_rsp);
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    ssize_t sz = sizeof(node->smu_rsp);
 
-    memcpy(buff, &g_driver.smu_rsp, sz);
+    memcpy(buff, &node->smu_rsp, sz);
     return sz;
 }
 
 static ssize_t mp1_smu_cmd_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buff, size_t count) {
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
     u32 op;
 
     // To date, there has never been a command that actually exceeds FFh
@@ -200,18 +487,20 @@ static ssize_t mp1_smu_cmd_store(struct kobject *kobj, struct kobj_attribute *at
             return 0;
     }
 
-    g_driver.smu_rsp = smu_send_command(g_driver.device, op, &g_driver.smu_args, MAILBOX_TYPE_MP1);
+    node->smu_rsp = smu_send_command(node->smu, op, &node->smu_args, MAILBOX_TYPE_MP1);
     return count;
 }
 
 static ssize_t hsmp_smu_cmd_show(struct kobject* kobj, struct kobj_attribute* attr, char* buff) {
-    ssize_t sz = sizeof(g_driver.smu_rsp);
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    ssize_t sz = sizeof(node->smu_rsp);
 
-    memcpy(buff, &g_driver.smu_rsp, sz);
+    memcpy(buff, &node->smu_rsp, sz);
     return sz;
 }
 
 static ssize_t hsmp_smu_cmd_store(struct kobject* kobj, struct kobj_attribute* attr, const char* buff, size_t count) {
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
     u32 op;
 
     // To date, there has never been a command that actually exceeds FFh
@@ -227,34 +516,39 @@ static ssize_t hsmp_smu_cmd_store(struct kobject* kobj, struct kobj_attribute* a
                 return 0;
     }
 
-    g_driver.smu_rsp = smu_send_command(g_driver.device, op, &g_driver.smu_args, MAILBOX_TYPE_HSMP);
+    node->smu_rsp = smu_send_command(node->smu, op, &node->smu_args, MAILBOX_TYPE_HSMP);
     return count;
 }
 
 static ssize_t smu_args_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
-    ssize_t sz = sizeof(g_driver.smu_args);
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    ssize_t sz = sizeof(node->smu_args);
 
-    memcpy(buff, &g_driver.smu_args.args, sz);
+    memcpy(buff, &node->smu_args.args, sz);
     return sz;
 }
 
 static ssize_t smu_args_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buff, size_t count) {
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+
     if (count != sizeof(u32) * 6)
         return 0;
 
-    memcpy(g_driver.smu_args.args, buff, count);
+    memcpy(node->smu_args.args, buff, count);
     return count;
 }
 
 static ssize_t smn_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {
-    ssize_t sz = sizeof(g_driver.smn_result);
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
+    ssize_t sz = sizeof(node->smn_result);
 
-    memcpy(buff, &g_driver.smn_result, sz);
+    memcpy(buff, &node->smn_result, sz);
     return sz;
 }
 
 static ssize_t smn_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buff,
 size_t count) {
+    struct ryzen_smu_node *node = ryzen_smu_kobj_node(kobj);
     u32 address, value;
 
     switch (count) {
@@ -262,7 +556,7 @@ size_t count) {
             // One word written means we read this address at buff[0]
             address = *(u32*)buff;
 
-            if (smu_read_address(g_driver.device, address, &g_driver.smn_result) != SMU_Return_OK)
+            if (smu_read_address(node->smu, address, &node->smn_result) != SMU_Return_OK)
                 pr_debug("Failed to read SMN address 0x%x\n", address);
             break;
         case (sizeof(u32) * 2):
@@ -270,12 +564,12 @@ size_t count) {
             address = *(u32*)buff;
             value = *(u32*)(buff + sizeof(u32));
 
-            if (smu_write_address(g_driver.device, address, value) != SMU_Return_OK) {
+            if (smu_write_address(node->smu, address, value) != SMU_Return_OK) {
                 pr_debug("Failed to write SMN address 0x%x with value 0x%x\n", address, value);
-                g_driver.smn_result = SMU_Return_PCIFailed;
+                node->smn_result = SMU_Return_PCIFailed;
             }
             else
-                g_driver.smn_result = SMU_Return_OK;
+                node->smn_result = SMU_Return_OK;
             break;
         default:
             return 0;
@@ -288,10 +582,15 @@ __RO_ATTR (drv_version);
 __RO_ATTR (version);
 __RO_ATTR (mp1_if_version);
 __RO_ATTR (codename);
+__RO_ATTR (info);
 
 __RO_ATTR (pm_table);
 __RO_ATTR (pm_table_size);
+__RO_ATTR (pm_table_generation);
+__RW_ATTR (pm_refresh_policy);
 __RO_ATTR (pm_table_version);
+__RO_ATTR (pm_metrics);
+__RO_ATTR (pm_core_metrics);
 
 __RW_ATTR (rsmu_cmd);
 __RW_ATTR (mp1_smu_cmd);
@@ -300,11 +599,13 @@ __RW_ATTR (smu_args);
 
 __RW_ATTR (smn);
 
+// Template copied into every node, which then fills in the optional pointers it supports.
 static struct attribute *drv_attrs[MAX_ATTRS_LEN] = {
     &dev_attr_drv_version.attr,
     &dev_attr_version.attr,
     &dev_attr_mp1_if_version.attr,
     &dev_attr_codename.attr,
+    &dev_attr_info.attr,
 
     &dev_attr_smu_args.attr,
     &dev_attr_mp1_smu_cmd.attr,
@@ -317,23 +618,343 @@ static struct attribute *drv_attrs[MAX_ATTRS_LEN] = {
     // RSMU Optional Pointer
     NULL,
 
-    // PM Table Optional Pointers
-    NULL,
-    NULL,
-    NULL,
-
     // Termination Pointer
     NULL,
 };
 
-static struct attribute_group drv_attr_group = {
-    .attrs = drv_attrs,
+static void ryzen_smu_node_release(struct kref *ref) {
+    struct ryzen_smu_node *node = container_of(ref, struct ryzen_smu_node, ref);
+
+    if (node->pm_metrics)
+        smu_pm_metrics_destroy(node->pm_metrics);
+
+    // Stopped on removal, but open files may still ask for queues until they are closed.
+    smu_cmdq_ctx_put(node->cmdq);
+
+    smu_cleanup(node->smu);
+    pci_dev_put(node->device);
+    kfree(node);
+}
+
+static int ryzen_smu_dev_open(struct inode *inode, struct file *filp) {
+    struct ryzen_smu_chrdev *chrdev = container_of(filp->private_data, struct ryzen_smu_chrdev, misc);
+    struct ryzen_smu_node *node = chrdev->node;
+    struct ryzen_smu_file *file;
+
+    file = kzalloc(sizeof(*file), GFP_KERNEL);
+    if (!file)
+        return -ENOMEM;
+
+    // Open files keep using the SMU after the device is removed, until they are closed.
+    file->node = node;
+    kref_get(&node->ref);
+
+    // Everything below, & every ioctl, relies on the PM table having been probed.
+    flush_work(&node->pm_work);
+
+    // Readers only receive samples taken after they opened the device.
+    if (node->sampler) {
+        file->sampler = node->sampler;
+        file->sample_cursor = smu_sampler_head(file->sampler) + 1;
+        smu_sampler_get(file->sampler);
+    }
+
+    filp->private_data = file;
+    return 0;
+}
+
+static int ryzen_smu_dev_release(struct inode *inode, struct file *filp) {
+    struct ryzen_smu_file *file = filp->private_data;
+
+    if (file->sampler)
+        smu_sampler_put(file->sampler);
+
+    kref_put(&file->node->ref, ryzen_smu_node_release);
+    kfree(file);
+    return 0;
+}
+
+static ssize_t ryzen_smu_dev_read(struct file *filp, char __user *buf, size_t count, loff_t *ppos) {
+    struct ryzen_smu_file *file = filp->private_data;
+
+    if (!file->sampler)
+        return -ENODEV;
+
+    return smu_sampler_read(file->sampler, &file->sample_cursor, buf, count,
+        filp->f_flags & O_NONBLOCK);
+}
+
+static __poll_t ryzen_smu_dev_poll(struct file *filp, poll_table *wait) {
+    struct ryzen_smu_file *file = filp->private_data;
+
+    if (!file->sampler)
+        return EPOLLERR;
+
+    return smu_sampler_poll(file->sampler, filp, file->sample_cursor, wait);
+}
+
+// Maps the region of [size] bytes at [base], owned by the SMU, read-only.
+static int ryzen_smu_dev_mmap_region(struct vm_area_struct *vma, u64 base, u32 size) {
+    unsigned long len = vma->vm_end - vma->vm_start;
+
+    // Only the page(s) the table spans may be mapped and they must never become writable as the
+    //  SMU owns this memory.
+    if (len > PAGE_ALIGN(offset_in_page(base) + size))
+        return -EINVAL;
+
+    if (vma->vm_flags & VM_WRITE)
+        return -EPERM;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+    vm_flags_clear(vma, VM_MAYWRITE);
+#else
+    vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+    return remap_pfn_range(vma, vma->vm_start, base >> PAGE_SHIFT, len, vma->vm_page_prot);
+}
+
+static int ryzen_smu_dev_mmap(struct file *filp, struct vm_area_struct *vma) {
+    struct ryzen_smu_file *file = filp->private_data;
+    struct ryzen_smu_node *node = file->node;
+    unsigned long offset = vma->vm_pgoff << PAGE_SHIFT;
+    u64 base;
+    u32 size;
+    int alt;
+
+    switch (offset) {
+        case RYZEN_SMU_MMAP_PM_TABLE:
+            alt = 0;
+            break;
+        case RYZEN_SMU_MMAP_PM_TABLE_ALT:
+            alt = 1;
+            break;
+        case RYZEN_SMU_MMAP_SAMPLES:
+            if (!file->sampler)
+                return -ENODEV;
+
+            return smu_sampler_mmap(file->sampler, vma);
+        default:
+            // Every other table is selected by ID, each taking 1 MiB of offsets.
+            if (offset < RYZEN_SMU_MMAP_TABLE(0) || offset >= RYZEN_SMU_MMAP_TABLE(64) ||
+                (offset & 0xFFFFF))
+                return -EINVAL;
+
+            if (smu_get_table_region(node->smu, (offset - RYZEN_SMU_MMAP_TABLE(0)) >> 20, &base,
+                &size) != SMU_Return_OK)
+                return -ENODEV;
+
+            return ryzen_smu_dev_mmap_region(vma, base, size);
+    }
+
+    if (!node->pm_table_read_size)
+        return -ENODEV;
+
+    if (smu_get_pm_table_region(node->smu, alt, &base, &size) != SMU_Return_OK)
+        return -ENODEV;
+
+    return ryzen_smu_dev_mmap_region(vma, base, size);
+}
+
+static long ryzen_smu_dev_pm_table_info(struct ryzen_smu_node *node, void __user *argp) {
+    struct ryzen_smu_pm_table_info info = { 0 };
+    u64 base;
+    u32 size;
+
+    if (!node->pm_table_read_size ||
+        smu_get_pm_table_region(node->smu, 0, &base, &size) != SMU_Return_OK)
+        return -ENODEV;
+
+    info.version = node->pm_table_version;
+    info.size = node->pm_table_read_size;
+    info.offset = offset_in_page(base);
+    info.size_primary = size;
+
+    if (smu_get_pm_table_region(node->smu, 1, &base, &size) == SMU_Return_OK) {
+        info.offset_alt = offset_in_page(base);
+        info.size_alt = size;
+    }
+
+    return copy_to_user(argp, &info, sizeof(info)) ? -EFAULT : 0;
+}
+
+static long ryzen_smu_dev_pm_table_generation(struct ryzen_smu_node *node, void __user *argp) {
+    struct ryzen_smu_pm_table_gen gen;
+    u32 ret;
+
+    if (!node->pm_table_read_size)
+        return -ENODEV;
+
+    // The sampler keeps the table up to date already, until the device is removed.
+    if (!READ_ONCE(node->sampler)) {
+        ret = smu_refresh_pm_table(node->smu, 0);
+        if (ret != SMU_Return_OK)
+            return ret == SMU_Return_CommandTimeout ? -ETIMEDOUT : -EIO;
+    }
+
+    if (smu_get_pm_table_generation(node->smu, &gen) != SMU_Return_OK)
+        return -ENODEV;
+
+    return copy_to_user(argp, &gen, sizeof(gen)) ? -EFAULT : 0;
+}
+
+static long ryzen_smu_dev_table_list(struct ryzen_smu_node *node, void __user *argp) {
+    struct ryzen_smu_table_list list = { 0 };
+    u32 ids[RYZEN_SMU_TABLE_MAX], i, size;
+    u64 base;
+
+    list.count = min_t(u32, smu_get_table_ids(node->smu, ids, RYZEN_SMU_TABLE_MAX),
+        RYZEN_SMU_TABLE_MAX);
+
+    for (i = 0; i < list.count; i++) {
+        // Resolving the region first makes the offset valid for mapping the table.
+        smu_get_table_region(node->smu, ids[i], &base, &size);
+        smu_get_table_info(node->smu, ids[i], &list.tables[i]);
+    }
+
+    return copy_to_user(argp, &list, sizeof(list)) ? -EFAULT : 0;
+}
+
+static long ryzen_smu_dev_table_refresh(struct ryzen_smu_node *node, void __user *argp) {
+    struct ryzen_smu_table_refresh req;
+
+    if (!node->table_count)
+        return -ENODEV;
+
+    if (copy_from_user(&req, argp, sizeof(req)))
+        return -EFAULT;
+
+    req.status = smu_refresh_tables(node->smu, req.ids, req.force, &req.failed);
+
+    return copy_to_user(argp, &req, sizeof(req)) ? -EFAULT : 0;
+}
+
+static long ryzen_smu_dev_smn_batch(struct ryzen_smu_node *node, void __user *argp) {
+    struct ryzen_smu_smn_batch batch;
+    struct ryzen_smu_smn_op *ops;
+    void __user *uops;
+    size_t len;
+    long err = 0;
+
+    if (copy_from_user(&batch, argp, sizeof(batch)))
+        return -EFAULT;
+
+    if (!batch.count || batch.count > RYZEN_SMU_SMN_BATCH_MAX)
+        return -EINVAL;
+
+    uops = u64_to_user_ptr(batch.ops);
+    len = batch.count * sizeof(*ops);
+
+    ops = memdup_user(uops, len);
+    if (IS_ERR(ops))
+        return PTR_ERR(ops);
+
+    batch.failed = smu_smn_rw_batch(node->smu, ops, batch.count);
+
+    if (copy_to_user(uops, ops, len) || copy_to_user(argp, &batch, sizeof(batch)))
+        err = -EFAULT;
+
+    kfree(ops);
+    return err;
+}
+
+static long ryzen_smu_dev_smu_cmd(struct ryzen_smu_node *node, void __user *argp) {
+    struct ryzen_smu_cmd cmd;
+    smu_req_args_t args;
+
+    BUILD_BUG_ON(sizeof(cmd.args) != sizeof(args.args));
+    BUILD_BUG_ON(RYZEN_SMU_MAILBOX_RSMU != MAILBOX_TYPE_RSMU ||
+        RYZEN_SMU_MAILBOX_MP1 != MAILBOX_TYPE_MP1 || RYZEN_SMU_MAILBOX_HSMP != MAILBOX_TYPE_HSMP);
+
+    if (copy_from_user(&cmd, argp, sizeof(cmd)))
+        return -EFAULT;
+
+    if (cmd.mailbox >= MAILBOX_TYPE_COUNT)
+        return -EINVAL;
+
+    // The arguments are kept on the stack so concurrent callers can't clobber each other.
+    memcpy(args.args, cmd.args, sizeof(args.args));
+    cmd.status = smu_send_command(node->smu, cmd.op, &args, cmd.mailbox);
+    memcpy(cmd.args, args.args, sizeof(cmd.args));
+
+    return copy_to_user(argp, &cmd, sizeof(cmd)) ? -EFAULT : 0;
+}
+
+static long ryzen_smu_dev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg) {
+    struct ryzen_smu_node *node = ((struct ryzen_smu_file *)filp->private_data)->node;
+    void __user *argp = (void __user *)arg;
+    u32 status;
+
+    switch (cmd) {
+        case RYZEN_SMU_IOC_PM_TABLE_INFO:
+            return ryzen_smu_dev_pm_table_info(node, argp);
+        case RYZEN_SMU_IOC_PM_TABLE_REFRESH:
+            if (!node->pm_table_read_size)
+                return -ENODEV;
+
+            // An explicit request, which transfers the table whatever the refresh policy.
+            status = smu_refresh_pm_table(node->smu, 1);
+            return put_user(status, (u32 __user *)argp);
+        case RYZEN_SMU_IOC_SMN_BATCH:
+            return ryzen_smu_dev_smn_batch(node, argp);
+        case RYZEN_SMU_IOC_SMU_CMD:
+            return ryzen_smu_dev_smu_cmd(node, argp);
+        case RYZEN_SMU_IOC_CMDQ_CREATE:
+            return smu_cmdq_create(node->cmdq);
+        case RYZEN_SMU_IOC_PM_TABLE_GENERATION:
+            return ryzen_smu_dev_pm_table_generation(node, argp);
+        case RYZEN_SMU_IOC_INFO:
+            return copy_to_user(argp, &node->info, sizeof(node->info)) ? -EFAULT : 0;
+        case RYZEN_SMU_IOC_TABLE_LIST:
+            return ryzen_smu_dev_table_list(node, argp);
+        case RYZEN_SMU_IOC_TABLE_REFRESH:
+            return ryzen_smu_dev_table_refresh(node, argp);
+        default:
+            return -ENOTTY;
+    }
+}
+
+static const struct file_operations ryzen_smu_dev_fops = {
+    .owner          = THIS_MODULE,
+    .open           = ryzen_smu_dev_open,
+    .release        = ryzen_smu_dev_release,
+    .read           = ryzen_smu_dev_read,
+    .poll           = ryzen_smu_dev_poll,
+    .unlocked_ioctl = ryzen_smu_dev_ioctl,
+    // All ioctl arguments are fixed-size so no translation is needed.
+    .compat_ioctl   = ryzen_smu_dev_ioctl,
+    .mmap           = ryzen_smu_dev_mmap,
+    .llseek         = noop_llseek,
 };
 
-static int ryzen_smu_get_version(enum smu_mailbox mb, int show) {
+static void ryzen_smu_chrdev_register(struct ryzen_smu_chrdev *chrdev, struct ryzen_smu_node *node,
+    const char *name) {
+    strscpy(chrdev->name, name, sizeof(chrdev->name));
+
+    chrdev->node        = node;
+    chrdev->misc.minor  = MISC_DYNAMIC_MINOR;
+    chrdev->misc.name   = chrdev->name;
+    chrdev->misc.fops   = &ryzen_smu_dev_fops;
+    chrdev->misc.mode   = S_IRUSR | S_IWUSR;
+
+    // The character device is optional; sysfs remains fully functional without it.
+    if (misc_register(&chrdev->misc))
+        pr_err("Unable to register the /dev/%s character device", chrdev->name);
+    else
+        chrdev->registered = 1;
+}
+
+static void ryzen_smu_chrdev_deregister(struct ryzen_smu_chrdev *chrdev) {
+    if (chrdev->registered)
+        misc_deregister(&chrdev->misc);
+
+    chrdev->registered = 0;
+}
+
+static int ryzen_smu_get_version(struct ryzen_smu_node *node, enum smu_mailbox mb, int show) {
     u32 ver;
 
-    ver = smu_get_version(g_driver.device, mb);
+    ver = smu_get_version(node->smu, mb);
     if (ver >= 0 && ver <= 0xFF) {
         pr_err("Failed to query the %sSMU version: %d",
             mb == MAILBOX_TYPE_RSMU ? "R" : "MP1 ", ver);
@@ -342,128 +963,534 @@ static int ryzen_smu_get_version(enum smu_mailbox mb, int show) {
 
     // In case this just tests for mailbox functionality, we don't need to output anything.
     if (show) {
+        node->info.smu_version = ver;
+
         if (ver & 0xFF000000)
-            sprintf(g_driver.smu_version, "%d.%d.%d.%d",
+            sprintf(node->smu_version, "%d.%d.%d.%d",
                 (ver >> 24) & 0xff, (ver >> 16) & 0xff, (ver >> 8) & 0xff, ver & 0xff);
         else
-            sprintf(g_driver.smu_version, "%d.%d.%d", (ver >> 16) & 0xff, (ver >> 8) & 0xff, ver & 0xff);
+            sprintf(node->smu_version, "%d.%d.%d", (ver >> 16) & 0xff, (ver >> 8) & 0xff, ver & 0xff);
 
-        pr_info("SMU v%s", g_driver.smu_version);
+        pr_info("Socket %d: SMU v%s", node->socket, node->smu_version);
     }
 
     return 0;
 }
 
-static int ryzen_smu_probe(struct pci_dev *dev, const struct pci_device_id *id) {
+/**
+ * Returns the first CPU of [node]'s socket. Without a NUMA node, as with numa=off or firmware
+ *  lacking an SRAT, it is the first CPU of the package of the same index instead.
+ */
+static unsigned int ryzen_smu_get_cpu(struct ryzen_smu_node *node) {
+    int numa_node = dev_to_node(&node->device->dev);
+    unsigned int cpu;
+
+    if (numa_node != NUMA_NO_NODE) {
+        cpu = cpumask_first(cpumask_of_node(numa_node));
+        if (cpu < nr_cpu_ids)
+            return cpu;
+    }
+
+    for_each_online_cpu(cpu)
+        if (topology_physical_package_id(cpu) == node->socket)
+            return cpu;
+
+    return 0;
+}
+
+/**
+ * Returns the socket of root complex [dev] from the PCI topology alone, as amd_nb numbers its
+ *  nodes. Every socket has a data fabric at 00:18.0 onwards & one or more root complexes of the
+ *  same device ID, enumerated in order of segment & bus, so consecutive runs of them belong to
+ *  the same socket. [first] is set if [dev] is the first of its socket, the one driving it.
+ */
+static int ryzen_smu_get_socket(struct pci_dev *dev, int *first) {
+    struct pci_dev *df, *root = NULL;
+    int sockets, roots = 0, index = -1, per_socket;
+
+    for (sockets = 0; sockets < RYZEN_SMU_MAX_NODES; sockets++) {
+        df = pci_get_domain_bus_and_slot(0, 0, PCI_DEVFN(0x18 + sockets, 0));
+        if (!df)
+            break;
+
+        pci_dev_put(df);
+    }
+
+    while ((root = pci_get_device(PCI_VENDOR_ID_AMD, dev->device, root))) {
+        if (root == dev)
+            index = roots;
+        roots++;
+    }
+
+    if (index < 0)
+        return -ENODEV;
+
+    // Without a visible data fabric, as within guests, every root complex is taken as a socket.
+    per_socket = (!sockets || roots < sockets) ? 1 : roots / sockets;
+
+    *first = !(index % per_socket);
+    return index / per_socket;
+}
+
+static void ryzen_smu_setup_pm_metrics(struct ryzen_smu_node *node) {
+    const struct smu_pm_decoder *dec;
+    struct smu_pm_metrics *pm;
+
+    // Derived metrics are only offered for tables whose layout is known.
+    dec = smu_pm_decoder_find(smu_get_codename(node->smu), node->pm_table_version,
+        node->pm_table_read_size);
+    if (!dec) {
+        pr_debug("Notice: PM table version 0x%06X has no known layout, metrics are disabled",
+            node->pm_table_version);
+        return;
+    }
+
+    // The sampler keeps the table up to date already.
+    pm = smu_pm_metrics_create(node->smu, dec, node->pm_table_read_size, !node->sampler,
+        dev_to_node(&node->device->dev));
+    if (IS_ERR(pm)) {
+        pr_err("Unable to allocate the PM table metrics -- disabling feature (%ld)", PTR_ERR(pm));
+        return;
+    }
+
+    node->pm_metrics = pm;
+    node->pm_attrs[node->pm_attr_count++] = &dev_attr_pm_metrics.attr;
+    node->pm_attrs[node->pm_attr_count++] = &dev_attr_pm_core_metrics.attr;
+}
+
+static void ryzen_smu_setup_pm_table(struct ryzen_smu_node *node) {
     enum smu_return_val ret;
 
-    g_driver.device = dev;
+    // Check that PM table options are supported before adding it to the attr list
+    ret = smu_transfer_table_to_dram(node->smu);
+    if (ret != SMU_Return_OK) {
+        pr_debug("Notice: PM tables are not supported for the current platform (%d)", ret);
+        return;
+    }
 
-    pr_info("loading version: %s", THIS_MODULE->version);
+    ret = smu_get_pm_table_version(node->smu, &node->pm_table_version);
+    if (ret != SMU_Return_OK && ret != SMU_Return_Unsupported) {
+        pr_err("Unable to resolve which PM table version the system uses -- disabling "
+            "feature (%d)", ret);
+        return;
+    }
 
-    // Clamp values.
-    if (smu_timeout_attempts > SMU_RETRIES_MAX)
-        smu_timeout_attempts = SMU_RETRIES_MAX;
-    if (smu_timeout_attempts < SMU_RETRIES_MIN)
-        smu_timeout_attempts = SMU_RETRIES_MIN;
+    // The DRAM base is only requested, & the table mapped, once something first reads it.
+    node->pm_table_read_size = smu_get_pm_table_size(node->smu, node->pm_table_version);
+    if (!node->pm_table_read_size) {
+        pr_err("Unknown PM table version: 0x%08X -- disabling feature", node->pm_table_version);
+        return;
+    }
 
-    // Detect processor class & figure out MP1/RSMU support.
-    if (smu_init(g_driver.device) != 0) {
-        pr_err("Failed to initialize the SMU for use");
+    pr_debug("PM table version 0x%08X spans %ld bytes", node->pm_table_version,
+        node->pm_table_read_size);
+
+    // The files are appended without gaps, the list ending at the first NULL.
+    node->pm_attrs[node->pm_attr_count++] = &dev_attr_pm_table_size.attr;
+    node->pm_attrs[node->pm_attr_count++] = &dev_attr_pm_table.attr;
+    node->pm_attrs[node->pm_attr_count++] = &dev_attr_pm_table_generation.attr;
+    node->pm_attrs[node->pm_attr_count++] = &dev_attr_pm_refresh_policy.attr;
+
+    if (node->pm_table_version)
+        node->pm_attrs[node->pm_attr_count++] = &dev_attr_pm_table_version.attr;
+
+    if (pm_sample_interval_us) {
+        node->sampler = smu_sampler_create(node->smu, node->pm_table_read_size,
+            pm_sample_interval_us, pm_sample_slots);
+
+        if (IS_ERR(node->sampler)) {
+            pr_err("Failed to start the PM table sampler (%ld)", PTR_ERR(node->sampler));
+            node->sampler = NULL;
+        }
+    }
+
+    ryzen_smu_setup_pm_metrics(node);
+}
+
+/**
+ * Creates the files of every table other than the PM table, in a tables/ directory next to the
+ *  PM table's. Neither the SMU nor the tables are accessed until a file is first read.
+ */
+static void ryzen_smu_setup_tables(struct ryzen_smu_node *node) {
+    u32 ids[RYZEN_SMU_TABLE_MAX], i;
+    struct ryzen_smu_table_attrs *t;
+
+    node->table_count = min_t(u32, smu_get_table_ids(node->smu, ids, RYZEN_SMU_TABLE_MAX),
+        RYZEN_SMU_TABLE_MAX);
+
+    for (i = 0; i < node->table_count; i++) {
+        t = &node->tables[i];
+        t->id = ids[i];
+
+        snprintf(t->data_name, sizeof(t->data_name), "%u", t->id);
+        sysfs_attr_init(&t->data.attr);
+        t->data.attr.name = t->data_name;
+        t->data.attr.mode = S_IRUSR | S_IRGRP | S_IROTH;
+        t->data.show = table_show;
+        t->data.store = attr_store_null;
+
+        snprintf(t->refresh_policy_name, sizeof(t->refresh_policy_name), "%u_refresh_policy",
+            t->id);
+        sysfs_attr_init(&t->refresh_policy.attr);
+        t->refresh_policy.attr.name = t->refresh_policy_name;
+        t->refresh_policy.attr.mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+        t->refresh_policy.show = table_refresh_policy_show;
+        t->refresh_policy.store = table_refresh_policy_store;
+
+        node->table_attrs[i * 2] = &t->data.attr;
+        node->table_attrs[i * 2 + 1] = &t->refresh_policy.attr;
+    }
+
+    node->table_group.name = "tables";
+    node->table_group.attrs = node->table_attrs;
+
+    if (node->table_count)
+        pr_debug("Socket %d exposes %u table(s) besides the PM table", node->socket,
+            node->table_count);
+}
+
+/**
+ * Reads which CCDs & cores were fused off. Only the Zen to Zen4 fuse locations are known, the
+ *  topology is left out for anything else.
+ */
+static void ryzen_smu_read_topology(struct ryzen_smu_node *node) {
+    u32 ccd_fuses[2] = { 0x5D218, 0x5D21C }, fuses[2], core_fuse_addr, core_fuse;
+    struct ryzen_smu_info *info = &node->info;
+    u32 cpuid = cpuid_eax(0x00000001), fam, model;
+    int i;
+
+    fam = ((cpuid & 0xf00) >> 8) + ((cpuid & 0xff00000) >> 20);
+    model = ((cpuid & 0xf0000) >> 12) + ((cpuid & 0xf0) >> 4);
+
+    if (fam != 0x17 && fam != 0x19)
+        return;
+
+    if (fam == 0x17 && model != 0x71) {
+        ccd_fuses[0] += 0x40;
+        ccd_fuses[1] += 0x40;
+    }
+
+    for (i = 0; i < 2; i++)
+        if (smu_read_address(node->smu, ccd_fuses[i], &fuses[i]) != SMU_Return_OK)
+            return;
+
+    info->ccds_disabled = ((fuses[1] & 0x3F) << 2) | ((fuses[0] >> 30) & 0x3);
+    info->ccds_enabled = (fuses[0] >> 22) & 0xFF;
+
+    // The core fuses are read from the first CCD which is present.
+    if (fam == 0x19)
+        core_fuse_addr = (0x30081800 + 0x598) |
+            (((info->ccds_disabled & info->ccds_enabled) & 1) ? 0x2000000 : 0);
+    else
+        core_fuse_addr = (0x30081800 + 0x238) | ((info->ccds_enabled & 1) ? 0 : 0x2000000);
+
+    if (smu_read_address(node->smu, core_fuse_addr, &core_fuse) != SMU_Return_OK)
+        return;
+
+    info->cores_disabled = core_fuse & 0xFF;
+    info->smt_enabled = (core_fuse >> 8) & 1;
+    info->flags |= RYZEN_SMU_INFO_TOPOLOGY;
+}
+
+/**
+ * Captures everything which stays the same for as long as the driver is loaded, so that neither
+ *  userspace nor the sysfs files need to query the SMU for it again.
+ */
+static void ryzen_smu_setup_info(struct ryzen_smu_node *node) {
+    struct ryzen_smu_info *info = &node->info;
+
+    info->info_version = RYZEN_SMU_INFO_VERSION;
+    info->size = sizeof(*info);
+    strscpy(info->driver_version, THIS_MODULE->version, sizeof(info->driver_version));
+
+    info->socket = node->socket;
+    info->codename = smu_get_codename(node->smu);
+    info->mp1_if_version = smu_get_mp1_if_version(node->smu);
+
+    // The PM table fields are filled in by ryzen_smu_pm_work().
+    ryzen_smu_read_topology(node);
+}
+
+/**
+ * Registers the hwmon device & perf PMU backed by the derived metrics. Neither is essential, so
+ *  failures are only reported. The first socket's PMU takes the name of the driver.
+ */
+static void ryzen_smu_setup_telemetry(struct ryzen_smu_node *node, int primary) {
+    char name[32];
+
+    node->hwmon = smu_hwmon_register(&node->device->dev, node->pm_metrics);
+    if (IS_ERR(node->hwmon)) {
+        pr_err("Unable to register the hwmon device of socket %d (%ld)", node->socket,
+            PTR_ERR(node->hwmon));
+        node->hwmon = NULL;
+    }
+
+    if (primary)
+        snprintf(name, sizeof(name), RYZEN_SMU_DEVICE_NAME);
+    else
+        snprintf(name, sizeof(name), RYZEN_SMU_DEVICE_NAME "_node%d", node->socket);
+
+    node->pmu = smu_pmu_register(name, node->pm_metrics, ryzen_smu_get_cpu(node));
+    if (IS_ERR(node->pmu)) {
+        pr_err("Unable to register the perf PMU of socket %d (%ld)", node->socket,
+            PTR_ERR(node->pmu));
+        node->pmu = NULL;
+    }
+}
+
+/**
+ * Probes the PM table off the probe path & without nodes_lock, as it takes several SMU commands.
+ *  Its files, hwmon device & perf PMU only appear once it is done. Readers of anything else
+ *  depending on the table flush this work first.
+ */
+static void ryzen_smu_pm_work(struct work_struct *work) {
+    struct ryzen_smu_node *node = container_of(work, struct ryzen_smu_node, pm_work);
+    int primary;
+    u64 base;
+    u32 size;
+
+    ryzen_smu_setup_pm_table(node);
+    if (!node->pm_table_read_size)
+        return;
+
+    node->info.pm_table_version = node->pm_table_version;
+    node->info.pm_table_size = node->pm_table_read_size;
+
+    // Resolving the base maps nothing, the table itself still being set up on first access.
+    if (smu_get_pm_table_region(node->smu, 0, &base, &size) == SMU_Return_OK)
+        node->info.pm_table_base = base;
+
+    node->pm_group.attrs = node->pm_attrs;
+
+    mutex_lock(&nodes_lock);
+
+    if (node->kobj && sysfs_create_group(node->kobj, &node->pm_group))
+        pr_err("Unable to create the sysfs PM table attributes of socket %d", node->socket);
+
+    primary = g_driver.primary == node;
+    if (primary) {
+        if (sysfs_create_group(g_driver.drv_kobj, &node->pm_group))
+            pr_err("Unable to create the sysfs PM table attributes of socket %d", node->socket);
+        else
+            node->pm_group_root = 1;
+    }
+
+    mutex_unlock(&nodes_lock);
+
+    if (node->pm_metrics)
+        ryzen_smu_setup_telemetry(node, primary);
+}
+
+static int ryzen_smu_probe(struct pci_dev *dev, const struct pci_device_id *id) {
+    struct ryzen_smu_node *node;
+    char name[32];
+    int socket, first, rsmu, err;
+
+    // The data fabric also matches but only the root complex gives access to SMN.
+    if (!(id->driver_data & RYZEN_SMU_DEV_ROOT))
+        return -ENODEV;
+
+    socket = ryzen_smu_get_socket(dev, &first);
+    if (socket < 0 || socket >= RYZEN_SMU_MAX_NODES) {
+        pr_err("Unsupported socket %d of device %s", socket, pci_name(dev));
+        return -ENODEV;
+    }
+
+    // Any other root complex of the socket reaches the same SMU.
+    if (!first) {
+        pr_debug("Socket %d is driven through another root complex, skipping %s", socket,
+            pci_name(dev));
+        return -ENODEV;
+    }
+
+    // Only the claim is made under nodes_lock, the SMU is set up without it.
+    mutex_lock(&nodes_lock);
+
+    if (test_and_set_bit(socket, &g_driver.claimed)) {
+        mutex_unlock(&nodes_lock);
+        pr_debug("Socket %d is already driven, skipping %s", socket, pci_name(dev));
         return -ENODEV;
     }
 
+    mutex_unlock(&nodes_lock);
+
+    node = kzalloc_node(sizeof(*node), GFP_KERNEL, dev_to_node(&dev->dev));
+    if (!node) {
+        err = -ENOMEM;
+        goto BREAK_OUT;
+    }
+
+    kref_init(&node->ref);
+    node->device = pci_dev_get(dev);
+    node->socket = socket;
+    node->smu_rsp = SMU_Return_OK;
+    INIT_WORK(&node->pm_work, ryzen_smu_pm_work);
+
+    memcpy(node->attrs, drv_attrs, sizeof(node->attrs));
+    node->attr_group.attrs = node->attrs;
+
+    // Detect processor class & figure out MP1/RSMU support.
+    node->smu = smu_init(dev);
+    if (IS_ERR(node->smu)) {
+        pr_err("Failed to initialize the SMU of socket %d for use", socket);
+        err = PTR_ERR(node->smu);
+        node->smu = NULL;
+        goto ERR_FREE;
+    }
+
     // Check if MP1 is working as we guarantee this support.
-    if (ryzen_smu_get_version(MAILBOX_TYPE_MP1, 1) != 0) {
+    if (ryzen_smu_get_version(node, MAILBOX_TYPE_MP1, 1) != 0) {
         pr_err("Failed to obtain the SMU version");
-        return -EINVAL;
+        err = -EINVAL;
+        goto ERR_CLEANUP;
     }
 
     // Check if RSMU is valid to determine if to skip PM table setup.
-    if (ryzen_smu_get_version(MAILBOX_TYPE_RSMU, 0) == 0) {
-        // We do something absolutely stupid here and use relative offsets to overwrite offsets
-        //  in the drv_attrs[] array.
-        //
-        // This shouldn't *typically* cause errors unless the array structure is messed with.
-        // So, we left a warning above to not touch it.
-        drv_attrs[MAX_ATTRS_LEN - 5] = &dev_attr_rsmu_cmd.attr;
-    }
-    else {
-        pr_info("RSMU Mailbox: Disabled or not responding to commands.");
-        goto _CONTINUE_SETUP;
+    rsmu = ryzen_smu_get_version(node, MAILBOX_TYPE_RSMU, 0) == 0;
+    if (rsmu) {
+        node->attrs[MAX_ATTRS_LEN - 2] = &dev_attr_rsmu_cmd.attr;
+        ryzen_smu_setup_tables(node);
     }
+    else
+        pr_info("RSMU Mailbox: Disabled or not responding to commands.");
 
-    // Check that PM table options are supported before adding it to the attr list
-    ret = smu_transfer_table_to_dram(g_driver.device);
-    if (ret == SMU_Return_OK) {
-        ret = smu_get_pm_table_version(g_driver.device, &g_driver.pm_table_version);
-        if (ret != SMU_Return_OK && ret != SMU_Return_Unsupported) {
-            pr_err("Unable to resolve which PM table version the system uses -- disabling "
-                "feature (%d)", ret);
-            goto _CONTINUE_SETUP;
-        }
+    ryzen_smu_setup_info(node);
 
-        g_driver.pm_table = kzalloc(PM_TABLE_MAX_SIZE, GFP_KERNEL);
-        if (g_driver.pm_table == NULL) {
-            pr_err("Unable to allocate kernel buffer for PM table mapping -- disabling PM table "
-                "feature");
-            goto _CONTINUE_SETUP;
+    mutex_lock(&nodes_lock);
+
+    // Allocate the sysfs attr group with the parameters for use
+    if (!g_driver.drv_kobj) {
+        g_driver.drv_kobj = kobject_create_and_add("ryzen_smu_drv", kernel_kobj);
+        if (!g_driver.drv_kobj) {
+            mutex_unlock(&nodes_lock);
+            pr_err("Unable to create sysfs interface");
+            err = -ENOMEM;
+            goto ERR_CLEANUP;
         }
+    }
 
-        // Perform an initial fill of the data for when the device is queued, saving time
-        pr_debug("Probing the PM table for state changes");
-        ret = smu_read_pm_table(dev, g_driver.pm_table, &g_driver.pm_table_read_size);
-        if (ret == SMU_Return_OK) {
-            pr_debug("Probe succeeded: read %ld bytes", g_driver.pm_table_read_size);
+    // Published before any attribute of the node can be reached.
+    g_driver.nodes[socket] = node;
+    pci_set_drvdata(dev, node);
 
-            drv_attrs[MAX_ATTRS_LEN - 4] = &dev_attr_pm_table_size.attr;
-            drv_attrs[MAX_ATTRS_LEN - 3] = &dev_attr_pm_table.attr;
+    snprintf(name, sizeof(name), "node%d", socket);
 
-            if (g_driver.pm_table_version)
-                drv_attrs[MAX_ATTRS_LEN - 2] = &dev_attr_pm_table_version.attr;
-        }
-        else
-            pr_err("Failed to probe the PM table -- disabling feature (%d)", ret);
+    node->kobj = kobject_create_and_add(name, g_driver.drv_kobj);
+    if (node->kobj && sysfs_create_group(node->kobj, &node->attr_group)) {
+        kobject_put(node->kobj);
+        node->kobj = NULL;
     }
-    else {
-        pr_debug("Notice: PM tables are not supported for the current platform (%d)", ret);
+
+    if (node->kobj && node->table_count && sysfs_create_group(node->kobj, &node->table_group))
+        pr_err("Unable to create the sysfs table attributes of socket %d", socket);
+
+    // Without workers, creating command queues simply fails.
+    node->cmdq = smu_cmdq_init(node->smu);
+    if (IS_ERR(node->cmdq)) {
+        pr_err("Unable to start the asynchronous command queue workers");
+        node->cmdq = NULL;
     }
 
-_CONTINUE_SETUP:
-    // Allocate the sysfs attr group with the parameters for use
-    g_driver.drv_kobj = kobject_create_and_add("ryzen_smu_drv", kernel_kobj);
-    if (!g_driver.drv_kobj) {
-        pr_err("Unable to create sysfs interface");
-        return -ENOMEM;
+    snprintf(name, sizeof(name), RYZEN_SMU_DEVICE_NAME "_node%d", socket);
+    ryzen_smu_chrdev_register(&node->chrdev, node, name);
+
+    // Diagnostics only, debugfs failures are not fatal and need not be checked.
+    if (!g_driver.debugfs_dir)
+        g_driver.debugfs_dir = debugfs_create_dir(RYZEN_SMU_DEVICE_NAME, NULL);
+
+    snprintf(name, sizeof(name), "node%d", socket);
+    node->debugfs_dir = debugfs_create_dir(name, g_driver.debugfs_dir);
+    smu_stats_debugfs_init(smu_get_stats(node->smu), node->debugfs_dir);
+
+    // The first socket also takes the paths used before multiple sockets were supported.
+    if (!g_driver.primary) {
+        g_driver.primary = node;
+
+        if (sysfs_create_group(g_driver.drv_kobj, &node->attr_group))
+            pr_err("Unable to create the sysfs attributes of socket %d", socket);
+
+        if (node->table_count && sysfs_create_group(g_driver.drv_kobj, &node->table_group))
+            pr_err("Unable to create the sysfs table attributes of socket %d", socket);
+
+        ryzen_smu_chrdev_register(&g_driver.chrdev, node, RYZEN_SMU_DEVICE_NAME);
     }
 
-    if (sysfs_create_group(g_driver.drv_kobj, &drv_attr_group))
-        kobject_put(g_driver.drv_kobj);
+    mutex_unlock(&nodes_lock);
+
+    if (rsmu)
+        schedule_work(&node->pm_work);
 
     return 0;
+
+ERR_CLEANUP:
+    smu_cleanup(node->smu);
+ERR_FREE:
+    pci_dev_put(node->device);
+    kfree(node);
+BREAK_OUT:
+    mutex_lock(&nodes_lock);
+    clear_bit(socket, &g_driver.claimed);
+    mutex_unlock(&nodes_lock);
+    return err;
 }
 
 static void ryzen_smu_remove(struct pci_dev *dev) {
-    // Free allocated resources as well as the SMU
-    if (g_driver.pm_table)
-        kfree(g_driver.pm_table);
+    struct ryzen_smu_node *node = pci_get_drvdata(dev);
 
-    if (g_driver.drv_kobj)
-        kobject_put(g_driver.drv_kobj);
+    cancel_work_sync(&node->pm_work);
+
+    mutex_lock(&nodes_lock);
+
+    if (g_driver.primary == node) {
+        ryzen_smu_chrdev_deregister(&g_driver.chrdev);
+        sysfs_remove_group(g_driver.drv_kobj, &node->attr_group);
+        if (node->table_count)
+            sysfs_remove_group(g_driver.drv_kobj, &node->table_group);
+        if (node->pm_group_root)
+            sysfs_remove_group(g_driver.drv_kobj, &node->pm_group);
+        g_driver.primary = NULL;
+    }
+
+    g_driver.nodes[node->socket] = NULL;
+    clear_bit(node->socket, &g_driver.claimed);
+
+    mutex_unlock(&nodes_lock);
+
+    debugfs_remove_recursive(node->debugfs_dir);
+    ryzen_smu_chrdev_deregister(&node->chrdev);
+
+    smu_cmdq_exit(node->cmdq);
+
+    if (node->pmu)
+        smu_pmu_unregister(node->pmu);
 
-    smu_cleanup();
+    if (node->hwmon)
+        smu_hwmon_unregister(node->hwmon);
+
+    // Removing the files waits for their readers, which may be using the sampler.
+    if (node->kobj)
+        kobject_put(node->kobj);
+
+    // Open files hold their own reference to the ring, but the table is no longer refreshed.
+    if (node->sampler) {
+        smu_sampler_destroy(node->sampler);
+        WRITE_ONCE(node->sampler, NULL);
+    }
+
+    // Open files hold their own reference, the SMU is freed with the last one.
+    kref_put(&node->ref, ryzen_smu_node_release);
 }
 
 static struct pci_device_id ryzen_smu_id_table[] = {
-    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_17H_ROOT) },
-    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_17H_M10H_ROOT) },
-    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_17H_M30H_ROOT) },
-    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_17H_M60H_ROOT) },
+    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_17H_ROOT), .driver_data = RYZEN_SMU_DEV_ROOT },
+    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_17H_M10H_ROOT), .driver_data = RYZEN_SMU_DEV_ROOT },
+    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_17H_M30H_ROOT), .driver_data = RYZEN_SMU_DEV_ROOT },
+    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_17H_M60H_ROOT), .driver_data = RYZEN_SMU_DEV_ROOT },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_1AH_M00H_DF_F4) },
-    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_1AH_M00H_ROOT) },
-    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_1AH_M20H_ROOT) },
+    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_1AH_M00H_ROOT), .driver_data = RYZEN_SMU_DEV_ROOT },
+    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_1AH_M20H_ROOT), .driver_data = RYZEN_SMU_DEV_ROOT },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_1AH_M60H_DF_F4) },
-    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_1AH_M60H_ROOT) },
+    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_1AH_M60H_ROOT), .driver_data = RYZEN_SMU_DEV_ROOT },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_1AH_M70H_DF_F4) },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_17H_DF_F4) },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_17H_M10H_DF_F4) },
@@ -471,22 +1498,22 @@ static struct pci_device_id ryzen_smu_id_table[] = {
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_17H_M60H_DF_F4) },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_17H_M70H_DF_F4) },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_17H_MA0H_DF_F4) },
-    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_17H_MA0H_ROOT) },
+    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_17H_MA0H_ROOT), .driver_data = RYZEN_SMU_DEV_ROOT },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_19H_DF_F4) },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_19H_M10H_DF_F4) },
-    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_19H_M10H_ROOT) },
+    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_19H_M10H_ROOT), .driver_data = RYZEN_SMU_DEV_ROOT },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_19H_M40H_DF_F4) },
-    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_19H_M40H_ROOT) },
+    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_19H_M40H_ROOT), .driver_data = RYZEN_SMU_DEV_ROOT },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_19H_M50H_DF_F4) },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_19H_M60H_DF_F4) },
-    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_19H_M60H_ROOT) },
+    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_19H_M60H_ROOT), .driver_data = RYZEN_SMU_DEV_ROOT },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_19H_M70H_DF_F4) },
-    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_19H_M70H_ROOT) },
+    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_19H_M70H_ROOT), .driver_data = RYZEN_SMU_DEV_ROOT },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_19H_M78H_DF_F4) },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_MI200_DF_F4) },
-    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_MI200_ROOT) },
+    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_MI200_ROOT), .driver_data = RYZEN_SMU_DEV_ROOT },
     { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_MI300_DF_F4) },
-    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_MI300_ROOT) },
+    { PCI_DEVICE(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_MI300_ROOT), .driver_data = RYZEN_SMU_DEV_ROOT },
     { }
 };
 MODULE_DEVICE_TABLE(pci, ryzen_smu_id_table);
@@ -496,9 +1523,35 @@ static struct pci_driver ryzen_smu_driver = {
     .remove = ryzen_smu_remove,
     .probe = ryzen_smu_probe,
     .name = KBUILD_MODNAME,
+    // Probing waits on several SMU commands per socket, which needn't hold up loading the module.
+    .driver = {
+        .probe_type = PROBE_PREFER_ASYNCHRONOUS,
+    },
 };
 
 static int __init ryzen_smu_driver_init(void) {
+    pr_info("loading version: %s", THIS_MODULE->version);
+
+    // Clamp values.
+    if (smu_timeout_attempts > SMU_RETRIES_MAX)
+        smu_timeout_attempts = SMU_RETRIES_MAX;
+    if (smu_timeout_attempts < SMU_RETRIES_MIN)
+        smu_timeout_attempts = SMU_RETRIES_MIN;
+
+    if (pm_refresh_policy >= SMU_PM_REFRESH_COUNT)
+        pm_refresh_policy = SMU_PM_REFRESH_INTERVAL;
+    if (pm_refresh_interval_us > SMU_PM_REFRESH_INTERVAL_MAX_US)
+        pm_refresh_interval_us = SMU_PM_REFRESH_INTERVAL_MAX_US;
+
+    if (pm_sample_interval_us && pm_sample_interval_us < SMU_SAMPLER_INTERVAL_MIN_US)
+        pm_sample_interval_us = SMU_SAMPLER_INTERVAL_MIN_US;
+    if (pm_sample_interval_us > SMU_SAMPLER_INTERVAL_MAX_US)
+        pm_sample_interval_us = SMU_SAMPLER_INTERVAL_MAX_US;
+    if (pm_sample_slots < SMU_SAMPLER_SLOTS_MIN)
+        pm_sample_slots = SMU_SAMPLER_SLOTS_MIN;
+    if (pm_sample_slots > SMU_SAMPLER_SLOTS_MAX)
+        pm_sample_slots = SMU_SAMPLER_SLOTS_MAX;
+
     // By default the driver will not be used to communicate with the
     //  northbridge so we forcefully tell the system to use it.
     if (pci_register_driver(&ryzen_smu_driver) < 0) {
@@ -511,6 +1564,12 @@ static int __init ryzen_smu_driver_init(void) {
 
 static void ryzen_smu_driver_exit(void) {
     pci_unregister_driver(&ryzen_smu_driver);
+
+    // Shared by all nodes, so only removed once every one of them is gone.
+    debugfs_remove_recursive(g_driver.debugfs_dir);
+
+    if (g_driver.drv_kobj)
+        kobject_put(g_driver.drv_kobj);
 }
 
 module_init(ryzen_smu_driver_init);
@@ -518,3 +1577,18 @@ module_exit(ryzen_smu_driver_exit);
 
 module_param(smu_timeout_attempts, uint, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
 MODULE_PARM_DESC(smu_timeout_attempts, "When executing an SMU command, the driver will retry this many times before considering a command to have timed out. Default: 8192");
+
+module_param(pm_refresh_policy, uint, S_IRUSR | S_IRGRP | S_IROTH);
+MODULE_PARM_DESC(pm_refresh_policy, "Determines when reading the PM table requests a new one from the SMU. 0: At most once per pm_refresh_interval_us, 1: On every read, 2: Only on explicit refresh requests. Default: 0");
+
+module_param(pm_refresh_interval_us, uint, S_IRUSR | S_IRGRP | S_IROTH);
+MODULE_PARM_DESC(pm_refresh_interval_us, "Minimum interval, in microseconds, between PM table transfers caused by reads. Default: 1000");
+
+module_param(pm_idle_timeout_ms, uint, S_IRUSR | S_IRGRP | S_IROTH);
+MODULE_PARM_DESC(pm_idle_timeout_ms, "When non-zero, the PM table is unmapped & its copies freed once it hasn't been read for this many milliseconds, being set up again by the next read. Default: 0 (Disabled)");
+
+module_param(pm_sample_interval_us, uint, S_IRUSR | S_IRGRP | S_IROTH);
+MODULE_PARM_DESC(pm_sample_interval_us, "When non-zero, the driver refreshes the PM table every this many microseconds into a ring buffer readable from /dev/ryzen_smu. Default: 0 (Disabled)");
+
+module_param(pm_sample_slots, uint, S_IRUSR | S_IRGRP | S_IROTH);
+MODULE_PARM_DESC(pm_sample_slots, "Number of PM table samples kept in the ring buffer. Default: 64");
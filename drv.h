@@ -0,0 +1,316 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com> */
+/* Ryzen SMU Command Driver Character Device Interface */
+
+#ifndef __DRV_H__
+#define __DRV_H__
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/**
+ * Userspace interface of the /dev/ryzen_smu character device.
+ *
+ * N.B. These definitions are mirrored by the userspace library and must be kept compatible.
+ */
+
+/* Name of the character device as found under /dev. */
+#define RYZEN_SMU_DEVICE_NAME                         "ryzen_smu"
+
+/**
+ * mmap() offsets, in bytes, selecting which region is mapped.
+ *
+ * The PM tables are mapped read-only and start at the byte offset within the first page indicated
+ *  by struct ryzen_smu_pm_table_info.
+ */
+#define RYZEN_SMU_MMAP_PM_TABLE                       0x00000000
+#define RYZEN_SMU_MMAP_PM_TABLE_ALT                   0x00100000
+#define RYZEN_SMU_MMAP_SAMPLES                        0x00200000
+
+/* The table with ID [id], as listed by RYZEN_SMU_IOC_TABLE_LIST. */
+#define RYZEN_SMU_MMAP_TABLE(id)                      (0x01000000 + ((id) << 20))
+
+/**
+ * Describes the layout of the PM table(s) when mapped via mmap().
+ */
+struct ryzen_smu_pm_table_info {
+    __u32 version;
+    // Total size of the table in bytes, including the secondary table if present.
+    __u32 size;
+
+    // Byte offset of the primary table in the RYZEN_SMU_MMAP_PM_TABLE mapping & its size.
+    __u32 offset;
+    __u32 size_primary;
+
+    // Byte offset of the secondary table in the RYZEN_SMU_MMAP_PM_TABLE_ALT mapping & its size.
+    // Only present on Picasso/RavenRidge 2, zero otherwise.
+    __u32 offset_alt;
+    __u32 size_alt;
+};
+
+/**
+ * Header of the PM table sample ring, found at the start of the RYZEN_SMU_MMAP_SAMPLES mapping,
+ *  when the periodic sampler is enabled.
+ *
+ * Samples are numbered from 1 onwards and sample N is stored in slot (N - 1) % slot_count.
+ * A slot's seq becomes zero while it is being rewritten and is set to the sample number once it
+ *  is complete, so a reader copying a slot must check seq is unchanged afterwards.
+ */
+struct ryzen_smu_sample_ring {
+    __u32 slot_count;
+    __u32 slot_size;
+    // Offset of the first slot from the start of the mapping.
+    __u32 slots_offset;
+    __u32 table_size;
+    __u64 interval_ns;
+
+    // Number of the most recently completed sample, zero if none were taken yet.
+    __u64 head;
+    // Sampling periods which elapsed without a sample being started.
+    __u64 missed;
+    // Samples which were discarded as the table transfer failed.
+    __u64 failed;
+};
+
+/**
+ * A single PM table sample, as stored in a ring slot or returned by read().
+ * Each read() record is sizeof(struct ryzen_smu_sample) + table_size bytes long.
+ */
+struct ryzen_smu_sample {
+    __u64 seq;
+    // CLOCK_MONOTONIC time at which the SMU completed the table transfer.
+    __u64 timestamp_ns;
+    // Time spent waiting for the transfer to complete.
+    __u32 duration_ns;
+    __u32 size;
+    __u8  data[];
+};
+
+/* Operations performed by an entry of a RYZEN_SMU_IOC_SMN_BATCH request. */
+#define RYZEN_SMU_SMN_OP_READ                         0
+#define RYZEN_SMU_SMN_OP_WRITE                        1
+
+/* Maximum amount of entries a single RYZEN_SMU_IOC_SMN_BATCH request may contain. */
+#define RYZEN_SMU_SMN_BATCH_MAX                       1024
+
+/**
+ * A single SMN access. For reads, [value] receives the register contents and for writes it holds
+ *  the value to write. [status] receives the resulting smu_return_val.
+ */
+struct ryzen_smu_smn_op {
+    __u32 address;
+    __u32 value;
+    __u32 op;
+    __u32 status;
+};
+
+/**
+ * Executes [count] SMN accesses pointed to by [ops], in order, without any other SMN access
+ *  taking place in between. [failed] receives the number of entries whose status is not OK.
+ */
+struct ryzen_smu_smn_batch {
+    __u64 ops;
+    __u32 count;
+    __u32 failed;
+};
+
+/* Mailboxes an SMU command may be sent to. */
+#define RYZEN_SMU_MAILBOX_RSMU                        0
+#define RYZEN_SMU_MAILBOX_MP1                         1
+#define RYZEN_SMU_MAILBOX_HSMP                        2
+
+/**
+ * An SMU command sent to [mailbox]. The arguments are replaced by those returned by the SMU once
+ *  the command completes and [status] receives the resulting smu_return_val.
+ */
+struct ryzen_smu_cmd {
+    __u32 mailbox;
+    __u32 op;
+    __u32 status;
+    __u32 args[6];
+};
+
+/* Maximum amount of commands a queue may have submitted but not yet read back. */
+#define RYZEN_SMU_CMDQ_DEPTH                          256
+
+/**
+ * A command submitted to, and completed by, a queue created with RYZEN_SMU_IOC_CMDQ_CREATE.
+ *
+ * Commands are submitted by write()-ing an array of these to the queue and are executed in order
+ *  for every mailbox. Completions are read() back, in order of completion, with [cookie] left
+ *  untouched and the status and arguments of [cmd] filled in.
+ */
+struct ryzen_smu_cmd_async {
+    __u64 cookie;
+    struct ryzen_smu_cmd cmd;
+    __u32 reserved;
+};
+
+/* Granularity, in bytes, at which changes to the PM table are tracked. */
+#define RYZEN_SMU_PM_TABLE_LINE_SIZE                  64
+
+/* Words of the dirty bitmap, enough to cover tables of up to 16 KiB. */
+#define RYZEN_SMU_PM_TABLE_DIRTY_WORDS                4
+
+/**
+ * Change tracking state of the PM table.
+ *
+ * [generation] is incremented by every table transfer which changed its contents and is zero until
+ *  the table is first transferred. Bit N of [dirty] (bit N % 64 of word N / 64) is set if bytes
+ *  [N * 64, N * 64 + 63] of the table changed in the transfer which produced [generation], so a
+ *  consumer whose copy is exactly one generation old only needs to refresh those.
+ */
+struct ryzen_smu_pm_table_gen {
+    __u64 generation;
+    __u64 dirty[RYZEN_SMU_PM_TABLE_DIRTY_WORDS];
+};
+
+/**
+ * Metrics derived from the PM table, returned by the binary pm_metrics sysfs file on processors
+ *  whose table layout the driver knows. They are computed once per table transfer which changed
+ *  the table, [generation] being that of struct ryzen_smu_pm_table_gen.
+ */
+struct ryzen_smu_pm_metrics {
+    __u64 generation;
+    __u32 package_power_mw;
+    // Average voltage of the cores which are not power gated.
+    __u32 core_voltage_uv;
+    __s32 temperature_mc;
+    __u32 peak_freq_mhz;
+    // Cores which spent at least 6% of the last interval in C0, out of [core_count].
+    __u16 active_cores;
+    __u16 core_count;
+    __u32 reserved;
+};
+
+/**
+ * Metrics of a single core, an array of [core_count] of which is returned by the binary
+ *  pm_core_metrics sysfs file. Gated cores report a voltage of zero.
+ */
+struct ryzen_smu_pm_core {
+    __u32 freq_eff_mhz;
+    __u32 voltage_uv;
+    __u32 power_mw;
+    // Residencies in hundredths of a percent.
+    __u16 c0;
+    __u16 cc6;
+};
+
+/**
+ * Revision of struct ryzen_smu_info. Fields are only ever appended, each bumping it. Revision 2
+ *  fills in pm_table_base, which was always zero before.
+ */
+#define RYZEN_SMU_INFO_VERSION                        2
+
+/* Set in ryzen_smu_info.flags if the topology fields were read from the fuses. */
+#define RYZEN_SMU_INFO_TOPOLOGY                       (1 << 0)
+
+/**
+ * Static metadata of a socket's SMU & firmware, captured once at probe so that it need not be
+ *  queried again. Returned by the binary info sysfs file & RYZEN_SMU_IOC_INFO.
+ *
+ * [size] is the amount of valid bytes, which may be less than sizeof() with older drivers.
+ */
+struct ryzen_smu_info {
+    __u32 info_version;
+    __u32 size;
+    char  driver_version[16];
+
+    __u32 socket;
+    __u32 codename;
+    __u32 mp1_if_version;
+    // Raw version as returned by the MP1 mailbox, either 3 or 4 bytes wide.
+    __u32 smu_version;
+
+    // All zero if PM tables are unsupported.
+    __u32 pm_table_version;
+    __u32 pm_table_size;
+    // Physical address of the primary table, resolved along with its version.
+    __u64 pm_table_base;
+
+    __u32 flags;
+    // Bitmaps of the CCDs present & disabled, and of the cores disabled within each CCD.
+    __u32 ccds_enabled;
+    __u32 ccds_disabled;
+    __u32 cores_disabled;
+    __u32 smt_enabled;
+    __u32 reserved;
+};
+
+/* Maximum amount of tables, other than the PM table, a socket may expose. IDs are below 64. */
+#define RYZEN_SMU_TABLE_MAX                           8
+
+/* Set in ryzen_smu_table_info.flags if the table is also appended to the PM table. */
+#define RYZEN_SMU_TABLE_PM_APPENDED                   (1 << 0)
+
+/**
+ * A table other than the PM table, which the SMU transfers to its own DRAM region when its ID is
+ *  passed to TransferTableSmu2Dram. Each has its own refresh policy, as for the PM table, and its
+ *  [generation] is incremented by every transfer which changed it.
+ *
+ * [offset] is the byte offset of the table within its RYZEN_SMU_MMAP_TABLE() mapping.
+ */
+struct ryzen_smu_table_info {
+    __u32 id;
+    __u32 size;
+    __u32 offset;
+    __u32 flags;
+    __u32 refresh_policy;
+    __u32 refresh_interval_us;
+    __u64 generation;
+};
+
+struct ryzen_smu_table_list {
+    __u32 count;
+    __u32 reserved;
+    struct ryzen_smu_table_info tables[RYZEN_SMU_TABLE_MAX];
+};
+
+/**
+ * Transfers every table whose bit is set in [ids] (bit N selecting ID N) in a single mailbox
+ *  session. Unless [force] is set, tables are subject to their own refresh policy. [failed]
+ *  receives the bits of the tables which couldn't be transferred & [status] the first error.
+ */
+struct ryzen_smu_table_refresh {
+    __u64 ids;
+    __u64 failed;
+    __u32 force;
+    __u32 status;
+};
+
+#define RYZEN_SMU_IOC_MAGIC                           0xE5
+
+/* Retrieves the PM table mapping layout. */
+#define RYZEN_SMU_IOC_PM_TABLE_INFO                   _IOR(RYZEN_SMU_IOC_MAGIC, 0x01, struct ryzen_smu_pm_table_info)
+
+/**
+ * Requests the SMU to update the PM table in DRAM regardless of the refresh policy, storing the
+ *  resulting smu_return_val.
+ */
+#define RYZEN_SMU_IOC_PM_TABLE_REFRESH                _IOR(RYZEN_SMU_IOC_MAGIC, 0x02, __u32)
+
+/* Performs a batch of SMN register reads and writes. */
+#define RYZEN_SMU_IOC_SMN_BATCH                       _IOWR(RYZEN_SMU_IOC_MAGIC, 0x03, struct ryzen_smu_smn_batch)
+
+/* Executes an SMU command, independently of the smu_args & *_smu_cmd sysfs files. */
+#define RYZEN_SMU_IOC_SMU_CMD                         _IOWR(RYZEN_SMU_IOC_MAGIC, 0x04, struct ryzen_smu_cmd)
+
+/* Creates an asynchronous command queue, returning a new file descriptor to it. */
+#define RYZEN_SMU_IOC_CMDQ_CREATE                     _IO(RYZEN_SMU_IOC_MAGIC, 0x05)
+
+/**
+ * Requests a PM table update, subject to the same refresh policy as reading pm_table, and
+ *  retrieves its change tracking state without copying the table itself.
+ */
+#define RYZEN_SMU_IOC_PM_TABLE_GENERATION             _IOR(RYZEN_SMU_IOC_MAGIC, 0x06, struct ryzen_smu_pm_table_gen)
+
+/* Retrieves the metadata captured at probe. */
+#define RYZEN_SMU_IOC_INFO                            _IOR(RYZEN_SMU_IOC_MAGIC, 0x07, struct ryzen_smu_info)
+
+/* Lists the tables other than the PM table, resolving their DRAM regions. */
+#define RYZEN_SMU_IOC_TABLE_LIST                      _IOR(RYZEN_SMU_IOC_MAGIC, 0x08, struct ryzen_smu_table_list)
+
+/* Transfers a set of tables other than the PM table. */
+#define RYZEN_SMU_IOC_TABLE_REFRESH                   _IOWR(RYZEN_SMU_IOC_MAGIC, 0x09, struct ryzen_smu_table_refresh)
+
+#endif /* __DRV_H__ */
@@ -0,0 +1,138 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com> */
+/* Ryzen SMU Hardware Monitoring */
+
+#include <linux/err.h>
+#include <linux/hwmon.h>
+#include <linux/slab.h>
+
+#include "pm_metrics.h"
+#include "hwmon.h"
+
+struct smu_hwmon {
+    struct device*          dev;
+    struct smu_pm_metrics*  pm;
+};
+
+// Channel info is spelled out, as HWMON_CHANNEL_INFO() isn't available on every kernel supported.
+static const u32 smu_hwmon_power_config[] = { HWMON_P_INPUT | HWMON_P_LABEL, 0 };
+static const u32 smu_hwmon_energy_config[] = { HWMON_E_INPUT | HWMON_E_LABEL, 0 };
+static const u32 smu_hwmon_in_config[] = { HWMON_I_INPUT | HWMON_I_LABEL, 0 };
+static const u32 smu_hwmon_temp_config[] = { HWMON_T_INPUT | HWMON_T_LABEL, 0 };
+
+static const struct hwmon_channel_info smu_hwmon_power = {
+    .type   = hwmon_power,
+    .config = smu_hwmon_power_config,
+};
+
+static const struct hwmon_channel_info smu_hwmon_energy = {
+    .type   = hwmon_energy,
+    .config = smu_hwmon_energy_config,
+};
+
+static const struct hwmon_channel_info smu_hwmon_in = {
+    .type   = hwmon_in,
+    .config = smu_hwmon_in_config,
+};
+
+static const struct hwmon_channel_info smu_hwmon_temp = {
+    .type   = hwmon_temp,
+    .config = smu_hwmon_temp_config,
+};
+
+static const struct hwmon_channel_info* const smu_hwmon_info[] = {
+    &smu_hwmon_power,
+    &smu_hwmon_energy,
+    &smu_hwmon_in,
+    &smu_hwmon_temp,
+    NULL,
+};
+
+static umode_t smu_hwmon_is_visible(const void* data, enum hwmon_sensor_types type, u32 attr,
+    int channel) {
+    return 0444;
+}
+
+static int smu_hwmon_read(struct device* dev, enum hwmon_sensor_types type, u32 attr, int channel,
+    long* val) {
+    struct smu_hwmon* hw = dev_get_drvdata(dev);
+    struct ryzen_smu_pm_metrics m;
+    struct smu_pm_counters c;
+    int err;
+
+    err = smu_pm_metrics_get(hw->pm, &m, NULL);
+    if (err)
+        return err;
+
+    switch (type) {
+        case hwmon_power:
+            *val = (long)m.package_power_mw * 1000;
+            break;
+        case hwmon_energy:
+            smu_pm_metrics_counters(hw->pm, &c);
+            *val = c.package_energy_uj;
+            break;
+        case hwmon_in:
+            *val = m.core_voltage_uv / 1000;
+            break;
+        case hwmon_temp:
+            *val = m.temperature_mc;
+            break;
+        default:
+            return -EOPNOTSUPP;
+    }
+
+    return 0;
+}
+
+static int smu_hwmon_read_string(struct device* dev, enum hwmon_sensor_types type, u32 attr,
+    int channel, const char** str) {
+    switch (type) {
+        case hwmon_in:
+            *str = "Vcore";
+            break;
+        default:
+            *str = "Package";
+            break;
+    }
+
+    return 0;
+}
+
+static const struct hwmon_ops smu_hwmon_ops = {
+    .is_visible     = smu_hwmon_is_visible,
+    .read           = smu_hwmon_read,
+    .read_string    = smu_hwmon_read_string,
+};
+
+static const struct hwmon_chip_info smu_hwmon_chip = {
+    .ops    = &smu_hwmon_ops,
+    .info   = (const struct hwmon_channel_info**)smu_hwmon_info,
+};
+
+struct smu_hwmon* smu_hwmon_register(struct device* parent, struct smu_pm_metrics* pm) {
+    struct smu_hwmon* hw;
+    struct device* dev;
+
+    hw = kzalloc(sizeof(*hw), GFP_KERNEL);
+    if (!hw)
+        return ERR_PTR(-ENOMEM);
+
+    hw->pm = pm;
+
+    // Not device managed, as devres is only released once the node & its metrics may be gone.
+    dev = hwmon_device_register_with_info(parent, "ryzen_smu", hw, &smu_hwmon_chip, NULL);
+    if (IS_ERR(dev)) {
+        kfree(hw);
+        return ERR_CAST(dev);
+    }
+
+    hw->dev = dev;
+
+    return hw;
+}
+
+void smu_hwmon_unregister(struct smu_hwmon* hw) {
+    hwmon_device_unregister(hw->dev);
+    kfree(hw);
+}
@@ -0,0 +1,23 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com> */
+/* Ryzen SMU Hardware Monitoring */
+
+#ifndef __HWMON_H__
+#define __HWMON_H__
+
+#include <linux/device.h>
+
+#include "pm_metrics.h"
+
+struct smu_hwmon;
+
+/**
+ * Registers a hwmon device under [parent] whose sensors are backed by [pm], reading them being
+ *  subject to the PM table refresh policy. [pm] must outlive the device.
+ *
+ * Returns an ERR_PTR() on failure.
+ */
+struct smu_hwmon* smu_hwmon_register(struct device* parent, struct smu_pm_metrics* pm);
+void smu_hwmon_unregister(struct smu_hwmon* hw);
+
+#endif /* __HWMON_H__ */
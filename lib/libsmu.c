@@ -17,11 +17,20 @@
  **/
 
 #include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <cpuid.h>
 
 #include "libsmu.h"
+#include "pm_tables.h"
 
 #define DRIVER_CLASS_PATH               "/sys/kernel/ryzen_smu_drv/"
 
@@ -29,6 +38,7 @@
 #define VERSION_PATH                    DRIVER_CLASS_PATH "version"
 #define IF_VERSION_PATH                 DRIVER_CLASS_PATH "mp1_if_version"
 #define CODENAME_PATH                   DRIVER_CLASS_PATH "codename"
+#define INFO_PATH                       DRIVER_CLASS_PATH "info"
 
 #define SMN_PATH                        DRIVER_CLASS_PATH "smn"
 #define SMU_ARG_PATH                    DRIVER_CLASS_PATH "smu_args"
@@ -40,6 +50,85 @@
 #define PM_SIZE_PATH                    DRIVER_CLASS_PATH "pm_table_size"
 #define PM_PATH                         DRIVER_CLASS_PATH "pm_table"
 
+#define DEVICE_PATH                     "/dev/ryzen_smu"
+
+/* Mirrors the character device interface defined by the driver in drv.h. */
+#define RYZEN_SMU_MMAP_PM_TABLE         0x00000000
+#define RYZEN_SMU_MMAP_PM_TABLE_ALT     0x00100000
+
+struct ryzen_smu_pm_table_info {
+    unsigned int                version;
+    unsigned int                size;
+    unsigned int                offset;
+    unsigned int                size_primary;
+    unsigned int                offset_alt;
+    unsigned int                size_alt;
+};
+
+/* smu_smn_op_t matches the layout of struct ryzen_smu_smn_op. */
+#define RYZEN_SMU_SMN_BATCH_MAX         1024
+
+struct ryzen_smu_smn_batch {
+    unsigned long long          ops;
+    unsigned int                count;
+    unsigned int                failed;
+};
+
+/* Mailbox numbers match enum smu_mailbox. */
+struct ryzen_smu_cmd {
+    unsigned int                mailbox;
+    unsigned int                op;
+    unsigned int                status;
+    unsigned int                args[6];
+};
+
+struct ryzen_smu_cmd_async {
+    unsigned long long          cookie;
+    struct ryzen_smu_cmd        cmd;
+    unsigned int                reserved;
+};
+
+#define RYZEN_SMU_IOC_MAGIC             0xE5
+#define RYZEN_SMU_IOC_PM_TABLE_INFO     _IOR(RYZEN_SMU_IOC_MAGIC, 0x01, struct ryzen_smu_pm_table_info)
+#define RYZEN_SMU_IOC_PM_TABLE_REFRESH  _IOR(RYZEN_SMU_IOC_MAGIC, 0x02, unsigned int)
+#define RYZEN_SMU_IOC_SMN_BATCH         _IOWR(RYZEN_SMU_IOC_MAGIC, 0x03, struct ryzen_smu_smn_batch)
+#define RYZEN_SMU_IOC_SMU_CMD           _IOWR(RYZEN_SMU_IOC_MAGIC, 0x04, struct ryzen_smu_cmd)
+#define RYZEN_SMU_IOC_CMDQ_CREATE       _IO(RYZEN_SMU_IOC_MAGIC, 0x05)
+/* smu_pm_table_gen_t matches the layout of struct ryzen_smu_pm_table_gen. */
+#define RYZEN_SMU_IOC_PM_TABLE_GENERATION \
+    _IOR(RYZEN_SMU_IOC_MAGIC, 0x06, smu_pm_table_gen_t)
+
+#define RYZEN_SMU_INFO_TOPOLOGY         (1 << 0)
+
+struct ryzen_smu_info {
+    unsigned int                info_version;
+    unsigned int                size;
+    char                        driver_version[16];
+
+    unsigned int                socket;
+    unsigned int                codename;
+    unsigned int                mp1_if_version;
+    unsigned int                smu_version;
+
+    unsigned int                pm_table_version;
+    unsigned int                pm_table_size;
+    unsigned long long          pm_table_base;
+
+    unsigned int                flags;
+    unsigned int                ccds_enabled;
+    unsigned int                ccds_disabled;
+    unsigned int                cores_disabled;
+    unsigned int                smt_enabled;
+    unsigned int                reserved;
+};
+
+/* Samples a client's copy may lag behind by before it checks whether the daemon still runs. */
+#define LIBSMU_SHM_STALE_INTERVALS      4
+#define LIBSMU_SHM_STALE_MIN_NS         1000000000ULL
+
+/* Amount of completions fetched from the driver per read. */
+#define LIBSMU_COMPLETION_BATCH         16
+
 /* Maximum driver version length defined as "255.255.255\n" */
 #define LIBSMU_MAX_DRIVER_VERSION_LEN   12
 
@@ -58,11 +147,67 @@ static int try_open_path(const char* pathname, int mode, int* fd) {
     return ret;
 }
 
+/**
+ * Parses the metadata the driver captured at probe, all at once. Returns DriverNotPresent for
+ *  drivers which predate the info file, so that the individual files are parsed instead.
+ */
+static smu_return_val smu_init_parse_info(smu_obj_t* obj) {
+    int ver_maj, ver_min, ver_rev, tmp_fd, ret;
+    struct ryzen_smu_info info;
+
+    if (!try_open_path(INFO_PATH, O_RDONLY, &tmp_fd))
+        return SMU_Return_DriverNotPresent;
+
+    ret = read(tmp_fd, &info, sizeof(info));
+    close(tmp_fd);
+
+    if (ret < 0)
+        return SMU_Return_RWError;
+
+    // Newer drivers only ever append fields.
+    if ((size_t)ret < sizeof(info) || info.size < sizeof(info))
+        return SMU_Return_DriverVersion;
+
+    info.driver_version[sizeof(info.driver_version) - 1] = 0;
+
+    // The driver version must match the expected exactly.
+    if (strcmp(info.driver_version, LIBSMU_SUPPORTED_DRIVER_VERSION))
+        return SMU_Return_DriverVersion;
+
+    sscanf(info.driver_version, "%d.%d.%d", &ver_maj, &ver_min, &ver_rev);
+    obj->driver_version = ver_maj << 16 | ver_min << 8 | ver_rev;
+
+    if (info.codename <= CODENAME_UNDEFINED || info.codename >= CODENAME_COUNT)
+        return SMU_Return_Unsupported;
+
+    obj->codename = info.codename;
+    obj->smu_if_version = info.mp1_if_version;
+    obj->smu_version = info.smu_version;
+    obj->pm_table_version = info.pm_table_version;
+    obj->pm_table_size = info.pm_table_size;
+    obj->pm_table_base = info.pm_table_base;
+
+    if (info.flags & RYZEN_SMU_INFO_TOPOLOGY) {
+        obj->topology.valid = 1;
+        obj->topology.ccds_enabled = info.ccds_enabled;
+        obj->topology.ccds_disabled = info.ccds_disabled;
+        obj->topology.cores_disabled = info.cores_disabled;
+        obj->topology.smt_enabled = info.smt_enabled;
+    }
+
+    return SMU_Return_OK;
+}
+
 static smu_return_val smu_init_parse(smu_obj_t* obj) {
     int ver_maj, ver_min, ver_rev, ver_alt, len, i, c;
     char rd_buf[1024];
     int tmp_fd, ret;
 
+    // Drivers exposing the info file provide everything in a single read.
+    ret = smu_init_parse_info(obj);
+    if (ret != SMU_Return_DriverNotPresent)
+        return ret;
+
     memset(rd_buf, 0, sizeof(rd_buf));
 
     // Verify the driver version is expected.
@@ -169,6 +314,21 @@ static smu_return_val smu_init_parse(smu_obj_t* obj) {
     return SMU_Return_OK;
 }
 
+#ifdef LIBSMU_FAMILY
+/**
+ * Verifies the processor is the one the library was specialized for, as every lookup of the PM
+ *  table layout was resolved when it was built.
+ */
+static smu_return_val smu_check_family(smu_obj_t* obj) {
+    if (obj->codename != LIBSMU_FAMILY_CODENAME ||
+        obj->pm_table_version != LIBSMU_FAMILY_PM_TABLE_VERSION ||
+        obj->pm_table_size < LIBSMU_FAMILY_PM_TABLE_SIZE)
+        return SMU_Return_Unsupported;
+
+    return SMU_Return_OK;
+}
+#endif
+
 smu_return_val smu_init(smu_obj_t* obj) {
     int i, ret;
 
@@ -179,6 +339,12 @@ smu_return_val smu_init(smu_obj_t* obj) {
     if (ret != SMU_Return_OK)
         return ret;
 
+#ifdef LIBSMU_FAMILY
+    ret = smu_check_family(obj);
+    if (ret != SMU_Return_OK)
+        return ret;
+#endif
+
     // The driver must provide access to these files.
     if (!try_open_path(SMN_PATH, O_RDWR, &obj->fd_smn) ||
         !try_open_path(MP1_SMU_CMD_PATH, O_RDWR, &obj->fd_mp1_smu_cmd) ||
@@ -194,6 +360,9 @@ smu_return_val smu_init(smu_obj_t* obj) {
             return SMU_Return_RWError;
     }
 
+    // The character device is only needed for optional features.
+    try_open_path(DEVICE_PATH, O_RDWR, &obj->fd_dev);
+
     for (i = 0; i < SMU_MUTEX_COUNT; i++)
         pthread_mutex_init(&obj->lock[i], NULL);
 
@@ -202,6 +371,115 @@ smu_return_val smu_init(smu_obj_t* obj) {
     return SMU_Return_OK;
 }
 
+smu_return_val smu_init_client(smu_obj_t* obj, const char* name) {
+    const smu_shm_header_t* hdr;
+    struct stat st;
+    void* map;
+    int fd, i;
+
+    memset(obj, 0, sizeof(*obj));
+
+    fd = shm_open(name ? name : SMU_SHM_DEFAULT_NAME, O_RDONLY, 0);
+    if (fd == -1)
+        return errno == ENOENT ? SMU_Return_DriverNotPresent : SMU_Return_RWError;
+
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(*hdr)) {
+        close(fd);
+        return SMU_Return_DriverNotPresent;
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+        return SMU_Return_RWError;
+
+    hdr = map;
+
+    // The magic is only set once the daemon published its first sample.
+    if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != SMU_SHM_MAGIC ||
+        hdr->version != SMU_SHM_VERSION || hdr->size > (size_t)st.st_size ||
+        hdr->table_offset + hdr->pm_table_size > hdr->size) {
+        munmap(map, st.st_size);
+        return SMU_Return_DriverVersion;
+    }
+
+    // A daemon which was killed leaves its segment behind.
+    if (kill(hdr->pid, 0) && errno == ESRCH) {
+        munmap(map, st.st_size);
+        return SMU_Return_DriverNotPresent;
+    }
+
+    obj->shm = map;
+    obj->shm_len = st.st_size;
+
+    obj->driver_version = hdr->driver_version;
+    obj->codename = hdr->codename;
+    obj->smu_if_version = hdr->smu_if_version;
+    obj->smu_version = hdr->smu_version;
+    obj->pm_table_size = hdr->pm_table_size;
+    obj->pm_table_version = hdr->pm_table_version;
+
+#ifdef LIBSMU_FAMILY
+    if (smu_check_family(obj) != SMU_Return_OK) {
+        munmap(map, st.st_size);
+        memset(obj, 0, sizeof(*obj));
+        return SMU_Return_Unsupported;
+    }
+#endif
+
+    for (i = 0; i < SMU_MUTEX_COUNT; i++)
+        pthread_mutex_init(&obj->lock[i], NULL);
+
+    obj->init = 1;
+
+    return SMU_Return_OK;
+}
+
+/**
+ * Determines whether the segment was abandoned by its daemon, which leaves it in place, unlinked
+ *  if it was restarted. The pid is only checked once the sample is overdue, sparing the syscall.
+ */
+static int smu_shm_stale(const smu_shm_header_t* hdr, unsigned long long timestamp_ns) {
+    unsigned long long now_ns = smu_now_ns(), overdue_ns;
+
+    overdue_ns = hdr->interval_us * 1000ULL * LIBSMU_SHM_STALE_INTERVALS;
+    if (overdue_ns < LIBSMU_SHM_STALE_MIN_NS)
+        overdue_ns = LIBSMU_SHM_STALE_MIN_NS;
+
+    if (now_ns < timestamp_ns + overdue_ns)
+        return 0;
+
+    return kill(hdr->pid, 0) && errno == ESRCH;
+}
+
+/**
+ * Copies [len] bytes at [src] within the segment of the daemon, retrying until they were not
+ *  being updated meanwhile.
+ */
+static smu_return_val smu_shm_copy(smu_obj_t* obj, const void* src, void* dst, size_t len) {
+    const smu_shm_header_t* hdr = obj->shm;
+    unsigned long long seq, timestamp_ns;
+    unsigned int i;
+
+    for (i = 0; i < 1000; i++) {
+        seq = __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE);
+
+        if (!(seq & 1)) {
+            memcpy(dst, src, len);
+            timestamp_ns = hdr->timestamp_ns;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+            if (__atomic_load_n(&hdr->seq, __ATOMIC_RELAXED) == seq)
+                return smu_shm_stale(hdr, timestamp_ns) ? SMU_Return_Stale : SMU_Return_OK;
+        }
+
+        sched_yield();
+    }
+
+    return SMU_Return_CmdRejectedBusy;
+}
+
 void smu_free(smu_obj_t* obj) {
     int i;
 
@@ -226,6 +504,21 @@ void smu_free(smu_obj_t* obj) {
     if (obj->fd_pm_table)
         close(obj->fd_pm_table);
 
+    if (obj->pm_table_map)
+        munmap(obj->pm_table_map, obj->pm_table_map_len);
+
+    if (obj->pm_table_map_alt)
+        munmap(obj->pm_table_map_alt, obj->pm_table_map_alt_len);
+
+    if (obj->fd_cmdq)
+        close(obj->fd_cmdq);
+
+    if (obj->fd_dev)
+        close(obj->fd_dev);
+
+    if (obj->shm)
+        munmap((void*)obj->shm, obj->shm_len);
+
     for (i = 0; i < SMU_MUTEX_COUNT; i++)
         pthread_mutex_destroy(&obj->lock[i]);
 
@@ -252,6 +545,27 @@ const char* smu_get_fw_version(smu_obj_t* obj) {
     return fw;
 }
 
+static smu_return_val smu_shm_read_smn(smu_obj_t* obj, unsigned int address,
+    unsigned int* result) {
+    const smu_shm_header_t* hdr = obj->shm;
+    unsigned int i, smn[2];
+    smu_return_val ret;
+
+    for (i = 0; i < hdr->smn_count && i < SMU_SHM_MAX_SMN; i++) {
+        if (hdr->smn_addresses[i] != address)
+            continue;
+
+        ret = smu_shm_copy(obj, &hdr->smn[i], smn, sizeof(smn));
+        if (ret != SMU_Return_OK)
+            return ret;
+
+        *result = smn[0];
+        return smn[1];
+    }
+
+    return SMU_Return_Unsupported;
+}
+
 smu_return_val smu_read_smn_addr(smu_obj_t* obj, unsigned int address, unsigned int* result) {
     unsigned int ret;
 
@@ -259,16 +573,19 @@ smu_return_val smu_read_smn_addr(smu_obj_t* obj, unsigned int address, unsigned
     if (!obj->init)
         return SMU_Return_Failed;
 
+    if (obj->shm)
+        return smu_shm_read_smn(obj, address, result);
+
+    // The driver keeps the result of the last address written until it is read back, so the
+    //  pair must not interleave with another thread's.
     pthread_mutex_lock(&obj->lock[SMU_MUTEX_SMN]);
 
-    lseek(obj->fd_smn, 0, SEEK_SET);
-    ret = write(obj->fd_smn, &address, sizeof(address));
+    ret = pwrite(obj->fd_smn, &address, sizeof(address), 0);
 
     if (ret != sizeof(address))
         goto BREAK_OUT;
 
-    lseek(obj->fd_smn, 0, SEEK_SET);
-    ret = read(obj->fd_smn, result, sizeof(*result));
+    ret = pread(obj->fd_smn, result, sizeof(*result), 0);
 
 BREAK_OUT:
     pthread_mutex_unlock(&obj->lock[SMU_MUTEX_SMN]);
@@ -283,24 +600,329 @@ smu_return_val smu_write_smn_addr(smu_obj_t* obj, unsigned int address, unsigned
     if (!obj->init)
         return SMU_Return_Failed;
 
+    if (obj->shm)
+        return SMU_Return_Unsupported;
+
     // buffer[0] contains the destination write target.
     // buffer[1] contains the value to write to the address.
     buffer[0] = address;
     buffer[1] = value;
 
-    pthread_mutex_lock(&obj->lock[SMU_MUTEX_SMN]);
+    // A single positioned write leaves no state behind, so no lock is needed.
+    ret = pwrite(obj->fd_smn, buffer, sizeof(buffer), 0);
 
-    lseek(obj->fd_smn, 0, SEEK_SET);
-    ret = write(obj->fd_smn, buffer, sizeof(buffer));
+    return ret == sizeof(buffer) ? SMU_Return_OK : SMU_Return_RWError;
+}
 
-    pthread_mutex_unlock(&obj->lock[SMU_MUTEX_SMN]);
+smu_return_val smu_smn_batch(smu_obj_t* obj, smu_smn_op_t* ops, unsigned int count) {
+    struct ryzen_smu_smn_batch batch;
+    unsigned int i, chunk;
 
-    return ret == sizeof(buffer) ? SMU_Return_OK : SMU_Return_RWError;
+    // Don't attempt to execute without initialization.
+    if (!obj->init)
+        return SMU_Return_Failed;
+
+    for (i = 0; obj->fd_dev && i < count; i += chunk) {
+        chunk = count - i < RYZEN_SMU_SMN_BATCH_MAX ? count - i : RYZEN_SMU_SMN_BATCH_MAX;
+
+        batch.ops = (unsigned long)(ops + i);
+        batch.count = chunk;
+
+        // Older drivers lack the ioctl, in which case fall back to sysfs for the remainder.
+        if (ioctl(obj->fd_dev, RYZEN_SMU_IOC_SMN_BATCH, &batch) != 0)
+            break;
+    }
+
+    for (; i < count; i++) {
+        if (ops[i].op == SMU_SMN_OP_READ)
+            ops[i].status = smu_read_smn_addr(obj, ops[i].address, &ops[i].value);
+        else if (ops[i].op == SMU_SMN_OP_WRITE)
+            ops[i].status = smu_write_smn_addr(obj, ops[i].address, ops[i].value);
+        else
+            ops[i].status = SMU_Return_InvalidArgument;
+    }
+
+    for (i = 0; i < count; i++)
+        if (ops[i].status != SMU_Return_OK)
+            return ops[i].status;
+
+    return SMU_Return_OK;
+}
+
+smu_return_val smu_read_smn_batch(smu_obj_t* obj, const unsigned int* addresses,
+    unsigned int* results, unsigned int count) {
+    smu_smn_op_t* ops;
+    unsigned int i;
+    smu_return_val ret;
+
+    ops = calloc(count, sizeof(*ops));
+    if (!ops)
+        return SMU_Return_Failed;
+
+    for (i = 0; i < count; i++) {
+        ops[i].address = addresses[i];
+        ops[i].op = SMU_SMN_OP_READ;
+    }
+
+    ret = smu_smn_batch(obj, ops, count);
+
+    for (i = 0; ret == SMU_Return_OK && i < count; i++)
+        results[i] = ops[i].value;
+
+    free(ops);
+    return ret;
+}
+
+static const unsigned int smu_umc_timing_regs[SMU_UMC_TIMING_REG_COUNT] = SMU_UMC_TIMING_REGS;
+
+static smu_return_val smu_get_cpu_family(unsigned int* fam, unsigned int* model) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(0x00000001, &eax, &ebx, &ecx, &edx))
+        return SMU_Return_Unsupported;
+
+    *fam = ((eax & 0xf00) >> 8) + ((eax & 0xff00000) >> 20);
+    *model = ((eax & 0xf0000) >> 12) + ((eax & 0xf0) >> 4);
+
+    return SMU_Return_OK;
+}
+
+/**
+ * Mirrors ryzen_smu_read_topology() of the driver, for those predating the info file.
+ */
+static smu_return_val smu_read_fuse_topology(smu_obj_t* obj, smu_fuse_topology_t* topology) {
+    unsigned int fam, model, ccds_present, ccds_disabled, core_fuse, core_fuse_addr, ccd_fuses[2],
+        fuses[2];
+    smu_return_val ret;
+
+    if (smu_get_cpu_family(&fam, &model) != SMU_Return_OK || (fam != 0x17 && fam != 0x19))
+        return SMU_Return_Unsupported;
+
+    ccd_fuses[0] = 0x5D218;
+    ccd_fuses[1] = 0x5D21C;
+
+    if (fam == 0x17 && model != 0x71) {
+        ccd_fuses[0] += 0x40;
+        ccd_fuses[1] += 0x40;
+    }
+
+    ret = smu_read_smn_batch(obj, ccd_fuses, fuses, 2);
+    if (ret != SMU_Return_OK)
+        return ret;
+
+    ccds_disabled = ((fuses[1] & 0x3F) << 2) | ((fuses[0] >> 30) & 0x3);
+    ccds_present = (fuses[0] >> 22) & 0xFF;
+
+    // The core fuses live in the first CCD that is present, which can only be read once known.
+    if (fam == 0x19)
+        core_fuse_addr = (0x30081800 + 0x598) |
+            ((((ccds_disabled & ccds_present) & 1) == 1) ? 0x2000000 : 0);
+    else
+        core_fuse_addr = (0x30081800 + 0x238) | (((ccds_present & 1) == 0) ? 0x2000000 : 0);
+
+    ret = smu_read_smn_addr(obj, core_fuse_addr, &core_fuse);
+    if (ret != SMU_Return_OK)
+        return ret;
+
+    topology->ccds_enabled = ccds_present;
+    topology->ccds_disabled = ccds_disabled;
+    topology->cores_disabled = core_fuse & 0xFF;
+    topology->smt_enabled = (core_fuse & (1 << 8)) != 0;
+    topology->valid = 1;
+
+    return SMU_Return_OK;
+}
+
+smu_return_val smu_get_fuse_topology(smu_obj_t* obj, smu_fuse_topology_t* topology) {
+    smu_return_val ret = SMU_Return_OK;
+
+    // Don't attempt to execute without initialization.
+    if (!obj->init)
+        return SMU_Return_Failed;
+
+    pthread_mutex_lock(&obj->lock[SMU_MUTEX_STATIC]);
+
+    if (!obj->topology.valid)
+        ret = smu_read_fuse_topology(obj, &obj->topology);
+
+    if (ret == SMU_Return_OK)
+        memcpy(topology, &obj->topology, sizeof(*topology));
+
+    pthread_mutex_unlock(&obj->lock[SMU_MUTEX_STATIC]);
+
+    return ret;
+}
+
+static unsigned int smu_umc_reg(const smu_dram_timings_t* t, unsigned int reg) {
+    unsigned int i;
+
+    for (i = 0; i < SMU_UMC_TIMING_REG_COUNT; i++)
+        if (smu_umc_timing_regs[i] == reg)
+            return t->regs[i];
+
+    return 0;
+}
+
+static void smu_decode_dram_timings(smu_dram_timings_t* t) {
+    unsigned int v1, v2;
+
+    v1 = smu_umc_reg(t, 0x50050);
+    v2 = smu_umc_reg(t, 0x50058);
+    t->bgs = !(v1 == v2 && v1 == 0x87654321);
+
+    v1 = smu_umc_reg(t, 0x500D0);
+    v2 = smu_umc_reg(t, 0x500D4);
+    t->bgs_alt = (v1 >> 4 & 0x7F) != 0 || (v2 >> 4 & 0x7F) != 0;
+
+    v1 = smu_umc_reg(t, 0x50200);
+    v2 = smu_umc_reg(t, 0x50204);
+    t->mem_clock_mhz = (v1 & 0x7f) / 3.f * 100.f;
+    t->gdm = ((v1 >> 11) & 1) == 1;
+    t->cmd_rate = ((v1 & 0x400) >> 10) != 0 ? 2 : 1;
+    t->tcl = v2 & 0x3f;
+    t->tras = v2 >> 8 & 0x7f;
+    t->trcdrd = v2 >> 16 & 0x3f;
+    t->trcdwr = v2 >> 24 & 0x3f;
+
+    v1 = smu_umc_reg(t, 0x50208);
+    v2 = smu_umc_reg(t, 0x5020C);
+    t->trc = v1 & 0xff;
+    t->trp = v1 >> 16 & 0x3f;
+    t->trrds = v2 & 0x1f;
+    t->trrdl = v2 >> 8 & 0x1f;
+    t->trtp = v2 >> 24 & 0x1f;
+
+    v1 = smu_umc_reg(t, 0x50210);
+    v2 = smu_umc_reg(t, 0x50214);
+    t->tfaw = v1 & 0xff;
+    t->tcwl = v2 & 0x3f;
+    t->twtrs = v2 >> 8 & 0x1f;
+    t->twtrl = v2 >> 16 & 0x3f;
+
+    v1 = smu_umc_reg(t, 0x50218);
+    v2 = smu_umc_reg(t, 0x50220);
+    t->twr = v1 & 0xff;
+    t->trdrddd = v2 & 0xf;
+    t->trdrdsd = v2 >> 8 & 0xf;
+    t->trdrdsc = v2 >> 16 & 0xf;
+    t->trdrdscl = v2 >> 24 & 0x3f;
+
+    v1 = smu_umc_reg(t, 0x50224);
+    v2 = smu_umc_reg(t, 0x50228);
+    t->twrwrdd = v1 & 0xf;
+    t->twrwrsd = v1 >> 8 & 0xf;
+    t->twrwrsc = v1 >> 16 & 0xf;
+    t->twrwrscl = v1 >> 24 & 0x3f;
+    t->twrrd = v2 & 0xf;
+    t->trdwr = v2 >> 8 & 0x1f;
+
+    v1 = smu_umc_reg(t, 0x50254);
+    t->tcke = v1 >> 24 & 0x1f;
+
+    // Some configurations only report the refresh timings in the second register.
+    v1 = smu_umc_reg(t, 0x50260);
+    v2 = smu_umc_reg(t, 0x50264);
+    if (v1 != v2 && v1 == 0x21060138)
+        v1 = v2;
+
+    t->trfc = v1 & 0x3ff;
+    t->trfc2 = v1 >> 11 & 0x3ff;
+    t->trfc4 = v1 >> 22 & 0x3ff;
+}
+
+static smu_return_val smu_read_dram_timings(smu_obj_t* obj) {
+    smu_smn_op_t ops[SMU_UMC_CHANNELS * SMU_UMC_TIMING_REG_COUNT];
+    smu_dram_timings_t* t;
+    unsigned int ch, i, failed = 0;
+
+    memset(ops, 0, sizeof(ops));
+
+    for (ch = 0; ch < SMU_UMC_CHANNELS; ch++) {
+        for (i = 0; i < SMU_UMC_TIMING_REG_COUNT; i++) {
+            ops[ch * SMU_UMC_TIMING_REG_COUNT + i].address =
+                smu_umc_timing_regs[i] + ch * SMU_UMC_CHANNEL_STRIDE;
+            ops[ch * SMU_UMC_TIMING_REG_COUNT + i].op = SMU_SMN_OP_READ;
+        }
+    }
+
+    // Accesses are judged per channel below, one that isn't present may well fail.
+    smu_smn_batch(obj, ops, SMU_UMC_CHANNELS * SMU_UMC_TIMING_REG_COUNT);
+
+    for (ch = 0; ch < SMU_UMC_CHANNELS; ch++) {
+        t = &obj->dram_timings[ch];
+        memset(t, 0, sizeof(*t));
+
+        for (i = 0; i < SMU_UMC_TIMING_REG_COUNT; i++) {
+            if (ops[ch * SMU_UMC_TIMING_REG_COUNT + i].status != SMU_Return_OK)
+                break;
+
+            t->regs[i] = ops[ch * SMU_UMC_TIMING_REG_COUNT + i].value;
+        }
+
+        // Empty channels read 0x300 from their configuration register.
+        if (i != SMU_UMC_TIMING_REG_COUNT || smu_umc_reg(t, 0x50200) == 0x300) {
+            memset(t, 0, sizeof(*t));
+            failed += i != SMU_UMC_TIMING_REG_COUNT;
+            continue;
+        }
+
+        t->populated = 1;
+        smu_decode_dram_timings(t);
+    }
+
+    // Nothing is cached if no channel could be read at all, so a later call may retry.
+    return failed == SMU_UMC_CHANNELS ? ops[0].status : SMU_Return_OK;
+}
+
+smu_return_val smu_get_dram_timings(smu_obj_t* obj, unsigned int channel,
+    smu_dram_timings_t* timings) {
+    smu_return_val ret = SMU_Return_OK;
+
+    // Don't attempt to execute without initialization.
+    if (!obj->init)
+        return SMU_Return_Failed;
+
+    if (channel >= SMU_UMC_CHANNELS)
+        return SMU_Return_InvalidArgument;
+
+    pthread_mutex_lock(&obj->lock[SMU_MUTEX_STATIC]);
+
+    if (!obj->dram_timings_read) {
+        ret = smu_read_dram_timings(obj);
+        obj->dram_timings_read = ret == SMU_Return_OK;
+    }
+
+    if (ret == SMU_Return_OK)
+        memcpy(timings, &obj->dram_timings[channel], sizeof(*timings));
+
+    pthread_mutex_unlock(&obj->lock[SMU_MUTEX_STATIC]);
+
+    return ret;
+}
+
+static int smu_send_command_dev(smu_obj_t* obj, unsigned int op, smu_arg_t* args,
+    enum smu_mailbox mailbox, smu_return_val* status) {
+    struct ryzen_smu_cmd cmd;
+
+    cmd.mailbox = mailbox;
+    cmd.op = op;
+    memcpy(cmd.args, args->args, sizeof(cmd.args));
+
+    if (ioctl(obj->fd_dev, RYZEN_SMU_IOC_SMU_CMD, &cmd) != 0)
+        return 0;
+
+    *status = cmd.status;
+
+    if (cmd.status == SMU_Return_OK)
+        memcpy(args->args, cmd.args, sizeof(args->args));
+
+    return 1;
 }
 
 smu_return_val smu_send_command(smu_obj_t* obj, unsigned int op, smu_arg_t* args,
     enum smu_mailbox mailbox) {
     unsigned int ret, status, fd_smu_cmd;
+    smu_return_val dev_status;
 
     // Don't attempt to execute without initialization.
     if (!obj->init)
@@ -324,18 +946,27 @@ smu_return_val smu_send_command(smu_obj_t* obj, unsigned int op, smu_arg_t* args
     if (!fd_smu_cmd)
         return SMU_Return_Unsupported;
 
+    // The character device executes the command in a single call without sharing any state with
+    //  other processes, sysfs is only used with drivers lacking it.
+    if (obj->fd_dev) {
+        if (smu_send_command_dev(obj, op, args, mailbox, &dev_status))
+            return dev_status;
+
+        if (errno != ENOTTY)
+            return SMU_Return_RWError;
+    }
+
+    // The arguments, command & response are separate files sharing state in the driver.
     pthread_mutex_lock(&obj->lock[SMU_MUTEX_CMD]);
 
-    lseek(obj->fd_smu_args, 0, SEEK_SET);
-    ret = write(obj->fd_smu_args, args->args, sizeof(*args));
+    ret = pwrite(obj->fd_smu_args, args->args, sizeof(*args), 0);
 
     if (ret != sizeof(*args)) {
         ret = SMU_Return_RWError;
         goto BREAK_OUT;
     }
 
-    lseek(fd_smu_cmd, 0, SEEK_SET);
-    ret = write(fd_smu_cmd, &op, sizeof(op));
+    ret = pwrite(fd_smu_cmd, &op, sizeof(op), 0);
 
     if (ret != sizeof(op)) {
         ret = SMU_Return_RWError;
@@ -345,8 +976,7 @@ smu_return_val smu_send_command(smu_obj_t* obj, unsigned int op, smu_arg_t* args
     // Commands should be completed instantly as the driver attempts to continuously
     //  execute it till a timeout has occurred and immediately updates the result.
     // Therefore it shouldn't be necessary to apply any sort of waiting here.
-    lseek(fd_smu_cmd, 0, SEEK_SET);
-    ret = read(fd_smu_cmd, &status, sizeof(status));
+    ret = pread(fd_smu_cmd, &status, sizeof(status), 0);
 
     if (ret != sizeof(status))
         ret = SMU_Return_RWError;
@@ -354,8 +984,7 @@ smu_return_val smu_send_command(smu_obj_t* obj, unsigned int op, smu_arg_t* args
         ret = status;
 
     if (ret == SMU_Return_OK) {
-        lseek(obj->fd_smu_args, 0, SEEK_SET);
-        ret = read(obj->fd_smu_args, args->args, sizeof(args->args)) == sizeof(args->args)
+        ret = pread(obj->fd_smu_args, args->args, sizeof(args->args), 0) == sizeof(args->args)
             ? SMU_Return_OK
             : SMU_Return_RWError;
     }
@@ -366,8 +995,104 @@ BREAK_OUT:
     return ret;
 }
 
+int smu_get_completion_fd(smu_obj_t* obj) {
+    int fd;
+
+    // Don't attempt to execute without initialization.
+    if (!obj->init || !obj->fd_dev)
+        return -1;
+
+    pthread_mutex_lock(&obj->lock[SMU_MUTEX_CMD]);
+
+    // The queue is only created once asynchronous commands are first used.
+    if (!obj->fd_cmdq) {
+        fd = ioctl(obj->fd_dev, RYZEN_SMU_IOC_CMDQ_CREATE);
+
+        if (fd > 0) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            obj->fd_cmdq = fd;
+        }
+    }
+
+    pthread_mutex_unlock(&obj->lock[SMU_MUTEX_CMD]);
+
+    return obj->fd_cmdq ? obj->fd_cmdq : -1;
+}
+
+smu_return_val smu_send_command_async(smu_obj_t* obj, unsigned long long cookie, unsigned int op,
+    const smu_arg_t* args, enum smu_mailbox mailbox) {
+    struct ryzen_smu_cmd_async rec = { 0 };
+    int fd;
+
+    // Don't attempt to execute without initialization.
+    if (!obj->init)
+        return SMU_Return_Failed;
+
+    fd = smu_get_completion_fd(obj);
+    if (fd < 0)
+        return SMU_Return_Unsupported;
+
+    rec.cookie = cookie;
+    rec.cmd.mailbox = mailbox;
+    rec.cmd.op = op;
+    memcpy(rec.cmd.args, args->args, sizeof(rec.cmd.args));
+
+    if (write(fd, &rec, sizeof(rec)) != sizeof(rec))
+        return errno == EAGAIN ? SMU_Return_CmdRejectedBusy : SMU_Return_RWError;
+
+    return SMU_Return_OK;
+}
+
+int smu_poll_completions(smu_obj_t* obj, smu_completion_t* completions, unsigned int max,
+    int timeout_ms) {
+    struct ryzen_smu_cmd_async recs[LIBSMU_COMPLETION_BATCH];
+    struct pollfd pfd;
+    unsigned int n = 0, i, want;
+    ssize_t ret;
+    int fd;
+
+    // Don't attempt to execute without initialization.
+    if (!obj->init)
+        return -1;
+
+    fd = smu_get_completion_fd(obj);
+    if (fd < 0)
+        return -1;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+
+    ret = poll(&pfd, 1, timeout_ms);
+    if (ret <= 0)
+        return ret < 0 ? -1 : 0;
+
+    while (n < max) {
+        want = max - n < LIBSMU_COMPLETION_BATCH ? max - n : LIBSMU_COMPLETION_BATCH;
+
+        ret = read(fd, recs, want * sizeof(recs[0]));
+        if (ret < 0) {
+            // Nothing else completed since the last read.
+            if (errno == EAGAIN)
+                break;
+
+            return n ? (int)n : -1;
+        }
+
+        for (i = 0; i < ret / sizeof(recs[0]); i++, n++) {
+            completions[n].cookie = recs[i].cookie;
+            completions[n].status = recs[i].cmd.status;
+            memcpy(completions[n].args.args, recs[i].cmd.args, sizeof(completions[n].args.args));
+        }
+
+        if ((size_t)ret < want * sizeof(recs[0]))
+            break;
+    }
+
+    return n;
+}
+
 smu_return_val smu_read_pm_table(smu_obj_t* obj, unsigned char* dst, size_t dst_len) {
-    int ret;
+    ssize_t ret;
 
     // Don't attempt to execute without initialization.
     if (!obj->init)
@@ -376,19 +1101,212 @@ smu_return_val smu_read_pm_table(smu_obj_t* obj, unsigned char* dst, size_t dst_
     if (dst_len != obj->pm_table_size)
         return SMU_Return_InsufficientSize;
 
+    if (obj->shm)
+        return smu_shm_copy(obj, (const unsigned char*)obj->shm +
+            ((const smu_shm_header_t*)obj->shm)->table_offset, dst, dst_len);
+
+    // Every read transfers the whole table, so threads may read concurrently.
+    ret = pread(obj->fd_pm_table, dst, obj->pm_table_size, 0);
+
+    return ret == (ssize_t)obj->pm_table_size ? SMU_Return_OK : SMU_Return_RWError;
+}
+
+smu_return_val smu_get_pm_table_generation(smu_obj_t* obj, smu_pm_table_gen_t* gen) {
+    // Don't attempt to execute without initialization.
+    if (!obj->init)
+        return SMU_Return_Failed;
+
+    // The daemon doesn't publish which parts of the table changed.
+    if (obj->shm) {
+        memset(gen->dirty, 0xFF, sizeof(gen->dirty));
+        return smu_shm_copy(obj, &((const smu_shm_header_t*)obj->shm)->generation,
+            &gen->generation, sizeof(gen->generation));
+    }
+
+    if (!obj->fd_dev || !smu_pm_tables_supported(obj))
+        return SMU_Return_Unsupported;
+
+    if (ioctl(obj->fd_dev, RYZEN_SMU_IOC_PM_TABLE_GENERATION, gen) != 0)
+        return errno == ENOTTY ? SMU_Return_Unsupported : SMU_Return_RWError;
+
+    return SMU_Return_OK;
+}
+
+smu_return_val smu_read_pm_table_if_changed(smu_obj_t* obj, unsigned char* dst, size_t dst_len,
+    smu_pm_table_gen_t* gen) {
+    smu_pm_table_gen_t cur;
+    smu_return_val ret;
+
+    ret = smu_get_pm_table_generation(obj, &cur);
+
+    // Without change tracking, every read is considered to have changed everything.
+    if (ret == SMU_Return_Unsupported) {
+        ret = smu_read_pm_table(obj, dst, dst_len);
+        if (ret == SMU_Return_OK)
+            memset(gen->dirty, 0xFF, sizeof(gen->dirty));
+
+        return ret;
+    }
+
+    if (ret != SMU_Return_OK)
+        return ret;
+
+    if (gen->generation && cur.generation == gen->generation)
+        return SMU_Return_Unchanged;
+
+    ret = smu_read_pm_table(obj, dst, dst_len);
+    if (ret != SMU_Return_OK)
+        return ret;
+
+    // The driver only knows the difference from the previous generation.
+    if (!gen->generation || cur.generation != gen->generation + 1)
+        memset(cur.dirty, 0xFF, sizeof(cur.dirty));
+
+    memcpy(gen, &cur, sizeof(cur));
+    return SMU_Return_OK;
+}
+
+static void* smu_map_region(smu_obj_t* obj, off_t region, unsigned int offset,
+    unsigned int size, size_t* len) {
+    void* map;
+
+    *len = offset + size;
+    map = mmap(NULL, *len, PROT_READ, MAP_SHARED, obj->fd_dev, region);
+
+    return map == MAP_FAILED ? NULL : map;
+}
+
+const float* smu_map_pm_table(smu_obj_t* obj, const float** alt) {
+    struct ryzen_smu_pm_table_info info;
+    const float* table = NULL;
+
+    // Don't attempt to execute without initialization.
+    if (!obj->init || !obj->fd_dev || !smu_pm_tables_supported(obj))
+        return NULL;
+
     pthread_mutex_lock(&obj->lock[SMU_MUTEX_PM]);
 
-    lseek(obj->fd_pm_table, 0, SEEK_SET);
-    ret = read(obj->fd_pm_table, dst, obj->pm_table_size);
+    if (ioctl(obj->fd_dev, RYZEN_SMU_IOC_PM_TABLE_INFO, &info) != 0)
+        goto BREAK_OUT;
 
-    if (ret != obj->pm_table_size)
-        ret = SMU_Return_RWError;
-    else
-        ret = SMU_Return_OK;
+    // The table does not start on a page boundary so keep track of where it begins.
+    if (!obj->pm_table_map) {
+        obj->pm_table_map = smu_map_region(obj, RYZEN_SMU_MMAP_PM_TABLE, info.offset,
+            info.size_primary, &obj->pm_table_map_len);
+
+        if (!obj->pm_table_map)
+            goto BREAK_OUT;
+    }
+
+    if (info.size_alt && !obj->pm_table_map_alt) {
+        obj->pm_table_map_alt = smu_map_region(obj, RYZEN_SMU_MMAP_PM_TABLE_ALT, info.offset_alt,
+            info.size_alt, &obj->pm_table_map_alt_len);
+
+        if (!obj->pm_table_map_alt)
+            goto BREAK_OUT;
+    }
+
+    table = (const float*)((unsigned char*)obj->pm_table_map + info.offset);
+
+    if (alt)
+        *alt = info.size_alt
+            ? (const float*)((unsigned char*)obj->pm_table_map_alt + info.offset_alt)
+            : NULL;
 
+BREAK_OUT:
     pthread_mutex_unlock(&obj->lock[SMU_MUTEX_PM]);
 
-    return ret;
+    return table;
+}
+
+smu_return_val smu_refresh_pm_table(smu_obj_t* obj) {
+    unsigned int status;
+
+    // Don't attempt to execute without initialization.
+    if (!obj->init)
+        return SMU_Return_Failed;
+
+    if (!obj->fd_dev || !smu_pm_tables_supported(obj))
+        return SMU_Return_Unsupported;
+
+    if (ioctl(obj->fd_dev, RYZEN_SMU_IOC_PM_TABLE_REFRESH, &status) != 0)
+        return SMU_Return_RWError;
+
+    return status;
+}
+
+const smu_pm_schema_t* smu_find_pm_schema(smu_processor_codename codename, unsigned int version) {
+    unsigned int i;
+
+    for (i = 0; i < PM_SCHEMA_COUNT; i++) {
+        if (g_pm_schemas[i].codename == codename && g_pm_schemas[i].version == version)
+            return &g_pm_schemas[i];
+    }
+
+    return NULL;
+}
+
+#ifndef LIBSMU_FAMILY
+const smu_pm_schema_t* smu_get_pm_schema(smu_obj_t* obj) {
+    const smu_pm_schema_t* schema;
+
+    if (!smu_pm_tables_supported(obj))
+        return NULL;
+
+    schema = smu_find_pm_schema(obj->codename, obj->pm_table_version);
+
+    // Fields past the end of a table smaller than expected would read out of bounds.
+    if (schema && schema->size > obj->pm_table_size)
+        return NULL;
+
+    return schema;
+}
+#endif
+
+const char* smu_pm_field_name(smu_pm_field field) {
+    if (field >= PM_FIELD_COUNT)
+        return "Undefined";
+
+    return g_pm_field_names[field];
+}
+
+int smu_pm_field_from_name(const char* name) {
+    int i;
+
+    for (i = 0; i < PM_FIELD_COUNT; i++) {
+        if (!strcmp(g_pm_field_names[i], name))
+            return i;
+    }
+
+    return -1;
+}
+
+unsigned long long smu_now_ns(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+long long smu_wait_deadline(unsigned long long* next, unsigned long long interval_ns) {
+    unsigned long long now, missed = 0;
+    struct timespec ts;
+
+    ts.tv_sec = *next / 1000000000ULL;
+    ts.tv_nsec = *next % 1000000000ULL;
+
+    if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        return -1;
+
+    *next += interval_ns;
+    now = smu_now_ns();
+
+    if (now > *next) {
+        missed = (now - *next) / interval_ns + 1;
+        *next += missed * interval_ns;
+    }
+
+    return missed;
 }
 
 const char* smu_return_to_str(smu_return_val val) {
@@ -421,11 +1339,16 @@ const char* smu_return_to_str(smu_return_val val) {
             return "Read Or Write Error";
         case SMU_Return_DriverVersion:
             return "SMU Driver Version Incompatible With Library Version";
+        case SMU_Return_Unchanged:
+            return "PM Table Unchanged";
+        case SMU_Return_Stale:
+            return "Telemetry Daemon Exited";
         default:
             return "Unspecified Error";
     }
 }
 
+#ifndef LIBSMU_FAMILY
 const char* smu_codename_to_str(smu_obj_t* obj) {
     switch (obj->codename) {
         case CODENAME_CASTLEPEAK:
@@ -480,3 +1403,4 @@ const char* smu_codename_to_str(smu_obj_t* obj) {
 unsigned int smu_pm_tables_supported(smu_obj_t* obj) {
     return obj->pm_table_size && obj->pm_table_version;
 }
+#endif
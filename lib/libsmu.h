@@ -19,6 +19,7 @@
 #ifndef __LIB_SMU_H__
 #define __LIB_SMU_H__
 
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 #include <pthread.h>
@@ -68,6 +69,10 @@ typedef enum {
     SMU_Return_RWError           = 0xE9,
     // Driver version is incompatible.
     SMU_Return_DriverVersion     = 0xE8,
+    // The PM table did not change since it was last read, nothing was copied.
+    SMU_Return_Unchanged         = 0xE7,
+    // The daemon publishing the segment exited, the client must be initialized again.
+    SMU_Return_Stale             = 0xE6,
 } smu_return_val;
 
 /**
@@ -116,14 +121,88 @@ typedef enum {
 
 /**
  * Mutex lock enumeration for specific components.
+ * Only SMN reads & commands sent through sysfs are serialized, as its files hold state between
+ *  calls. The PM lock only guards mapping the table.
  */
 enum SMU_MUTEX_LOCK {
     SMU_MUTEX_SMN,
     SMU_MUTEX_CMD,
     SMU_MUTEX_PM,
+    // Guards reading the fuses & DRAM timings which are cached after the first read.
+    SMU_MUTEX_STATIC,
     SMU_MUTEX_COUNT
 };
 
+/**
+ * CCDs & cores as they were fused off, each field being a bitmap with one bit per CCD or per core
+ *  within a CCD. Provided at initialization by drivers which read the fuses at probe, as indicated
+ *  by [valid], or otherwise read on the first call to smu_get_fuse_topology().
+ */
+typedef struct {
+    unsigned int                valid;
+    unsigned int                ccds_enabled;
+    unsigned int                ccds_disabled;
+    unsigned int                cores_disabled;
+    unsigned int                smt_enabled;
+} smu_fuse_topology_t;
+
+/* UMC channels decoded by smu_get_dram_timings(), each a further stride apart in SMN space. */
+#define SMU_UMC_CHANNELS                                   2
+#define SMU_UMC_CHANNEL_STRIDE                             0x100000
+
+/* Registers of every channel holding its DRAM timings, relative to the first channel. */
+#define SMU_UMC_TIMING_REGS {                                                                   \
+    0x50050, 0x50058, 0x500D0, 0x500D4, 0x50200, 0x50204, 0x50208, 0x5020C, 0x50210,          \
+    0x50214, 0x50218, 0x50220, 0x50224, 0x50228, 0x50254, 0x50260, 0x50264,                   \
+}
+#define SMU_UMC_TIMING_REG_COUNT                           17
+
+/**
+ * DRAM configuration of a single UMC channel, timings being in memory clocks.
+ * Unpopulated channels have [populated] cleared & every other field zeroed.
+ */
+typedef struct {
+    unsigned int                populated;
+    // Raw contents of the registers, in the order of SMU_UMC_TIMING_REGS.
+    unsigned int                regs[SMU_UMC_TIMING_REG_COUNT];
+
+    float                       mem_clock_mhz;
+    unsigned int                bgs;
+    unsigned int                bgs_alt;
+    unsigned int                gdm;
+    // Command rate, 1T or 2T.
+    unsigned int                cmd_rate;
+
+    unsigned int                tcl;
+    unsigned int                tras;
+    unsigned int                trcdrd;
+    unsigned int                trcdwr;
+    unsigned int                trc;
+    unsigned int                trp;
+    unsigned int                trrds;
+    unsigned int                trrdl;
+    unsigned int                trtp;
+    unsigned int                tfaw;
+    unsigned int                tcwl;
+    unsigned int                twtrs;
+    unsigned int                twtrl;
+    unsigned int                twr;
+    unsigned int                trdrddd;
+    unsigned int                trdrdsd;
+    unsigned int                trdrdsc;
+    unsigned int                trdrdscl;
+    unsigned int                twrwrdd;
+    unsigned int                twrwrsd;
+    unsigned int                twrwrsc;
+    unsigned int                twrwrscl;
+    unsigned int                twrrd;
+    unsigned int                trdwr;
+    unsigned int                tcke;
+    unsigned int                trfc;
+    unsigned int                trfc2;
+    unsigned int                trfc4;
+} smu_dram_timings_t;
+
 typedef struct {
     /* Accessible To Users, Read-Only. */
     unsigned int                init;
@@ -134,6 +213,9 @@ typedef struct {
     unsigned int                smu_version;
     unsigned int                pm_table_size;
     unsigned int                pm_table_version;
+    // Physical address of the PM table, zero if the driver doesn't report it.
+    unsigned long long          pm_table_base;
+    smu_fuse_topology_t         topology;
 
     /* Internal Library Use Only */
     int                         fd_smn;
@@ -142,10 +224,302 @@ typedef struct {
     int                         fd_hsmp_smu_cmd;
     int                         fd_smu_args;
     int                         fd_pm_table;
+    int                         fd_dev;
+    int                         fd_cmdq;
+
+    void*                       pm_table_map;
+    void*                       pm_table_map_alt;
+    size_t                      pm_table_map_len;
+    size_t                      pm_table_map_alt_len;
+
+    const void*                 shm;
+    size_t                      shm_len;
+
+    unsigned int                dram_timings_read;
+    smu_dram_timings_t          dram_timings[SMU_UMC_CHANNELS];
 
     pthread_mutex_t             lock[SMU_MUTEX_COUNT];
 } smu_obj_t;
 
+/* Operations an smu_smn_op_t may perform. */
+#define SMU_SMN_OP_READ                                    0
+#define SMU_SMN_OP_WRITE                                   1
+
+/**
+ * A single SMN access of a batch.
+ * For reads, value receives the register contents and for writes it holds the value to write.
+ */
+typedef struct {
+    unsigned int                address;
+    unsigned int                value;
+    unsigned int                op;
+    /* Receives the smu_return_val of the access. */
+    unsigned int                status;
+} smu_smn_op_t;
+
+/* Granularity, in bytes, at which changes to the PM table are tracked. */
+#define SMU_PM_TABLE_LINE_SIZE                             64
+#define SMU_PM_TABLE_DIRTY_WORDS                           4
+
+/**
+ * Change tracking state of the PM table.
+ * The generation is incremented whenever the contents of the table change and bit N of the dirty
+ *  bitmap is set if bytes [N * 64, N * 64 + 63] of the table changed since the previous one.
+ */
+typedef struct {
+    unsigned long long          generation;
+    unsigned long long          dirty[SMU_PM_TABLE_DIRTY_WORDS];
+} smu_pm_table_gen_t;
+
+/**
+ * Fields of the PM table known to the library. Not every table version reports every field, see
+ *  smu_get_pm_schema().
+ */
+typedef enum {
+    PM_FIELD_PPT_LIMIT,
+    PM_FIELD_PPT_VALUE,
+    PM_FIELD_TDC_LIMIT,
+    PM_FIELD_TDC_VALUE,
+    PM_FIELD_THM_LIMIT,
+    PM_FIELD_THM_VALUE,
+    PM_FIELD_FIT_LIMIT,
+    PM_FIELD_FIT_VALUE,
+    PM_FIELD_EDC_LIMIT,
+    PM_FIELD_EDC_VALUE,
+    PM_FIELD_VID_LIMIT,
+    PM_FIELD_VID_VALUE,
+    PM_FIELD_PPT_WC,
+    PM_FIELD_PPT_ACTUAL,
+    PM_FIELD_TDC_WC,
+    PM_FIELD_TDC_ACTUAL,
+    PM_FIELD_THM_WC,
+    PM_FIELD_THM_ACTUAL,
+    PM_FIELD_FIT_WC,
+    PM_FIELD_FIT_ACTUAL,
+    PM_FIELD_EDC_WC,
+    PM_FIELD_EDC_ACTUAL,
+    PM_FIELD_VID_WC,
+    PM_FIELD_VID_ACTUAL,
+    PM_FIELD_VDDCR_CPU_POWER,
+    PM_FIELD_VDDCR_SOC_POWER,
+    PM_FIELD_VDDIO_MEM_POWER,
+    PM_FIELD_VDD18_POWER,
+    PM_FIELD_ROC_POWER,
+    PM_FIELD_SOCKET_POWER,
+    PM_FIELD_PPT_FREQUENCY,
+    PM_FIELD_TDC_FREQUENCY,
+    PM_FIELD_THM_FREQUENCY,
+    PM_FIELD_PROCHOT_FREQUENCY,
+    PM_FIELD_VOLTAGE_FREQUENCY,
+    PM_FIELD_CCA_FREQUENCY,
+    PM_FIELD_FIT_VOLTAGE,
+    PM_FIELD_FIT_PRE_VOLTAGE,
+    PM_FIELD_LATCHUP_VOLTAGE,
+    PM_FIELD_CPU_SET_VOLTAGE,
+    PM_FIELD_CPU_TELEMETRY_VOLTAGE,
+    PM_FIELD_CPU_TELEMETRY_CURRENT,
+    PM_FIELD_CPU_TELEMETRY_POWER,
+    PM_FIELD_CPU_TELEMETRY_POWER_ALT,
+    PM_FIELD_SOC_SET_VOLTAGE,
+    PM_FIELD_SOC_TELEMETRY_VOLTAGE,
+    PM_FIELD_SOC_TELEMETRY_CURRENT,
+    PM_FIELD_SOC_TELEMETRY_POWER,
+    PM_FIELD_FCLK_FREQ,
+    PM_FIELD_FCLK_FREQ_EFF,
+    PM_FIELD_UCLK_FREQ,
+    PM_FIELD_MEMCLK_FREQ,
+    PM_FIELD_FCLK_DRAM_SETPOINT,
+    PM_FIELD_FCLK_DRAM_BUSY,
+    PM_FIELD_FCLK_GMI_SETPOINT,
+    PM_FIELD_FCLK_GMI_BUSY,
+    PM_FIELD_FCLK_IOHC_SETPOINT,
+    PM_FIELD_FCLK_IOHC_BUSY,
+    PM_FIELD_FCLK_XGMI_SETPOINT,
+    PM_FIELD_FCLK_XGMI_BUSY,
+    PM_FIELD_CCM_READS,
+    PM_FIELD_CCM_WRITES,
+    PM_FIELD_IOMS,
+    PM_FIELD_XGMI,
+    PM_FIELD_CS_UMC_READS,
+    PM_FIELD_CS_UMC_WRITES,
+    PM_FIELD_FCLK_RESIDENCY,
+    PM_FIELD_FCLK_FREQ_TABLE,
+    PM_FIELD_UCLK_FREQ_TABLE,
+    PM_FIELD_MEMCLK_FREQ_TABLE,
+    PM_FIELD_FCLK_VOLTAGE,
+    PM_FIELD_LCLK_SETPOINT_0,
+    PM_FIELD_LCLK_BUSY_0,
+    PM_FIELD_LCLK_FREQ_0,
+    PM_FIELD_LCLK_FREQ_EFF_0,
+    PM_FIELD_LCLK_MAX_DPM_0,
+    PM_FIELD_LCLK_MIN_DPM_0,
+    PM_FIELD_LCLK_SETPOINT_1,
+    PM_FIELD_LCLK_BUSY_1,
+    PM_FIELD_LCLK_FREQ_1,
+    PM_FIELD_LCLK_FREQ_EFF_1,
+    PM_FIELD_LCLK_MAX_DPM_1,
+    PM_FIELD_LCLK_MIN_DPM_1,
+    PM_FIELD_LCLK_SETPOINT_2,
+    PM_FIELD_LCLK_BUSY_2,
+    PM_FIELD_LCLK_FREQ_2,
+    PM_FIELD_LCLK_FREQ_EFF_2,
+    PM_FIELD_LCLK_MAX_DPM_2,
+    PM_FIELD_LCLK_MIN_DPM_2,
+    PM_FIELD_LCLK_SETPOINT_3,
+    PM_FIELD_LCLK_BUSY_3,
+    PM_FIELD_LCLK_FREQ_3,
+    PM_FIELD_LCLK_FREQ_EFF_3,
+    PM_FIELD_LCLK_MAX_DPM_3,
+    PM_FIELD_LCLK_MIN_DPM_3,
+    PM_FIELD_XGMI_SETPOINT,
+    PM_FIELD_XGMI_BUSY,
+    PM_FIELD_XGMI_LANE_WIDTH,
+    PM_FIELD_XGMI_DATA_RATE,
+    PM_FIELD_SOC_POWER,
+    PM_FIELD_SOC_TEMP,
+    PM_FIELD_DDR_VDDP_POWER,
+    PM_FIELD_DDR_VDDIO_MEM_POWER,
+    PM_FIELD_GMI2_VDDG_POWER,
+    PM_FIELD_IO_VDDCR_SOC_POWER,
+    PM_FIELD_IOD_VDDIO_MEM_POWER,
+    PM_FIELD_IO_VDD18_POWER,
+    PM_FIELD_TDP,
+    PM_FIELD_DETERMINISM,
+    PM_FIELD_V_VDDM,
+    PM_FIELD_V_VDDP,
+    PM_FIELD_V_VDDG,
+    PM_FIELD_PEAK_TEMP,
+    PM_FIELD_PEAK_VOLTAGE,
+    PM_FIELD_AVG_CORE_COUNT,
+    PM_FIELD_CCLK_LIMIT,
+    PM_FIELD_MAX_VOLTAGE,
+    PM_FIELD_DC_BTC,
+    PM_FIELD_CSTATE_BOOST,
+    PM_FIELD_PROCHOT,
+    PM_FIELD_PC6,
+    PM_FIELD_PWM,
+    PM_FIELD_SOCCLK,
+    PM_FIELD_SHUBCLK,
+    PM_FIELD_MP0CLK,
+    PM_FIELD_MP1CLK,
+    PM_FIELD_MP5CLK,
+    PM_FIELD_SMNCLK,
+    PM_FIELD_TWIXCLK,
+    PM_FIELD_WAFLCLK,
+    PM_FIELD_DPM_BUSY,
+    PM_FIELD_MP1_BUSY,
+    PM_FIELD_CORE_POWER,
+    PM_FIELD_CORE_VOLTAGE,
+    PM_FIELD_CORE_TEMP,
+    PM_FIELD_CORE_FIT,
+    PM_FIELD_CORE_IDDMAX,
+    PM_FIELD_CORE_FREQ,
+    PM_FIELD_CORE_FREQEFF,
+    PM_FIELD_CORE_C0,
+    PM_FIELD_CORE_CC1,
+    PM_FIELD_CORE_CC6,
+    PM_FIELD_CORE_CKS_FDD,
+    PM_FIELD_CORE_CI_FDD,
+    PM_FIELD_CORE_IRM,
+    PM_FIELD_CORE_PSTATE,
+    PM_FIELD_CORE_CPPC_MAX,
+    PM_FIELD_CORE_CPPC_MIN,
+    PM_FIELD_CORE_SC_LIMIT,
+    PM_FIELD_CORE_SC_CAC,
+    PM_FIELD_CORE_SC_RESIDENCY,
+    PM_FIELD_L3_LOGIC_POWER,
+    PM_FIELD_L3_VDDM_POWER,
+    PM_FIELD_L3_TEMP,
+    PM_FIELD_L3_FIT,
+    PM_FIELD_L3_IDDMAX,
+    PM_FIELD_L3_FREQ,
+    PM_FIELD_L3_CKS_FDD,
+    PM_FIELD_L3_CCA_THRESHOLD,
+    PM_FIELD_L3_CCA_CAC,
+    PM_FIELD_L3_CCA_ACTIVATION,
+    PM_FIELD_L3_EDC_LIMIT,
+    PM_FIELD_L3_EDC_CAC,
+    PM_FIELD_L3_EDC_RESIDENCY,
+    PM_FIELD_MP5_BUSY,
+    PM_FIELD_COUNT,
+} smu_pm_field;
+
+typedef enum {
+    PM_TYPE_F32,
+    PM_TYPE_U32,
+} smu_pm_type;
+
+/**
+ * Location of a field within the PM table.
+ * Element N of the field is stored at [offset + N * stride].
+ */
+typedef struct {
+    unsigned int                offset;
+    /* Number of elements, per-core & per-CCX fields hold one per instance. Zero if absent. */
+    unsigned int                count;
+    unsigned int                stride;
+    smu_pm_type                 type;
+} smu_pm_field_t;
+
+/**
+ * Layout of one PM table version, indexed by smu_pm_field.
+ */
+typedef struct {
+    smu_processor_codename      codename;
+    unsigned int                version;
+    unsigned int                size;
+    smu_pm_field_t              fields[PM_FIELD_COUNT];
+} smu_pm_schema_t;
+
+#include "libsmu_family.h"
+
+/* Name of the shared memory segment published by smu_telemetryd unless configured otherwise. */
+#define SMU_SHM_DEFAULT_NAME                               "/ryzen_smu"
+#define SMU_SHM_MAGIC                                      0x4D485355
+#define SMU_SHM_VERSION                                    1
+
+/* Maximum amount of SMN addresses sampled by the daemon. */
+#define SMU_SHM_MAX_SMN                                    64
+
+/**
+ * Layout of the shared memory segment published by smu_telemetryd, the last sampled PM table
+ *  following it at [table_offset].
+ * [seq] is odd while the daemon updates the sample. Readers must load it before & after copying
+ *  the sample, retrying if it was odd or changed in between. Everything above [seq] is constant
+ *  once [magic] is set.
+ */
+typedef struct {
+    unsigned int                magic;
+    unsigned int                version;
+    unsigned int                size;
+    unsigned int                table_offset;
+
+    unsigned int                codename;
+    unsigned int                smu_if_version;
+    unsigned int                smu_version;
+    unsigned int                driver_version;
+    unsigned int                pm_table_version;
+    unsigned int                pm_table_size;
+
+    unsigned int                interval_us;
+    unsigned int                pid;
+    unsigned int                smn_count;
+    unsigned int                smn_addresses[SMU_SHM_MAX_SMN];
+
+    unsigned long long          seq;
+    /* CLOCK_MONOTONIC time the sample was taken at. */
+    unsigned long long          timestamp_ns;
+    /* Incremented whenever the PM table changes. */
+    unsigned long long          generation;
+    /* Samples the daemon failed to take, which leave the previous one in place. */
+    unsigned long long          failed;
+    /* Value & smu_return_val of reading each SMN address. */
+    struct {
+        unsigned int            value;
+        unsigned int            status;
+    } smn[SMU_SHM_MAX_SMN];
+} smu_shm_header_t;
+
 typedef union {
     struct {
         float                   args0_f;
@@ -180,6 +554,21 @@ typedef union {
  * Returns SMU_Return_OK on success.
  */
 smu_return_val smu_init(smu_obj_t* obj);
+
+/**
+ * Initializes the library as a client of the smu_telemetryd daemon publishing the shared memory
+ *  segment [name], or SMU_SHM_DEFAULT_NAME if NULL. This requires no privileges nor the driver.
+ * The same members as smu_init() become accessible. smu_read_pm_table() & related methods return
+ *  the latest sample of the daemon, while smu_read_smn_addr() only succeeds for the addresses it
+ *  samples. Every other method returns SMU_Return_Unsupported.
+ *
+ * Once the daemon exits, including when it is restarted & publishes a new segment under the same
+ *  name, reads return SMU_Return_Stale rather than its last sample. Clients re-attach by calling
+ *  smu_free() then smu_init_client() again.
+ *
+ * Returns SMU_Return_DriverNotPresent if the daemon isn't running.
+ */
+smu_return_val smu_init_client(smu_obj_t* obj, const char* name);
 void smu_free(smu_obj_t* obj);
 
 /**
@@ -193,9 +582,48 @@ const char* smu_get_fw_version(smu_obj_t* obj);
 smu_return_val smu_read_smn_addr(smu_obj_t* obj, unsigned int address, unsigned int* result);
 smu_return_val smu_write_smn_addr(smu_obj_t* obj, unsigned int address, unsigned int value);
 
+/**
+ * Performs [count] SMN reads or writes in order, storing the result of each in its status.
+ * When the driver supports it, the whole batch executes with a single system call and without
+ *  any other SMN access interleaving, otherwise each access is performed individually.
+ *
+ * Returns SMU_Return_OK if all accesses succeeded or the status of the first one that failed.
+ */
+smu_return_val smu_smn_batch(smu_obj_t* obj, smu_smn_op_t* ops, unsigned int count);
+
+/**
+ * Reads [count] 32 bit words from the SMN address space at [addresses] into [results].
+ *
+ * Returns SMU_Return_OK on success.
+ */
+smu_return_val smu_read_smn_batch(smu_obj_t* obj, const unsigned int* addresses,
+    unsigned int* results, unsigned int count);
+
+/**
+ * Retrieves the fuse topology of the processor into [topology], reading the CCD & core fuses over
+ *  SMN on the first call should the driver not have provided them. Later calls return the cached
+ *  copy without accessing the hardware.
+ *
+ * Returns SMU_Return_OK on success or SMU_Return_Unsupported on processors other than family 17h
+ *  & 19h.
+ */
+smu_return_val smu_get_fuse_topology(smu_obj_t* obj, smu_fuse_topology_t* topology);
+
+/**
+ * Retrieves the DRAM timings of UMC [channel] into [timings]. The first call reads the registers
+ *  of every channel in a single SMN batch & later calls return the cached copy without accessing
+ *  the hardware.
+ *
+ * Returns SMU_Return_OK on success, including for unpopulated channels.
+ */
+smu_return_val smu_get_dram_timings(smu_obj_t* obj, unsigned int channel,
+    smu_dram_timings_t* timings);
+
 /**
  * Sends a command to the SMU.
  * Arguments are sent in the args buffer and are also returned in it.
+ * When the driver provides the character device, the command executes atomically in a single
+ *  system call, making it safe to use from multiple processes at once.
  * 
  * Returns SMU_Return_OK on success.
  */
@@ -209,12 +637,419 @@ smu_return_val smu_send_command(smu_obj_t* obj, unsigned int op, smu_arg_t *args
  */
 smu_return_val smu_read_pm_table(smu_obj_t* obj, unsigned char* dst, size_t dst_len);
 
+/**
+ * Requests a PM table update and retrieves the table's change tracking state, which is much
+ *  cheaper than reading the table itself.
+ *
+ * Returns SMU_Return_OK on success or SMU_Return_Unsupported if the driver lacks support.
+ */
+smu_return_val smu_get_pm_table_generation(smu_obj_t* obj, smu_pm_table_gen_t* gen);
+
+/**
+ * Reads the PM table into the destination buffer only if it changed since the generation in
+ *  [gen], which should be zeroed before the first call. On return, [gen] holds the generation of
+ *  the table copied and its dirty bitmap covers every line that changed since the previous copy,
+ *  conservatively marking all of them if it can't be told.
+ *
+ * Returns SMU_Return_OK if the table was read or SMU_Return_Unchanged if it was not.
+ */
+smu_return_val smu_read_pm_table_if_changed(smu_obj_t* obj, unsigned char* dst, size_t dst_len,
+    smu_pm_table_gen_t* gen);
+
+/**
+ * Maps the PM table read-only into the address space of the process, allowing it to be read
+ *  without any copies or system calls.
+ * The mapping reflects the last table transferred by the SMU. This happens on every
+ *  smu_refresh_pm_table() or smu_read_pm_table() call made by any process.
+ *
+ * On Picasso & Raven Ridge, the secondary table is stored in [alt] if it isn't NULL.
+ * The mapping remains valid until smu_free() is called.
+ *
+ * Returns a pointer to the table or NULL if mapping is unsupported or failed.
+ */
+const float* smu_map_pm_table(smu_obj_t* obj, const float** alt);
+
+/**
+ * Commands the SMU to update the PM table in memory without reading it.
+ *
+ * Returns an SMU_Return_OK on success.
+ */
+smu_return_val smu_refresh_pm_table(smu_obj_t* obj);
+
+/**
+ * Result of a command sent with smu_send_command_async().
+ */
+typedef struct {
+    unsigned long long          cookie;
+    smu_return_val              status;
+    smu_arg_t                   args;
+} smu_completion_t;
+
+/**
+ * Queues a command to be executed by the driver without waiting for it to complete.
+ * Commands sent to the same mailbox execute in order. Their results are retrieved with
+ *  smu_poll_completions(), identified by [cookie].
+ *
+ * Returns SMU_Return_OK if the command was queued or SMU_Return_CmdRejectedBusy if too many
+ *  completions are waiting to be retrieved.
+ */
+smu_return_val smu_send_command_async(smu_obj_t* obj, unsigned long long cookie, unsigned int op,
+    const smu_arg_t* args, enum smu_mailbox mailbox);
+
+/**
+ * Retrieves up to [max] completed asynchronous commands, waiting at most [timeout_ms]
+ *  milliseconds for one to complete. A negative timeout waits indefinitely.
+ *
+ * Returns the number of completions stored or -1 on error.
+ */
+int smu_poll_completions(smu_obj_t* obj, smu_completion_t* completions, unsigned int max,
+    int timeout_ms);
+
+/**
+ * Returns a file descriptor which becomes readable once asynchronous commands have completed,
+ *  for use with poll(), select() or epoll, or -1 if unsupported.
+ * It must not be read from directly, use smu_poll_completions() instead.
+ */
+int smu_get_completion_fd(smu_obj_t* obj);
+
+/**
+ * Returns the layout of the PM table reported by the processor or NULL if it isn't known.
+ * Builds specialized for a family define it in libsmu_family.h instead.
+ */
+#ifndef LIBSMU_FAMILY
+const smu_pm_schema_t* smu_get_pm_schema(smu_obj_t* obj);
+#endif
+
+/**
+ * Returns the layout of PM table [version] on [codename] or NULL if it isn't known.
+ */
+const smu_pm_schema_t* smu_find_pm_schema(smu_processor_codename codename, unsigned int version);
+
+/**
+ * Converts a field to its name, as spelled after the PM_FIELD_ prefix, and back.
+ * smu_pm_field_from_name() returns -1 if no field is named [name].
+ */
+const char* smu_pm_field_name(smu_pm_field field);
+int smu_pm_field_from_name(const char* name);
+
+/**
+ * Reads element [idx] of [field] from a PM table laid out as described by [schema].
+ * In builds specialized for a family, a constant [field] compiles to a load at a fixed offset.
+ *
+ * Returns NAN if the table version doesn't report the field or element.
+ */
+static inline float smu_pm_get_f32(const smu_pm_schema_t* schema, const void* table,
+    smu_pm_field field, unsigned int idx) {
+    const smu_pm_field_t* f = SMU_PM_FIELD(schema, field);
+    unsigned int u32;
+    float f32;
+
+    if (idx >= f->count)
+        return NAN;
+
+    // The table is only guaranteed to be byte aligned when it was copied into a user buffer.
+    if (f->type == PM_TYPE_U32) {
+        memcpy(&u32, (const unsigned char*)table + f->offset + idx * f->stride, sizeof(u32));
+        return (float)u32;
+    }
+
+    memcpy(&f32, (const unsigned char*)table + f->offset + idx * f->stride, sizeof(f32));
+    return f32;
+}
+
+/** SHARED SNAPSHOTS **/
+
+/* Number of snapshots kept by smu_snapshot_t, allowing consumers to copy one while the next ones
+ *  are taken. */
+#define SMU_SNAPSHOT_SLOTS                                 4
+
+/**
+ * Describes a snapshot of the PM table.
+ */
+typedef struct {
+    /* Number of the snapshot, increasing by one for every snapshot taken. */
+    unsigned long long          seq;
+    /* CLOCK_MONOTONIC time the table was read at. */
+    unsigned long long          timestamp_ns;
+    /* Generation of the table as tracked by the driver or zero if it lacks support. */
+    unsigned long long          generation;
+} smu_snapshot_info_t;
+
+typedef struct {
+    /* Accessible To Users, Read-Only. */
+    unsigned int                interval_us;
+    /* Refreshes that failed, which keep the previous snapshot current. */
+    unsigned long long          failed;
+
+    /* Internal Library Use Only */
+    smu_obj_t*                  obj;
+    pthread_t                   thread;
+    int                         running;
+    int                         stop;
+    unsigned char*              slots;
+    size_t                      slot_size;
+    unsigned long long          head;
+    smu_pm_table_gen_t          gen;
+} smu_snapshot_t;
+
+/**
+ * Starts a thread reading the PM table every [interval_us] microseconds, publishing it for any
+ *  number of threads to retrieve with smu_snapshot_read() without reading the table themselves.
+ * The first snapshot is taken before returning. Tables the driver reports as unchanged are not
+ *  published again.
+ */
+smu_return_val smu_snapshot_start(smu_snapshot_t* s, smu_obj_t* obj, unsigned int interval_us);
+
+/**
+ * Copies the latest snapshot into [dst], holding exactly the PM table size, without ever waiting
+ *  on the refresh thread or other readers. Multiple threads may call this simultaneously.
+ * [info] must be zeroed before the first call & is updated to describe the snapshot copied.
+ *
+ * Returns SMU_Return_Unchanged if [info] already describes the latest snapshot, in which case
+ *  nothing is copied.
+ */
+smu_return_val smu_snapshot_read(smu_snapshot_t* s, unsigned char* dst, size_t dst_len,
+    smu_snapshot_info_t* info);
+
+/**
+ * Stops the refresh thread. No readers may be using [s] anymore.
+ */
+void smu_snapshot_stop(smu_snapshot_t* s);
+
+/** DERIVED METRICS **/
+
+/**
+ * Per-core metrics decoded from a PM table by smu_decode_core_metrics(), as one array per metric
+ *  holding an element per core. Arrays are 32 byte aligned & padded to a multiple of 8 elements.
+ */
+typedef struct {
+    /* Number of cores decoded & the number the arrays were allocated for. */
+    unsigned int                count;
+    unsigned int                capacity;
+
+    /* Effective frequency in MHz, excluding the time spent clock gated. */
+    float*                      frequency;
+    /* Estimated voltage while awake, zero for cores whose clock is stopped. */
+    float*                      voltage;
+    float*                      power;
+    float*                      temperature;
+    /* C-state residencies, in percent. */
+    float*                      c0;
+    float*                      c1;
+    float*                      c6;
+
+    /**
+     * Bit N of word N / 64 of [active] is set if core N spent at least 6% of the time in C0,
+     *  cores lacking it are sleeping. The same bit of [gated] is set if its clock is stopped.
+     */
+    unsigned long long*         active;
+    unsigned long long*         gated;
+
+    /* Estimated voltage of awake cores, excluding the time the package spent in PC6. */
+    float                       package_voltage;
+    float                       peak_frequency;
+    /* Sums over all decoded cores. */
+    float                       total_c0;
+    float                       total_c6;
+    float                       total_voltage;
+} smu_core_metrics_t;
+
+typedef enum {
+    SMU_METRICS_ISA_SCALAR,
+    SMU_METRICS_ISA_SSE2,
+    SMU_METRICS_ISA_AVX2,
+} smu_metrics_isa;
+
+/**
+ * Allocates the arrays of [m] to hold up to [cores] cores. Released by smu_core_metrics_free().
+ */
+smu_return_val smu_core_metrics_init(smu_core_metrics_t* m, unsigned int cores);
+void smu_core_metrics_free(smu_core_metrics_t* m);
+
+/**
+ * Decodes the metrics of the first [cores] cores from a PM table laid out as described by
+ *  [schema], using the widest vector instructions supported by the processor.
+ * Results may differ in the last bits between instruction sets, as sums are accumulated in a
+ *  different order and the compiler may fuse the arithmetic of the scalar fallback.
+ *
+ * Returns SMU_Return_Unsupported if the table doesn't report the required fields for that many
+ *  cores or SMU_Return_InsufficientSize if [m] is too small.
+ */
+smu_return_val smu_decode_core_metrics(const smu_pm_schema_t* schema, const void* table,
+    unsigned int cores, smu_core_metrics_t* m);
+
+/**
+ * Returns the instruction set used by smu_decode_core_metrics().
+ */
+smu_metrics_isa smu_core_metrics_isa(void);
+
+/** PM TABLE RECORDINGS **/
+
+/* Sample number holding no decoded table. */
+#define SMU_REC_NO_FRAME                                   (~0ULL)
+
+/* Longest label an event may carry, excluding the terminator. */
+#define SMU_REC_MAX_LABEL                                  63
+
+/**
+ * Compression applied to every frame of a recording. LZ4 & zstd are only available if the
+ *  library was built with LIBSMU_HAVE_LZ4 or LIBSMU_HAVE_ZSTD defined, linking the respective
+ *  library.
+ */
+typedef enum {
+    SMU_REC_COMPRESS_NONE,
+    SMU_REC_COMPRESS_LZ4,
+    SMU_REC_COMPRESS_ZSTD,
+} smu_rec_compression;
+
+/**
+ * Describes the PM tables stored in a recording.
+ */
+typedef struct {
+    smu_processor_codename      codename;
+    unsigned int                pm_table_version;
+    unsigned int                pm_table_size;
+    /* A complete table is stored every this many samples, bounding the cost of seeking. */
+    unsigned int                keyframe_interval;
+    smu_rec_compression         compression;
+} smu_rec_info_t;
+
+/**
+ * Events marked in a recording, in between samples.
+ */
+typedef enum {
+    SMU_REC_EVENT_MARK,
+    SMU_REC_EVENT_WORKLOAD_START,
+    SMU_REC_EVENT_WORKLOAD_STOP,
+} smu_rec_event_type;
+
+typedef struct {
+    smu_rec_event_type          type;
+    unsigned long long          timestamp_ns;
+    /* Number of samples recorded before the event. */
+    unsigned long long          sample;
+    char                        label[SMU_REC_MAX_LABEL + 1];
+} smu_rec_event_t;
+
+typedef struct {
+    /* Accessible To Users, Read-Only. */
+    smu_rec_info_t              info;
+    unsigned long long          count;
+    unsigned long long          event_count;
+
+    /* Internal Library Use Only */
+    FILE*                       fp;
+    unsigned long long          offset;
+    unsigned char*              prev;
+    unsigned char*              scratch;
+    unsigned char*              packed;
+    size_t                      packed_len;
+    unsigned long long*         index;
+    size_t                      index_cap;
+    unsigned long long*         events;
+    size_t                      events_cap;
+} smu_rec_writer_t;
+
+typedef struct {
+    /* Accessible To Users, Read-Only. */
+    smu_rec_info_t              info;
+    unsigned long long          count;
+    unsigned long long          event_count;
+
+    /* Internal Library Use Only */
+    const unsigned char*        map;
+    size_t                      map_len;
+    const unsigned long long*   index;
+    unsigned long long*         index_owned;
+    const unsigned long long*   events;
+    unsigned long long*         events_owned;
+    unsigned char*              table;
+    unsigned char*              scratch;
+    unsigned long long          pos;
+} smu_rec_reader_t;
+
+/**
+ * Creates a recording at [path] of PM tables described by [info], whose size must be a multiple
+ *  of 4 bytes.
+ * Samples after the first of every keyframe interval only store the 32-bit words which changed
+ *  since the previous sample.
+ *
+ * Returns SMU_Return_Unsupported if the compression requested wasn't built in.
+ */
+smu_return_val smu_rec_writer_open(smu_rec_writer_t* w, const char* path,
+    const smu_rec_info_t* info);
+
+/**
+ * Appends a PM table of info.pm_table_size bytes to the recording, sampled at [timestamp_ns].
+ */
+smu_return_val smu_rec_write(smu_rec_writer_t* w, const void* table,
+    unsigned long long timestamp_ns);
+
+/**
+ * Marks an event of [type] at [timestamp_ns], after the samples written so far. [label] may be
+ *  NULL and is truncated to SMU_REC_MAX_LABEL characters.
+ */
+smu_return_val smu_rec_write_event(smu_rec_writer_t* w, smu_rec_event_type type,
+    const char* label, unsigned long long timestamp_ns);
+
+/**
+ * Writes the index allowing the samples to be sought directly & closes the recording.
+ * Recordings which were never closed remain readable up to the last complete sample.
+ */
+smu_return_val smu_rec_writer_close(smu_rec_writer_t* w);
+
+/**
+ * Maps the recording at [path] for reading.
+ *
+ * Returns SMU_Return_RWError if the file can't be read or isn't a recording.
+ */
+smu_return_val smu_rec_reader_open(smu_rec_reader_t* r, const char* path);
+
+/**
+ * Decodes sample [n] into [dst], holding at least info.pm_table_size bytes, & stores the time it
+ *  was sampled at in [timestamp_ns]. Either may be NULL.
+ * Only the samples since the closest keyframe are decoded, or just one when reading in order.
+ *
+ * Returns SMU_Return_InvalidArgument if the recording holds no sample [n].
+ */
+smu_return_val smu_rec_read(smu_rec_reader_t* r, unsigned long long n, void* dst,
+    unsigned long long* timestamp_ns);
+
+/**
+ * Reads event [n] of the recording, in the order they were marked.
+ *
+ * Returns SMU_Return_InvalidArgument if the recording holds no event [n].
+ */
+smu_return_val smu_rec_read_event(smu_rec_reader_t* r, unsigned long long n,
+    smu_rec_event_t* event);
+void smu_rec_reader_close(smu_rec_reader_t* r);
+
 /** HELPER METHODS **/
 
 /**
  * Converts SMU values to the string representation.
  */
 const char* smu_return_to_str(smu_return_val val);
+
+/**
+ * Returns the CLOCK_MONOTONIC time in nanoseconds, which every timestamp of the library uses.
+ */
+unsigned long long smu_now_ns(void);
+
+/**
+ * Sleeps until the CLOCK_MONOTONIC time [*next], then advances it by [interval_ns]. Absolute
+ *  deadlines keep the rate steady however long the work in between takes. Deadlines which were
+ *  already missed are skipped rather than caught up in a burst, keeping wakeups on the same grid.
+ *
+ * Returns the number of deadlines skipped, or -1 if a signal interrupted the sleep, in which case
+ *  [*next] is left as is.
+ */
+long long smu_wait_deadline(unsigned long long* next, unsigned long long interval_ns);
+
+/**
+ * Builds specialized for a family define these in libsmu_family.h instead.
+ */
+#ifndef LIBSMU_FAMILY
 const char* smu_codename_to_str(smu_obj_t* obj);
 
 /**
@@ -222,5 +1057,6 @@ const char* smu_codename_to_str(smu_obj_t* obj);
  * Returns 1 if they are.
  */
 unsigned int smu_pm_tables_supported(smu_obj_t* obj);
+#endif
 
 #endif /* __LIB_SMU_H__ */
@@ -0,0 +1,94 @@
+/**
+ * Ryzen SMU Userspace Library
+ * Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+/**
+ * Builds of the library specialized for a single family & PM table version, selected by defining
+ *  LIBSMU_FAMILY_SELECT to one of the LIBSMU_FAMILY_ID_<NAME> macros below for every translation
+ *  unit, library included. Selecting a family not listed fails the build.
+ *
+ * The layout, sizes & mailbox opcodes of the family become compile-time constants: field accesses
+ *  through SMU_PM_FIELD() & smu_pm_get_f32() resolve to fixed offsets, SMU_CODENAME() to the
+ *  family's codename, and smu_get_pm_schema(), smu_pm_tables_supported() & smu_codename_to_str()
+ *  no longer dispatch on what the driver reports. smu_init() & smu_init_client() instead refuse
+ *  any other processor or table version with SMU_Return_Unsupported.
+ *
+ * Without LIBSMU_FAMILY_SELECT defined, the library dispatches at runtime & supports every family.
+ **/
+
+#ifndef __LIB_SMU_FAMILY_H__
+#define __LIB_SMU_FAMILY_H__
+
+/* Start at 1, as names without a family expand to 0 when compared. */
+#define LIBSMU_FAMILY_ID_MATISSE        1
+
+#ifndef LIBSMU_FAMILY_SELECT
+/* Runtime dispatch. */
+#elif LIBSMU_FAMILY_SELECT == LIBSMU_FAMILY_ID_MATISSE
+#define LIBSMU_FAMILY                   1
+#define LIBSMU_FAMILY_NAME              "Matisse"
+#define LIBSMU_FAMILY_CODENAME          CODENAME_MATISSE
+#define LIBSMU_FAMILY_PM_TABLE_VERSION  0x240903
+#define LIBSMU_FAMILY_PM_TABLE_SIZE     0x518
+#define LIBSMU_FAMILY_PM_TABLE_FIELDS   "pm_tables/matisse_240903.h"
+
+/* RSMU opcodes, see docs/rsmu_commands.md. */
+#define LIBSMU_FAMILY_OP_SET_PPT_LIMIT  0x53
+#define LIBSMU_FAMILY_OP_SET_TDC_LIMIT  0x54
+#define LIBSMU_FAMILY_OP_SET_EDC_LIMIT  0x55
+#else
+#error "Unknown LIBSMU_FAMILY_SELECT, see LIBSMU_FAMILY_ID_* in libsmu_family.h"
+#endif
+
+#ifdef LIBSMU_FAMILY
+
+static const smu_pm_schema_t smu_family_pm_schema = {
+    .codename   = LIBSMU_FAMILY_CODENAME,
+    .version    = LIBSMU_FAMILY_PM_TABLE_VERSION,
+    .size       = LIBSMU_FAMILY_PM_TABLE_SIZE,
+    .fields     = {
+#include LIBSMU_FAMILY_PM_TABLE_FIELDS
+    },
+};
+
+/* [schema] is still evaluated, so that callers compile the same in either build. */
+#define SMU_PM_FIELD(schema, field)     ((void)(schema), &smu_family_pm_schema.fields[field])
+#define SMU_CODENAME(obj)               ((void)(obj), LIBSMU_FAMILY_CODENAME)
+
+static inline const smu_pm_schema_t* smu_get_pm_schema(smu_obj_t* obj) {
+    (void)obj;
+    return &smu_family_pm_schema;
+}
+
+static inline unsigned int smu_pm_tables_supported(smu_obj_t* obj) {
+    (void)obj;
+    return 1;
+}
+
+static inline const char* smu_codename_to_str(smu_obj_t* obj) {
+    (void)obj;
+    return LIBSMU_FAMILY_NAME;
+}
+
+#else
+
+#define SMU_PM_FIELD(schema, field)     (&(schema)->fields[field])
+#define SMU_CODENAME(obj)               ((obj)->codename)
+
+#endif
+
+#endif /* __LIB_SMU_FAMILY_H__ */
@@ -0,0 +1,326 @@
+/**
+ * Ryzen SMU Userspace Library
+ * Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define METRICS_X86
+#endif
+
+#include "libsmu.h"
+
+// Alignment of every output array, allowing whole AVX registers to be loaded from them.
+#define METRICS_ALIGN                   32
+
+// Residency below which AMD considers a core to be sleeping. Source: Ryzen Master
+#define METRICS_ACTIVE_C0               6.f
+
+// Voltage a core settles at while in CC6.
+#define METRICS_SLEEP_VOLTAGE           0.2f
+
+#define MASK_SET(mask, i)               ((mask)[(i) / 64] |= 1ULL << ((i) % 64))
+
+/**
+ * Decodes cores [start, count) of [m] in place.
+ * On entry the frequency array holds the effective frequencies in GHz as reported by the SMU and
+ *  the voltage array the raw core clocks, used to detect gated cores.
+ */
+typedef void (*metrics_kernel_fn)(smu_core_metrics_t* m, unsigned int start, float avg_voltage);
+
+static void metrics_kernel_scalar(smu_core_metrics_t* m, unsigned int start, float avg_voltage) {
+    float freq, sleep, volt;
+    unsigned int i;
+
+    for (i = start; i < m->count; i++) {
+        freq = m->frequency[i] * 1000.f;
+        m->frequency[i] = freq;
+
+        if (freq > m->peak_frequency)
+            m->peak_frequency = freq;
+
+        m->total_c0 += m->c0[i];
+        m->total_c6 += m->c6[i];
+
+        if (m->voltage[i] != 0.f) {
+            sleep = m->c6[i] / 100.f;
+            volt = (1.f - sleep) * avg_voltage + METRICS_SLEEP_VOLTAGE * sleep;
+            m->total_voltage += volt;
+        }
+        else {
+            volt = 0.f;
+            MASK_SET(m->gated, i);
+        }
+
+        m->voltage[i] = volt;
+
+        if (m->c0[i] >= METRICS_ACTIVE_C0)
+            MASK_SET(m->active, i);
+    }
+}
+
+#ifdef METRICS_X86
+
+__attribute__((target("sse2")))
+static void metrics_kernel_sse(smu_core_metrics_t* m, unsigned int start, float avg_voltage) {
+    const __m128 k1000 = _mm_set1_ps(1000.f), k100 = _mm_set1_ps(100.f),
+        one = _mm_set1_ps(1.f), zero = _mm_setzero_ps(), active_c0 = _mm_set1_ps(METRICS_ACTIVE_C0),
+        vsleep = _mm_set1_ps(METRICS_SLEEP_VOLTAGE), vavg = _mm_set1_ps(avg_voltage);
+    __m128 peak = _mm_setzero_ps(), sum_c0 = zero, sum_c6 = zero, sum_v = zero;
+    __m128 freq, c0, c6, raw, sleep, volt, clocked;
+    float lanes[4];
+    unsigned int i, j;
+
+    for (i = start; i + 4 <= m->count; i += 4) {
+        freq = _mm_mul_ps(_mm_load_ps(m->frequency + i), k1000);
+        c0 = _mm_load_ps(m->c0 + i);
+        c6 = _mm_load_ps(m->c6 + i);
+        raw = _mm_load_ps(m->voltage + i);
+
+        _mm_store_ps(m->frequency + i, freq);
+        peak = _mm_max_ps(peak, freq);
+        sum_c0 = _mm_add_ps(sum_c0, c0);
+        sum_c6 = _mm_add_ps(sum_c6, c6);
+
+        sleep = _mm_div_ps(c6, k100);
+        volt = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(one, sleep), vavg), _mm_mul_ps(vsleep, sleep));
+        clocked = _mm_cmpneq_ps(raw, zero);
+        volt = _mm_and_ps(volt, clocked);
+
+        _mm_store_ps(m->voltage + i, volt);
+        sum_v = _mm_add_ps(sum_v, volt);
+
+        // Groups of 4 start on a multiple of 4 so never straddle two mask words.
+        m->gated[i / 64] |= (unsigned long long)(~_mm_movemask_ps(clocked) & 0xF) << (i % 64);
+        m->active[i / 64] |=
+            (unsigned long long)_mm_movemask_ps(_mm_cmpge_ps(c0, active_c0)) << (i % 64);
+    }
+
+    _mm_storeu_ps(lanes, peak);
+    for (j = 0; j < 4; j++) {
+        if (lanes[j] > m->peak_frequency)
+            m->peak_frequency = lanes[j];
+    }
+
+    _mm_storeu_ps(lanes, sum_c0);
+    m->total_c0 += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    _mm_storeu_ps(lanes, sum_c6);
+    m->total_c6 += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    _mm_storeu_ps(lanes, sum_v);
+    m->total_voltage += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    metrics_kernel_scalar(m, i, avg_voltage);
+}
+
+__attribute__((target("avx2")))
+static void metrics_kernel_avx2(smu_core_metrics_t* m, unsigned int start, float avg_voltage) {
+    const __m256 k1000 = _mm256_set1_ps(1000.f), k100 = _mm256_set1_ps(100.f),
+        one = _mm256_set1_ps(1.f), zero = _mm256_setzero_ps(),
+        active_c0 = _mm256_set1_ps(METRICS_ACTIVE_C0), vsleep = _mm256_set1_ps(METRICS_SLEEP_VOLTAGE),
+        vavg = _mm256_set1_ps(avg_voltage);
+    __m256 peak = _mm256_setzero_ps(), sum_c0 = zero, sum_c6 = zero, sum_v = zero;
+    __m256 freq, c0, c6, raw, sleep, volt, clocked;
+    float lanes[8];
+    unsigned int i, j;
+
+    for (i = start; i + 8 <= m->count; i += 8) {
+        freq = _mm256_mul_ps(_mm256_load_ps(m->frequency + i), k1000);
+        c0 = _mm256_load_ps(m->c0 + i);
+        c6 = _mm256_load_ps(m->c6 + i);
+        raw = _mm256_load_ps(m->voltage + i);
+
+        _mm256_store_ps(m->frequency + i, freq);
+        peak = _mm256_max_ps(peak, freq);
+        sum_c0 = _mm256_add_ps(sum_c0, c0);
+        sum_c6 = _mm256_add_ps(sum_c6, c6);
+
+        sleep = _mm256_div_ps(c6, k100);
+        volt = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(one, sleep), vavg),
+            _mm256_mul_ps(vsleep, sleep));
+        clocked = _mm256_cmp_ps(raw, zero, _CMP_NEQ_UQ);
+        volt = _mm256_and_ps(volt, clocked);
+
+        _mm256_store_ps(m->voltage + i, volt);
+        sum_v = _mm256_add_ps(sum_v, volt);
+
+        m->gated[i / 64] |= (unsigned long long)(~_mm256_movemask_ps(clocked) & 0xFF) << (i % 64);
+        m->active[i / 64] |=
+            (unsigned long long)_mm256_movemask_ps(_mm256_cmp_ps(c0, active_c0, _CMP_GE_OQ))
+                << (i % 64);
+    }
+
+    _mm256_storeu_ps(lanes, peak);
+    for (j = 0; j < 8; j++) {
+        if (lanes[j] > m->peak_frequency)
+            m->peak_frequency = lanes[j];
+    }
+
+    _mm256_storeu_ps(lanes, sum_c0);
+    for (j = 0; j < 8; j++)
+        m->total_c0 += lanes[j];
+    _mm256_storeu_ps(lanes, sum_c6);
+    for (j = 0; j < 8; j++)
+        m->total_c6 += lanes[j];
+    _mm256_storeu_ps(lanes, sum_v);
+    for (j = 0; j < 8; j++)
+        m->total_voltage += lanes[j];
+
+    // Leaves at most 7 cores, which still fit a whole SSE iteration.
+    metrics_kernel_sse(m, i, avg_voltage);
+}
+
+#endif /* METRICS_X86 */
+
+static metrics_kernel_fn g_metrics_kernel = metrics_kernel_scalar;
+static smu_metrics_isa g_metrics_isa = SMU_METRICS_ISA_SCALAR;
+static pthread_once_t g_metrics_once = PTHREAD_ONCE_INIT;
+
+static void metrics_select_kernel(void) {
+#ifdef METRICS_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        g_metrics_kernel = metrics_kernel_avx2;
+        g_metrics_isa = SMU_METRICS_ISA_AVX2;
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        g_metrics_kernel = metrics_kernel_sse;
+        g_metrics_isa = SMU_METRICS_ISA_SSE2;
+    }
+#endif
+}
+
+smu_metrics_isa smu_core_metrics_isa(void) {
+    pthread_once(&g_metrics_once, metrics_select_kernel);
+    return g_metrics_isa;
+}
+
+static float* metrics_alloc_array(unsigned int cores) {
+    void* ptr;
+
+    // Padded up to a whole vector so the arrays may also be consumed a register at a time.
+    if (posix_memalign(&ptr, METRICS_ALIGN, ((cores + 7) & ~7U) * sizeof(float)))
+        return NULL;
+
+    memset(ptr, 0, ((cores + 7) & ~7U) * sizeof(float));
+    return ptr;
+}
+
+smu_return_val smu_core_metrics_init(smu_core_metrics_t* m, unsigned int cores) {
+    unsigned int words = (cores + 63) / 64;
+
+    memset(m, 0, sizeof(*m));
+
+    if (!cores)
+        return SMU_Return_InsufficientSize;
+
+    m->capacity = cores;
+    m->frequency = metrics_alloc_array(cores);
+    m->voltage = metrics_alloc_array(cores);
+    m->power = metrics_alloc_array(cores);
+    m->temperature = metrics_alloc_array(cores);
+    m->c0 = metrics_alloc_array(cores);
+    m->c1 = metrics_alloc_array(cores);
+    m->c6 = metrics_alloc_array(cores);
+    m->active = calloc(words, sizeof(*m->active));
+    m->gated = calloc(words, sizeof(*m->gated));
+
+    if (!m->frequency || !m->voltage || !m->power || !m->temperature || !m->c0 || !m->c1 ||
+        !m->c6 || !m->active || !m->gated) {
+        smu_core_metrics_free(m);
+        return SMU_Return_RWError;
+    }
+
+    pthread_once(&g_metrics_once, metrics_select_kernel);
+
+    return SMU_Return_OK;
+}
+
+void smu_core_metrics_free(smu_core_metrics_t* m) {
+    free(m->frequency);
+    free(m->voltage);
+    free(m->power);
+    free(m->temperature);
+    free(m->c0);
+    free(m->c1);
+    free(m->c6);
+    free(m->active);
+    free(m->gated);
+
+    memset(m, 0, sizeof(*m));
+}
+
+/**
+ * Copies the first [count] elements of [field] into [dst], returning 0 if the table doesn't
+ *  report that many.
+ */
+static int metrics_gather(const smu_pm_schema_t* schema, const unsigned char* table,
+    smu_pm_field field, float* dst, unsigned int count) {
+    const smu_pm_field_t* f = SMU_PM_FIELD(schema, field);
+    unsigned int i;
+
+    if (f->count < count || f->type != PM_TYPE_F32)
+        return 0;
+
+    if (f->stride == sizeof(float)) {
+        memcpy(dst, table + f->offset, count * sizeof(float));
+        return 1;
+    }
+
+    for (i = 0; i < count; i++)
+        memcpy(dst + i, table + f->offset + i * f->stride, sizeof(float));
+
+    return 1;
+}
+
+smu_return_val smu_decode_core_metrics(const smu_pm_schema_t* schema, const void* table,
+    unsigned int cores, smu_core_metrics_t* m) {
+    float package_sleep;
+
+    if (cores > m->capacity)
+        return SMU_Return_InsufficientSize;
+
+    // The raw core clocks are staged in the voltage array, which the kernel then overwrites.
+    if (!metrics_gather(schema, table, PM_FIELD_CORE_FREQEFF, m->frequency, cores) ||
+        !metrics_gather(schema, table, PM_FIELD_CORE_FREQ, m->voltage, cores) ||
+        !metrics_gather(schema, table, PM_FIELD_CORE_POWER, m->power, cores) ||
+        !metrics_gather(schema, table, PM_FIELD_CORE_TEMP, m->temperature, cores) ||
+        !metrics_gather(schema, table, PM_FIELD_CORE_C0, m->c0, cores) ||
+        !metrics_gather(schema, table, PM_FIELD_CORE_CC1, m->c1, cores) ||
+        !metrics_gather(schema, table, PM_FIELD_CORE_CC6, m->c6, cores) ||
+        !SMU_PM_FIELD(schema, PM_FIELD_PC6)->count ||
+        !SMU_PM_FIELD(schema, PM_FIELD_CPU_TELEMETRY_VOLTAGE)->count)
+        return SMU_Return_Unsupported;
+
+    m->count = cores;
+    m->peak_frequency = m->total_c0 = m->total_c6 = m->total_voltage = 0.f;
+    memset(m->active, 0, ((m->capacity + 63) / 64) * sizeof(*m->active));
+    memset(m->gated, 0, ((m->capacity + 63) / 64) * sizeof(*m->gated));
+
+    // The telemetry voltage averages in the time the package spent asleep at the CC6 voltage,
+    //  which is removed to estimate the voltage of the cores while awake.
+    package_sleep = smu_pm_get_f32(schema, table, PM_FIELD_PC6, 0) / 100.f;
+    m->package_voltage = package_sleep < 1.f ?
+        (smu_pm_get_f32(schema, table, PM_FIELD_CPU_TELEMETRY_VOLTAGE, 0) -
+            METRICS_SLEEP_VOLTAGE * package_sleep) / (1.f - package_sleep) : METRICS_SLEEP_VOLTAGE;
+
+    g_metrics_kernel(m, 0, m->package_voltage);
+
+    return SMU_Return_OK;
+}
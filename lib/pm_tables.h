@@ -0,0 +1,216 @@
+/**
+ * Ryzen SMU Userspace Library
+ * Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+/**
+ * PM table layouts known to the library.
+ * Only included by libsmu.c, consumers go through smu_get_pm_schema() instead. The fields of
+ *  each version live under pm_tables/, shared with libsmu_family.h.
+ **/
+
+#ifndef __LIB_SMU_PM_TABLES_H__
+#define __LIB_SMU_PM_TABLES_H__
+
+#include "libsmu.h"
+
+static const char* const g_pm_field_names[PM_FIELD_COUNT] = {
+    [PM_FIELD_PPT_LIMIT]                = "PPT_LIMIT",
+    [PM_FIELD_PPT_VALUE]                = "PPT_VALUE",
+    [PM_FIELD_TDC_LIMIT]                = "TDC_LIMIT",
+    [PM_FIELD_TDC_VALUE]                = "TDC_VALUE",
+    [PM_FIELD_THM_LIMIT]                = "THM_LIMIT",
+    [PM_FIELD_THM_VALUE]                = "THM_VALUE",
+    [PM_FIELD_FIT_LIMIT]                = "FIT_LIMIT",
+    [PM_FIELD_FIT_VALUE]                = "FIT_VALUE",
+    [PM_FIELD_EDC_LIMIT]                = "EDC_LIMIT",
+    [PM_FIELD_EDC_VALUE]                = "EDC_VALUE",
+    [PM_FIELD_VID_LIMIT]                = "VID_LIMIT",
+    [PM_FIELD_VID_VALUE]                = "VID_VALUE",
+    [PM_FIELD_PPT_WC]                   = "PPT_WC",
+    [PM_FIELD_PPT_ACTUAL]               = "PPT_ACTUAL",
+    [PM_FIELD_TDC_WC]                   = "TDC_WC",
+    [PM_FIELD_TDC_ACTUAL]               = "TDC_ACTUAL",
+    [PM_FIELD_THM_WC]                   = "THM_WC",
+    [PM_FIELD_THM_ACTUAL]               = "THM_ACTUAL",
+    [PM_FIELD_FIT_WC]                   = "FIT_WC",
+    [PM_FIELD_FIT_ACTUAL]               = "FIT_ACTUAL",
+    [PM_FIELD_EDC_WC]                   = "EDC_WC",
+    [PM_FIELD_EDC_ACTUAL]               = "EDC_ACTUAL",
+    [PM_FIELD_VID_WC]                   = "VID_WC",
+    [PM_FIELD_VID_ACTUAL]               = "VID_ACTUAL",
+    [PM_FIELD_VDDCR_CPU_POWER]          = "VDDCR_CPU_POWER",
+    [PM_FIELD_VDDCR_SOC_POWER]          = "VDDCR_SOC_POWER",
+    [PM_FIELD_VDDIO_MEM_POWER]          = "VDDIO_MEM_POWER",
+    [PM_FIELD_VDD18_POWER]              = "VDD18_POWER",
+    [PM_FIELD_ROC_POWER]                = "ROC_POWER",
+    [PM_FIELD_SOCKET_POWER]             = "SOCKET_POWER",
+    [PM_FIELD_PPT_FREQUENCY]            = "PPT_FREQUENCY",
+    [PM_FIELD_TDC_FREQUENCY]            = "TDC_FREQUENCY",
+    [PM_FIELD_THM_FREQUENCY]            = "THM_FREQUENCY",
+    [PM_FIELD_PROCHOT_FREQUENCY]        = "PROCHOT_FREQUENCY",
+    [PM_FIELD_VOLTAGE_FREQUENCY]        = "VOLTAGE_FREQUENCY",
+    [PM_FIELD_CCA_FREQUENCY]            = "CCA_FREQUENCY",
+    [PM_FIELD_FIT_VOLTAGE]              = "FIT_VOLTAGE",
+    [PM_FIELD_FIT_PRE_VOLTAGE]          = "FIT_PRE_VOLTAGE",
+    [PM_FIELD_LATCHUP_VOLTAGE]          = "LATCHUP_VOLTAGE",
+    [PM_FIELD_CPU_SET_VOLTAGE]          = "CPU_SET_VOLTAGE",
+    [PM_FIELD_CPU_TELEMETRY_VOLTAGE]    = "CPU_TELEMETRY_VOLTAGE",
+    [PM_FIELD_CPU_TELEMETRY_CURRENT]    = "CPU_TELEMETRY_CURRENT",
+    [PM_FIELD_CPU_TELEMETRY_POWER]      = "CPU_TELEMETRY_POWER",
+    [PM_FIELD_CPU_TELEMETRY_POWER_ALT]  = "CPU_TELEMETRY_POWER_ALT",
+    [PM_FIELD_SOC_SET_VOLTAGE]          = "SOC_SET_VOLTAGE",
+    [PM_FIELD_SOC_TELEMETRY_VOLTAGE]    = "SOC_TELEMETRY_VOLTAGE",
+    [PM_FIELD_SOC_TELEMETRY_CURRENT]    = "SOC_TELEMETRY_CURRENT",
+    [PM_FIELD_SOC_TELEMETRY_POWER]      = "SOC_TELEMETRY_POWER",
+    [PM_FIELD_FCLK_FREQ]                = "FCLK_FREQ",
+    [PM_FIELD_FCLK_FREQ_EFF]            = "FCLK_FREQ_EFF",
+    [PM_FIELD_UCLK_FREQ]                = "UCLK_FREQ",
+    [PM_FIELD_MEMCLK_FREQ]              = "MEMCLK_FREQ",
+    [PM_FIELD_FCLK_DRAM_SETPOINT]       = "FCLK_DRAM_SETPOINT",
+    [PM_FIELD_FCLK_DRAM_BUSY]           = "FCLK_DRAM_BUSY",
+    [PM_FIELD_FCLK_GMI_SETPOINT]        = "FCLK_GMI_SETPOINT",
+    [PM_FIELD_FCLK_GMI_BUSY]            = "FCLK_GMI_BUSY",
+    [PM_FIELD_FCLK_IOHC_SETPOINT]       = "FCLK_IOHC_SETPOINT",
+    [PM_FIELD_FCLK_IOHC_BUSY]           = "FCLK_IOHC_BUSY",
+    [PM_FIELD_FCLK_XGMI_SETPOINT]       = "FCLK_XGMI_SETPOINT",
+    [PM_FIELD_FCLK_XGMI_BUSY]           = "FCLK_XGMI_BUSY",
+    [PM_FIELD_CCM_READS]                = "CCM_READS",
+    [PM_FIELD_CCM_WRITES]               = "CCM_WRITES",
+    [PM_FIELD_IOMS]                     = "IOMS",
+    [PM_FIELD_XGMI]                     = "XGMI",
+    [PM_FIELD_CS_UMC_READS]             = "CS_UMC_READS",
+    [PM_FIELD_CS_UMC_WRITES]            = "CS_UMC_WRITES",
+    [PM_FIELD_FCLK_RESIDENCY]           = "FCLK_RESIDENCY",
+    [PM_FIELD_FCLK_FREQ_TABLE]          = "FCLK_FREQ_TABLE",
+    [PM_FIELD_UCLK_FREQ_TABLE]          = "UCLK_FREQ_TABLE",
+    [PM_FIELD_MEMCLK_FREQ_TABLE]        = "MEMCLK_FREQ_TABLE",
+    [PM_FIELD_FCLK_VOLTAGE]             = "FCLK_VOLTAGE",
+    [PM_FIELD_LCLK_SETPOINT_0]          = "LCLK_SETPOINT_0",
+    [PM_FIELD_LCLK_BUSY_0]              = "LCLK_BUSY_0",
+    [PM_FIELD_LCLK_FREQ_0]              = "LCLK_FREQ_0",
+    [PM_FIELD_LCLK_FREQ_EFF_0]          = "LCLK_FREQ_EFF_0",
+    [PM_FIELD_LCLK_MAX_DPM_0]           = "LCLK_MAX_DPM_0",
+    [PM_FIELD_LCLK_MIN_DPM_0]           = "LCLK_MIN_DPM_0",
+    [PM_FIELD_LCLK_SETPOINT_1]          = "LCLK_SETPOINT_1",
+    [PM_FIELD_LCLK_BUSY_1]              = "LCLK_BUSY_1",
+    [PM_FIELD_LCLK_FREQ_1]              = "LCLK_FREQ_1",
+    [PM_FIELD_LCLK_FREQ_EFF_1]          = "LCLK_FREQ_EFF_1",
+    [PM_FIELD_LCLK_MAX_DPM_1]           = "LCLK_MAX_DPM_1",
+    [PM_FIELD_LCLK_MIN_DPM_1]           = "LCLK_MIN_DPM_1",
+    [PM_FIELD_LCLK_SETPOINT_2]          = "LCLK_SETPOINT_2",
+    [PM_FIELD_LCLK_BUSY_2]              = "LCLK_BUSY_2",
+    [PM_FIELD_LCLK_FREQ_2]              = "LCLK_FREQ_2",
+    [PM_FIELD_LCLK_FREQ_EFF_2]          = "LCLK_FREQ_EFF_2",
+    [PM_FIELD_LCLK_MAX_DPM_2]           = "LCLK_MAX_DPM_2",
+    [PM_FIELD_LCLK_MIN_DPM_2]           = "LCLK_MIN_DPM_2",
+    [PM_FIELD_LCLK_SETPOINT_3]          = "LCLK_SETPOINT_3",
+    [PM_FIELD_LCLK_BUSY_3]              = "LCLK_BUSY_3",
+    [PM_FIELD_LCLK_FREQ_3]              = "LCLK_FREQ_3",
+    [PM_FIELD_LCLK_FREQ_EFF_3]          = "LCLK_FREQ_EFF_3",
+    [PM_FIELD_LCLK_MAX_DPM_3]           = "LCLK_MAX_DPM_3",
+    [PM_FIELD_LCLK_MIN_DPM_3]           = "LCLK_MIN_DPM_3",
+    [PM_FIELD_XGMI_SETPOINT]            = "XGMI_SETPOINT",
+    [PM_FIELD_XGMI_BUSY]                = "XGMI_BUSY",
+    [PM_FIELD_XGMI_LANE_WIDTH]          = "XGMI_LANE_WIDTH",
+    [PM_FIELD_XGMI_DATA_RATE]           = "XGMI_DATA_RATE",
+    [PM_FIELD_SOC_POWER]                = "SOC_POWER",
+    [PM_FIELD_SOC_TEMP]                 = "SOC_TEMP",
+    [PM_FIELD_DDR_VDDP_POWER]           = "DDR_VDDP_POWER",
+    [PM_FIELD_DDR_VDDIO_MEM_POWER]      = "DDR_VDDIO_MEM_POWER",
+    [PM_FIELD_GMI2_VDDG_POWER]          = "GMI2_VDDG_POWER",
+    [PM_FIELD_IO_VDDCR_SOC_POWER]       = "IO_VDDCR_SOC_POWER",
+    [PM_FIELD_IOD_VDDIO_MEM_POWER]      = "IOD_VDDIO_MEM_POWER",
+    [PM_FIELD_IO_VDD18_POWER]           = "IO_VDD18_POWER",
+    [PM_FIELD_TDP]                      = "TDP",
+    [PM_FIELD_DETERMINISM]              = "DETERMINISM",
+    [PM_FIELD_V_VDDM]                   = "V_VDDM",
+    [PM_FIELD_V_VDDP]                   = "V_VDDP",
+    [PM_FIELD_V_VDDG]                   = "V_VDDG",
+    [PM_FIELD_PEAK_TEMP]                = "PEAK_TEMP",
+    [PM_FIELD_PEAK_VOLTAGE]             = "PEAK_VOLTAGE",
+    [PM_FIELD_AVG_CORE_COUNT]           = "AVG_CORE_COUNT",
+    [PM_FIELD_CCLK_LIMIT]               = "CCLK_LIMIT",
+    [PM_FIELD_MAX_VOLTAGE]              = "MAX_VOLTAGE",
+    [PM_FIELD_DC_BTC]                   = "DC_BTC",
+    [PM_FIELD_CSTATE_BOOST]             = "CSTATE_BOOST",
+    [PM_FIELD_PROCHOT]                  = "PROCHOT",
+    [PM_FIELD_PC6]                      = "PC6",
+    [PM_FIELD_PWM]                      = "PWM",
+    [PM_FIELD_SOCCLK]                   = "SOCCLK",
+    [PM_FIELD_SHUBCLK]                  = "SHUBCLK",
+    [PM_FIELD_MP0CLK]                   = "MP0CLK",
+    [PM_FIELD_MP1CLK]                   = "MP1CLK",
+    [PM_FIELD_MP5CLK]                   = "MP5CLK",
+    [PM_FIELD_SMNCLK]                   = "SMNCLK",
+    [PM_FIELD_TWIXCLK]                  = "TWIXCLK",
+    [PM_FIELD_WAFLCLK]                  = "WAFLCLK",
+    [PM_FIELD_DPM_BUSY]                 = "DPM_BUSY",
+    [PM_FIELD_MP1_BUSY]                 = "MP1_BUSY",
+    [PM_FIELD_CORE_POWER]               = "CORE_POWER",
+    [PM_FIELD_CORE_VOLTAGE]             = "CORE_VOLTAGE",
+    [PM_FIELD_CORE_TEMP]                = "CORE_TEMP",
+    [PM_FIELD_CORE_FIT]                 = "CORE_FIT",
+    [PM_FIELD_CORE_IDDMAX]              = "CORE_IDDMAX",
+    [PM_FIELD_CORE_FREQ]                = "CORE_FREQ",
+    [PM_FIELD_CORE_FREQEFF]             = "CORE_FREQEFF",
+    [PM_FIELD_CORE_C0]                  = "CORE_C0",
+    [PM_FIELD_CORE_CC1]                 = "CORE_CC1",
+    [PM_FIELD_CORE_CC6]                 = "CORE_CC6",
+    [PM_FIELD_CORE_CKS_FDD]             = "CORE_CKS_FDD",
+    [PM_FIELD_CORE_CI_FDD]              = "CORE_CI_FDD",
+    [PM_FIELD_CORE_IRM]                 = "CORE_IRM",
+    [PM_FIELD_CORE_PSTATE]              = "CORE_PSTATE",
+    [PM_FIELD_CORE_CPPC_MAX]            = "CORE_CPPC_MAX",
+    [PM_FIELD_CORE_CPPC_MIN]            = "CORE_CPPC_MIN",
+    [PM_FIELD_CORE_SC_LIMIT]            = "CORE_SC_LIMIT",
+    [PM_FIELD_CORE_SC_CAC]              = "CORE_SC_CAC",
+    [PM_FIELD_CORE_SC_RESIDENCY]        = "CORE_SC_RESIDENCY",
+    [PM_FIELD_L3_LOGIC_POWER]           = "L3_LOGIC_POWER",
+    [PM_FIELD_L3_VDDM_POWER]            = "L3_VDDM_POWER",
+    [PM_FIELD_L3_TEMP]                  = "L3_TEMP",
+    [PM_FIELD_L3_FIT]                   = "L3_FIT",
+    [PM_FIELD_L3_IDDMAX]                = "L3_IDDMAX",
+    [PM_FIELD_L3_FREQ]                  = "L3_FREQ",
+    [PM_FIELD_L3_CKS_FDD]               = "L3_CKS_FDD",
+    [PM_FIELD_L3_CCA_THRESHOLD]         = "L3_CCA_THRESHOLD",
+    [PM_FIELD_L3_CCA_CAC]               = "L3_CCA_CAC",
+    [PM_FIELD_L3_CCA_ACTIVATION]        = "L3_CCA_ACTIVATION",
+    [PM_FIELD_L3_EDC_LIMIT]             = "L3_EDC_LIMIT",
+    [PM_FIELD_L3_EDC_CAC]               = "L3_EDC_CAC",
+    [PM_FIELD_L3_EDC_RESIDENCY]         = "L3_EDC_RESIDENCY",
+    [PM_FIELD_MP5_BUSY]                 = "MP5_BUSY",
+};
+
+/**
+ * Each entry is matched on both the codename & the table version reported by the SMU.
+ * Fields a version does not report are left zeroed, giving them a count of zero.
+ */
+static const smu_pm_schema_t g_pm_schemas[] = {
+    // Ryzen 3700X/3800X
+    {
+        .codename   = CODENAME_MATISSE,
+        .version    = 0x240903,
+        .size       = 0x518,
+        .fields     = {
+#include "pm_tables/matisse_240903.h"
+        },
+    },
+};
+
+#define PM_SCHEMA_COUNT             (sizeof(g_pm_schemas) / sizeof(g_pm_schemas[0]))
+
+#endif /* __LIB_SMU_PM_TABLES_H__ */
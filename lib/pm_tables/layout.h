@@ -0,0 +1,29 @@
+/**
+ * Ryzen SMU Userspace Library
+ * Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+/**
+ * Helpers describing the fields of a PM table layout, for the files under pm_tables/.
+ **/
+
+#ifndef __LIB_SMU_PM_LAYOUT_H__
+#define __LIB_SMU_PM_LAYOUT_H__
+
+#define PM_F32(offs)                { (offs), 1, 0, PM_TYPE_F32 }
+#define PM_F32_ARRAY(offs, n)       { (offs), (n), sizeof(float), PM_TYPE_F32 }
+
+#endif /* __LIB_SMU_PM_LAYOUT_H__ */
@@ -0,0 +1,191 @@
+/**
+ * Ryzen SMU Userspace Library
+ * Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+/**
+ * Fields of Matisse PM table version 0x240903 (Ryzen 3700X/3800X), 0x518 bytes.
+ * Included within the initializer of a smu_pm_schema_t, both by the registry of pm_tables.h and
+ *  by builds specialized for the family in libsmu_family.h.
+ **/
+
+#include "layout.h"
+
+    [PM_FIELD_PPT_LIMIT]                = PM_F32(0x000),
+    [PM_FIELD_PPT_VALUE]                = PM_F32(0x004),
+    [PM_FIELD_TDC_LIMIT]                = PM_F32(0x008),
+    [PM_FIELD_TDC_VALUE]                = PM_F32(0x00C),
+    [PM_FIELD_THM_LIMIT]                = PM_F32(0x010),
+    [PM_FIELD_THM_VALUE]                = PM_F32(0x014),
+    [PM_FIELD_FIT_LIMIT]                = PM_F32(0x018),
+    [PM_FIELD_FIT_VALUE]                = PM_F32(0x01C),
+    [PM_FIELD_EDC_LIMIT]                = PM_F32(0x020),
+    [PM_FIELD_EDC_VALUE]                = PM_F32(0x024),
+    [PM_FIELD_VID_LIMIT]                = PM_F32(0x028),
+    [PM_FIELD_VID_VALUE]                = PM_F32(0x02C),
+    [PM_FIELD_PPT_WC]                   = PM_F32(0x030),
+    [PM_FIELD_PPT_ACTUAL]               = PM_F32(0x034),
+    [PM_FIELD_TDC_WC]                   = PM_F32(0x038),
+    [PM_FIELD_TDC_ACTUAL]               = PM_F32(0x03C),
+    [PM_FIELD_THM_WC]                   = PM_F32(0x040),
+    [PM_FIELD_THM_ACTUAL]               = PM_F32(0x044),
+    [PM_FIELD_FIT_WC]                   = PM_F32(0x048),
+    [PM_FIELD_FIT_ACTUAL]               = PM_F32(0x04C),
+    [PM_FIELD_EDC_WC]                   = PM_F32(0x050),
+    [PM_FIELD_EDC_ACTUAL]               = PM_F32(0x054),
+    [PM_FIELD_VID_WC]                   = PM_F32(0x058),
+    [PM_FIELD_VID_ACTUAL]               = PM_F32(0x05C),
+    [PM_FIELD_VDDCR_CPU_POWER]          = PM_F32(0x060),
+    [PM_FIELD_VDDCR_SOC_POWER]          = PM_F32(0x064),
+    [PM_FIELD_VDDIO_MEM_POWER]          = PM_F32(0x068),
+    [PM_FIELD_VDD18_POWER]              = PM_F32(0x06C),
+    [PM_FIELD_ROC_POWER]                = PM_F32(0x070),
+    [PM_FIELD_SOCKET_POWER]             = PM_F32(0x074),
+    [PM_FIELD_PPT_FREQUENCY]            = PM_F32(0x078),
+    [PM_FIELD_TDC_FREQUENCY]            = PM_F32(0x07C),
+    [PM_FIELD_THM_FREQUENCY]            = PM_F32(0x080),
+    [PM_FIELD_PROCHOT_FREQUENCY]        = PM_F32(0x084),
+    [PM_FIELD_VOLTAGE_FREQUENCY]        = PM_F32(0x088),
+    [PM_FIELD_CCA_FREQUENCY]            = PM_F32(0x08C),
+    [PM_FIELD_FIT_VOLTAGE]              = PM_F32(0x090),
+    [PM_FIELD_FIT_PRE_VOLTAGE]          = PM_F32(0x094),
+    [PM_FIELD_LATCHUP_VOLTAGE]          = PM_F32(0x098),
+    [PM_FIELD_CPU_SET_VOLTAGE]          = PM_F32(0x09C),
+    [PM_FIELD_CPU_TELEMETRY_VOLTAGE]    = PM_F32(0x0A0),
+    [PM_FIELD_CPU_TELEMETRY_CURRENT]    = PM_F32(0x0A4),
+    [PM_FIELD_CPU_TELEMETRY_POWER]      = PM_F32(0x0A8),
+    [PM_FIELD_CPU_TELEMETRY_POWER_ALT]  = PM_F32(0x0AC),
+    [PM_FIELD_SOC_SET_VOLTAGE]          = PM_F32(0x0B0),
+    [PM_FIELD_SOC_TELEMETRY_VOLTAGE]    = PM_F32(0x0B4),
+    [PM_FIELD_SOC_TELEMETRY_CURRENT]    = PM_F32(0x0B8),
+    [PM_FIELD_SOC_TELEMETRY_POWER]      = PM_F32(0x0BC),
+    [PM_FIELD_FCLK_FREQ]                = PM_F32(0x0C0),
+    [PM_FIELD_FCLK_FREQ_EFF]            = PM_F32(0x0C4),
+    [PM_FIELD_UCLK_FREQ]                = PM_F32(0x0C8),
+    [PM_FIELD_MEMCLK_FREQ]              = PM_F32(0x0CC),
+    [PM_FIELD_FCLK_DRAM_SETPOINT]       = PM_F32(0x0D0),
+    [PM_FIELD_FCLK_DRAM_BUSY]           = PM_F32(0x0D4),
+    [PM_FIELD_FCLK_GMI_SETPOINT]        = PM_F32(0x0D8),
+    [PM_FIELD_FCLK_GMI_BUSY]            = PM_F32(0x0DC),
+    [PM_FIELD_FCLK_IOHC_SETPOINT]       = PM_F32(0x0E0),
+    [PM_FIELD_FCLK_IOHC_BUSY]           = PM_F32(0x0E4),
+    [PM_FIELD_FCLK_XGMI_SETPOINT]       = PM_F32(0x0E8),
+    [PM_FIELD_FCLK_XGMI_BUSY]           = PM_F32(0x0EC),
+    [PM_FIELD_CCM_READS]                = PM_F32(0x0F0),
+    [PM_FIELD_CCM_WRITES]               = PM_F32(0x0F4),
+    [PM_FIELD_IOMS]                     = PM_F32(0x0F8),
+    [PM_FIELD_XGMI]                     = PM_F32(0x0FC),
+    [PM_FIELD_CS_UMC_READS]             = PM_F32(0x100),
+    [PM_FIELD_CS_UMC_WRITES]            = PM_F32(0x104),
+    [PM_FIELD_FCLK_RESIDENCY]           = PM_F32_ARRAY(0x108, 4),
+    [PM_FIELD_FCLK_FREQ_TABLE]          = PM_F32_ARRAY(0x118, 4),
+    [PM_FIELD_UCLK_FREQ_TABLE]          = PM_F32_ARRAY(0x128, 4),
+    [PM_FIELD_MEMCLK_FREQ_TABLE]        = PM_F32_ARRAY(0x138, 4),
+    [PM_FIELD_FCLK_VOLTAGE]             = PM_F32_ARRAY(0x148, 4),
+    [PM_FIELD_LCLK_SETPOINT_0]          = PM_F32(0x158),
+    [PM_FIELD_LCLK_BUSY_0]              = PM_F32(0x15C),
+    [PM_FIELD_LCLK_FREQ_0]              = PM_F32(0x160),
+    [PM_FIELD_LCLK_FREQ_EFF_0]          = PM_F32(0x164),
+    [PM_FIELD_LCLK_MAX_DPM_0]           = PM_F32(0x168),
+    [PM_FIELD_LCLK_MIN_DPM_0]           = PM_F32(0x16C),
+    [PM_FIELD_LCLK_SETPOINT_1]          = PM_F32(0x170),
+    [PM_FIELD_LCLK_BUSY_1]              = PM_F32(0x174),
+    [PM_FIELD_LCLK_FREQ_1]              = PM_F32(0x178),
+    [PM_FIELD_LCLK_FREQ_EFF_1]          = PM_F32(0x17C),
+    [PM_FIELD_LCLK_MAX_DPM_1]           = PM_F32(0x180),
+    [PM_FIELD_LCLK_MIN_DPM_1]           = PM_F32(0x184),
+    [PM_FIELD_LCLK_SETPOINT_2]          = PM_F32(0x188),
+    [PM_FIELD_LCLK_BUSY_2]              = PM_F32(0x18C),
+    [PM_FIELD_LCLK_FREQ_2]              = PM_F32(0x190),
+    [PM_FIELD_LCLK_FREQ_EFF_2]          = PM_F32(0x194),
+    [PM_FIELD_LCLK_MAX_DPM_2]           = PM_F32(0x198),
+    [PM_FIELD_LCLK_MIN_DPM_2]           = PM_F32(0x19C),
+    [PM_FIELD_LCLK_SETPOINT_3]          = PM_F32(0x1A0),
+    [PM_FIELD_LCLK_BUSY_3]              = PM_F32(0x1A4),
+    [PM_FIELD_LCLK_FREQ_3]              = PM_F32(0x1A8),
+    [PM_FIELD_LCLK_FREQ_EFF_3]          = PM_F32(0x1AC),
+    [PM_FIELD_LCLK_MAX_DPM_3]           = PM_F32(0x1B0),
+    [PM_FIELD_LCLK_MIN_DPM_3]           = PM_F32(0x1B4),
+    [PM_FIELD_XGMI_SETPOINT]            = PM_F32(0x1B8),
+    [PM_FIELD_XGMI_BUSY]                = PM_F32(0x1BC),
+    [PM_FIELD_XGMI_LANE_WIDTH]          = PM_F32(0x1C0),
+    [PM_FIELD_XGMI_DATA_RATE]           = PM_F32(0x1C4),
+    [PM_FIELD_SOC_POWER]                = PM_F32(0x1C8),
+    [PM_FIELD_SOC_TEMP]                 = PM_F32(0x1CC),
+    [PM_FIELD_DDR_VDDP_POWER]           = PM_F32(0x1D0),
+    [PM_FIELD_DDR_VDDIO_MEM_POWER]      = PM_F32(0x1D4),
+    [PM_FIELD_GMI2_VDDG_POWER]          = PM_F32(0x1D8),
+    [PM_FIELD_IO_VDDCR_SOC_POWER]       = PM_F32(0x1DC),
+    [PM_FIELD_IOD_VDDIO_MEM_POWER]      = PM_F32(0x1E0),
+    [PM_FIELD_IO_VDD18_POWER]           = PM_F32(0x1E4),
+    [PM_FIELD_TDP]                      = PM_F32(0x1E8),
+    [PM_FIELD_DETERMINISM]              = PM_F32(0x1EC),
+    [PM_FIELD_V_VDDM]                   = PM_F32(0x1F0),
+    [PM_FIELD_V_VDDP]                   = PM_F32(0x1F4),
+    [PM_FIELD_V_VDDG]                   = PM_F32(0x1F8),
+    [PM_FIELD_PEAK_TEMP]                = PM_F32(0x1FC),
+    [PM_FIELD_PEAK_VOLTAGE]             = PM_F32(0x200),
+    [PM_FIELD_AVG_CORE_COUNT]           = PM_F32(0x204),
+    [PM_FIELD_CCLK_LIMIT]               = PM_F32(0x208),
+    [PM_FIELD_MAX_VOLTAGE]              = PM_F32(0x20C),
+    [PM_FIELD_DC_BTC]                   = PM_F32(0x210),
+    [PM_FIELD_CSTATE_BOOST]             = PM_F32(0x214),
+    [PM_FIELD_PROCHOT]                  = PM_F32(0x218),
+    [PM_FIELD_PC6]                      = PM_F32(0x21C),
+    [PM_FIELD_PWM]                      = PM_F32(0x220),
+    [PM_FIELD_SOCCLK]                   = PM_F32(0x224),
+    [PM_FIELD_SHUBCLK]                  = PM_F32(0x228),
+    [PM_FIELD_MP0CLK]                   = PM_F32(0x22C),
+    [PM_FIELD_MP1CLK]                   = PM_F32(0x230),
+    [PM_FIELD_MP5CLK]                   = PM_F32(0x234),
+    [PM_FIELD_SMNCLK]                   = PM_F32(0x238),
+    [PM_FIELD_TWIXCLK]                  = PM_F32(0x23C),
+    [PM_FIELD_WAFLCLK]                  = PM_F32(0x240),
+    [PM_FIELD_DPM_BUSY]                 = PM_F32(0x244),
+    [PM_FIELD_MP1_BUSY]                 = PM_F32(0x248),
+    [PM_FIELD_CORE_POWER]               = PM_F32_ARRAY(0x24C, 8),
+    [PM_FIELD_CORE_VOLTAGE]             = PM_F32_ARRAY(0x26C, 8),
+    [PM_FIELD_CORE_TEMP]                = PM_F32_ARRAY(0x28C, 8),
+    [PM_FIELD_CORE_FIT]                 = PM_F32_ARRAY(0x2AC, 8),
+    [PM_FIELD_CORE_IDDMAX]              = PM_F32_ARRAY(0x2CC, 8),
+    [PM_FIELD_CORE_FREQ]                = PM_F32_ARRAY(0x2EC, 8),
+    [PM_FIELD_CORE_FREQEFF]             = PM_F32_ARRAY(0x30C, 8),
+    [PM_FIELD_CORE_C0]                  = PM_F32_ARRAY(0x32C, 8),
+    [PM_FIELD_CORE_CC1]                 = PM_F32_ARRAY(0x34C, 8),
+    [PM_FIELD_CORE_CC6]                 = PM_F32_ARRAY(0x36C, 8),
+    [PM_FIELD_CORE_CKS_FDD]             = PM_F32_ARRAY(0x38C, 8),
+    [PM_FIELD_CORE_CI_FDD]              = PM_F32_ARRAY(0x3AC, 8),
+    [PM_FIELD_CORE_IRM]                 = PM_F32_ARRAY(0x3CC, 8),
+    [PM_FIELD_CORE_PSTATE]              = PM_F32_ARRAY(0x3EC, 8),
+    [PM_FIELD_CORE_CPPC_MAX]            = PM_F32_ARRAY(0x40C, 8),
+    [PM_FIELD_CORE_CPPC_MIN]            = PM_F32_ARRAY(0x42C, 8),
+    [PM_FIELD_CORE_SC_LIMIT]            = PM_F32_ARRAY(0x44C, 8),
+    [PM_FIELD_CORE_SC_CAC]              = PM_F32_ARRAY(0x46C, 8),
+    [PM_FIELD_CORE_SC_RESIDENCY]        = PM_F32_ARRAY(0x48C, 8),
+    [PM_FIELD_L3_LOGIC_POWER]           = PM_F32_ARRAY(0x4AC, 2),
+    [PM_FIELD_L3_VDDM_POWER]            = PM_F32_ARRAY(0x4B4, 2),
+    [PM_FIELD_L3_TEMP]                  = PM_F32_ARRAY(0x4BC, 2),
+    [PM_FIELD_L3_FIT]                   = PM_F32_ARRAY(0x4C4, 2),
+    [PM_FIELD_L3_IDDMAX]                = PM_F32_ARRAY(0x4CC, 2),
+    [PM_FIELD_L3_FREQ]                  = PM_F32_ARRAY(0x4D4, 2),
+    [PM_FIELD_L3_CKS_FDD]               = PM_F32_ARRAY(0x4DC, 2),
+    [PM_FIELD_L3_CCA_THRESHOLD]         = PM_F32_ARRAY(0x4E4, 2),
+    [PM_FIELD_L3_CCA_CAC]               = PM_F32_ARRAY(0x4EC, 2),
+    [PM_FIELD_L3_CCA_ACTIVATION]        = PM_F32_ARRAY(0x4F4, 2),
+    [PM_FIELD_L3_EDC_LIMIT]             = PM_F32_ARRAY(0x4FC, 2),
+    [PM_FIELD_L3_EDC_CAC]               = PM_F32_ARRAY(0x504, 2),
+    [PM_FIELD_L3_EDC_RESIDENCY]         = PM_F32_ARRAY(0x50C, 2),
+    [PM_FIELD_MP5_BUSY]                 = PM_F32_ARRAY(0x514, 1),
@@ -0,0 +1,785 @@
+/**
+ * Ryzen SMU Userspace Library
+ * Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifdef LIBSMU_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef LIBSMU_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "libsmu.h"
+
+/**
+ * Layout of a recording, every field being in the byte order of the host which wrote it, as the
+ *  structures below are written & mapped back as is. The format version doubles as the byte order
+ *  mark: read on a host of the other order it appears byte swapped, far above REC_FORMAT_VERSION,
+ *  and the recording is rejected rather than misread.
+ *
+ *  rec_header_t
+ *  rec_frame_t + payload           (repeated for every sample & event, padded to 8 bytes)
+ *  uint64_t[count]                 Offset of every sample, written when the recording is closed.
+ *  uint64_t[event_count]           Offset of every event.
+ *  rec_event_trailer_t
+ *  rec_trailer_t
+ *
+ * A keyframe carries the whole table while a delta frame carries runs of the 32-bit words that
+ *  changed since the previous sample, XORed with their previous value. Either payload may then be
+ *  compressed as a single block. Event frames carry a rec_event_t followed by the label, are never
+ *  compressed and don't affect the decoding of samples. Recordings which were never closed lack
+ *  the indices & trailers and are indexed by scanning the frames instead, up to the last complete
+ *  one.
+ *
+ * Version 1 recordings hold no events and lack the event index & rec_event_trailer_t.
+ */
+#define REC_MAGIC                       "SMUPMREC"
+#define REC_INDEX_MAGIC                 "SMUPMIDX"
+#define REC_FRAME_MAGIC                 0x454D5246
+#define REC_FORMAT_VERSION              2
+
+#define REC_FRAME_KEY                   0
+#define REC_FRAME_DELTA                 1
+#define REC_FRAME_EVENT                 2
+
+// Frames are padded to keep every header naturally aligned within the mapping.
+#define REC_ALIGN(len)                  (((len) + 7) & ~(uint64_t)7)
+
+// Runs are addressed with 16-bit word indices.
+#define REC_MAX_TABLE_SIZE              (0xFFFF * 4)
+
+// Unchanged words separating two runs are folded into them when this costs less than a new run.
+#define REC_RUN_MERGE_GAP               1
+
+typedef struct {
+    char                        magic[8];
+    uint32_t                    format;
+    uint32_t                    codename;
+    uint32_t                    pm_table_version;
+    uint32_t                    pm_table_size;
+    uint32_t                    keyframe_interval;
+    uint32_t                    compression;
+} rec_header_t;
+
+typedef struct {
+    uint32_t                    magic;
+    uint8_t                     type;
+    uint8_t                     compression;
+    uint16_t                    reserved;
+    // Bytes of payload following the frame & their size once decompressed.
+    uint32_t                    stored_len;
+    uint32_t                    raw_len;
+    uint64_t                    timestamp_ns;
+} rec_frame_t;
+
+typedef struct {
+    uint64_t                    index_offset;
+    uint64_t                    count;
+    char                        magic[8];
+} rec_trailer_t;
+
+typedef struct {
+    uint64_t                    index_offset;
+    uint64_t                    count;
+} rec_event_trailer_t;
+
+typedef struct {
+    uint16_t                    start;
+    uint16_t                    count;
+} rec_run_t;
+
+typedef struct {
+    uint32_t                    type;
+    uint32_t                    reserved;
+    uint64_t                    sample;
+    // Followed by the NUL terminated label.
+} rec_event_t;
+
+/**
+ * Appends [offset] to an index of [*count] entries, growing it as needed.
+ */
+static int rec_index_push(unsigned long long** index, size_t* cap, unsigned long long count,
+    unsigned long long offset) {
+    unsigned long long* grown;
+
+    if (count == *cap) {
+        grown = realloc(*index, (*cap ? *cap * 2 : 1024) * sizeof(*grown));
+        if (!grown)
+            return 0;
+
+        *index = grown;
+        *cap = *cap ? *cap * 2 : 1024;
+    }
+
+    (*index)[count] = offset;
+    return 1;
+}
+
+/**
+ * Writes a frame & its payload, padded to keep the next frame aligned.
+ */
+static smu_return_val rec_write_frame(smu_rec_writer_t* w, const rec_frame_t* frame,
+    const void* payload) {
+    static const unsigned char padding[8];
+    size_t len = frame->stored_len;
+
+    if (fwrite(frame, sizeof(*frame), 1, w->fp) != 1 || fwrite(payload, len, 1, w->fp) != 1 ||
+        fwrite(padding, REC_ALIGN(len) - len, 1, w->fp) != (REC_ALIGN(len) != len))
+        return SMU_Return_RWError;
+
+    w->offset += sizeof(*frame) + REC_ALIGN(len);
+
+    return SMU_Return_OK;
+}
+
+static int rec_compression_supported(smu_rec_compression compression) {
+    switch (compression) {
+        case SMU_REC_COMPRESS_NONE:
+            return 1;
+#ifdef LIBSMU_HAVE_LZ4
+        case SMU_REC_COMPRESS_LZ4:
+            return 1;
+#endif
+#ifdef LIBSMU_HAVE_ZSTD
+        case SMU_REC_COMPRESS_ZSTD:
+            return 1;
+#endif
+        default:
+            return 0;
+    }
+}
+
+static size_t rec_compress_bound(smu_rec_compression compression, size_t len) {
+    switch (compression) {
+#ifdef LIBSMU_HAVE_LZ4
+        case SMU_REC_COMPRESS_LZ4:
+            return LZ4_compressBound(len);
+#endif
+#ifdef LIBSMU_HAVE_ZSTD
+        case SMU_REC_COMPRESS_ZSTD:
+            return ZSTD_compressBound(len);
+#endif
+        default:
+            return len;
+    }
+}
+
+/**
+ * Compresses [len] bytes of [src] into [dst], holding rec_compress_bound() bytes.
+ * Returns the compressed size or 0 if the block did not shrink and should be stored as is.
+ */
+static size_t rec_compress(smu_rec_compression compression, const void* src, size_t len,
+    void* dst, size_t dst_len) {
+    size_t ret = 0;
+
+    switch (compression) {
+#ifdef LIBSMU_HAVE_LZ4
+        case SMU_REC_COMPRESS_LZ4: {
+            int n = LZ4_compress_default(src, dst, len, dst_len);
+
+            ret = n > 0 ? (size_t)n : 0;
+            break;
+        }
+#endif
+#ifdef LIBSMU_HAVE_ZSTD
+        case SMU_REC_COMPRESS_ZSTD:
+            ret = ZSTD_compress(dst, dst_len, src, len, 3);
+            if (ZSTD_isError(ret))
+                ret = 0;
+            break;
+#endif
+        default:
+            // Only reached for compressions not built in, which store blocks as is.
+            (void)src;
+            (void)dst;
+            (void)dst_len;
+            break;
+    }
+
+    return ret < len ? ret : 0;
+}
+
+/**
+ * Decompresses a block into exactly [len] bytes of [dst].
+ */
+static smu_return_val rec_decompress(smu_rec_compression compression, const void* src,
+    size_t src_len, void* dst, size_t len) {
+    switch (compression) {
+#ifdef LIBSMU_HAVE_LZ4
+        case SMU_REC_COMPRESS_LZ4:
+            if (LZ4_decompress_safe(src, dst, src_len, len) != (int)len)
+                return SMU_Return_RWError;
+            return SMU_Return_OK;
+#endif
+#ifdef LIBSMU_HAVE_ZSTD
+        case SMU_REC_COMPRESS_ZSTD:
+            if (ZSTD_decompress(dst, len, src, src_len) != len)
+                return SMU_Return_RWError;
+            return SMU_Return_OK;
+#endif
+        default:
+            (void)src;
+            (void)src_len;
+            (void)dst;
+            (void)len;
+            return SMU_Return_Unsupported;
+    }
+}
+
+smu_return_val smu_rec_writer_open(smu_rec_writer_t* w, const char* path,
+    const smu_rec_info_t* info) {
+    rec_header_t hdr;
+
+    memset(w, 0, sizeof(*w));
+
+    if (!info->pm_table_size || info->pm_table_size % 4 ||
+        info->pm_table_size > REC_MAX_TABLE_SIZE || !info->keyframe_interval)
+        return SMU_Return_InvalidArgument;
+
+    if (!rec_compression_supported(info->compression))
+        return SMU_Return_Unsupported;
+
+    w->info = *info;
+    w->prev = calloc(1, info->pm_table_size);
+    w->scratch = malloc(info->pm_table_size);
+    w->packed_len = rec_compress_bound(info->compression, info->pm_table_size);
+    w->packed = malloc(w->packed_len);
+
+    if (!w->prev || !w->scratch || !w->packed)
+        goto ERR_FREE;
+
+    w->fp = fopen(path, "wb");
+    if (!w->fp)
+        goto ERR_FREE;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, REC_MAGIC, sizeof(hdr.magic));
+    hdr.format = REC_FORMAT_VERSION;
+    hdr.codename = info->codename;
+    hdr.pm_table_version = info->pm_table_version;
+    hdr.pm_table_size = info->pm_table_size;
+    hdr.keyframe_interval = info->keyframe_interval;
+    hdr.compression = info->compression;
+
+    if (fwrite(&hdr, sizeof(hdr), 1, w->fp) != 1) {
+        fclose(w->fp);
+        goto ERR_FREE;
+    }
+
+    w->offset = sizeof(hdr);
+
+    return SMU_Return_OK;
+
+ERR_FREE:
+    free(w->prev);
+    free(w->scratch);
+    free(w->packed);
+    memset(w, 0, sizeof(*w));
+
+    return SMU_Return_RWError;
+}
+
+/**
+ * Encodes the words of [table] differing from the previous sample into the scratch buffer.
+ * Returns the encoded size or 0 if it would not be smaller than a keyframe.
+ */
+static size_t rec_encode_delta(smu_rec_writer_t* w, const unsigned char* table) {
+    unsigned int words = w->info.pm_table_size / 4, i, end, gap;
+    size_t len = 0, limit = w->info.pm_table_size;
+    uint32_t cur, prev;
+    rec_run_t run;
+
+    for (i = 0; i < words; ) {
+        memcpy(&cur, table + i * 4, 4);
+        memcpy(&prev, w->prev + i * 4, 4);
+
+        if (cur == prev) {
+            i++;
+            continue;
+        }
+
+        // Extend the run while the next change is at most REC_RUN_MERGE_GAP words away.
+        for (end = i + 1, gap = 0; end < words && gap <= REC_RUN_MERGE_GAP; end++) {
+            memcpy(&cur, table + end * 4, 4);
+            memcpy(&prev, w->prev + end * 4, 4);
+            gap = cur == prev ? gap + 1 : 0;
+        }
+        end -= gap;
+
+        if (len + sizeof(run) + (end - i) * 4 >= limit)
+            return 0;
+
+        run.start = i;
+        run.count = end - i;
+        memcpy(w->scratch + len, &run, sizeof(run));
+        len += sizeof(run);
+
+        for (; i < end; i++) {
+            memcpy(&cur, table + i * 4, 4);
+            memcpy(&prev, w->prev + i * 4, 4);
+            cur ^= prev;
+            memcpy(w->scratch + len, &cur, 4);
+            len += 4;
+        }
+    }
+
+    return len;
+}
+
+smu_return_val smu_rec_write(smu_rec_writer_t* w, const void* table,
+    unsigned long long timestamp_ns) {
+    const unsigned char* payload;
+    rec_frame_t frame;
+    size_t len, packed;
+
+    if (!w->fp)
+        return SMU_Return_InvalidArgument;
+
+    memset(&frame, 0, sizeof(frame));
+    frame.magic = REC_FRAME_MAGIC;
+    frame.timestamp_ns = timestamp_ns;
+
+    len = w->count % w->info.keyframe_interval ? rec_encode_delta(w, table) : 0;
+
+    if (len) {
+        frame.type = REC_FRAME_DELTA;
+        payload = w->scratch;
+    }
+    else {
+        // Also taken if nothing changed at all, as an empty delta isn't worth special casing.
+        frame.type = REC_FRAME_KEY;
+        payload = table;
+        len = w->info.pm_table_size;
+    }
+
+    frame.raw_len = len;
+    frame.compression = SMU_REC_COMPRESS_NONE;
+
+    packed = rec_compress(w->info.compression, payload, len, w->packed, w->packed_len);
+    if (packed) {
+        frame.compression = w->info.compression;
+        payload = w->packed;
+        len = packed;
+    }
+
+    frame.stored_len = len;
+
+    if (!rec_index_push(&w->index, &w->index_cap, w->count, w->offset) ||
+        rec_write_frame(w, &frame, payload) != SMU_Return_OK)
+        return SMU_Return_RWError;
+
+    w->count++;
+
+    memcpy(w->prev, table, w->info.pm_table_size);
+
+    // Bounds what is lost if the process dies before closing the recording.
+    if (frame.type == REC_FRAME_KEY && fflush(w->fp))
+        return SMU_Return_RWError;
+
+    return SMU_Return_OK;
+}
+
+smu_return_val smu_rec_write_event(smu_rec_writer_t* w, smu_rec_event_type type,
+    const char* label, unsigned long long timestamp_ns) {
+    unsigned char payload[sizeof(rec_event_t) + SMU_REC_MAX_LABEL + 1];
+    size_t label_len = label ? strnlen(label, SMU_REC_MAX_LABEL) : 0;
+    rec_event_t event;
+    rec_frame_t frame;
+
+    if (!w->fp)
+        return SMU_Return_InvalidArgument;
+
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.sample = w->count;
+
+    memcpy(payload, &event, sizeof(event));
+    if (label_len)
+        memcpy(payload + sizeof(event), label, label_len);
+    payload[sizeof(event) + label_len] = 0;
+
+    memset(&frame, 0, sizeof(frame));
+    frame.magic = REC_FRAME_MAGIC;
+    frame.type = REC_FRAME_EVENT;
+    frame.compression = SMU_REC_COMPRESS_NONE;
+    frame.stored_len = frame.raw_len = sizeof(event) + label_len + 1;
+    frame.timestamp_ns = timestamp_ns;
+
+    if (!rec_index_push(&w->events, &w->events_cap, w->event_count, w->offset) ||
+        rec_write_frame(w, &frame, payload) != SMU_Return_OK)
+        return SMU_Return_RWError;
+
+    w->event_count++;
+
+    return SMU_Return_OK;
+}
+
+smu_return_val smu_rec_writer_close(smu_rec_writer_t* w) {
+    rec_event_trailer_t event_trailer;
+    smu_return_val ret = SMU_Return_OK;
+    rec_trailer_t trailer;
+
+    if (!w->fp)
+        return SMU_Return_InvalidArgument;
+
+    if (fwrite(w->index, sizeof(*w->index), w->count, w->fp) != w->count ||
+        fwrite(w->events, sizeof(*w->events), w->event_count, w->fp) != w->event_count)
+        ret = SMU_Return_RWError;
+
+    memset(&event_trailer, 0, sizeof(event_trailer));
+    event_trailer.index_offset = w->offset + w->count * sizeof(*w->index);
+    event_trailer.count = w->event_count;
+
+    memset(&trailer, 0, sizeof(trailer));
+    trailer.index_offset = w->offset;
+    trailer.count = w->count;
+    memcpy(trailer.magic, REC_INDEX_MAGIC, sizeof(trailer.magic));
+
+    if (ret == SMU_Return_OK && (fwrite(&event_trailer, sizeof(event_trailer), 1, w->fp) != 1 ||
+        fwrite(&trailer, sizeof(trailer), 1, w->fp) != 1))
+        ret = SMU_Return_RWError;
+
+    if (fclose(w->fp) && ret == SMU_Return_OK)
+        ret = SMU_Return_RWError;
+
+    free(w->prev);
+    free(w->scratch);
+    free(w->packed);
+    free(w->index);
+    free(w->events);
+    memset(w, 0, sizeof(*w));
+
+    return ret;
+}
+
+static const rec_frame_t* rec_frame_at_offset(smu_rec_reader_t* r, uint64_t offset) {
+    return (const rec_frame_t*)(r->map + offset);
+}
+
+static const rec_frame_t* rec_frame_at(smu_rec_reader_t* r, unsigned long long n) {
+    return rec_frame_at_offset(r, r->index[n]);
+}
+
+/**
+ * Checks that a frame at [offset] lies entirely within [end] & is sane for the recording.
+ */
+static int rec_frame_valid(smu_rec_reader_t* r, uint64_t offset, uint64_t end) {
+    const unsigned char* payload;
+    const rec_frame_t* frame;
+
+    if (offset + sizeof(rec_frame_t) > end)
+        return 0;
+
+    frame = (const rec_frame_t*)(r->map + offset);
+    payload = (const unsigned char*)(frame + 1);
+
+    if (frame->magic != REC_FRAME_MAGIC ||
+        REC_ALIGN(frame->stored_len) > end - offset - sizeof(rec_frame_t))
+        return 0;
+
+    // Labels must be terminated within the frame.
+    if (frame->type == REC_FRAME_EVENT)
+        return frame->compression == SMU_REC_COMPRESS_NONE &&
+            frame->stored_len == frame->raw_len && frame->raw_len > sizeof(rec_event_t) &&
+            frame->raw_len <= sizeof(rec_event_t) + SMU_REC_MAX_LABEL + 1 &&
+            !payload[frame->raw_len - 1];
+
+    return frame->raw_len <= r->info.pm_table_size &&
+        (frame->type != REC_FRAME_KEY || frame->raw_len == r->info.pm_table_size) &&
+        frame->type <= REC_FRAME_DELTA;
+}
+
+/**
+ * Checks that the [count] frames of [index] are well formed, lie before [end] & are events or
+ *  samples as expected.
+ */
+static int rec_index_valid(smu_rec_reader_t* r, const unsigned long long* index,
+    unsigned long long count, uint64_t end, int events) {
+    unsigned long long i;
+
+    for (i = 0; i < count; i++) {
+        if (!rec_frame_valid(r, index[i], end) ||
+            (rec_frame_at_offset(r, index[i])->type == REC_FRAME_EVENT) != events)
+            return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Uses the indices written when the recording was closed, if they can be trusted.
+ */
+static int rec_load_index(smu_rec_reader_t* r, uint32_t format) {
+    const rec_event_trailer_t* event_trailer = NULL;
+    const rec_trailer_t* trailer;
+    uint64_t end = r->map_len, events_start;
+
+    if (end < sizeof(rec_header_t) + sizeof(*trailer) + (format > 1 ? sizeof(*event_trailer) : 0))
+        return 0;
+
+    end -= sizeof(*trailer);
+    trailer = (const rec_trailer_t*)(r->map + end);
+
+    if (memcmp(trailer->magic, REC_INDEX_MAGIC, sizeof(trailer->magic)))
+        return 0;
+
+    if (format > 1) {
+        end -= sizeof(*event_trailer);
+        event_trailer = (const rec_event_trailer_t*)(r->map + end);
+    }
+
+    // The index of samples is followed by the index of events, ending right before the trailers.
+    events_start = event_trailer ? event_trailer->index_offset : end;
+
+    if (trailer->index_offset % 8 || events_start % 8 || trailer->index_offset > events_start ||
+        events_start > end || trailer->count != (events_start - trailer->index_offset) / 8 ||
+        (event_trailer && event_trailer->count != (end - events_start) / 8))
+        return 0;
+
+    r->index = (const unsigned long long*)(r->map + trailer->index_offset);
+    r->events = (const unsigned long long*)(r->map + events_start);
+
+    if (!rec_index_valid(r, r->index, trailer->count, trailer->index_offset, 0) ||
+        (event_trailer &&
+        !rec_index_valid(r, r->events, event_trailer->count, trailer->index_offset, 1))) {
+        r->index = r->events = NULL;
+        return 0;
+    }
+
+    r->count = trailer->count;
+    r->event_count = event_trailer ? event_trailer->count : 0;
+
+    return 1;
+}
+
+/**
+ * Builds the indices of a recording which was never closed, keeping every complete frame.
+ */
+static smu_return_val rec_scan_index(smu_rec_reader_t* r) {
+    uint64_t offset = sizeof(rec_header_t);
+    size_t cap = 0, events_cap = 0;
+    const rec_frame_t* frame;
+    int ok;
+
+    while (rec_frame_valid(r, offset, r->map_len)) {
+        frame = rec_frame_at_offset(r, offset);
+
+        if (frame->type == REC_FRAME_EVENT)
+            ok = rec_index_push(&r->events_owned, &events_cap, r->event_count++, offset);
+        else
+            ok = rec_index_push(&r->index_owned, &cap, r->count++, offset);
+
+        if (!ok)
+            return SMU_Return_RWError;
+
+        offset += sizeof(*frame) + REC_ALIGN(frame->stored_len);
+    }
+
+    r->index = r->index_owned;
+    r->events = r->events_owned;
+    return SMU_Return_OK;
+}
+
+smu_return_val smu_rec_reader_open(smu_rec_reader_t* r, const char* path) {
+    const rec_header_t* hdr;
+    smu_return_val ret;
+    struct stat st;
+    void* map;
+    int fd;
+
+    memset(r, 0, sizeof(*r));
+    r->pos = SMU_REC_NO_FRAME;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return SMU_Return_RWError;
+
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(rec_header_t)) {
+        close(fd);
+        return SMU_Return_RWError;
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+        return SMU_Return_RWError;
+
+    r->map = map;
+    r->map_len = st.st_size;
+
+    // Also rejects recordings written in the other byte order, whose format appears byte swapped.
+    hdr = (const rec_header_t*)r->map;
+    if (memcmp(hdr->magic, REC_MAGIC, sizeof(hdr->magic)) || !hdr->format ||
+        hdr->format > REC_FORMAT_VERSION ||
+        !hdr->pm_table_size || hdr->pm_table_size % 4 || hdr->pm_table_size > REC_MAX_TABLE_SIZE) {
+        ret = SMU_Return_RWError;
+        goto ERR_CLOSE;
+    }
+
+    r->info.codename = hdr->codename;
+    r->info.pm_table_version = hdr->pm_table_version;
+    r->info.pm_table_size = hdr->pm_table_size;
+    r->info.keyframe_interval = hdr->keyframe_interval;
+    r->info.compression = hdr->compression;
+
+    r->table = malloc(r->info.pm_table_size);
+    r->scratch = malloc(r->info.pm_table_size);
+    if (!r->table || !r->scratch) {
+        ret = SMU_Return_RWError;
+        goto ERR_CLOSE;
+    }
+
+    // Only trust the indices if every frame they point to is well formed.
+    if (rec_load_index(r, hdr->format))
+        return SMU_Return_OK;
+
+    ret = rec_scan_index(r);
+    if (ret != SMU_Return_OK)
+        goto ERR_CLOSE;
+
+    return SMU_Return_OK;
+
+ERR_CLOSE:
+    smu_rec_reader_close(r);
+    return ret;
+}
+
+/**
+ * Applies frame [n] on top of the decoded table.
+ */
+static smu_return_val rec_apply_frame(smu_rec_reader_t* r, unsigned long long n) {
+    const rec_frame_t* frame = rec_frame_at(r, n);
+    const unsigned char* payload = (const unsigned char*)(frame + 1);
+    unsigned int words = r->info.pm_table_size / 4;
+    uint32_t cur, delta;
+    smu_return_val ret;
+    size_t pos, i;
+    rec_run_t run;
+
+    if (frame->compression != SMU_REC_COMPRESS_NONE) {
+        ret = rec_decompress(frame->compression, payload, frame->stored_len, r->scratch,
+            frame->raw_len);
+        if (ret != SMU_Return_OK)
+            return ret;
+
+        payload = r->scratch;
+    }
+    else if (frame->stored_len != frame->raw_len)
+        return SMU_Return_RWError;
+
+    if (frame->type == REC_FRAME_KEY) {
+        memcpy(r->table, payload, r->info.pm_table_size);
+        return SMU_Return_OK;
+    }
+
+    for (pos = 0; pos + sizeof(run) <= frame->raw_len; ) {
+        memcpy(&run, payload + pos, sizeof(run));
+        pos += sizeof(run);
+
+        if ((size_t)run.start + run.count > words || pos + run.count * 4 > frame->raw_len)
+            return SMU_Return_RWError;
+
+        for (i = run.start; i < (size_t)run.start + run.count; i++, pos += 4) {
+            memcpy(&cur, r->table + i * 4, 4);
+            memcpy(&delta, payload + pos, 4);
+            cur ^= delta;
+            memcpy(r->table + i * 4, &cur, 4);
+        }
+    }
+
+    return pos == frame->raw_len ? SMU_Return_OK : SMU_Return_RWError;
+}
+
+smu_return_val smu_rec_read(smu_rec_reader_t* r, unsigned long long n, void* dst,
+    unsigned long long* timestamp_ns) {
+    unsigned long long key, i;
+    smu_return_val ret;
+
+    if (n >= r->count)
+        return SMU_Return_InvalidArgument;
+
+    if (r->pos != n) {
+        for (key = n; key && rec_frame_at(r, key)->type != REC_FRAME_KEY; key--)
+            ;
+
+        if (rec_frame_at(r, key)->type != REC_FRAME_KEY)
+            return SMU_Return_RWError;
+
+        // Reading forwards only needs to apply the frames since the last one decoded.
+        i = r->pos != SMU_REC_NO_FRAME && r->pos >= key && r->pos < n ? r->pos + 1 : key;
+
+        for (; i <= n; i++) {
+            ret = rec_apply_frame(r, i);
+            if (ret != SMU_Return_OK) {
+                r->pos = SMU_REC_NO_FRAME;
+                return ret;
+            }
+        }
+
+        r->pos = n;
+    }
+
+    if (dst)
+        memcpy(dst, r->table, r->info.pm_table_size);
+
+    if (timestamp_ns)
+        *timestamp_ns = rec_frame_at(r, n)->timestamp_ns;
+
+    return SMU_Return_OK;
+}
+
+smu_return_val smu_rec_read_event(smu_rec_reader_t* r, unsigned long long n,
+    smu_rec_event_t* event) {
+    const rec_frame_t* frame;
+    rec_event_t ev;
+
+    if (n >= r->event_count)
+        return SMU_Return_InvalidArgument;
+
+    frame = rec_frame_at_offset(r, r->events[n]);
+    memcpy(&ev, frame + 1, sizeof(ev));
+
+    event->type = ev.type;
+    event->timestamp_ns = frame->timestamp_ns;
+    event->sample = ev.sample;
+
+    // The label was checked to be terminated & short enough when the recording was opened.
+    memcpy(event->label, (const unsigned char*)(frame + 1) + sizeof(ev),
+        frame->raw_len - sizeof(ev));
+
+    return SMU_Return_OK;
+}
+
+void smu_rec_reader_close(smu_rec_reader_t* r) {
+    if (r->map)
+        munmap((void*)r->map, r->map_len);
+
+    free(r->index_owned);
+    free(r->events_owned);
+    free(r->table);
+    free(r->scratch);
+    memset(r, 0, sizeof(*r));
+}
@@ -0,0 +1,189 @@
+/**
+ * Ryzen SMU Userspace Library
+ * Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+
+#include "libsmu.h"
+
+/**
+ * A single refresh thread publishes every snapshot into the next slot of a small ring, each slot
+ *  being guarded by its own sequence number in the fashion of a seqlock. Consumers copy the slot
+ *  the head points at & retry in the unlikely case the refresh thread lapped the whole ring
+ *  meanwhile, so they never wait on the refresh thread nor on each other.
+ */
+typedef struct {
+    unsigned long long          seq;
+    unsigned long long          timestamp_ns;
+    unsigned long long          generation;
+    unsigned char               data[];
+} snapshot_slot_t;
+
+// Slots are kept on separate cache lines to avoid false sharing between writer & readers.
+#define SNAPSHOT_SLOT_ALIGN             64
+
+// Attempts made by a consumer before giving up on a ring being rewritten faster than it copies.
+#define SNAPSHOT_READ_ATTEMPTS          16
+
+static snapshot_slot_t* snapshot_slot(smu_snapshot_t* s, unsigned long long seq) {
+    return (snapshot_slot_t*)(s->slots + (seq % SMU_SNAPSHOT_SLOTS) * s->slot_size);
+}
+
+/**
+ * Takes and publishes a snapshot unless the table did not change since the last one.
+ */
+static smu_return_val snapshot_take(smu_snapshot_t* s) {
+    unsigned long long seq = s->head + 1;
+    snapshot_slot_t* slot = snapshot_slot(s, seq);
+    smu_return_val ret;
+
+    // Invalidate the slot first so that a consumer which fell a whole ring behind detects it.
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    ret = smu_read_pm_table_if_changed(s->obj, slot->data, s->obj->pm_table_size, &s->gen);
+    if (ret != SMU_Return_OK)
+        return ret;
+
+    slot->timestamp_ns = smu_now_ns();
+    slot->generation = s->gen.generation;
+
+    __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+    __atomic_store_n(&s->head, seq, __ATOMIC_RELEASE);
+
+    return SMU_Return_OK;
+}
+
+static void* snapshot_thread(void* arg) {
+    smu_snapshot_t* s = arg;
+    unsigned long long interval = s->interval_us * 1000ULL, next = smu_now_ns() + interval;
+
+    while (!__atomic_load_n(&s->stop, __ATOMIC_ACQUIRE)) {
+        while (smu_wait_deadline(&next, interval) < 0)
+            ;
+
+        switch (snapshot_take(s)) {
+            case SMU_Return_OK:
+            case SMU_Return_Unchanged:
+                break;
+            default:
+                __atomic_add_fetch(&s->failed, 1, __ATOMIC_RELAXED);
+                break;
+        }
+    }
+
+    return NULL;
+}
+
+smu_return_val smu_snapshot_start(smu_snapshot_t* s, smu_obj_t* obj, unsigned int interval_us) {
+    smu_return_val ret;
+    void* slots;
+
+    memset(s, 0, sizeof(*s));
+
+    // Don't attempt to execute without initialization.
+    if (!obj->init)
+        return SMU_Return_Failed;
+
+    if (!smu_pm_tables_supported(obj))
+        return SMU_Return_Unsupported;
+
+    if (!interval_us)
+        return SMU_Return_InvalidArgument;
+
+    s->obj = obj;
+    s->interval_us = interval_us;
+    s->slot_size = (sizeof(snapshot_slot_t) + obj->pm_table_size + SNAPSHOT_SLOT_ALIGN - 1) &
+        ~(size_t)(SNAPSHOT_SLOT_ALIGN - 1);
+
+    if (posix_memalign(&slots, SNAPSHOT_SLOT_ALIGN, SMU_SNAPSHOT_SLOTS * s->slot_size))
+        return SMU_Return_RWError;
+
+    memset(slots, 0, SMU_SNAPSHOT_SLOTS * s->slot_size);
+    s->slots = slots;
+
+    // Consumers can rely on a snapshot existing as soon as this returns.
+    ret = snapshot_take(s);
+    if (ret != SMU_Return_OK)
+        goto ERR_FREE;
+
+    if (pthread_create(&s->thread, NULL, snapshot_thread, s)) {
+        ret = SMU_Return_Failed;
+        goto ERR_FREE;
+    }
+
+    s->running = 1;
+
+    return SMU_Return_OK;
+
+ERR_FREE:
+    free(s->slots);
+    memset(s, 0, sizeof(*s));
+
+    return ret;
+}
+
+smu_return_val smu_snapshot_read(smu_snapshot_t* s, unsigned char* dst, size_t dst_len,
+    smu_snapshot_info_t* info) {
+    unsigned long long head, seq;
+    snapshot_slot_t* slot;
+    unsigned int i;
+
+    if (!s->running)
+        return SMU_Return_Failed;
+
+    if (dst_len != s->obj->pm_table_size)
+        return SMU_Return_InsufficientSize;
+
+    for (i = 0; i < SNAPSHOT_READ_ATTEMPTS; i++) {
+        head = __atomic_load_n(&s->head, __ATOMIC_ACQUIRE);
+
+        if (info->seq == head)
+            return SMU_Return_Unchanged;
+
+        slot = snapshot_slot(s, head);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != head)
+            continue;
+
+        memcpy(dst, slot->data, dst_len);
+        info->timestamp_ns = slot->timestamp_ns;
+        info->generation = slot->generation;
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+
+        if (seq == head) {
+            info->seq = head;
+            return SMU_Return_OK;
+        }
+    }
+
+    return SMU_Return_CmdRejectedBusy;
+}
+
+void smu_snapshot_stop(smu_snapshot_t* s) {
+    if (!s->running)
+        return;
+
+    __atomic_store_n(&s->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(s->thread, NULL);
+
+    free(s->slots);
+    memset(s, 0, sizeof(*s));
+}
@@ -0,0 +1,32 @@
+/**
+ * Ryzen SMU Userspace Library
+ * Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef __LIB_SMU_TEST_H__
+#define __LIB_SMU_TEST_H__
+
+/**
+ * Pseudo-random numbers from a fixed seed, so that every run tests the same inputs.
+ */
+static inline unsigned int test_rng(void) {
+    static unsigned int state = 0x12345678;
+
+    state = state * 1103515245 + 12345;
+    return state >> 8;
+}
+
+#endif /* __LIB_SMU_TEST_H__ */
@@ -0,0 +1,154 @@
+/**
+ * Ryzen SMU Userspace Library
+ * Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+/**
+ * Checks the vector kernels decoding core metrics agree with the scalar one, for every core count
+ *  up to a few vectors past a mask word so that every tail is covered.
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+// The kernels are internal to the library.
+#include "../metrics.c"
+#include "test.h"
+
+#define MAX_CORES                       80
+
+// Sums are accumulated in a different order, per core values may only differ by fused rounding.
+#define TOLERANCE                       1e-5f
+
+static smu_core_metrics_t input, scalar, vector;
+static int failures;
+
+static int close_enough(float a, float b) {
+    return fabsf(a - b) <= TOLERANCE * fmaxf(1.f, fmaxf(fabsf(a), fabsf(b)));
+}
+
+/**
+ * Fills the inputs with a mix of gated, sleeping & busy cores, hitting the C0 threshold exactly.
+ */
+static void make_input(void) {
+    unsigned int i;
+
+    for (i = 0; i < MAX_CORES; i++) {
+        input.frequency[i] = (test_rng() % 5000) / 1000.f;
+        input.voltage[i] = i % 7 == 3 ? 0.f : (test_rng() % 5000) / 1000.f;
+        input.c6[i] = (test_rng() % 10000) / 100.f;
+        input.c0[i] = i % 5 == 1 ? METRICS_ACTIVE_C0 : (test_rng() % 10000) / 100.f;
+    }
+}
+
+static void run_kernel(metrics_kernel_fn kernel, smu_core_metrics_t* m, unsigned int count) {
+    unsigned int words = (m->capacity + 63) / 64;
+
+    memcpy(m->frequency, input.frequency, MAX_CORES * sizeof(float));
+    memcpy(m->voltage, input.voltage, MAX_CORES * sizeof(float));
+    memcpy(m->c0, input.c0, MAX_CORES * sizeof(float));
+    memcpy(m->c6, input.c6, MAX_CORES * sizeof(float));
+    memset(m->active, 0, words * sizeof(*m->active));
+    memset(m->gated, 0, words * sizeof(*m->gated));
+
+    m->count = count;
+    m->peak_frequency = m->total_c0 = m->total_c6 = m->total_voltage = 0.f;
+
+    kernel(m, 0, 1.1f);
+}
+
+/**
+ * Compares [kernel] against the scalar kernel for [count] cores.
+ */
+static int compare(metrics_kernel_fn kernel, const char* name, unsigned int count) {
+    unsigned int i, words = (MAX_CORES + 63) / 64;
+
+    run_kernel(metrics_kernel_scalar, &scalar, count);
+    run_kernel(kernel, &vector, count);
+
+    for (i = 0; i < count; i++) {
+        if (scalar.frequency[i] != vector.frequency[i] ||
+            !close_enough(scalar.voltage[i], vector.voltage[i])) {
+            fprintf(stderr, "FAIL: %s, %u cores: core %u is %.6f MHz %.6f V instead of %.6f MHz "
+                "%.6f V\n", name, count, i, vector.frequency[i], vector.voltage[i],
+                scalar.frequency[i], scalar.voltage[i]);
+            return 0;
+        }
+    }
+
+    for (i = 0; i < words; i++) {
+        if (scalar.active[i] != vector.active[i] || scalar.gated[i] != vector.gated[i]) {
+            fprintf(stderr, "FAIL: %s, %u cores: mask word %u differs\n", name, count, i);
+            return 0;
+        }
+    }
+
+    if (scalar.peak_frequency != vector.peak_frequency ||
+        !close_enough(scalar.total_c0, vector.total_c0) ||
+        !close_enough(scalar.total_c6, vector.total_c6) ||
+        !close_enough(scalar.total_voltage, vector.total_voltage)) {
+        fprintf(stderr, "FAIL: %s, %u cores: sums differ\n", name, count);
+        return 0;
+    }
+
+    return 1;
+}
+
+static void test_kernel(metrics_kernel_fn kernel, const char* name) {
+    unsigned int count;
+
+    for (count = 1; count <= MAX_CORES; count++) {
+        if (!compare(kernel, name, count)) {
+            failures++;
+            return;
+        }
+    }
+
+    printf("PASS: %s\n", name);
+}
+
+int main(void) {
+    if (smu_core_metrics_init(&input, MAX_CORES) != SMU_Return_OK ||
+        smu_core_metrics_init(&scalar, MAX_CORES) != SMU_Return_OK ||
+        smu_core_metrics_init(&vector, MAX_CORES) != SMU_Return_OK) {
+        fprintf(stderr, "Can't allocate the metrics.\n");
+        return 1;
+    }
+
+    make_input();
+
+#ifdef METRICS_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse2"))
+        test_kernel(metrics_kernel_sse, "sse2");
+    else
+        printf("SKIP: sse2, not supported\n");
+
+    if (__builtin_cpu_supports("avx2"))
+        test_kernel(metrics_kernel_avx2, "avx2");
+    else
+        printf("SKIP: avx2, not supported\n");
+#else
+    printf("SKIP: no vector kernels\n");
+#endif
+
+    smu_core_metrics_free(&input);
+    smu_core_metrics_free(&scalar);
+    smu_core_metrics_free(&vector);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,325 @@
+/**
+ * Ryzen SMU Userspace Library
+ * Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+/**
+ * Writes recordings of synthetic PM tables & checks they read back identically, whether closed,
+ *  never closed or cut at any point.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libsmu.h"
+#include "test.h"
+
+#define TABLE_SIZE                      0x7E4
+#define SAMPLES                         200
+#define KEYFRAME_INTERVAL               16
+
+#define CHECK(cond, ...)                \
+    do { if (!(cond)) { fail(__VA_ARGS__); return -1; } } while (0)
+
+// Same as CHECK() once the reader is open, closing it on failure.
+#define CHECK_OPEN(cond, ...)           \
+    do { if (!(cond)) { fail(__VA_ARGS__); goto ERR_CLOSE; } } while (0)
+
+static unsigned char tables[SAMPLES][TABLE_SIZE];
+static char path[] = "/tmp/test_recording_XXXXXX";
+static int failures;
+
+static void fail(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+static void fail(const char* fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    fprintf(stderr, "FAIL: ");
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+
+    failures++;
+}
+
+/**
+ * Fills the tables with samples resembling real ones, where few words change between samples.
+ */
+static void make_tables(void) {
+    unsigned int i, j, n;
+    float value;
+
+    for (j = 0; j < TABLE_SIZE; j += 4) {
+        value = (float)(test_rng() % 10000) / 100.f;
+        memcpy(tables[0] + j, &value, 4);
+    }
+
+    for (i = 1; i < SAMPLES; i++) {
+        memcpy(tables[i], tables[i - 1], TABLE_SIZE);
+
+        // Every tenth sample changes nothing, others from a few words up to the whole table.
+        n = i % 10 ? (i % 37 ? test_rng() % 40 : TABLE_SIZE / 4) : 0;
+        while (n--) {
+            j = (test_rng() % (TABLE_SIZE / 4)) * 4;
+            value = (float)(test_rng() % 10000) / 100.f;
+            memcpy(tables[i] + j, &value, 4);
+        }
+    }
+}
+
+/**
+ * Records every sample, with events after the first & in the middle, optionally closing the file.
+ */
+static smu_return_val write_recording(smu_rec_compression compression, int close) {
+    smu_rec_info_t info = {
+        .codename = CODENAME_MATISSE,
+        .pm_table_version = 0x240903,
+        .pm_table_size = TABLE_SIZE,
+        .keyframe_interval = KEYFRAME_INTERVAL,
+        .compression = compression,
+    };
+    smu_rec_writer_t w;
+    smu_return_val ret;
+    unsigned int i;
+
+    ret = smu_rec_writer_open(&w, path, &info);
+    if (ret != SMU_Return_OK)
+        return ret;
+
+    for (i = 0; i < SAMPLES; i++) {
+        if (smu_rec_write(&w, tables[i], 1000ULL * i) != SMU_Return_OK)
+            return SMU_Return_RWError;
+
+        if ((i == 0 &&
+            smu_rec_write_event(&w, SMU_REC_EVENT_WORKLOAD_START, "build", 1000ULL * i + 1) !=
+                SMU_Return_OK) ||
+            (i == SAMPLES / 2 &&
+            smu_rec_write_event(&w, SMU_REC_EVENT_MARK, NULL, 1000ULL * i + 1) != SMU_Return_OK))
+            return SMU_Return_RWError;
+    }
+
+    if (close)
+        return smu_rec_writer_close(&w);
+
+    // Leaves the recording as a killed writer would, with every frame written but no indices.
+    fclose(w.fp);
+    free(w.prev);
+    free(w.scratch);
+    free(w.packed);
+    free(w.index);
+    free(w.events);
+
+    return SMU_Return_OK;
+}
+
+/**
+ * Checks every sample of the recording is identical to the original.
+ * Returns the number of samples or -1 if any differs.
+ */
+static long long check_recording(const char* what) {
+    unsigned char table[TABLE_SIZE];
+    unsigned long long ts, count, i;
+    smu_rec_event_t event;
+    smu_rec_reader_t r;
+
+    CHECK(smu_rec_reader_open(&r, path) == SMU_Return_OK, "%s: can't open", what);
+
+    CHECK_OPEN(r.info.codename == CODENAME_MATISSE && r.info.pm_table_version == 0x240903 &&
+        r.info.pm_table_size == TABLE_SIZE, "%s: header mismatch", what);
+    CHECK_OPEN(r.count <= SAMPLES, "%s: %llu samples", what, r.count);
+
+    for (i = 0; i < r.count; i++) {
+        CHECK_OPEN(smu_rec_read(&r, i, table, &ts) == SMU_Return_OK,
+            "%s: can't read %llu", what, i);
+        CHECK_OPEN(!memcmp(table, tables[i], TABLE_SIZE) && ts == 1000ULL * i,
+            "%s: sample %llu differs", what, i);
+    }
+
+    // Seeking backwards restarts from the closest keyframe.
+    for (i = r.count; i--; ) {
+        CHECK_OPEN(smu_rec_read(&r, i, table, NULL) == SMU_Return_OK &&
+            !memcmp(table, tables[i], TABLE_SIZE),
+            "%s: sample %llu differs when read backwards", what, i);
+    }
+
+    CHECK_OPEN(smu_rec_read(&r, r.count, table, NULL) == SMU_Return_InvalidArgument,
+        "%s: read past the end", what);
+
+    if (r.event_count > 0) {
+        CHECK_OPEN(smu_rec_read_event(&r, 0, &event) == SMU_Return_OK &&
+            event.type == SMU_REC_EVENT_WORKLOAD_START && event.sample == 1 &&
+            event.timestamp_ns == 1 && !strcmp(event.label, "build"), "%s: event 0 differs", what);
+    }
+
+    if (r.event_count > 1) {
+        CHECK_OPEN(smu_rec_read_event(&r, 1, &event) == SMU_Return_OK &&
+            event.type == SMU_REC_EVENT_MARK && event.sample == SAMPLES / 2 + 1 &&
+            !event.label[0], "%s: event 1 differs", what);
+    }
+
+    count = r.count;
+    smu_rec_reader_close(&r);
+
+    return count;
+
+ERR_CLOSE:
+    smu_rec_reader_close(&r);
+    return -1;
+}
+
+/**
+ * Cuts the closed recording [data] at every 8 bytes, every complete sample remaining readable.
+ */
+static int check_truncated(const unsigned char* data, long len, const char* name) {
+    long long count, prev = 0;
+    smu_rec_reader_t r;
+    char what[64];
+    long cut;
+    FILE* fp;
+
+    for (cut = 0; cut < len; cut += 8) {
+        fp = fopen(path, "wb");
+        CHECK(fp && fwrite(data, 1, cut, fp) == (size_t)cut && !fclose(fp), "can't truncate");
+
+        // Only the header is needed to open a recording, even holding no sample.
+        if (cut < 32) {
+            CHECK(smu_rec_reader_open(&r, path) == SMU_Return_RWError,
+                "%s: opened a recording cut at %ld", name, cut);
+            continue;
+        }
+
+        snprintf(what, sizeof(what), "%s cut at %ld", name, cut);
+
+        count = check_recording(what);
+        if (count < 0)
+            return -1;
+
+        CHECK(count >= prev, "%s: %lld samples, %lld before", what, count, prev);
+        prev = count;
+    }
+
+    // Losing the trailers alone leaves every frame in place.
+    CHECK(prev == SAMPLES, "%s: %lld samples without the trailers", name, prev);
+
+    return 1;
+}
+
+/**
+ * Checks the recording [data] is rejected once its format version is byte swapped, as it would
+ *  appear on a host of the other byte order.
+ */
+static int check_byte_swapped(const unsigned char* data, long len, const char* name) {
+    unsigned char* copy = malloc(len);
+    smu_rec_reader_t r;
+    unsigned int i;
+    FILE* fp;
+    int ok;
+
+    CHECK(copy, "out of memory");
+    memcpy(copy, data, len);
+
+    // The format follows the 8 byte magic.
+    for (i = 0; i < 4; i++)
+        copy[8 + i] = data[11 - i];
+
+    fp = fopen(path, "wb");
+    ok = fp && fwrite(copy, 1, len, fp) == (size_t)len;
+    if (fp && fclose(fp))
+        ok = 0;
+    free(copy);
+
+    CHECK(ok, "can't write");
+    CHECK(smu_rec_reader_open(&r, path) == SMU_Return_RWError,
+        "%s: opened a recording in the other byte order", name);
+
+    return 1;
+}
+
+static void test_compression(smu_rec_compression compression, const char* name) {
+    unsigned char* data;
+    char what[64];
+    long len;
+    FILE* fp;
+
+    if (write_recording(compression, 1) == SMU_Return_Unsupported) {
+        printf("SKIP: %s, not built in\n", name);
+        return;
+    }
+
+    snprintf(what, sizeof(what), "%s closed", name);
+    if (check_recording(what) != SAMPLES) {
+        fail("%s: samples missing", what);
+        return;
+    }
+
+    fp = fopen(path, "rb");
+    if (!fp || fseek(fp, 0, SEEK_END) || (len = ftell(fp)) <= 0 || fseek(fp, 0, SEEK_SET)) {
+        fail("%s: can't read back", name);
+        return;
+    }
+
+    data = malloc(len);
+    if (!data || fread(data, 1, len, fp) != (size_t)len) {
+        fail("%s: can't read back", name);
+        fclose(fp);
+        free(data);
+        return;
+    }
+    fclose(fp);
+
+    if (check_truncated(data, len, name) < 0 || check_byte_swapped(data, len, name) < 0) {
+        free(data);
+        return;
+    }
+    free(data);
+
+    snprintf(what, sizeof(what), "%s never closed", name);
+    if (write_recording(compression, 0) != SMU_Return_OK) {
+        fail("%s: can't write", what);
+        return;
+    }
+
+    if (check_recording(what) != SAMPLES) {
+        fail("%s: samples missing", what);
+        return;
+    }
+
+    printf("PASS: %s\n", name);
+}
+
+int main(void) {
+    int fd;
+
+    fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    make_tables();
+
+    test_compression(SMU_REC_COMPRESS_NONE, "none");
+    test_compression(SMU_REC_COMPRESS_LZ4, "lz4");
+    test_compression(SMU_REC_COMPRESS_ZSTD, "zstd");
+
+    unlink(path);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,317 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com> */
+/* Ryzen SMU PM Table Metrics */
+
+#include <linux/err.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/limits.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+
+#include "smu.h"
+#include "drv.h"
+#include "pm_metrics.h"
+
+// Residency below which AMD considers a core to be sleeping, in hundredths of a percent.
+// Source: Ryzen Master
+#define PM_ACTIVE_C0                                  600
+
+// Voltage a core settles at while in CC6.
+#define PM_SLEEP_VOLTAGE_UV                           200000
+
+/**
+ * Byte offsets of the fields metrics are derived from, each being a float or, for the per-core
+ *  fields, an array of [cores] floats.
+ */
+struct smu_pm_decoder {
+    enum smu_processor_codename codename;
+    u32 version;
+    u32 size;
+    u32 cores;
+
+    u32 socket_power;
+    u32 package_voltage;
+    u32 package_pc6;
+    u32 temperature;
+
+    u32 core_power;
+    u32 core_freq;
+    u32 core_freqeff;
+    u32 core_c0;
+    u32 core_cc6;
+};
+
+struct smu_pm_metrics {
+    struct smu_dev*                 smu;
+    const struct smu_pm_decoder*    dec;
+    size_t                          size;
+    int                             refresh;
+
+    // Serializes updates, guarding the table copy & the metrics.
+    struct mutex                    lock;
+    u8*                             table;
+    struct ryzen_smu_pm_metrics     metrics;
+    struct ryzen_smu_pm_core*       cores;
+    ktime_t                         last_update;
+
+    // Read from atomic context, so guarded by a spinlock rather than the mutex.
+    spinlock_t                      counters_lock;
+    struct smu_pm_counters          counters;
+};
+
+// Mirrors the layouts of lib/pm_tables.h.
+static const struct smu_pm_decoder g_pm_decoders[] = {
+    {
+        .codename           = CODENAME_MATISSE,
+        .version            = 0x240903,
+        .size               = 0x518,
+        .cores              = 8,
+
+        .socket_power       = 0x074,
+        .package_voltage    = 0x0A0,
+        .package_pc6        = 0x21C,
+        .temperature        = 0x014,
+
+        .core_power         = 0x24C,
+        .core_freq          = 0x2EC,
+        .core_freqeff       = 0x30C,
+        .core_c0            = 0x32C,
+        .core_cc6           = 0x36C,
+    },
+};
+
+/**
+ * Converts the IEEE-754 single [bits] to an integer in units of 1/[scale], rounding towards zero.
+ * The FPU isn't usable here, so this works on the bits directly. Denormals, infinities & NaNs,
+ *  none of which the SMU reports for sane values, yield zero & huge values saturate.
+ */
+static s64 pm_f32_scaled(u32 bits, u32 scale) {
+    u32 exp = (bits >> 23) & 0xFF;
+    u64 val;
+    int shift;
+
+    if (exp == 0 || exp == 0xFF)
+        return 0;
+
+    // At most 56 bits wide, with the binary point 23 bits from the right.
+    val = (u64)((bits & 0x7FFFFF) | 0x800000) * scale;
+    shift = (int)exp - 127 - 23;
+
+    if (shift >= 8)
+        val = S64_MAX;
+    else if (shift >= 0)
+        val <<= shift;
+    else if (shift > -64)
+        val >>= -shift;
+    else
+        val = 0;
+
+    return (bits & 0x80000000) ? -(s64)val : (s64)val;
+}
+
+static u32 pm_read(const u8* table, u32 offset, u32 idx) {
+    u32 bits;
+
+    memcpy(&bits, table + offset + idx * sizeof(bits), sizeof(bits));
+    return bits;
+}
+
+// Clamps negative readings, which only result from sensor noise, to zero.
+static u32 pm_read_u32(const u8* table, u32 offset, u32 idx, u32 scale) {
+    return clamp_t(s64, pm_f32_scaled(pm_read(table, offset, idx), scale), 0, U32_MAX);
+}
+
+const struct smu_pm_decoder* smu_pm_decoder_find(enum smu_processor_codename codename, u32 version,
+    size_t size) {
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(g_pm_decoders); i++)
+        if (g_pm_decoders[i].codename == codename && g_pm_decoders[i].version == version)
+            return g_pm_decoders[i].size <= size ? &g_pm_decoders[i] : NULL;
+
+    return NULL;
+}
+
+u32 smu_pm_decoder_cores(const struct smu_pm_decoder* dec) {
+    return dec->cores;
+}
+
+/**
+ * Returns the package voltage while awake. The telemetry voltage averages in the time the package
+ *  spent in PC6 at the sleep voltage, which is removed as smu_decode_core_metrics() does.
+ */
+static u32 pm_awake_voltage_uv(const struct smu_pm_decoder* dec, const u8* table) {
+    u32 pc6 = min_t(u32, pm_read_u32(table, dec->package_pc6, 0, 100), 10000);
+    s64 telemetry_uv = pm_read_u32(table, dec->package_voltage, 0, 1000000);
+
+    if (pc6 >= 10000)
+        return PM_SLEEP_VOLTAGE_UV;
+
+    return clamp_t(s64, div_s64(telemetry_uv * 10000 - (s64)PM_SLEEP_VOLTAGE_UV * pc6,
+        10000 - pc6), 0, U32_MAX);
+}
+
+void smu_pm_decode(const struct smu_pm_decoder* dec, const u8* table,
+    struct ryzen_smu_pm_metrics* m, struct ryzen_smu_pm_core* cores) {
+    u32 i, pkg_uv, cc6, ungated = 0;
+    u64 total_uv = 0;
+
+    memset(m, 0, sizeof(*m));
+
+    m->package_power_mw = pm_read_u32(table, dec->socket_power, 0, 1000);
+    m->temperature_mc = clamp_t(s64, pm_f32_scaled(pm_read(table, dec->temperature, 0), 1000),
+        S32_MIN, S32_MAX);
+    m->core_count = dec->cores;
+
+    pkg_uv = pm_awake_voltage_uv(dec, table);
+
+    for (i = 0; i < dec->cores; i++) {
+        // Effective frequencies are reported in GHz.
+        cores[i].freq_eff_mhz = pm_read_u32(table, dec->core_freqeff, i, 1000);
+        cores[i].power_mw = pm_read_u32(table, dec->core_power, i, 1000);
+        cores[i].c0 = min_t(u32, pm_read_u32(table, dec->core_c0, i, 100), 10000);
+        cores[i].cc6 = cc6 = min_t(u32, pm_read_u32(table, dec->core_cc6, i, 100), 10000);
+
+        // Gated cores report no clock. The others sit at the package voltage except while in CC6,
+        //  in the same fashion Ryzen Master estimates them & matching lib/metrics.c.
+        if (pm_read(table, dec->core_freq, i) & 0x7FFFFFFF) {
+            cores[i].voltage_uv = div_u64((u64)(10000 - cc6) * pkg_uv +
+                (u64)cc6 * PM_SLEEP_VOLTAGE_UV, 10000);
+            total_uv += cores[i].voltage_uv;
+            ungated++;
+        }
+        else
+            cores[i].voltage_uv = 0;
+
+        if (cores[i].c0 >= PM_ACTIVE_C0)
+            m->active_cores++;
+
+        m->peak_freq_mhz = max(m->peak_freq_mhz, cores[i].freq_eff_mhz);
+    }
+
+    if (ungated)
+        m->core_voltage_uv = div_u64(total_uv, ungated);
+}
+
+struct smu_pm_metrics* smu_pm_metrics_create(struct smu_dev* smu, const struct smu_pm_decoder* dec,
+    size_t size, int refresh, int numa_node) {
+    struct smu_pm_metrics* pm;
+
+    pm = kzalloc_node(sizeof(*pm), GFP_KERNEL, numa_node);
+    if (!pm)
+        return ERR_PTR(-ENOMEM);
+
+    pm->table = kzalloc_node(size, GFP_KERNEL, numa_node);
+    pm->cores = kcalloc_node(dec->cores, sizeof(*pm->cores), GFP_KERNEL, numa_node);
+
+    if (!pm->table || !pm->cores) {
+        smu_pm_metrics_destroy(pm);
+        return ERR_PTR(-ENOMEM);
+    }
+
+    pm->smu = smu;
+    pm->dec = dec;
+    pm->size = size;
+    pm->refresh = refresh;
+    pm->metrics.core_count = dec->cores;
+
+    mutex_init(&pm->lock);
+    spin_lock_init(&pm->counters_lock);
+
+    return pm;
+}
+
+void smu_pm_metrics_destroy(struct smu_pm_metrics* pm) {
+    kfree(pm->table);
+    kfree(pm->cores);
+    kfree(pm);
+}
+
+u32 smu_pm_metrics_cores(struct smu_pm_metrics* pm) {
+    return pm->dec->cores;
+}
+
+/**
+ * Accounts the time since the previous update at the rates just decoded, which the SMU reports as
+ *  averages over the interval leading up to the table transfer.
+ */
+static void smu_pm_metrics_integrate(struct smu_pm_metrics* pm, u64 dt_ns) {
+    struct smu_pm_counters* c = &pm->counters;
+    unsigned long flags;
+    u32 i, core_mw = 0;
+
+    spin_lock_irqsave(&pm->counters_lock, flags);
+
+    for (i = 0; i < pm->dec->cores; i++) {
+        core_mw += pm->cores[i].power_mw;
+        c->c0_residency_ns += mul_u64_u32_div(dt_ns, pm->cores[i].c0, 10000);
+        c->cc6_residency_ns += mul_u64_u32_div(dt_ns, pm->cores[i].cc6, 10000);
+    }
+
+    // mW * ns = 10^-6 uJ.
+    c->package_energy_uj += mul_u64_u32_div(dt_ns, pm->metrics.package_power_mw, 1000000);
+    c->core_energy_uj += mul_u64_u32_div(dt_ns, core_mw, 1000000);
+
+    spin_unlock_irqrestore(&pm->counters_lock, flags);
+}
+
+int smu_pm_metrics_get(struct smu_pm_metrics* pm, struct ryzen_smu_pm_metrics* m,
+    struct ryzen_smu_pm_core* cores) {
+    struct ryzen_smu_pm_table_gen gen;
+    ktime_t now;
+    int err = 0;
+
+    mutex_lock(&pm->lock);
+
+    if (pm->refresh && smu_refresh_pm_table(pm->smu, 0) != SMU_Return_OK) {
+        err = -EIO;
+        goto BREAK_OUT;
+    }
+
+    if (smu_get_pm_table_generation(pm->smu, &gen) != SMU_Return_OK) {
+        err = -ENODEV;
+        goto BREAK_OUT;
+    }
+
+    // Only decoded once per table transfer which changed it.
+    if (gen.generation == pm->metrics.generation)
+        goto COPY_OUT;
+
+    if (smu_copy_pm_table(pm->smu, pm->table, pm->size) != SMU_Return_OK) {
+        err = -EIO;
+        goto BREAK_OUT;
+    }
+
+    smu_pm_decode(pm->dec, pm->table, &pm->metrics, pm->cores);
+    pm->metrics.generation = gen.generation;
+
+    // Nothing to integrate before the first update.
+    now = ktime_get();
+    if (pm->last_update)
+        smu_pm_metrics_integrate(pm, ktime_to_ns(ktime_sub(now, pm->last_update)));
+
+    pm->last_update = now;
+
+COPY_OUT:
+    if (m)
+        memcpy(m, &pm->metrics, sizeof(*m));
+
+    if (cores)
+        memcpy(cores, pm->cores, pm->dec->cores * sizeof(*cores));
+
+BREAK_OUT:
+    mutex_unlock(&pm->lock);
+    return err;
+}
+
+void smu_pm_metrics_counters(struct smu_pm_metrics* pm, struct smu_pm_counters* c) {
+    unsigned long flags;
+
+    spin_lock_irqsave(&pm->counters_lock, flags);
+    memcpy(c, &pm->counters, sizeof(*c));
+    spin_unlock_irqrestore(&pm->counters_lock, flags);
+}
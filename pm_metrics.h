@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com> */
+/* Ryzen SMU PM Table Metrics */
+
+#ifndef __PM_METRICS_H__
+#define __PM_METRICS_H__
+
+#include "smu.h"
+#include "drv.h"
+
+struct smu_pm_decoder;
+
+/**
+ * Returns the decoder of PM table [version] of [codename], or NULL if its layout is unknown or
+ *  doesn't fit within [size] bytes.
+ */
+const struct smu_pm_decoder* smu_pm_decoder_find(enum smu_processor_codename codename, u32 version,
+    size_t size);
+
+/**
+ * Returns the amount of cores described by tables [dec] decodes.
+ */
+u32 smu_pm_decoder_cores(const struct smu_pm_decoder* dec);
+
+/**
+ * Derives the metrics of [table] into [m] and the per-core metrics into [cores], which holds
+ *  smu_pm_decoder_cores() entries. Only integer arithmetic is used, so this may be called from any
+ *  context.
+ */
+void smu_pm_decode(const struct smu_pm_decoder* dec, const u8* table,
+    struct ryzen_smu_pm_metrics* m, struct ryzen_smu_pm_core* cores);
+
+/**
+ * Running totals of the derived metrics, integrated over every table update observed, which
+ *  userspace computes rates & averages from.
+ */
+struct smu_pm_counters {
+    u64 package_energy_uj;
+    u64 core_energy_uj;
+    // Time spent in C0 & CC6, summed over every core.
+    u64 c0_residency_ns;
+    u64 cc6_residency_ns;
+};
+
+/**
+ * The metrics of a single SMU, derived from its PM table using a decoder, which sysfs, hwmon &
+ *  perf share.
+ */
+struct smu_pm_metrics;
+
+/**
+ * Creates the metrics of [smu], whose table is [size] bytes and decoded by [dec]. Reads request a
+ *  table update subject to the refresh policy if [refresh] is set, otherwise something else keeps
+ *  the table up to date.
+ *
+ * Returns an ERR_PTR() on failure.
+ */
+struct smu_pm_metrics* smu_pm_metrics_create(struct smu_dev* smu, const struct smu_pm_decoder* dec,
+    size_t size, int refresh, int numa_node);
+void smu_pm_metrics_destroy(struct smu_pm_metrics* pm);
+
+u32 smu_pm_metrics_cores(struct smu_pm_metrics* pm);
+
+/**
+ * Updates the metrics, decoding the table again only if it changed, and copies them to [m] &
+ *  [cores], either of which may be NULL. May sleep.
+ */
+int smu_pm_metrics_get(struct smu_pm_metrics* pm, struct ryzen_smu_pm_metrics* m,
+    struct ryzen_smu_pm_core* cores);
+
+/**
+ * Copies the counters as of the last update. Safe to call from atomic context.
+ */
+void smu_pm_metrics_counters(struct smu_pm_metrics* pm, struct smu_pm_counters* c);
+
+#endif /* __PM_METRICS_H__ */
@@ -0,0 +1,257 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com> */
+/* Ryzen SMU Perf Events */
+
+#include <linux/atomic.h>
+#include <linux/cpumask.h>
+#include <linux/device.h>
+#include <linux/err.h>
+#include <linux/perf_event.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/version.h>
+#include <linux/workqueue.h>
+
+#include "pm_metrics.h"
+#include "pmu.h"
+
+/**
+ * Events are running totals of the metrics, as counting events need to be monotonic: perf stat
+ *  reports the energy consumed, which divided by the time elapsed is the average power.
+ */
+enum smu_pmu_event {
+    SMU_PMU_PACKAGE_ENERGY = 1,
+    SMU_PMU_CORE_ENERGY,
+    SMU_PMU_C0_RESIDENCY,
+    SMU_PMU_CC6_RESIDENCY,
+
+    SMU_PMU_EVENT_COUNT
+};
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 0, 0)
+    #define SMU_PMU_CAPABILITIES    (PERF_PMU_CAP_NO_INTERRUPT | PERF_PMU_CAP_NO_EXCLUDE)
+#else
+    #define SMU_PMU_CAPABILITIES    PERF_PMU_CAP_NO_INTERRUPT
+#endif
+
+struct smu_pmu {
+    struct pmu              pmu;
+    struct smu_pm_metrics*  pm;
+    int                     cpu;
+    char                    name[32];
+
+    // Events may only be read from atomic context, so the table is decoded in the background
+    //  while any of them are counting and they read the counters as of the last update.
+    atomic_t                active;
+    struct delayed_work     poll;
+};
+
+static struct smu_pmu* to_smu_pmu(struct pmu* pmu) {
+    return container_of(pmu, struct smu_pmu, pmu);
+}
+
+static u64 smu_pmu_counter(struct smu_pmu* sp, u64 config) {
+    struct smu_pm_counters c;
+
+    smu_pm_metrics_counters(sp->pm, &c);
+
+    switch (config) {
+        case SMU_PMU_PACKAGE_ENERGY:
+            return c.package_energy_uj;
+        case SMU_PMU_CORE_ENERGY:
+            return c.core_energy_uj;
+        case SMU_PMU_C0_RESIDENCY:
+            return c.c0_residency_ns;
+        case SMU_PMU_CC6_RESIDENCY:
+            return c.cc6_residency_ns;
+        default:
+            return 0;
+    }
+}
+
+static void smu_pmu_poll(struct work_struct* work) {
+    struct smu_pmu* sp = container_of(to_delayed_work(work), struct smu_pmu, poll);
+
+    // Failed transfers are simply not integrated, the next one covers their interval.
+    smu_pm_metrics_get(sp->pm, NULL, NULL);
+
+    if (atomic_read(&sp->active))
+        schedule_delayed_work(&sp->poll, msecs_to_jiffies(SMU_PMU_POLL_MS));
+}
+
+static int smu_pmu_event_init(struct perf_event* event) {
+    struct smu_pmu* sp = to_smu_pmu(event->pmu);
+
+    if (event->attr.type != event->pmu->type)
+        return -ENOENT;
+
+    if (event->attr.config == 0 || event->attr.config >= SMU_PMU_EVENT_COUNT)
+        return -EINVAL;
+
+    // The SMU has no notion of tasks nor raises interrupts, so only system wide counting works.
+    if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK || event->cpu < 0)
+        return -EINVAL;
+
+    event->cpu = sp->cpu;
+    event->hw.config = event->attr.config;
+
+    return 0;
+}
+
+static void smu_pmu_event_update(struct perf_event* event) {
+    struct smu_pmu* sp = to_smu_pmu(event->pmu);
+    u64 prev, now;
+
+    now = smu_pmu_counter(sp, event->hw.config);
+    prev = local64_xchg(&event->hw.prev_count, now);
+
+    local64_add(now - prev, &event->count);
+}
+
+static void smu_pmu_event_start(struct perf_event* event, int flags) {
+    struct smu_pmu* sp = to_smu_pmu(event->pmu);
+
+    local64_set(&event->hw.prev_count, smu_pmu_counter(sp, event->hw.config));
+    event->hw.state = 0;
+}
+
+static void smu_pmu_event_stop(struct perf_event* event, int flags) {
+    if (event->hw.state & PERF_HES_STOPPED)
+        return;
+
+    smu_pmu_event_update(event);
+    event->hw.state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+static int smu_pmu_event_add(struct perf_event* event, int flags) {
+    struct smu_pmu* sp = to_smu_pmu(event->pmu);
+
+    event->hw.state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+
+    if (atomic_inc_return(&sp->active) == 1)
+        schedule_delayed_work(&sp->poll, 0);
+
+    if (flags & PERF_EF_START)
+        smu_pmu_event_start(event, flags);
+
+    return 0;
+}
+
+static void smu_pmu_event_del(struct perf_event* event, int flags) {
+    struct smu_pmu* sp = to_smu_pmu(event->pmu);
+
+    smu_pmu_event_stop(event, PERF_EF_UPDATE);
+
+    // The poll stops rescheduling itself once nothing is counting.
+    atomic_dec(&sp->active);
+}
+
+static ssize_t cpumask_show(struct device* dev, struct device_attribute* attr, char* buf) {
+    struct smu_pmu* sp = to_smu_pmu(dev_get_drvdata(dev));
+
+    return cpumap_print_to_pagebuf(true, buf, cpumask_of(sp->cpu));
+}
+
+static DEVICE_ATTR_RO(cpumask);
+
+static struct attribute* smu_pmu_attrs[] = {
+    &dev_attr_cpumask.attr,
+    NULL,
+};
+
+static const struct attribute_group smu_pmu_attr_group = {
+    .attrs = smu_pmu_attrs,
+};
+
+PMU_FORMAT_ATTR(event, "config:0-7");
+
+static struct attribute* smu_pmu_format_attrs[] = {
+    &format_attr_event.attr,
+    NULL,
+};
+
+static const struct attribute_group smu_pmu_format_group = {
+    .name   = "format",
+    .attrs  = smu_pmu_format_attrs,
+};
+
+// Energy is counted in uJ & residencies in ns.
+PMU_EVENT_ATTR_STRING(package_energy, smu_pmu_package_energy, "event=0x01");
+PMU_EVENT_ATTR_STRING(package_energy.unit, smu_pmu_package_energy_unit, "Joules");
+PMU_EVENT_ATTR_STRING(package_energy.scale, smu_pmu_package_energy_scale, "1e-6");
+PMU_EVENT_ATTR_STRING(core_energy, smu_pmu_core_energy, "event=0x02");
+PMU_EVENT_ATTR_STRING(core_energy.unit, smu_pmu_core_energy_unit, "Joules");
+PMU_EVENT_ATTR_STRING(core_energy.scale, smu_pmu_core_energy_scale, "1e-6");
+PMU_EVENT_ATTR_STRING(c0_residency, smu_pmu_c0_residency, "event=0x03");
+PMU_EVENT_ATTR_STRING(c0_residency.unit, smu_pmu_c0_residency_unit, "ns");
+PMU_EVENT_ATTR_STRING(cc6_residency, smu_pmu_cc6_residency, "event=0x04");
+PMU_EVENT_ATTR_STRING(cc6_residency.unit, smu_pmu_cc6_residency_unit, "ns");
+
+static struct attribute* smu_pmu_event_attrs[] = {
+    &smu_pmu_package_energy.attr.attr,
+    &smu_pmu_package_energy_unit.attr.attr,
+    &smu_pmu_package_energy_scale.attr.attr,
+    &smu_pmu_core_energy.attr.attr,
+    &smu_pmu_core_energy_unit.attr.attr,
+    &smu_pmu_core_energy_scale.attr.attr,
+    &smu_pmu_c0_residency.attr.attr,
+    &smu_pmu_c0_residency_unit.attr.attr,
+    &smu_pmu_cc6_residency.attr.attr,
+    &smu_pmu_cc6_residency_unit.attr.attr,
+    NULL,
+};
+
+static const struct attribute_group smu_pmu_events_group = {
+    .name   = "events",
+    .attrs  = smu_pmu_event_attrs,
+};
+
+static const struct attribute_group* smu_pmu_attr_groups[] = {
+    &smu_pmu_attr_group,
+    &smu_pmu_format_group,
+    &smu_pmu_events_group,
+    NULL,
+};
+
+struct smu_pmu* smu_pmu_register(const char* name, struct smu_pm_metrics* pm, int cpu) {
+    struct smu_pmu* sp;
+    int err;
+
+    sp = kzalloc(sizeof(*sp), GFP_KERNEL);
+    if (!sp)
+        return ERR_PTR(-ENOMEM);
+
+    sp->pm = pm;
+    sp->cpu = cpu;
+    strscpy(sp->name, name, sizeof(sp->name));
+    INIT_DELAYED_WORK(&sp->poll, smu_pmu_poll);
+
+    sp->pmu = (struct pmu) {
+        .module         = THIS_MODULE,
+        .task_ctx_nr    = perf_invalid_context,
+        .attr_groups    = smu_pmu_attr_groups,
+        .capabilities   = SMU_PMU_CAPABILITIES,
+        .event_init     = smu_pmu_event_init,
+        .add            = smu_pmu_event_add,
+        .del            = smu_pmu_event_del,
+        .start          = smu_pmu_event_start,
+        .stop           = smu_pmu_event_stop,
+        .read           = smu_pmu_event_update,
+    };
+
+    err = perf_pmu_register(&sp->pmu, sp->name, -1);
+    if (err) {
+        kfree(sp);
+        return ERR_PTR(err);
+    }
+
+    return sp;
+}
+
+void smu_pmu_unregister(struct smu_pmu* sp) {
+    perf_pmu_unregister(&sp->pmu);
+
+    // No events remain past unregistering, so the poll won't be scheduled again.
+    cancel_delayed_work_sync(&sp->poll);
+    kfree(sp);
+}
@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com> */
+/* Ryzen SMU Perf Events */
+
+#ifndef __PMU_H__
+#define __PMU_H__
+
+#include "pm_metrics.h"
+
+/* Interval at which the PM table is decoded while any event is counting. */
+#define SMU_PMU_POLL_MS                               100
+
+struct smu_pmu;
+
+/**
+ * Registers a perf PMU named [name] counting the integrated metrics of [pm], whose events are
+ *  bound to [cpu]. [pm] must outlive the PMU.
+ *
+ * Returns an ERR_PTR() on failure.
+ */
+struct smu_pmu* smu_pmu_register(const char* name, struct smu_pm_metrics* pm, int cpu);
+void smu_pmu_unregister(struct smu_pmu* sp);
+
+#endif /* __PMU_H__ */
@@ -0,0 +1,462 @@
+/**
+ * Ryzen SMU Userspace Library Python Bindings
+ * Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <libsmu.h>
+
+/**
+ * The _libsmu extension only wraps libsmu, the numpy views it is meant for being built by the
+ *  ryzen_smu package on top of the buffers returned here, so the extension itself needn't be built
+ *  against numpy.
+ */
+
+static PyObject* SmuError;
+
+typedef struct {
+    PyObject_HEAD
+    smu_obj_t                   obj;
+    // Shape of the buffer exported, in 32-bit words.
+    Py_ssize_t                  words;
+} SmuObject;
+
+static PyObject* smu_py_error(smu_return_val ret) {
+    PyObject* err = Py_BuildValue("(is)", ret, smu_return_to_str(ret));
+
+    if (err) {
+        PyErr_SetObject(SmuError, err);
+        Py_DECREF(err);
+    }
+
+    return NULL;
+}
+
+/**
+ * Converts a PM table layout into a dict mapping every field reported by the table version to an
+ *  (offset, count, stride, type) tuple, type being either "f32" or "u32".
+ */
+static PyObject* smu_py_schema_dict(const smu_pm_schema_t* schema) {
+    const smu_pm_field_t* f;
+    PyObject *dict, *item;
+    int i;
+
+    dict = PyDict_New();
+    if (!dict)
+        return NULL;
+
+    for (i = 0; i < PM_FIELD_COUNT; i++) {
+        f = &schema->fields[i];
+        if (!f->count)
+            continue;
+
+        item = Py_BuildValue("(IIIs)", f->offset, f->count, f->stride,
+            f->type == PM_TYPE_U32 ? "u32" : "f32");
+
+        if (!item || PyDict_SetItemString(dict, smu_pm_field_name(i), item)) {
+            Py_XDECREF(item);
+            Py_DECREF(dict);
+            return NULL;
+        }
+
+        Py_DECREF(item);
+    }
+
+    return dict;
+}
+
+static int Smu_init(SmuObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = { "client", "name", NULL };
+    const char* name = NULL;
+    smu_return_val ret;
+    int client = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|pz", kwlist, &client, &name))
+        return -1;
+
+    if (self->obj.init) {
+        PyErr_SetString(PyExc_RuntimeError, "Smu is already initialized");
+        return -1;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = client ? smu_init_client(&self->obj, name) : smu_init(&self->obj);
+    Py_END_ALLOW_THREADS
+
+    if (ret != SMU_Return_OK) {
+        smu_py_error(ret);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void Smu_dealloc(SmuObject* self) {
+    if (self->obj.init)
+        smu_free(&self->obj);
+
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+/**
+ * Exports the PM table without copying it: the memory the SMU transfers the table to when bound to
+ *  the driver, or the segment published by smu_telemetryd for clients. Either is only updated by
+ *  the next transfer, which may be taking place while the buffer is read.
+ */
+static int Smu_getbuffer(SmuObject* self, Py_buffer* view, int flags) {
+    const float *table, *alt = NULL;
+    const smu_shm_header_t* hdr;
+
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "The PM table is read-only");
+        return -1;
+    }
+
+    if (self->obj.shm) {
+        hdr = self->obj.shm;
+        table = (const float*)((const unsigned char*)self->obj.shm + hdr->table_offset);
+    }
+    else if (!(table = smu_map_pm_table(&self->obj, &alt))) {
+        PyErr_SetString(PyExc_BufferError, "The PM table can't be mapped");
+        return -1;
+    }
+
+    // The secondary table of Picasso & Raven Ridge lives in a separate mapping.
+    if (alt) {
+        PyErr_SetString(PyExc_BufferError,
+            "The PM table spans two mappings, use read_pm_table() instead");
+        return -1;
+    }
+
+    if (PyBuffer_FillInfo(view, (PyObject*)self, (void*)table, self->obj.pm_table_size, 1, flags))
+        return -1;
+
+    // PyBuffer_FillInfo() only describes bytes, which consumers not asking for the format expect.
+    //  The strides, if requested, point to the itemsize.
+    if (flags & PyBUF_FORMAT) {
+        view->format = "f";
+        view->itemsize = sizeof(float);
+
+        if (flags & PyBUF_ND) {
+            self->words = self->obj.pm_table_size / sizeof(float);
+            view->shape = &self->words;
+        }
+    }
+
+    return 0;
+}
+
+static PyBufferProcs Smu_as_buffer = {
+    .bf_getbuffer = (getbufferproc)Smu_getbuffer,
+};
+
+static PyObject* Smu_read_pm_table(SmuObject* self, PyObject* args) {
+    PyObject *out = NULL, *ret_obj;
+    smu_return_val ret;
+    Py_buffer buf;
+
+    if (!PyArg_ParseTuple(args, "|O", &out))
+        return NULL;
+
+    // Reading into a caller's buffer lets loops run without allocating.
+    if (out && out != Py_None) {
+        if (PyObject_GetBuffer(out, &buf, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS))
+            return NULL;
+
+        if ((size_t)buf.len < self->obj.pm_table_size) {
+            PyBuffer_Release(&buf);
+            return smu_py_error(SMU_Return_InsufficientSize);
+        }
+
+        Py_BEGIN_ALLOW_THREADS
+        ret = smu_read_pm_table(&self->obj, buf.buf, self->obj.pm_table_size);
+        Py_END_ALLOW_THREADS
+
+        PyBuffer_Release(&buf);
+
+        if (ret != SMU_Return_OK)
+            return smu_py_error(ret);
+
+        Py_INCREF(out);
+        return out;
+    }
+
+    ret_obj = PyByteArray_FromStringAndSize(NULL, self->obj.pm_table_size);
+    if (!ret_obj)
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = smu_read_pm_table(&self->obj, (unsigned char*)PyByteArray_AS_STRING(ret_obj),
+        self->obj.pm_table_size);
+    Py_END_ALLOW_THREADS
+
+    if (ret != SMU_Return_OK) {
+        Py_DECREF(ret_obj);
+        return smu_py_error(ret);
+    }
+
+    return ret_obj;
+}
+
+static PyObject* Smu_refresh_pm_table(SmuObject* self, PyObject* unused) {
+    smu_return_val ret;
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = smu_refresh_pm_table(&self->obj);
+    Py_END_ALLOW_THREADS
+
+    if (ret != SMU_Return_OK)
+        return smu_py_error(ret);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* Smu_pm_table_generation(SmuObject* self, PyObject* unused) {
+    smu_pm_table_gen_t gen;
+    smu_return_val ret;
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = smu_get_pm_table_generation(&self->obj, &gen);
+    Py_END_ALLOW_THREADS
+
+    if (ret != SMU_Return_OK)
+        return smu_py_error(ret);
+
+    return PyLong_FromUnsignedLongLong(gen.generation);
+}
+
+static PyObject* Smu_schema(SmuObject* self, PyObject* unused) {
+    const smu_pm_schema_t* schema = smu_get_pm_schema(&self->obj);
+
+    if (!schema)
+        Py_RETURN_NONE;
+
+    return smu_py_schema_dict(schema);
+}
+
+static PyObject* Smu_get_codename(SmuObject* self, void* closure) {
+    return PyLong_FromLong(self->obj.codename);
+}
+
+static PyObject* Smu_get_codename_str(SmuObject* self, void* closure) {
+    return PyUnicode_FromString(smu_codename_to_str(&self->obj));
+}
+
+static PyObject* Smu_get_fw_version(SmuObject* self, void* closure) {
+    return PyUnicode_FromString(smu_get_fw_version(&self->obj));
+}
+
+static PyObject* Smu_get_pm_table_version(SmuObject* self, void* closure) {
+    return PyLong_FromUnsignedLong(self->obj.pm_table_version);
+}
+
+static PyObject* Smu_get_pm_table_size(SmuObject* self, void* closure) {
+    return PyLong_FromUnsignedLong(self->obj.pm_table_size);
+}
+
+static PyObject* Smu_get_pm_tables_supported(SmuObject* self, void* closure) {
+    return PyBool_FromLong(self->obj.shm ? self->obj.pm_table_size != 0
+        : smu_pm_tables_supported(&self->obj));
+}
+
+static PyMethodDef Smu_methods[] = {
+    { "read_pm_table", (PyCFunction)Smu_read_pm_table, METH_VARARGS,
+        "read_pm_table(out=None)\n--\n\n"
+        "Copies the PM table into [out], a writable buffer, or a new bytearray." },
+    { "refresh_pm_table", (PyCFunction)Smu_refresh_pm_table, METH_NOARGS,
+        "Commands the SMU to update the mapped PM table without reading it." },
+    { "pm_table_generation", (PyCFunction)Smu_pm_table_generation, METH_NOARGS,
+        "Returns the generation of the PM table, bumped by every transfer which changed it." },
+    { "schema", (PyCFunction)Smu_schema, METH_NOARGS,
+        "Returns the layout of the PM table as a dict of field names, or None if unknown." },
+    { NULL },
+};
+
+static PyGetSetDef Smu_getset[] = {
+    { "codename", (getter)Smu_get_codename, NULL, "Processor codename, as an integer.", NULL },
+    { "codename_str", (getter)Smu_get_codename_str, NULL, "Processor codename.", NULL },
+    { "fw_version", (getter)Smu_get_fw_version, NULL, "SMU firmware version.", NULL },
+    { "pm_table_version", (getter)Smu_get_pm_table_version, NULL, "PM table version.", NULL },
+    { "pm_table_size", (getter)Smu_get_pm_table_size, NULL, "PM table size in bytes.", NULL },
+    { "pm_tables_supported", (getter)Smu_get_pm_tables_supported, NULL,
+        "Whether the PM table can be read.", NULL },
+    { NULL },
+};
+
+static PyTypeObject SmuType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "ryzen_smu._libsmu.Smu",
+    .tp_doc = "Smu(client=False, name=None)\n--\n\n"
+        "Connection to the ryzen_smu driver or, for clients, to the segment published by\n"
+        "smu_telemetryd under [name]. The object exports the PM table through the buffer\n"
+        "protocol without copying it.",
+    .tp_basicsize = sizeof(SmuObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)Smu_init,
+    .tp_dealloc = (destructor)Smu_dealloc,
+    .tp_as_buffer = &Smu_as_buffer,
+    .tp_methods = Smu_methods,
+    .tp_getset = Smu_getset,
+};
+
+static PyObject* libsmu_find_schema(PyObject* self, PyObject* args) {
+    const smu_pm_schema_t* schema;
+    unsigned int codename, version;
+
+    if (!PyArg_ParseTuple(args, "II", &codename, &version))
+        return NULL;
+
+    schema = smu_find_pm_schema(codename, version);
+    if (!schema)
+        Py_RETURN_NONE;
+
+    return smu_py_schema_dict(schema);
+}
+
+static PyObject* libsmu_field_names(PyObject* self, PyObject* unused) {
+    PyObject *list, *name;
+    int i;
+
+    list = PyList_New(PM_FIELD_COUNT);
+    if (!list)
+        return NULL;
+
+    for (i = 0; i < PM_FIELD_COUNT; i++) {
+        name = PyUnicode_FromString(smu_pm_field_name(i));
+        if (!name) {
+            Py_DECREF(list);
+            return NULL;
+        }
+
+        PyList_SET_ITEM(list, i, name);
+    }
+
+    return list;
+}
+
+/**
+ * Decodes [count] samples of a recording, from sample [start] onwards, into one contiguous buffer
+ *  so that they can be viewed as a single (count, words) array. Samples are decoded in order,
+ *  meaning each delta frame is only applied once.
+ */
+static PyObject* libsmu_read_recording(PyObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = { "path", "start", "count", NULL };
+    PyObject *tables = NULL, *stamps = NULL, *ret_obj = NULL;
+    unsigned long long start = 0, i, n;
+    long long count = -1;
+    unsigned long long* ts;
+    smu_rec_reader_t r;
+    unsigned char* dst;
+    smu_return_val ret;
+    const char* path;
+    size_t size;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|KL", kwlist, &path, &start, &count))
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = smu_rec_reader_open(&r, path);
+    Py_END_ALLOW_THREADS
+
+    if (ret != SMU_Return_OK)
+        return smu_py_error(ret);
+
+    n = start < r.count ? r.count - start : 0;
+    if (count >= 0 && (unsigned long long)count < n)
+        n = count;
+
+    size = r.info.pm_table_size;
+
+    tables = PyByteArray_FromStringAndSize(NULL, n * size);
+    stamps = PyByteArray_FromStringAndSize(NULL, n * sizeof(*ts));
+    if (!tables || !stamps)
+        goto BREAK_OUT;
+
+    dst = (unsigned char*)PyByteArray_AS_STRING(tables);
+    ts = (unsigned long long*)PyByteArray_AS_STRING(stamps);
+
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 0, ret = SMU_Return_OK; i < n && ret == SMU_Return_OK; i++)
+        ret = smu_rec_read(&r, start + i, dst + i * size, &ts[i]);
+    Py_END_ALLOW_THREADS
+
+    if (ret != SMU_Return_OK) {
+        smu_py_error(ret);
+        goto BREAK_OUT;
+    }
+
+    ret_obj = Py_BuildValue("{s:I,s:I,s:I,s:K,s:O,s:O}", "codename", r.info.codename,
+        "pm_table_version", r.info.pm_table_version, "pm_table_size", r.info.pm_table_size,
+        "count", n, "timestamps", stamps, "tables", tables);
+
+BREAK_OUT:
+    Py_XDECREF(tables);
+    Py_XDECREF(stamps);
+    smu_rec_reader_close(&r);
+
+    return ret_obj;
+}
+
+static PyMethodDef libsmu_methods[] = {
+    { "find_schema", libsmu_find_schema, METH_VARARGS,
+        "find_schema(codename, version)\n--\n\n"
+        "Returns the layout of PM table [version] on [codename], or None if unknown." },
+    { "field_names", libsmu_field_names, METH_NOARGS,
+        "Returns the name of every PM table field known to the library." },
+    { "read_recording", (PyCFunction)(void (*)(void))libsmu_read_recording,
+        METH_VARARGS | METH_KEYWORDS,
+        "read_recording(path, start=0, count=-1)\n--\n\n"
+        "Decodes [count] samples of the recording at [path] into a dict holding the\n"
+        "recording's metadata along with 'timestamps' & 'tables' bytearrays." },
+    { NULL },
+};
+
+static struct PyModuleDef libsmu_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "ryzen_smu._libsmu",
+    .m_doc = "Bindings to the Ryzen SMU userspace library.",
+    .m_size = -1,
+    .m_methods = libsmu_methods,
+};
+
+PyMODINIT_FUNC PyInit__libsmu(void) {
+    PyObject* m;
+
+    if (PyType_Ready(&SmuType) < 0)
+        return NULL;
+
+    m = PyModule_Create(&libsmu_module);
+    if (!m)
+        return NULL;
+
+    SmuError = PyErr_NewExceptionWithDoc("ryzen_smu._libsmu.SmuError",
+        "Raised with the (smu_return_val, description) of a failed operation.", PyExc_OSError,
+        NULL);
+
+    Py_INCREF(&SmuType);
+    if (!SmuError || PyModule_AddObject(m, "Smu", (PyObject*)&SmuType) ||
+        PyModule_AddObject(m, "SmuError", SmuError)) {
+        Py_DECREF(&SmuType);
+        Py_XDECREF(SmuError);
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    return m;
+}
@@ -0,0 +1,122 @@
+"""
+Ryzen SMU Userspace Library Python Bindings
+
+Exposes the PM table as numpy arrays backed by the memory the SMU writes it to, or by the segment
+published by smu_telemetryd, without copying it. Fields are looked up by the names of the library's
+schema registry, as spelled after the PM_FIELD_ prefix.
+"""
+
+from collections import namedtuple
+
+import numpy as np
+
+from ._libsmu import SmuError, field_names, find_schema, read_recording
+from ._libsmu import Smu as _Smu
+
+__all__ = [
+    "Smu",
+    "SmuError",
+    "Recording",
+    "field_names",
+    "find_schema",
+    "field_view",
+    "load_recording",
+]
+
+
+def field_view(schema, table, name):
+    """
+    Returns a view of field [name] of [table], laid out as described by [schema], without copying
+    it. [table] is either a single table or a (samples, words) array of them, in which case the
+    view holds one row per sample.
+
+    Returns None if the table version doesn't report the field.
+    """
+    field = schema.get(name)
+    if field is None:
+        return None
+
+    offset, count, stride, kind = field
+    if offset % 4 or stride % 4:
+        raise ValueError("Field {0} isn't aligned to 32-bit words".format(name))
+
+    words = table if kind == "f32" else table.view(np.uint32)
+    start, step = offset // 4, max(stride // 4, 1)
+
+    return words[..., start:start + count * step:step]
+
+
+class Smu(_Smu):
+    """
+    Connection to the ryzen_smu driver or, with client set, to the segment published by
+    smu_telemetryd under [name].
+    """
+
+    def __init__(self, client=False, name=None):
+        super().__init__(client=client, name=name)
+        self._schema = super().schema()
+        self._table = None
+
+    def pm_table(self):
+        """
+        Returns the PM table as a read-only float32 array viewing the mapped table. The array is
+        only updated by table transfers, requested with refresh_pm_table() or any read.
+        """
+        if self._table is None:
+            self._table = np.frombuffer(self, dtype=np.float32)
+
+        return self._table
+
+    def schema(self):
+        """
+        Returns the layout of the PM table as a dict of field names, or None if it isn't known.
+        """
+        return self._schema
+
+    def field(self, name, table=None):
+        """
+        Returns a view of field [name] of [table], the mapped PM table by default.
+        """
+        if self._schema is None:
+            return None
+
+        return field_view(self._schema, self.pm_table() if table is None else table, name)
+
+
+class Recording(
+    namedtuple("Recording", ["codename", "pm_table_version", "schema", "timestamps", "tables"])
+):
+    """
+    Samples of a recording. [timestamps] holds the time every sample was taken at, in nanoseconds,
+    and [tables] is a (samples, words) float32 array of the tables.
+    """
+
+    __slots__ = ()
+
+    def field(self, name):
+        """
+        Returns a view of field [name] holding one row per sample, or None if it isn't reported.
+        """
+        if self.schema is None:
+            return None
+
+        return field_view(self.schema, self.tables, name)
+
+
+def load_recording(path, start=0, count=-1):
+    """
+    Decodes [count] samples of the recording at [path], from sample [start] onwards, all at once.
+    """
+    rec = read_recording(path, start, count)
+    words = rec["pm_table_size"] // 4
+
+    tables = np.frombuffer(rec["tables"], dtype=np.float32).reshape(rec["count"], words)
+    timestamps = np.frombuffer(rec["timestamps"], dtype=np.uint64)
+
+    return Recording(
+        codename=rec["codename"],
+        pm_table_version=rec["pm_table_version"],
+        schema=find_schema(rec["codename"], rec["pm_table_version"]),
+        timestamps=timestamps,
+        tables=tables,
+    )
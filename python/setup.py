@@ -0,0 +1,27 @@
+#!/bin/python3
+
+from setuptools import setup, Extension
+
+# The library is built straight into the extension, as the userspace tools do.
+libsmu = Extension(
+    "ryzen_smu._libsmu",
+    sources=[
+        "libsmu_module.c",
+        "../lib/libsmu.c",
+        "../lib/recording.c",
+    ],
+    include_dirs=["../lib"],
+    extra_compile_args=["-O3"],
+    libraries=["m", "rt", "pthread"],
+)
+
+setup(
+    name="ryzen_smu",
+    version="0.1.5",
+    description="Python bindings to the Ryzen SMU userspace library",
+    license="GPL-3.0-or-later",
+    packages=["ryzen_smu"],
+    ext_modules=[libsmu],
+    install_requires=["numpy"],
+    python_requires=">=3.7",
+)
@@ -0,0 +1,316 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com> */
+/* Ryzen SMU Periodic PM Table Sampler */
+
+#include <linux/hrtimer.h>
+#include <linux/kref.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/version.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+
+#include "smu.h"
+#include "drv.h"
+#include "sampler.h"
+
+/**
+ * The sampler is a single producer: an hrtimer fires every interval and queues the transfer onto
+ *  an ordered high priority workqueue, as talking to the SMU may sleep. Every completed sample is
+ *  published into a ring shared by all readers, whether they mmap() it or read() from the device,
+ *  so any number of consumers cost exactly one SMU transaction per period.
+ */
+struct smu_sampler {
+    struct smu_dev*                 smu;
+    struct kref                     ref;
+
+    struct hrtimer                  timer;
+    struct work_struct              work;
+    struct workqueue_struct*        wq;
+    wait_queue_head_t               waitq;
+    ktime_t                         interval;
+    int                             stopped;
+
+    // vmalloc_user() region holding the header page followed by the slots.
+    struct ryzen_smu_sample_ring*   ring;
+    size_t                          ring_size;
+    size_t                          table_size;
+};
+
+static struct ryzen_smu_sample* smu_sampler_slot(struct smu_sampler* s, u64 seq) {
+    u8* base = (u8*)s->ring + s->ring->slots_offset;
+
+    return (struct ryzen_smu_sample*)(base + ((seq - 1) % s->ring->slot_count) * s->ring->slot_size);
+}
+
+static void smu_sampler_work(struct work_struct* work) {
+    struct smu_sampler* s = container_of(work, struct smu_sampler, work);
+    struct ryzen_smu_sample* sample;
+    ktime_t start, end;
+    u64 seq;
+    u32 ret;
+
+    start = ktime_get();
+    ret = smu_refresh_pm_table(s->smu, 1);
+    end = ktime_get();
+
+    if (ret != SMU_Return_OK) {
+        WRITE_ONCE(s->ring->failed, s->ring->failed + 1);
+        pr_debug("Sampler: PM table transfer failed (%d)", ret);
+        return;
+    }
+
+    // Being the only writer, the head can't change under us.
+    seq = s->ring->head + 1;
+    sample = smu_sampler_slot(s, seq);
+
+    // Invalidate the slot before overwriting it so readers can detect a torn copy.
+    WRITE_ONCE(sample->seq, 0);
+    smp_wmb();
+
+    if (smu_copy_pm_table(s->smu, sample->data, s->table_size) != SMU_Return_OK) {
+        WRITE_ONCE(s->ring->failed, s->ring->failed + 1);
+        return;
+    }
+
+    sample->timestamp_ns = ktime_to_ns(end);
+    sample->duration_ns = ktime_to_ns(ktime_sub(end, start));
+    sample->size = s->table_size;
+
+    smp_wmb();
+    WRITE_ONCE(sample->seq, seq);
+    smp_store_release(&s->ring->head, seq);
+
+    wake_up_interruptible_all(&s->waitq);
+}
+
+static enum hrtimer_restart smu_sampler_tick(struct hrtimer* timer) {
+    struct smu_sampler* s = container_of(timer, struct smu_sampler, timer);
+    u64 overruns;
+
+    overruns = hrtimer_forward_now(timer, s->interval);
+    if (overruns > 1)
+        WRITE_ONCE(s->ring->missed, s->ring->missed + overruns - 1);
+
+    // The previous sample is still in progress, this period is skipped.
+    if (!queue_work(s->wq, &s->work))
+        WRITE_ONCE(s->ring->missed, s->ring->missed + 1);
+
+    return HRTIMER_RESTART;
+}
+
+struct smu_sampler* smu_sampler_create(struct smu_dev* smu, size_t table_size, u32 interval_us,
+    u32 slots) {
+    struct smu_sampler* s;
+    size_t slot_size;
+
+    s = kzalloc(sizeof(*s), GFP_KERNEL);
+    if (!s)
+        return ERR_PTR(-ENOMEM);
+
+    slot_size = ALIGN(sizeof(struct ryzen_smu_sample) + table_size, 64);
+
+    s->smu = smu;
+    s->table_size = table_size;
+    s->interval = us_to_ktime(interval_us);
+    s->ring_size = PAGE_ALIGN(PAGE_SIZE + slots * slot_size);
+
+    // Zeroed memory which may be remapped into userspace.
+    s->ring = vmalloc_user(s->ring_size);
+    if (!s->ring)
+        goto ERR_FREE;
+
+    s->ring->slot_count = slots;
+    s->ring->slot_size = slot_size;
+    s->ring->slots_offset = PAGE_SIZE;
+    s->ring->table_size = table_size;
+    s->ring->interval_ns = ktime_to_ns(s->interval);
+
+    s->wq = alloc_ordered_workqueue("ryzen_smu_sampler", WQ_HIGHPRI);
+    if (!s->wq)
+        goto ERR_FREE;
+
+    kref_init(&s->ref);
+    init_waitqueue_head(&s->waitq);
+    INIT_WORK(&s->work, smu_sampler_work);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+    hrtimer_setup(&s->timer, smu_sampler_tick, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+#else
+    hrtimer_init(&s->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+    s->timer.function = smu_sampler_tick;
+#endif
+
+    hrtimer_start(&s->timer, ktime_add(ktime_get(), s->interval), HRTIMER_MODE_ABS);
+
+    pr_info("Sampling the PM table every %u us into %u slots", interval_us, slots);
+    return s;
+
+ERR_FREE:
+    vfree(s->ring);
+    kfree(s);
+
+    return ERR_PTR(-ENOMEM);
+}
+
+static void smu_sampler_release(struct kref* ref) {
+    struct smu_sampler* s = container_of(ref, struct smu_sampler, ref);
+
+    vfree(s->ring);
+    kfree(s);
+}
+
+void smu_sampler_get(struct smu_sampler* s) {
+    kref_get(&s->ref);
+}
+
+void smu_sampler_put(struct smu_sampler* s) {
+    kref_put(&s->ref, smu_sampler_release);
+}
+
+void smu_sampler_destroy(struct smu_sampler* s) {
+    // The timer must be stopped first as it is what queues the work.
+    hrtimer_cancel(&s->timer);
+    cancel_work_sync(&s->work);
+    destroy_workqueue(s->wq);
+
+    // Release any readers still blocked waiting for a sample.
+    WRITE_ONCE(s->stopped, 1);
+    wake_up_interruptible_all(&s->waitq);
+
+    smu_sampler_put(s);
+}
+
+u64 smu_sampler_head(struct smu_sampler* s) {
+    return smp_load_acquire(&s->ring->head);
+}
+
+int smu_sampler_copy_latest(struct smu_sampler* s, u8* dst) {
+    struct ryzen_smu_sample* sample;
+    u64 head;
+    int i;
+
+    // Periods are far apart compared to a copy so a couple of attempts suffice.
+    for (i = 0; i < 4; i++) {
+        head = smu_sampler_head(s);
+        if (!head)
+            return -ENODATA;
+
+        sample = smu_sampler_slot(s, head);
+        if (READ_ONCE(sample->seq) != head)
+            continue;
+
+        smp_rmb();
+        memcpy(dst, sample->data, s->table_size);
+        smp_rmb();
+
+        if (READ_ONCE(sample->seq) == head)
+            return 0;
+    }
+
+    return -EAGAIN;
+}
+
+static void smu_sampler_vm_open(struct vm_area_struct* vma) {
+    smu_sampler_get(vma->vm_private_data);
+}
+
+static void smu_sampler_vm_close(struct vm_area_struct* vma) {
+    smu_sampler_put(vma->vm_private_data);
+}
+
+static const struct vm_operations_struct smu_sampler_vm_ops = {
+    .open   = smu_sampler_vm_open,
+    .close  = smu_sampler_vm_close,
+};
+
+int smu_sampler_mmap(struct smu_sampler* s, struct vm_area_struct* vma) {
+    int err;
+
+    // Readers must never be able to corrupt the ring for others.
+    if (vma->vm_flags & VM_WRITE)
+        return -EPERM;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+    vm_flags_clear(vma, VM_MAYWRITE);
+#else
+    vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+    // Rejects mappings larger than the ring.
+    err = remap_vmalloc_range(vma, s->ring, 0);
+    if (err)
+        return err;
+
+    // The mapping outlives the file so it must hold its own reference.
+    vma->vm_private_data = s;
+    vma->vm_ops = &smu_sampler_vm_ops;
+    smu_sampler_get(s);
+
+    return 0;
+}
+
+ssize_t smu_sampler_read(struct smu_sampler* s, u64* cursor, char __user* buf, size_t count,
+    int nonblock) {
+    size_t record = sizeof(struct ryzen_smu_sample) + s->table_size, done = 0;
+    struct ryzen_smu_sample* sample;
+    u64 head, seq;
+    int err;
+
+    if (count < record)
+        return -EINVAL;
+
+    for (;;) {
+        head = smu_sampler_head(s);
+
+        while (*cursor <= head && done + record <= count) {
+            // Skip ahead past any samples that were overwritten before being read.
+            if (head - *cursor >= s->ring->slot_count)
+                *cursor = head - s->ring->slot_count + 1;
+
+            sample = smu_sampler_slot(s, *cursor);
+            seq = READ_ONCE(sample->seq);
+            smp_rmb();
+
+            if (seq == *cursor) {
+                if (copy_to_user(buf + done, sample, record))
+                    return done ? done : -EFAULT;
+
+                smp_rmb();
+
+                // Only keep the record if the producer did not start rewriting it meanwhile.
+                if (READ_ONCE(sample->seq) == seq)
+                    done += record;
+            }
+
+            (*cursor)++;
+        }
+
+        if (done)
+            return done;
+
+        if (READ_ONCE(s->stopped))
+            return -ENODEV;
+
+        if (nonblock)
+            return -EAGAIN;
+
+        err = wait_event_interruptible(s->waitq,
+            smu_sampler_head(s) >= *cursor || READ_ONCE(s->stopped));
+        if (err)
+            return err;
+    }
+}
+
+__poll_t smu_sampler_poll(struct smu_sampler* s, struct file* filp, u64 cursor,
+    poll_table* wait) {
+    poll_wait(filp, &s->waitq, wait);
+
+    if (READ_ONCE(s->stopped))
+        return EPOLLERR;
+
+    return smu_sampler_head(s) >= cursor ? EPOLLIN | EPOLLRDNORM : 0;
+}
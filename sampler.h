@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com> */
+/* Ryzen SMU Periodic PM Table Sampler */
+
+#ifndef __SAMPLER_H__
+#define __SAMPLER_H__
+
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/pci.h>
+#include <linux/poll.h>
+
+#include "smu.h"
+
+/* Range of the sampling interval, in microseconds. */
+#define SMU_SAMPLER_INTERVAL_MIN_US                   100
+#define SMU_SAMPLER_INTERVAL_MAX_US                   10000000
+
+/* Range of the amount of samples kept in the ring. */
+#define SMU_SAMPLER_SLOTS_MIN                         2
+#define SMU_SAMPLER_SLOTS_MAX                         4096
+
+struct smu_sampler;
+
+/**
+ * Allocates a ring of [slots] samples of [table_size] bytes and starts refreshing the PM table of
+ *  [smu] into it every [interval_us] microseconds.
+ *
+ * Returns the sampler or an ERR_PTR() on failure.
+ */
+struct smu_sampler* smu_sampler_create(struct smu_dev* smu, size_t table_size, u32 interval_us,
+    u32 slots);
+
+/**
+ * Stops sampling and drops the creator's reference. The ring is freed once all readers and
+ *  mappings using it have also released it.
+ */
+void smu_sampler_destroy(struct smu_sampler* s);
+
+/**
+ * Acquires or releases a reference to the sampler, keeping the ring alive.
+ */
+void smu_sampler_get(struct smu_sampler* s);
+void smu_sampler_put(struct smu_sampler* s);
+
+/**
+ * Returns the number of the most recently completed sample, zero if none exist yet.
+ */
+u64 smu_sampler_head(struct smu_sampler* s);
+
+/**
+ * Copies the table of the most recently completed sample into the destination buffer, which
+ *  must hold at least the table size.
+ *
+ * Returns 0 on success or a negative error code if no sample could be retrieved.
+ */
+int smu_sampler_copy_latest(struct smu_sampler* s, u8* dst);
+
+/**
+ * Maps the sample ring read-only into a userspace VMA.
+ */
+int smu_sampler_mmap(struct smu_sampler* s, struct vm_area_struct* vma);
+
+/**
+ * Reads as many complete samples as fit in [count] bytes, starting from the sample numbered
+ *  [*cursor], which is advanced past every sample consumed or lost to an overrun.
+ *
+ * Blocks until at least one sample is available unless [nonblock] is set.
+ */
+ssize_t smu_sampler_read(struct smu_sampler* s, u64* cursor, char __user* buf, size_t count,
+    int nonblock);
+
+/**
+ * Polls for samples numbered [cursor] or above.
+ */
+__poll_t smu_sampler_poll(struct smu_sampler* s, struct file* filp, u64 cursor,
+    poll_table* wait);
+
+#endif /* __SAMPLER_H__ */
@@ -1,33 +1,22 @@
 #!/bin/python
 
-import os
 import sys
-import struct
 
-def read_pm():
-    with open("dump.bin", "rb") as fp:
-        content = fp.read()
-        fp.close()
-    return content
+import ryzen_smu
 
-def read_float(buffer, offset):
-    return struct.unpack("@f", buffer[offset:(offset + 4)])[0]
+def dump_float(path, sample):
+    rec = ryzen_smu.load_recording(path, sample, 1)
 
-def read_double(buffer, offset):
-    return struct.unpack("@d", buffer[offset:(offset + 8)])[0]
+    if len(rec.tables) == 0:
+        print("{} holds no sample {}".format(path, sample))
+        sys.exit(1)
 
-def read_int(buffer, offset):
-    return struct.unpack("@I", buffer[offset:(offset + 4)])[0]
+    for i, v in enumerate(rec.tables[0]):
+        print("0x{:04X} -> {:8.6f}".format(i * 4, v))
 
-def dump_float():
-    c = read_pm()
-    size = len(c)
 
-    i = 0
-    while i < size:
-        v = read_float(c, i)
-        print("0x{:04X} -> {:8.6f}".format(i, v))
-        i = i + 4
+if len(sys.argv) < 2:
+    print("Usage: {} <recording> [sample]".format(sys.argv[0]))
+    sys.exit(1)
 
-
-dump_float()
\ No newline at end of file
+dump_float(sys.argv[1], int(sys.argv[2]) if len(sys.argv) > 2 else 0)
@@ -4,14 +4,273 @@
 
 #include <asm/io.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/pci.h>
+#include <linux/slab.h>
 #include <linux/time.h>
+#include <linux/workqueue.h>
 
+#include "drv.h"
 #include "smu.h"
+#include "stats.h"
+
+#define CREATE_TRACE_POINTS
+#include "smu_trace.h"
+
+// How the DRAM base address of the PM table(s) is requested.
+enum smu_pm_base_method {
+  // A single command returning a 64-bit address in its first two arguments.
+  SMU_PM_BASE_SINGLE,
+  // A setup command, followed by one returning a 32-bit address.
+  SMU_PM_BASE_TWO_STEP,
+  // The bases of the primary & secondary tables, each selected separately.
+  SMU_PM_BASE_DUAL,
+};
+
+struct smu_pm_size {
+  u32 version;
+  u32 size;
+};
+
+// A table the SMU transfers to DRAM when its ID is passed in the first argument
+//  of TransferTableSmu2Dram, read independently of the PM table.
+struct smu_table_desc {
+  u32 id;
+  u32 size;
+  // Whether the table is also appended to the PM table, as it always was.
+  int pm_append;
+};
+
+// Everything needed to reach the PM table(s) of a codename, resolved once in
+//  smu_init(). A zero opcode means the codename doesn't support the command.
+struct smu_pm_ops {
+  enum smu_mailbox mailbox;
+
+  enum smu_pm_base_method base_method;
+  u32 base_fn[3];
+
+  // TransferTableSmu2Dram along with the table it selects for the PM table.
+  u32 transfer_fn;
+  u32 transfer_arg;
+
+  // TableVersionId.
+  u32 version_fn;
+
+  // Sizes of every known table version, in which case the version is probed
+  //  to determine the size. Otherwise, [size] is fixed.
+  const struct smu_pm_size *sizes;
+  u32 size_count;
+  u32 size;
+
+  // Other tables transferred through [transfer_fn], by ID. Only tables appended
+  //  to the PM table, sharing its DRAM region, are known so far.
+  const struct smu_table_desc *tables;
+  u32 table_count;
+};
+
+#define SMU_PM_SIZES(table) .sizes = table, .size_count = ARRAY_SIZE(table)
+#define SMU_PM_TABLES(table) .tables = table, .table_count = ARRAY_SIZE(table)
+
+// These sizes are actually accurate and not just "guessed".
+// Source: Ryzen Master.
+static const struct smu_pm_size smu_pm_sizes_matisse[] = {
+    {0x240902, 0x514},
+    {0x240903, 0x518},
+    {0x240802, 0x7E0},
+    {0x240803, 0x7E4},
+};
+
+static const struct smu_pm_size smu_pm_sizes_vermeer[] = {
+    {0x2D0903, 0x594},
+    {0x380904, 0x5A4},
+    {0x380005, 0x1BB0}, // 64
+    {0x380505, 0xF30},  // 32
+    {0x380605, 0xC10},  // 24
+    {0x380705, 0x8F0},  // 16
+    {0x380905, 0x5D0},  // 8
+    {0x2D0803, 0x894},
+    {0x380804, 0x8A4},
+    {0x380805, 0x8F0},
+};
+
+static const struct smu_pm_size smu_pm_sizes_milan[] = {
+    {0x2D0008, 0x1AB0},
+};
+
+static const struct smu_pm_size smu_pm_sizes_renoir[] = {
+    {0x370000, 0x794},
+    {0x370001, 0x884},
+    {0x370002, 0x88C},
+    {0x370003, 0x88C},
+    {0x370004, 0x8AC},
+    {0x370005, 0x8F0},
+};
+
+static const struct smu_pm_size smu_pm_sizes_cezanne[] = {
+    {0x400005, 0x944},
+};
+
+static const struct smu_pm_size smu_pm_sizes_rembrandt[] = {
+    {0x450004, 0xA44},
+    {0x450005, 0xA44},
+};
+
+static const struct smu_pm_size smu_pm_sizes_raphael[] = {
+    {0x540104, 0x6A8},
+    {0x000400, 0x948},
+};
+
+static const struct smu_pm_size smu_pm_sizes_phoenix[] = {
+    {0x4C0006, 0xAA0},
+    {0x4C0007, 0xAA0},
+    {0x4C0008, 0xAA0},
+};
+
+static const struct smu_pm_size smu_pm_sizes_hawkpoint[] = {
+    {0x4C0008, 0xA00},
+};
+
+// Picasso/RavenRidge have two PM tables, a larger (primary) one and a smaller
+//  one, always 0x608 and 0xA4 bytes each. Source: Ryzen Master.
+static const struct smu_table_desc smu_tables_raven[] = {
+    {.id = 5, .size = 0xA4, .pm_append = 1},
+};
+
+// Commands shared by every member of a family.
+#define SMU_PM_OPS_ZEN                                                         \
+  .mailbox = MAILBOX_TYPE_RSMU, .base_method = SMU_PM_BASE_SINGLE,             \
+  .base_fn = {0x0a}, .transfer_fn = 0x0a
+
+#define SMU_PM_OPS_ZEN_PLUS                                                    \
+  .mailbox = MAILBOX_TYPE_RSMU, .base_method = SMU_PM_BASE_TWO_STEP,           \
+  .base_fn = {0x0b, 0x0c}, .transfer_fn = 0x3d, .transfer_arg = 3
+
+#define SMU_PM_OPS_RAVEN                                                       \
+  .mailbox = MAILBOX_TYPE_RSMU, .base_method = SMU_PM_BASE_DUAL,               \
+  .base_fn = {0x0a, 0x3d, 0x0b}, .transfer_fn = 0x3d, .transfer_arg = 3,       \
+  SMU_PM_TABLES(smu_tables_raven)
+
+#define SMU_PM_OPS_ZEN2                                                        \
+  .mailbox = MAILBOX_TYPE_RSMU, .base_method = SMU_PM_BASE_SINGLE,             \
+  .base_fn = {0x06}, .transfer_fn = 0x05, .version_fn = 0x08
+
+#define SMU_PM_OPS_ZEN4                                                        \
+  .mailbox = MAILBOX_TYPE_RSMU, .base_method = SMU_PM_BASE_SINGLE,             \
+  .base_fn = {0x04}, .transfer_fn = 0x03, .version_fn = 0x05
+
+#define SMU_PM_OPS_APU                                                         \
+  .mailbox = MAILBOX_TYPE_RSMU, .base_method = SMU_PM_BASE_SINGLE,             \
+  .base_fn = {0x66}, .transfer_fn = 0x65, .transfer_arg = 3,                   \
+  .version_fn = 0x06
+
+static const struct smu_pm_ops smu_pm_ops_zen = {SMU_PM_OPS_ZEN};
+
+static const struct smu_pm_ops smu_pm_ops_zen_plus = {SMU_PM_OPS_ZEN_PLUS};
+
+static const struct smu_pm_ops smu_pm_ops_picasso = {
+    SMU_PM_OPS_RAVEN, .version_fn = 0x0c, .size = 0x608};
+
+static const struct smu_pm_ops smu_pm_ops_ravenridge2 = {SMU_PM_OPS_RAVEN,
+                                                         .size = 0x608};
+
+static const struct smu_pm_ops smu_pm_ops_dali = {
+    .mailbox = MAILBOX_TYPE_RSMU,
+    .base_method = SMU_PM_BASE_DUAL,
+    .base_fn = {0x0a, 0x3d, 0x0b}};
+
+static const struct smu_pm_ops smu_pm_ops_matisse = {
+    SMU_PM_OPS_ZEN2, SMU_PM_SIZES(smu_pm_sizes_matisse)};
+
+static const struct smu_pm_ops smu_pm_ops_vermeer = {
+    SMU_PM_OPS_ZEN2, SMU_PM_SIZES(smu_pm_sizes_vermeer)};
+
+static const struct smu_pm_ops smu_pm_ops_milan = {
+    SMU_PM_OPS_ZEN2, SMU_PM_SIZES(smu_pm_sizes_milan)};
+
+static const struct smu_pm_ops smu_pm_ops_raphael = {
+    SMU_PM_OPS_ZEN4, SMU_PM_SIZES(smu_pm_sizes_raphael)};
+
+static const struct smu_pm_ops smu_pm_ops_graniteridge = {SMU_PM_OPS_ZEN4,
+                                                          .size = 0x948};
+
+static const struct smu_pm_ops smu_pm_ops_renoir = {
+    SMU_PM_OPS_APU, SMU_PM_SIZES(smu_pm_sizes_renoir)};
+
+// Unlike the other APUs, the table argument isn't needed here.
+static const struct smu_pm_ops smu_pm_ops_cezanne = {
+    .mailbox = MAILBOX_TYPE_RSMU,
+    .base_method = SMU_PM_BASE_SINGLE,
+    .base_fn = {0x66},
+    .transfer_fn = 0x65,
+    .version_fn = 0x06,
+    SMU_PM_SIZES(smu_pm_sizes_cezanne)};
+
+static const struct smu_pm_ops smu_pm_ops_rembrandt = {
+    SMU_PM_OPS_APU, SMU_PM_SIZES(smu_pm_sizes_rembrandt)};
+
+static const struct smu_pm_ops smu_pm_ops_phoenix = {
+    SMU_PM_OPS_APU, SMU_PM_SIZES(smu_pm_sizes_phoenix)};
+
+static const struct smu_pm_ops smu_pm_ops_hawkpoint = {
+    SMU_PM_OPS_APU, SMU_PM_SIZES(smu_pm_sizes_hawkpoint)};
+
+static const struct smu_pm_ops smu_pm_ops_strix = {SMU_PM_OPS_APU,
+                                                   .size = 0xAA0};
+
+// Codenames without an entry don't support PM tables.
+static const struct smu_pm_ops *const smu_pm_ops_table[CODENAME_COUNT] = {
+    [CODENAME_NAPLES] = &smu_pm_ops_zen,
+    [CODENAME_SUMMITRIDGE] = &smu_pm_ops_zen,
+    [CODENAME_THREADRIPPER] = &smu_pm_ops_zen,
+    [CODENAME_COLFAX] = &smu_pm_ops_zen_plus,
+    [CODENAME_PINNACLERIDGE] = &smu_pm_ops_zen_plus,
+    [CODENAME_PICASSO] = &smu_pm_ops_picasso,
+    [CODENAME_RAVENRIDGE] = &smu_pm_ops_picasso,
+    [CODENAME_RAVENRIDGE2] = &smu_pm_ops_ravenridge2,
+    [CODENAME_DALI] = &smu_pm_ops_dali,
+    [CODENAME_CASTLEPEAK] = &smu_pm_ops_matisse,
+    [CODENAME_MATISSE] = &smu_pm_ops_matisse,
+    [CODENAME_VERMEER] = &smu_pm_ops_vermeer,
+    [CODENAME_CHAGALL] = &smu_pm_ops_vermeer,
+    [CODENAME_MILAN] = &smu_pm_ops_milan,
+    [CODENAME_RAPHAEL] = &smu_pm_ops_raphael,
+    [CODENAME_GRANITERIDGE] = &smu_pm_ops_graniteridge,
+    [CODENAME_RENOIR] = &smu_pm_ops_renoir,
+    [CODENAME_LUCIENNE] = &smu_pm_ops_renoir,
+    [CODENAME_CEZANNE] = &smu_pm_ops_cezanne,
+    [CODENAME_REMBRANDT] = &smu_pm_ops_rembrandt,
+    [CODENAME_PHOENIX] = &smu_pm_ops_phoenix,
+    [CODENAME_HAWKPOINT] = &smu_pm_ops_hawkpoint,
+    [CODENAME_STRIX] = &smu_pm_ops_strix,
+};
+
+// State of a table other than the PM table, guarded by table_mutex.
+struct smu_table {
+  const struct smu_table_desc *desc;
+
+  u64 dram_base;
+  u8 __iomem *virt_addr;
+
+  // Copy of the table as of the last transfer which changed it, followed by
+  //  the scratch space the next transfer is compared in.
+  u8 *buf;
+  u64 generation;
+
+  enum smu_pm_refresh_policy refresh_policy;
+  u32 refresh_interval_us;
+  ktime_t last_transfer;
+  ktime_t last_access;
+};
+
+// State of the SMU behind a single root complex, one of which exists for every
+//  socket of the system.
+struct smu_dev {
+  struct pci_dev *pdev;
 
-static struct {
   enum smu_processor_codename codename;
+  const struct smu_pm_ops *pm_ops;
 
   // Optional RSMU mailbox addresses.
   u32 addr_rsmu_mb_cmd;
@@ -28,82 +287,137 @@ static struct {
   u32 addr_hsmp_mb_rsp;
   u32 addr_hsmp_mb_args;
 
-  // Optional PM table information.
+  // Optional PM table information. [pm_dram_map_size] includes the size of
+  //  [pm_alt], the table appended to it on Picasso/RavenRidge 2, if present.
   u64 pm_dram_base;
-  u32 pm_dram_base_alt;
   u32 pm_dram_map_size;
-  u32 pm_dram_map_size_alt;
-
-  // Internal tracker to determine the minimum interval required to
-  //  refresh the metrics table.
-  u32 pm_jiffies;
-
-  // Virtual addresses mapped to physical DRAM bases for PM table.
+  struct smu_table *pm_alt;
+
+  // Determines whether reads transfer a new table, based on the time of the
+  //  last transfer, zero until the first one.
+  enum smu_pm_refresh_policy pm_refresh_policy;
+  u32 pm_refresh_interval_us;
+  ktime_t pm_last_transfer;
+
+  // Unless the timeout is zero, the mappings & copies below, as well as those
+  //  of the other tables, are released once the table has not been accessed
+  //  for that long, being set up again by the next access.
+  u32 pm_idle_timeout_ms;
+  ktime_t pm_last_access;
+  struct delayed_work pm_idle_work;
+
+  // Virtual address mapped to the physical DRAM base of the PM table.
   u8 __iomem *pm_table_virt_addr;
-  u8 __iomem *pm_table_virt_addr_alt;
-} g_smu = {
-    .codename = CODENAME_UNDEFINED,
-
-    .addr_rsmu_mb_cmd = 0,
-    .addr_rsmu_mb_rsp = 0,
-    .addr_rsmu_mb_args = 0,
-
-    .mp1_if_ver = IF_VERSION_COUNT,
-    .addr_mp1_mb_cmd = 0,
-    .addr_mp1_mb_rsp = 0,
-    .addr_mp1_mb_args = 0,
-
-    .addr_hsmp_mb_cmd = 0,
-    .addr_hsmp_mb_rsp = 0,
-    .addr_hsmp_mb_args = 0,
-
-    .pm_dram_base = 0,
-    .pm_dram_base_alt = 0,
-    .pm_dram_map_size = 0,
-    .pm_dram_map_size_alt = 0,
-    .pm_jiffies = 0,
-
-    .pm_table_virt_addr = NULL,
-    .pm_table_virt_addr_alt = NULL,
+
+  // Copies of the table as of the last and previous transfer, which every
+  //  read is served from and are compared to track which lines changed.
+  u8 *pm_table_cur;
+  u8 *pm_table_prev;
+  u64 pm_generation;
+  u64 pm_dirty[RYZEN_SMU_PM_TABLE_DIRTY_WORDS];
+
+  // The SMN lock is defined separately because the SMN address space can be
+  //  used independently from the SMU but the SMU requires access to the SMN to
+  //  execute commands. Each mailbox has its own set of registers so commands
+  //  sent to different mailboxes may execute concurrently, only taking the SMN
+  //  lock for the duration of each individual register access.
+  struct mutex pci_mutex;
+  struct mutex smu_mutex[MAILBOX_TYPE_COUNT];
+
+  // Guards the PM table state (DRAM bases, sizes, mappings and refresh
+  //  tracker) which can be reached concurrently from sysfs and the character
+  //  device.
+  //
+  // Lock ordering, outermost first, is:
+  //  pm_mutex -> table_mutex -> smu_mutex[mailbox] -> pci_mutex
+  struct mutex pm_mutex;
+
+  // Other tables, indexed in the order of their descriptors. Kept apart from
+  //  pm_mutex so reading them never holds up the PM table.
+  struct smu_table tables[RYZEN_SMU_TABLE_MAX];
+  u32 table_count;
+  struct mutex table_mutex;
+
+  // Command latency statistics, guarded by the mailbox locks.
+  struct smu_stats *stats;
 };
 
-// Both mutexes are defined separately because the SMN address space can be used
-//  independently from the SMU but the SMU requires access to the SMN to execute
-//  commands.
-static DEFINE_MUTEX(amd_pci_mutex);
-static DEFINE_MUTEX(amd_smu_mutex);
+static void smu_pm_table_release(struct smu_dev *smu);
+static void smu_pm_table_idle(struct work_struct *work);
+static enum smu_return_val smu_table_setup(struct smu_dev *smu,
+                                           struct smu_table *t);
+static void smu_table_track(struct smu_table *t, ktime_t now);
+static void smu_table_release(struct smu_table *t);
 
-int smu_smn_rw_address(struct pci_dev *dev, u32 address, u32 *value,
-                       int write) {
+// Callers must hold pci_mutex.
+static int smu_smn_rw_address_locked(struct smu_dev *smu, u32 address,
+                                     u32 *value, int write) {
   int err;
 
-  // This may work differently for multi-NUMA systems.
-  mutex_lock(&amd_pci_mutex);
-  err = pci_write_config_dword(dev, SMU_PCI_ADDR_REG, address);
+  err = pci_write_config_dword(smu->pdev, SMU_PCI_ADDR_REG, address);
 
   if (!err) {
-    err = (write ? pci_write_config_dword(dev, SMU_PCI_DATA_REG, *value)
-                 : pci_read_config_dword(dev, SMU_PCI_DATA_REG, value));
+    err = (write ? pci_write_config_dword(smu->pdev, SMU_PCI_DATA_REG, *value)
+                 : pci_read_config_dword(smu->pdev, SMU_PCI_DATA_REG, value));
 
     if (err)
       pr_warn("Error %s SMN address: 0x%x!\n", write ? "writing" : "reading",
               address);
   } else
     pr_warn("Error programming SMN address: 0x%x!\n", address);
-  mutex_unlock(&amd_pci_mutex);
+
+  // A failed read leaves *value unwritten.
+  trace_smu_smn_access(smu->pdev->bus->number, address,
+                       err && !write ? 0 : *value, write, err);
+
+  return err;
+}
+
+int smu_smn_rw_address(struct smu_dev *smu, u32 address, u32 *value,
+                       int write) {
+  int err;
+
+  // Every root complex exposes its own index/data pair so the lock is per
+  //  device and sockets never contend with each other.
+  mutex_lock(&smu->pci_mutex);
+  err = smu_smn_rw_address_locked(smu, address, value, write);
+  mutex_unlock(&smu->pci_mutex);
 
   return err;
 }
 
-enum smu_return_val smu_read_address(struct pci_dev *dev, u32 address,
+u32 smu_smn_rw_batch(struct smu_dev *smu, struct ryzen_smu_smn_op *ops,
+                     u32 count) {
+  u32 i, failed = 0;
+
+  mutex_lock(&smu->pci_mutex);
+  for (i = 0; i < count; i++) {
+    if (ops[i].op != RYZEN_SMU_SMN_OP_READ &&
+        ops[i].op != RYZEN_SMU_SMN_OP_WRITE)
+      ops[i].status = SMU_Return_InvalidArgument;
+    else if (smu_smn_rw_address_locked(smu, ops[i].address, &ops[i].value,
+                                       ops[i].op == RYZEN_SMU_SMN_OP_WRITE))
+      ops[i].status = SMU_Return_PCIFailed;
+    else
+      ops[i].status = SMU_Return_OK;
+
+    if (ops[i].status != SMU_Return_OK)
+      failed++;
+  }
+  mutex_unlock(&smu->pci_mutex);
+
+  return failed;
+}
+
+enum smu_return_val smu_read_address(struct smu_dev *smu, u32 address,
                                      u32 *value) {
-  return !smu_smn_rw_address(dev, address, value, 0) ? SMU_Return_OK
+  return !smu_smn_rw_address(smu, address, value, 0) ? SMU_Return_OK
                                                      : SMU_Return_PCIFailed;
 }
 
-enum smu_return_val smu_write_address(struct pci_dev *dev, u32 address,
+enum smu_return_val smu_write_address(struct smu_dev *smu, u32 address,
                                       u32 value) {
-  return !smu_smn_rw_address(dev, address, &value, 1) ? SMU_Return_OK
+  return !smu_smn_rw_address(smu, address, &value, 1) ? SMU_Return_OK
                                                       : SMU_Return_PCIFailed;
 }
 
@@ -116,123 +430,276 @@ void smu_args_init(smu_req_args_t *args, u32 value) {
     args->args[i] = 0;
 }
 
-enum smu_return_val smu_send_command(struct pci_dev *dev, u32 op,
-                                     smu_req_args_t *args,
-                                     enum smu_mailbox mailbox) {
-  u32 retries, tmp, i, rsp_addr, args_addr, cmd_addr;
+// Sleeps for about [delay_us], never past [deadline].
+static void smu_wait_sleep(u32 delay_us, u64 deadline) {
+  u64 now = ktime_get_ns();
+
+  if (now >= deadline)
+    return;
+
+  delay_us = min_t(u64, delay_us, div_u64(deadline - now, NSEC_PER_USEC));
+  if (delay_us)
+    usleep_range(delay_us, delay_us + delay_us / 4);
+}
+
+// Polls the RSP register until the SMU writes a response or [deadline] passes.
+//
+// Each poll is a pair of PCI config accesses serialized against all other SMN
+//  users, so the mailbox is only spun on for as long as the command is
+//  expected to take based on its previous completions. Past that, and right
+//  away for commands known to be slow, the wait sleeps with an exponentially
+//  growing interval instead of pinning the CPU. Sleeps are clamped to the time
+//  remaining, so the deadline bounds how long the mailbox lock is held.
+static enum smu_return_val smu_wait_response(struct smu_dev *smu, u32 rsp_addr,
+                                             u64 expected_ns, u64 deadline,
+                                             u32 *rsp, u32 *polls,
+                                             u32 *sleeps) {
+  u64 start, spin_ns;
+  u32 delay_us;
+
+  start = ktime_get_ns();
+  spin_ns = clamp_t(u64, expected_ns * 2, SMU_WAIT_SPIN_MIN_NS,
+                    SMU_WAIT_SPIN_MAX_NS);
+  delay_us = SMU_WAIT_SLEEP_MIN_US;
+
+  // Sleep through most of the expected time of slow commands upfront.
+  if (expected_ns > SMU_WAIT_SPIN_MAX_NS) {
+    delay_us = min_t(u64, div_u64(expected_ns * 3, 4 * NSEC_PER_USEC),
+                     SMU_WAIT_SLEEP_MAX_US * 8);
+    smu_wait_sleep(delay_us, deadline);
+    (*sleeps)++;
+
+    delay_us = SMU_WAIT_SLEEP_MIN_US;
+  }
 
+  for (;;) {
+    if (smu_read_address(smu, rsp_addr, rsp) != SMU_Return_OK)
+      return SMU_Return_PCIFailed;
+
+    (*polls)++;
+
+    if (*rsp)
+      return SMU_Return_OK;
+
+    if (ktime_get_ns() >= deadline)
+      return SMU_Return_CommandTimeout;
+
+    if (ktime_get_ns() - start < spin_ns) {
+      cpu_relax();
+      continue;
+    }
+
+    smu_wait_sleep(delay_us, deadline);
+    (*sleeps)++;
+
+    delay_us = min_t(u32, delay_us * 2, SMU_WAIT_SLEEP_MAX_US);
+  }
+}
+
+// Registers through which commands are exchanged with a mailbox.
+struct smu_mailbox_regs {
+  u32 cmd;
+  u32 rsp;
+  u32 args;
+};
+
+static int smu_get_mailbox_regs(struct smu_dev *smu, enum smu_mailbox mailbox,
+                                struct smu_mailbox_regs *regs) {
   // == Pick the correct mailbox address. ==
   switch (mailbox) {
   case MAILBOX_TYPE_RSMU:
-    rsp_addr = g_smu.addr_rsmu_mb_rsp;
-    cmd_addr = g_smu.addr_rsmu_mb_cmd;
-    args_addr = g_smu.addr_rsmu_mb_args;
+    regs->rsp = smu->addr_rsmu_mb_rsp;
+    regs->cmd = smu->addr_rsmu_mb_cmd;
+    regs->args = smu->addr_rsmu_mb_args;
     break;
   case MAILBOX_TYPE_MP1:
-    rsp_addr = g_smu.addr_mp1_mb_rsp;
-    cmd_addr = g_smu.addr_mp1_mb_cmd;
-    args_addr = g_smu.addr_mp1_mb_args;
+    regs->rsp = smu->addr_mp1_mb_rsp;
+    regs->cmd = smu->addr_mp1_mb_cmd;
+    regs->args = smu->addr_mp1_mb_args;
     break;
   case MAILBOX_TYPE_HSMP:
-    rsp_addr = g_smu.addr_hsmp_mb_rsp;
-    cmd_addr = g_smu.addr_hsmp_mb_cmd;
-    args_addr = g_smu.addr_hsmp_mb_args;
+    regs->rsp = smu->addr_hsmp_mb_rsp;
+    regs->cmd = smu->addr_hsmp_mb_cmd;
+    regs->args = smu->addr_hsmp_mb_args;
     break;
   default:
-    return SMU_Return_Unsupported;
+    return 0;
   }
 
   // == In the unlikely event a mailbox is undefined, don't even attempt to
   // execute. ==
-  if (!rsp_addr || !cmd_addr || !args_addr)
-    return SMU_Return_Unsupported;
+  return regs->rsp && regs->cmd && regs->args;
+}
+
+// Executes a single command, the caller holding the lock of [mailbox]. [start]
+//  is when the caller began waiting for the lock and [locked] when it got it.
+static enum smu_return_val
+smu_exec_command(struct smu_dev *smu, u32 op, smu_req_args_t *args,
+                 enum smu_mailbox mailbox,
+                 const struct smu_mailbox_regs *regs, u64 start, u64 locked) {
+  u32 tmp, i, polls = 0, sleeps = 0;
+  struct smu_mailbox_stats *mb_stats;
+  struct smu_cmd_stats *stats;
+  enum smu_return_val ret;
+  u64 issued = 0, responded = 0, deadline;
+  int busy = 0;
 
-  pr_debug(
-      "SMU Service Request: ID(0x%x) Args(0x%x, 0x%x, 0x%x, 0x%x, 0x%x, 0x%x)",
-      op, args->s.arg0, args->s.arg1, args->s.arg2, args->s.arg3, args->s.arg4,
-      args->s.arg5);
+  stats = smu_stats_get(smu->stats, mailbox, op);
+  mb_stats = smu_stats_get_mailbox(smu->stats, mailbox);
 
-  mutex_lock(&amd_smu_mutex);
+  // Both waits share the time the attempts took when polled back to back.
+  deadline = ktime_get_ns() + (u64)smu_timeout_attempts * SMU_WAIT_POLL_NS;
 
   // Step 1: Wait until the RSP register is non-zero.
-  retries = smu_timeout_attempts;
-  do
-    if (smu_read_address(dev, rsp_addr, &tmp) != SMU_Return_OK) {
-      mutex_unlock(&amd_smu_mutex);
-      pr_warn("Failed to perform initial probe on SMU RSP!\n");
+  ret = smu_wait_response(smu, regs->rsp, 0, deadline, &tmp, &polls, &sleeps);
 
-      return SMU_Return_PCIFailed;
-    }
-  while (tmp == 0 && retries--);
+  if (ret == SMU_Return_PCIFailed) {
+    pr_warn("Failed to perform initial probe on SMU RSP!\n");
+    goto BREAK_OUT;
+  }
 
   // Step 1.b: A command is still being processed meaning
   //  a new command cannot be issued.
-  if (!retries && !tmp) {
-    mutex_unlock(&amd_smu_mutex);
+  if (ret == SMU_Return_CommandTimeout) {
+    busy = 1;
     pr_debug("SMU Service Request Failed: Timeout on initial wait for mailbox "
              "availability.");
-
-    return SMU_Return_CommandTimeout;
+    goto BREAK_OUT;
   }
 
   // Step 2: Write zero (0) to the RSP register.
-  smu_write_address(dev, rsp_addr, 0);
+  smu_write_address(smu, regs->rsp, 0);
 
   // Step 3: Write the argument(s) into the argument register(s).
   for (i = 0; i < SMU_REQ_MAX_ARGS; i++)
-    smu_write_address(dev, args_addr + (i * 4), args->args[i]);
+    smu_write_address(smu, regs->args + (i * 4), args->args[i]);
 
   // Step 4: Write the message Id into the Message ID register.
-  smu_write_address(dev, cmd_addr, op);
+  smu_write_address(smu, regs->cmd, op);
+  issued = ktime_get_ns();
 
   // Step 5: Wait until the Response register is non-zero.
-  do
-    if (smu_read_address(dev, rsp_addr, &tmp) != SMU_Return_OK) {
-      mutex_unlock(&amd_smu_mutex);
-      pr_warn("Failed to perform probe on SMU RSP!\n");
+  ret = smu_wait_response(smu, regs->rsp, stats->ewma_ns, deadline, &tmp,
+                          &polls, &sleeps);
+  responded = ktime_get_ns();
 
-      return SMU_Return_PCIFailed;
-    }
-  while (tmp == 0 && retries--);
+  if (ret == SMU_Return_PCIFailed) {
+    pr_warn("Failed to perform probe on SMU RSP!\n");
+    goto BREAK_OUT;
+  }
 
   // Step 6: If the Response register contains OK, then SMU has finished
   // processing
   //  the message.
-  if (tmp != SMU_Return_OK && !retries) {
-    mutex_unlock(&amd_smu_mutex);
-
-    // The RSP register is still 0, the SMU is still processing the request or
-    // has frozen. Either way the command has timed out so indicate as such.
-    if (!tmp) {
-      pr_debug("SMU Service Request Failed: Timeout on command (0x%x) after %d "
-               "attempts.",
-               op, smu_timeout_attempts);
-
-      return SMU_Return_CommandTimeout;
-    }
+  if (ret == SMU_Return_OK && tmp != SMU_Return_OK)
+    ret = tmp;
+
+  smu_stats_record(stats, responded - issued, polls, sleeps, ret);
+
+  // The RSP register is still 0, the SMU is still processing the request or
+  // has frozen. Either way the command has timed out so indicate as such.
+  if (ret == SMU_Return_CommandTimeout) {
+    pr_debug("SMU Service Request Failed: Timeout on command (0x%x) after %u "
+             "polls.",
+             op, polls);
+    goto BREAK_OUT;
+  }
 
+  if (ret != SMU_Return_OK) {
     pr_debug("SMU Service Request Failed: Response %Xh was unexpected.", tmp);
-    return tmp;
+    goto BREAK_OUT;
   }
 
   // Step 7: If a return argument is expected, the Argument register may be read
   //  at this time.
   for (i = 0; i < SMU_REQ_MAX_ARGS; i++)
-    if (smu_read_address(dev, args_addr + (i * 4), &args->args[i]) !=
+    if (smu_read_address(smu, regs->args + (i * 4), &args->args[i]) !=
         SMU_Return_OK)
       pr_warn("Failed to fetch SMU ARG [%d]!\n", i);
 
-  mutex_unlock(&amd_smu_mutex);
+BREAK_OUT:
+  // Commands never issued spent all of their time waiting on the mailbox.
+  if (!issued)
+    issued = responded = ktime_get_ns();
 
-  pr_debug(
-      "SMU Service Response: ID(0x%x) Args(0x%x, 0x%x, 0x%x, 0x%x, 0x%x, 0x%x)",
-      op, args->s.arg0, args->s.arg1, args->s.arg2, args->s.arg3, args->s.arg4,
-      args->s.arg5);
+  smu_stats_record_mailbox(mb_stats, locked - start, issued - locked,
+                           responded - issued, busy, ret);
 
-  return SMU_Return_OK;
+  if (ret == SMU_Return_CommandTimeout)
+    trace_smu_cmd_timeout(smu->pdev->bus->number, mailbox, op, busy, polls,
+                          busy ? issued - locked : responded - issued);
+
+  trace_smu_cmd_complete(smu->pdev->bus->number, mailbox, op, ret, args,
+                         polls, sleeps,
+                         locked - start, responded - issued);
+
+  return ret;
+}
+
+enum smu_return_val smu_send_command(struct smu_dev *smu, u32 op,
+                                     smu_req_args_t *args,
+                                     enum smu_mailbox mailbox) {
+  struct smu_mailbox_regs regs;
+  enum smu_return_val ret;
+  u64 start;
+
+  if (!smu_get_mailbox_regs(smu, mailbox, &regs))
+    return SMU_Return_Unsupported;
+
+  trace_smu_cmd_start(smu->pdev->bus->number, mailbox, op, args);
+
+  start = ktime_get_ns();
+  mutex_lock(&smu->smu_mutex[mailbox]);
+
+  ret = smu_exec_command(smu, op, args, mailbox, &regs, start, ktime_get_ns());
+
+  mutex_unlock(&smu->smu_mutex[mailbox]);
+
+  return ret;
+}
+
+// Sends [op] once for each of the [count] argument sets, back to back under a
+//  single acquisition of the mailbox lock, storing each result in [rets].
+//  Every command is attempted, whatever the outcome of the previous ones.
+//
+// Returns SMU_Return_OK if every command succeeded, otherwise the first error.
+static enum smu_return_val smu_send_commands(struct smu_dev *smu, u32 op,
+                                             smu_req_args_t *args, u32 count,
+                                             enum smu_mailbox mailbox,
+                                             u32 *rets) {
+  enum smu_return_val ret = SMU_Return_OK;
+  struct smu_mailbox_regs regs;
+  u64 start;
+  u32 i;
+
+  if (!smu_get_mailbox_regs(smu, mailbox, &regs)) {
+    for (i = 0; i < count; i++)
+      rets[i] = SMU_Return_Unsupported;
+    return SMU_Return_Unsupported;
+  }
+
+  start = ktime_get_ns();
+  mutex_lock(&smu->smu_mutex[mailbox]);
+
+  for (i = 0; i < count; i++) {
+    trace_smu_cmd_start(smu->pdev->bus->number, mailbox, op, &args[i]);
+
+    // Only the first command waited for the lock.
+    if (i)
+      start = ktime_get_ns();
+
+    rets[i] = smu_exec_command(smu, op, &args[i], mailbox, &regs, start,
+                               ktime_get_ns());
+    if (rets[i] != SMU_Return_OK && ret == SMU_Return_OK)
+      ret = rets[i];
+  }
+
+  mutex_unlock(&smu->smu_mutex[mailbox]);
+
+  return ret;
 }
 
-int smu_resolve_cpu_class(struct pci_dev *dev) {
+int smu_resolve_cpu_class(struct smu_dev *smu) {
   u32 cpuid, cpu_family, cpu_model, stepping, pkg_type;
 
   // https://en.wikichip.org/wiki/amd/cpuid
@@ -256,44 +723,44 @@ int smu_resolve_cpu_class(struct pci_dev *dev) {
     switch (cpu_model) {
     case 0x01:
       if (pkg_type == 7)
-        g_smu.codename = CODENAME_THREADRIPPER;
+        smu->codename = CODENAME_THREADRIPPER;
       else if (pkg_type == 4)
-        g_smu.codename = CODENAME_NAPLES;
+        smu->codename = CODENAME_NAPLES;
       else
-        g_smu.codename = CODENAME_SUMMITRIDGE;
+        smu->codename = CODENAME_SUMMITRIDGE;
       break;
     case 0x08:
       if (pkg_type == 7 || pkg_type == 4)
-        g_smu.codename = CODENAME_COLFAX;
+        smu->codename = CODENAME_COLFAX;
       else
-        g_smu.codename = CODENAME_PINNACLERIDGE;
+        smu->codename = CODENAME_PINNACLERIDGE;
       break;
     case 0x11:
-      g_smu.codename = CODENAME_RAVENRIDGE;
+      smu->codename = CODENAME_RAVENRIDGE;
       break;
     case 0x18:
       if (pkg_type == 2)
-        g_smu.codename = CODENAME_RAVENRIDGE2;
+        smu->codename = CODENAME_RAVENRIDGE2;
       else
-        g_smu.codename = CODENAME_PICASSO;
+        smu->codename = CODENAME_PICASSO;
       break;
     case 0x20:
-      g_smu.codename = CODENAME_DALI;
+      smu->codename = CODENAME_DALI;
       break;
     case 0x31:
-      g_smu.codename = CODENAME_CASTLEPEAK;
+      smu->codename = CODENAME_CASTLEPEAK;
       break;
     case 0x60:
-      g_smu.codename = CODENAME_RENOIR;
+      smu->codename = CODENAME_RENOIR;
       break;
     case 0x68:
-      g_smu.codename = CODENAME_LUCIENNE;
+      smu->codename = CODENAME_LUCIENNE;
       break;
     case 0x71:
-      g_smu.codename = CODENAME_MATISSE;
+      smu->codename = CODENAME_MATISSE;
       break;
     case 0x90:
-      g_smu.codename = CODENAME_VANGOGH;
+      smu->codename = CODENAME_VANGOGH;
       break;
     default:
       pr_err(
@@ -308,29 +775,29 @@ int smu_resolve_cpu_class(struct pci_dev *dev) {
   else if (cpu_family == 0x19) {
     switch (cpu_model) {
     case 0x01:
-      g_smu.codename = CODENAME_MILAN;
+      smu->codename = CODENAME_MILAN;
       break;
     case 0x08:
-      g_smu.codename = CODENAME_CHAGALL;
+      smu->codename = CODENAME_CHAGALL;
       break;
     case 0x20:
     case 0x21:
-      g_smu.codename = CODENAME_VERMEER;
+      smu->codename = CODENAME_VERMEER;
       break;
     case 0x40:
     case 0x44:
-      g_smu.codename = CODENAME_REMBRANDT;
+      smu->codename = CODENAME_REMBRANDT;
       break;
     case 0x50:
-      g_smu.codename = CODENAME_CEZANNE;
+      smu->codename = CODENAME_CEZANNE;
       break;
     case 0x61:
-      g_smu.codename = CODENAME_RAPHAEL;
+      smu->codename = CODENAME_RAPHAEL;
       break;
     case 0x74:
-      g_smu.codename = CODENAME_PHOENIX;
+      smu->codename = CODENAME_PHOENIX;
     case 0x75:
-      g_smu.codename = CODENAME_HAWKPOINT;
+      smu->codename = CODENAME_HAWKPOINT;
       break;
     default:
       pr_err("CPUID: Unknown Zen3/4 processor model: 0x%X (CPUID: 0x%08X)",
@@ -341,10 +808,10 @@ int smu_resolve_cpu_class(struct pci_dev *dev) {
   } else if (cpu_family == 0x1a) {
     switch (cpu_model) {
     case 0x24:
-      g_smu.codename = CODENAME_STRIX;
+      smu->codename = CODENAME_STRIX;
       break;
     case 0x44:
-      g_smu.codename = CODENAME_GRANITERIDGE;
+      smu->codename = CODENAME_GRANITERIDGE;
       break;
     default:
       pr_err("CPUID: Unknown Zen5/6 processor model: 0x%X (CPUID: 0x%08X)",
@@ -362,17 +829,12 @@ int smu_resolve_cpu_class(struct pci_dev *dev) {
   }
 }
 
-int smu_init(struct pci_dev *dev) {
-  // This really should never be called twice however in case it is, consider it
-  // initialized.
-  if (g_smu.codename != CODENAME_UNDEFINED)
-    return 0;
-
-  if (smu_resolve_cpu_class(dev))
+static int smu_detect_mailboxes(struct smu_dev *smu) {
+  if (smu_resolve_cpu_class(smu))
     return -ENODEV;
 
   // Detect RSMU mailbox address.
-  switch (g_smu.codename) {
+  switch (smu->codename) {
   case CODENAME_CASTLEPEAK:
   case CODENAME_MATISSE:
   case CODENAME_VERMEER:
@@ -380,18 +842,18 @@ int smu_init(struct pci_dev *dev) {
   case CODENAME_CHAGALL:
   case CODENAME_RAPHAEL:
   case CODENAME_GRANITERIDGE:
-    g_smu.addr_rsmu_mb_cmd = 0x3B10524;
-    g_smu.addr_rsmu_mb_rsp = 0x3B10570;
-    g_smu.addr_rsmu_mb_args = 0x3B10A40;
+    smu->addr_rsmu_mb_cmd = 0x3B10524;
+    smu->addr_rsmu_mb_rsp = 0x3B10570;
+    smu->addr_rsmu_mb_args = 0x3B10A40;
     goto LOG_RSMU;
   case CODENAME_COLFAX:
   case CODENAME_NAPLES:
   case CODENAME_SUMMITRIDGE:
   case CODENAME_THREADRIPPER:
   case CODENAME_PINNACLERIDGE:
-    g_smu.addr_rsmu_mb_cmd = 0x3B1051C;
-    g_smu.addr_rsmu_mb_rsp = 0x3B10568;
-    g_smu.addr_rsmu_mb_args = 0x3B10590;
+    smu->addr_rsmu_mb_cmd = 0x3B1051C;
+    smu->addr_rsmu_mb_rsp = 0x3B10568;
+    smu->addr_rsmu_mb_args = 0x3B10590;
     goto LOG_RSMU;
   case CODENAME_RENOIR:
   case CODENAME_LUCIENNE:
@@ -404,25 +866,25 @@ int smu_init(struct pci_dev *dev) {
   case CODENAME_PHOENIX:
   case CODENAME_STRIX:
   case CODENAME_HAWKPOINT:
-    g_smu.addr_rsmu_mb_cmd = 0x3B10A20;
-    g_smu.addr_rsmu_mb_rsp = 0x3B10A80;
-    g_smu.addr_rsmu_mb_args = 0x3B10A88;
+    smu->addr_rsmu_mb_cmd = 0x3B10A20;
+    smu->addr_rsmu_mb_rsp = 0x3B10A80;
+    smu->addr_rsmu_mb_args = 0x3B10A88;
     goto LOG_RSMU;
   case CODENAME_VANGOGH:
     pr_debug("RSMU Mailbox: Not supported or unknown, disabling use.");
     goto MP1_DETECT;
   default:
-    pr_err("Unknown processor codename: %d", g_smu.codename);
+    pr_err("Unknown processor codename: %d", smu->codename);
     return -ENODEV;
   }
 
 LOG_RSMU:
   pr_debug("RSMU Mailbox: (cmd: 0x%X, rsp: 0x%X, args: 0x%X)",
-           g_smu.addr_rsmu_mb_cmd, g_smu.addr_rsmu_mb_rsp,
-           g_smu.addr_rsmu_mb_args);
+           smu->addr_rsmu_mb_cmd, smu->addr_rsmu_mb_rsp,
+           smu->addr_rsmu_mb_args);
 
   // Detect HSMP mailbox address.
-  switch (g_smu.codename) {
+  switch (smu->codename) {
   case CODENAME_CASTLEPEAK:
   case CODENAME_MATISSE:
   case CODENAME_VERMEER:
@@ -430,9 +892,9 @@ LOG_RSMU:
   case CODENAME_CHAGALL:
   case CODENAME_RAPHAEL:
   case CODENAME_GRANITERIDGE:
-    g_smu.addr_hsmp_mb_cmd = 0x3B10534;
-    g_smu.addr_hsmp_mb_rsp = 0x3B10980;
-    g_smu.addr_hsmp_mb_args = 0x3B109E0;
+    smu->addr_hsmp_mb_cmd = 0x3B10534;
+    smu->addr_hsmp_mb_rsp = 0x3B10980;
+    smu->addr_hsmp_mb_args = 0x3B109E0;
     goto LOG_HSMP;
   case CODENAME_CEZANNE:
   case CODENAME_COLFAX:
@@ -453,36 +915,36 @@ LOG_RSMU:
   case CODENAME_HAWKPOINT:
     goto MP1_DETECT;
   default:
-    pr_err("Unknown processor codename: %d", g_smu.codename);
+    pr_err("Unknown processor codename: %d", smu->codename);
     return -ENODEV;
   }
 
 LOG_HSMP:
   pr_debug("HSMP Mailbox: (cmd: 0x%X, rsp: 0x%X, args: 0x%X)",
-           g_smu.addr_hsmp_mb_cmd, g_smu.addr_hsmp_mb_rsp,
-           g_smu.addr_hsmp_mb_args);
+           smu->addr_hsmp_mb_cmd, smu->addr_hsmp_mb_rsp,
+           smu->addr_hsmp_mb_args);
 
 MP1_DETECT:
   // Detect MP1 SMU mailbox address.
-  switch (g_smu.codename) {
+  switch (smu->codename) {
   case CODENAME_COLFAX:
   case CODENAME_NAPLES:
   case CODENAME_SUMMITRIDGE:
   case CODENAME_THREADRIPPER:
   case CODENAME_PINNACLERIDGE:
-    g_smu.mp1_if_ver = IF_VERSION_9;
-    g_smu.addr_mp1_mb_cmd = 0x3B10528;
-    g_smu.addr_mp1_mb_rsp = 0x3B10564;
-    g_smu.addr_mp1_mb_args = 0x3B10598;
+    smu->mp1_if_ver = IF_VERSION_9;
+    smu->addr_mp1_mb_cmd = 0x3B10528;
+    smu->addr_mp1_mb_rsp = 0x3B10564;
+    smu->addr_mp1_mb_args = 0x3B10598;
     break;
   case CODENAME_PICASSO:
   case CODENAME_RAVENRIDGE:
   case CODENAME_RAVENRIDGE2:
   case CODENAME_DALI:
-    g_smu.mp1_if_ver = IF_VERSION_10;
-    g_smu.addr_mp1_mb_cmd = 0x3B10528;
-    g_smu.addr_mp1_mb_rsp = 0x3B10564;
-    g_smu.addr_mp1_mb_args = 0x3B10998;
+    smu->mp1_if_ver = IF_VERSION_10;
+    smu->addr_mp1_mb_cmd = 0x3B10528;
+    smu->addr_mp1_mb_rsp = 0x3B10564;
+    smu->addr_mp1_mb_args = 0x3B10998;
     break;
   case CODENAME_MATISSE:
   case CODENAME_VERMEER:
@@ -491,48 +953,101 @@ MP1_DETECT:
   case CODENAME_CHAGALL:
   case CODENAME_RAPHAEL:
   case CODENAME_GRANITERIDGE:
-    g_smu.mp1_if_ver = IF_VERSION_11;
-    g_smu.addr_mp1_mb_cmd = 0x3B10530;
-    g_smu.addr_mp1_mb_rsp = 0x3B1057C;
-    g_smu.addr_mp1_mb_args = 0x3B109C4;
+    smu->mp1_if_ver = IF_VERSION_11;
+    smu->addr_mp1_mb_cmd = 0x3B10530;
+    smu->addr_mp1_mb_rsp = 0x3B1057C;
+    smu->addr_mp1_mb_args = 0x3B109C4;
     break;
   case CODENAME_RENOIR:
   case CODENAME_LUCIENNE:
   case CODENAME_CEZANNE:
-    g_smu.mp1_if_ver = IF_VERSION_12;
-    g_smu.addr_mp1_mb_cmd = 0x3B10528;
-    g_smu.addr_mp1_mb_rsp = 0x3B10564;
-    g_smu.addr_mp1_mb_args = 0x3B10998;
+    smu->mp1_if_ver = IF_VERSION_12;
+    smu->addr_mp1_mb_cmd = 0x3B10528;
+    smu->addr_mp1_mb_rsp = 0x3B10564;
+    smu->addr_mp1_mb_args = 0x3B10998;
     break;
   case CODENAME_VANGOGH:
   case CODENAME_REMBRANDT:
   case CODENAME_PHOENIX:
   case CODENAME_HAWKPOINT:
-    g_smu.mp1_if_ver = IF_VERSION_13;
-    g_smu.addr_mp1_mb_cmd = 0x3B10528;
-    g_smu.addr_mp1_mb_rsp = 0x3B10578;
-    g_smu.addr_mp1_mb_args = 0x3B10998;
+    smu->mp1_if_ver = IF_VERSION_13;
+    smu->addr_mp1_mb_cmd = 0x3B10528;
+    smu->addr_mp1_mb_rsp = 0x3B10578;
+    smu->addr_mp1_mb_args = 0x3B10998;
     break;
   case CODENAME_STRIX:
-    g_smu.mp1_if_ver = IF_VERSION_13;
-    g_smu.addr_mp1_mb_cmd = 0x3b10928;
-    g_smu.addr_mp1_mb_rsp = 0x3b10978;
-    g_smu.addr_mp1_mb_args = 0x3b10998;
+    smu->mp1_if_ver = IF_VERSION_13;
+    smu->addr_mp1_mb_cmd = 0x3b10928;
+    smu->addr_mp1_mb_rsp = 0x3b10978;
+    smu->addr_mp1_mb_args = 0x3b10998;
     break;
   default:
-    pr_err("Unknown processor codename: %d", g_smu.codename);
+    pr_err("Unknown processor codename: %d", smu->codename);
     return -ENODEV;
   }
 
   pr_debug("MP1 Mailbox: (cmd: 0x%X, rsp: 0x%X, args: 0x%X)",
-           g_smu.addr_mp1_mb_cmd, g_smu.addr_mp1_mb_rsp,
-           g_smu.addr_mp1_mb_args);
+           smu->addr_mp1_mb_cmd, smu->addr_mp1_mb_rsp,
+           smu->addr_mp1_mb_args);
 
-  pr_info("Family Codename: %s", getCodeName(g_smu.codename));
+  pr_info("Family Codename: %s", getCodeName(smu->codename));
 
   return 0;
 }
 
+struct smu_dev *smu_init(struct pci_dev *dev) {
+  struct smu_dev *smu;
+  int i, err;
+
+  smu = kzalloc_node(sizeof(*smu), GFP_KERNEL, dev_to_node(&dev->dev));
+  if (!smu)
+    return ERR_PTR(-ENOMEM);
+
+  smu->pdev = dev;
+  smu->codename = CODENAME_UNDEFINED;
+  smu->mp1_if_ver = IF_VERSION_COUNT;
+  smu->pm_refresh_policy = pm_refresh_policy;
+  smu->pm_refresh_interval_us = pm_refresh_interval_us;
+  smu->pm_idle_timeout_ms = pm_idle_timeout_ms;
+  INIT_DELAYED_WORK(&smu->pm_idle_work, smu_pm_table_idle);
+
+  mutex_init(&smu->pci_mutex);
+  mutex_init(&smu->pm_mutex);
+  mutex_init(&smu->table_mutex);
+  for (i = 0; i < MAILBOX_TYPE_COUNT; i++)
+    mutex_init(&smu->smu_mutex[i]);
+
+  err = smu_detect_mailboxes(smu);
+  if (err)
+    goto ERR_FREE;
+
+  smu->pm_ops = smu_pm_ops_table[smu->codename];
+
+  for (i = 0; smu->pm_ops && i < smu->pm_ops->table_count &&
+              i < RYZEN_SMU_TABLE_MAX;
+       i++) {
+    smu->tables[i].desc = &smu->pm_ops->tables[i];
+    smu->tables[i].refresh_policy = pm_refresh_policy;
+    smu->tables[i].refresh_interval_us = pm_refresh_interval_us;
+
+    if (smu->tables[i].desc->pm_append)
+      smu->pm_alt = &smu->tables[i];
+  }
+  smu->table_count = i;
+
+  smu->stats = smu_stats_alloc();
+  if (!smu->stats) {
+    err = -ENOMEM;
+    goto ERR_FREE;
+  }
+
+  return smu;
+
+ERR_FREE:
+  kfree(smu);
+  return ERR_PTR(err);
+}
+
 const char *getCodeName(enum smu_processor_codename codename) {
   switch (codename) {
   case CODENAME_COLFAX:
@@ -587,25 +1102,31 @@ const char *getCodeName(enum smu_processor_codename codename) {
     return "Undefined";
   }
 }
-void smu_cleanup(void) {
+void smu_cleanup(struct smu_dev *smu) {
+  int i;
+
   // Unmap DRAM Base if required after SMU use.
-  if (g_smu.pm_table_virt_addr) {
-    iounmap(g_smu.pm_table_virt_addr);
-    g_smu.pm_table_virt_addr = NULL;
-  }
+  cancel_delayed_work_sync(&smu->pm_idle_work);
+  smu_pm_table_release(smu);
+  for (i = 0; i < smu->table_count; i++)
+    smu_table_release(&smu->tables[i]);
 
-  if (g_smu.pm_table_virt_addr_alt) {
-    iounmap(g_smu.pm_table_virt_addr_alt);
-    g_smu.pm_table_virt_addr_alt = NULL;
-  }
+  smu_stats_free(smu->stats);
+
+  mutex_destroy(&smu->table_mutex);
+  mutex_destroy(&smu->pm_mutex);
+  mutex_destroy(&smu->pci_mutex);
+  for (i = 0; i < MAILBOX_TYPE_COUNT; i++)
+    mutex_destroy(&smu->smu_mutex[i]);
 
-  // Set SMU state to uninitialized, requiring a call to smu_init() again.
-  g_smu.codename = CODENAME_UNDEFINED;
+  kfree(smu);
 }
 
-enum smu_processor_codename smu_get_codename(void) { return g_smu.codename; }
+enum smu_processor_codename smu_get_codename(struct smu_dev *smu) {
+  return smu->codename;
+}
 
-u32 smu_get_version(struct pci_dev *dev, enum smu_mailbox mb) {
+u32 smu_get_version(struct smu_dev *smu, enum smu_mailbox mb) {
   smu_req_args_t args;
   u32 ret;
 
@@ -614,91 +1135,58 @@ u32 smu_get_version(struct pci_dev *dev, enum smu_mailbox mb) {
 
   // OP 0x02 is consistent with all platforms meaning
   //  it can be used directly.
-  ret = smu_send_command(dev, 0x02, &args, mb);
+  ret = smu_send_command(smu, 0x02, &args, mb);
   if (ret != SMU_Return_OK)
     return ret;
 
   return args.s.arg0;
 }
 
-enum smu_if_version smu_get_mp1_if_version(void) { return g_smu.mp1_if_ver; }
-
-u64 smu_get_dram_base_address(struct pci_dev *dev) {
-  u32 fn[3], ret, parts[2];
-  smu_req_args_t args;
+struct smu_stats *smu_get_stats(struct smu_dev *smu) { return smu->stats; }
 
-  const enum smu_mailbox type = MAILBOX_TYPE_RSMU;
+enum smu_if_version smu_get_mp1_if_version(struct smu_dev *smu) {
+  return smu->mp1_if_ver;
+}
 
-  smu_args_init(&args, 0);
+u64 smu_get_dram_base_address(struct smu_dev *smu) {
+  const struct smu_pm_ops *ops = smu->pm_ops;
+  u32 ret, parts[2];
+  smu_req_args_t args;
 
-  switch (g_smu.codename) {
-  case CODENAME_NAPLES:
-  case CODENAME_SUMMITRIDGE:
-  case CODENAME_THREADRIPPER:
-    fn[0] = 0xa;
-    goto BASE_ADDR_CLASS_1;
-  case CODENAME_VERMEER:
-  case CODENAME_MATISSE:
-  case CODENAME_CASTLEPEAK:
-  case CODENAME_MILAN:
-  case CODENAME_CHAGALL:
-    fn[0] = 0x06;
-    goto BASE_ADDR_CLASS_1;
-  case CODENAME_RAPHAEL:
-  case CODENAME_GRANITERIDGE:
-    fn[0] = 0x04;
-    goto BASE_ADDR_CLASS_1;
-  case CODENAME_RENOIR:
-  case CODENAME_LUCIENNE:
-  case CODENAME_CEZANNE:
-  case CODENAME_REMBRANDT:
-  case CODENAME_PHOENIX:
-  case CODENAME_STRIX:
-  case CODENAME_HAWKPOINT:
-    fn[0] = 0x66;
-    goto BASE_ADDR_CLASS_1;
-  case CODENAME_COLFAX:
-  case CODENAME_PINNACLERIDGE:
-    fn[0] = 0x0b;
-    fn[1] = 0x0c;
-    goto BASE_ADDR_CLASS_2;
-  case CODENAME_DALI:
-  case CODENAME_PICASSO:
-  case CODENAME_RAVENRIDGE:
-  case CODENAME_RAVENRIDGE2:
-    fn[0] = 0x0a;
-    fn[1] = 0x3d;
-    fn[2] = 0x0b;
-    goto BASE_ADDR_CLASS_3;
-  default:
+  if (!ops)
     return SMU_Return_Unsupported;
-  }
 
-BASE_ADDR_CLASS_1:
-  args.s.arg0 = args.s.arg1 = 1;
-  ret = smu_send_command(dev, fn[0], &args, type);
+  smu_args_init(&args, 0);
 
-  return ret != SMU_Return_OK ? ret : args.s.arg0 | ((u64)args.s.arg1 << 32);
+  switch (ops->base_method) {
+  case SMU_PM_BASE_SINGLE:
+    args.s.arg0 = args.s.arg1 = 1;
+    ret = smu_send_command(smu, ops->base_fn[0], &args, ops->mailbox);
 
-BASE_ADDR_CLASS_2:
-  ret = smu_send_command(dev, fn[0], &args, type);
-  if (ret != SMU_Return_OK)
-    return ret;
+    return ret != SMU_Return_OK ? ret : args.s.arg0 | ((u64)args.s.arg1 << 32);
+  case SMU_PM_BASE_TWO_STEP:
+    ret = smu_send_command(smu, ops->base_fn[0], &args, ops->mailbox);
+    if (ret != SMU_Return_OK)
+      return ret;
 
-  smu_args_init(&args, 0);
-  ret = smu_send_command(dev, fn[1], &args, type);
+    smu_args_init(&args, 0);
+    ret = smu_send_command(smu, ops->base_fn[1], &args, ops->mailbox);
 
-  return ret != SMU_Return_OK ? ret : args.s.arg0;
+    return ret != SMU_Return_OK ? ret : args.s.arg0;
+  case SMU_PM_BASE_DUAL:
+    break;
+  default:
+    return SMU_Return_Unsupported;
+  }
 
-BASE_ADDR_CLASS_3:
   // == Part 1 ==
   args.s.arg0 = 3;
-  ret = smu_send_command(dev, fn[0], &args, type);
+  ret = smu_send_command(smu, ops->base_fn[0], &args, ops->mailbox);
   if (ret != SMU_Return_OK)
     return ret;
 
   smu_args_init(&args, 3);
-  ret = smu_send_command(dev, fn[2], &args, type);
+  ret = smu_send_command(smu, ops->base_fn[2], &args, ops->mailbox);
   if (ret != SMU_Return_OK)
     return ret;
 
@@ -708,17 +1196,17 @@ BASE_ADDR_CLASS_3:
 
   // == Part 2 ==
   smu_args_init(&args, 3);
-  ret = smu_send_command(dev, fn[1], &args, type);
+  ret = smu_send_command(smu, ops->base_fn[1], &args, ops->mailbox);
   if (ret != SMU_Return_OK)
     return ret;
 
   smu_args_init(&args, 5);
-  ret = smu_send_command(dev, fn[0], &args, type);
+  ret = smu_send_command(smu, ops->base_fn[0], &args, ops->mailbox);
   if (ret != SMU_Return_OK)
     return ret;
 
   smu_args_init(&args, 5);
-  ret = smu_send_command(dev, fn[2], &args, type);
+  ret = smu_send_command(smu, ops->base_fn[2], &args, ops->mailbox);
   if (ret != SMU_Return_OK)
     return ret;
 
@@ -729,341 +1217,116 @@ BASE_ADDR_CLASS_3:
   return (u64)parts[1] << 32 | parts[0];
 }
 
-enum smu_return_val smu_transfer_table_to_dram(struct pci_dev *dev) {
+enum smu_return_val smu_transfer_table_to_dram(struct smu_dev *smu) {
+  const struct smu_pm_ops *ops = smu->pm_ops;
   smu_req_args_t args;
-  u32 fn;
 
   /**
    * Probes (updates) the PM Table.
    * SMC Message corresponds to TransferTableSmu2Dram.
    * Physically mapped at the DRAM Base address(es).
    */
+  if (!ops || !ops->transfer_fn)
+    return SMU_Return_Unsupported;
 
   // Arg[0] here specifies the PM table when set to 0.
   // For GPU ASICs, it seems there's more tables that can be found but for CPUs,
   //  it seems this value is ignored.
-  smu_args_init(&args, 0);
-
-  switch (g_smu.codename) {
-  case CODENAME_SUMMITRIDGE:
-  case CODENAME_THREADRIPPER:
-  case CODENAME_NAPLES:
-    fn = 0x0a;
-    break;
-  case CODENAME_CASTLEPEAK:
-  case CODENAME_MATISSE:
-  case CODENAME_VERMEER:
-  case CODENAME_MILAN:
-  case CODENAME_CHAGALL:
-    fn = 0x05;
-    break;
-  case CODENAME_RAPHAEL:
-  case CODENAME_GRANITERIDGE:
-    fn = 0x03;
-    break;
-  case CODENAME_CEZANNE:
-    fn = 0x65;
-    break;
-  case CODENAME_RENOIR:
-  case CODENAME_LUCIENNE:
-  case CODENAME_REMBRANDT:
-  case CODENAME_PHOENIX:
-  case CODENAME_STRIX:
-  case CODENAME_HAWKPOINT:
-    args.s.arg0 = 3;
-    fn = 0x65;
-    break;
-  case CODENAME_COLFAX:
-  case CODENAME_PINNACLERIDGE:
-  case CODENAME_PICASSO:
-  case CODENAME_RAVENRIDGE:
-  case CODENAME_RAVENRIDGE2:
-    args.s.arg0 = 3;
-    fn = 0x3d;
-    break;
-  default:
-    return SMU_Return_Unsupported;
-  }
+  smu_args_init(&args, ops->transfer_arg);
 
-  return smu_send_command(dev, fn, &args, MAILBOX_TYPE_RSMU);
+  return smu_send_command(smu, ops->transfer_fn, &args, ops->mailbox);
 }
 
-enum smu_return_val smu_transfer_2nd_table_to_dram(struct pci_dev *dev) {
+enum smu_return_val smu_get_pm_table_version(struct smu_dev *smu,
+                                             u32 *version) {
+  const struct smu_pm_ops *ops = smu->pm_ops;
+  enum smu_return_val ret;
   smu_req_args_t args;
-  u32 fn;
 
   /**
-   * Probes (updates) the secondary PM Table.
-   * SMC Message corresponds to TransferTableSmu2Dram.
-   * Physically mapped at the DRAM Base address(es).
+   * For some codenames, there are different PM tables for each chip.
+   * SMC Message corresponds to TableVersionId.
+   * Based on AGESA FW revision.
    */
+  if (!ops || !ops->version_fn)
+    return SMU_Return_Unsupported;
 
-  // Arg[0] here specifies the PM table when set to 0.
-  // For GPU ASICs, it seems there's more tables that can be found but for CPUs,
-  //  it seems this value is ignored.
   smu_args_init(&args, 0);
 
-  switch (g_smu.codename) {
-  case CODENAME_COLFAX:
-  case CODENAME_PINNACLERIDGE:
-  case CODENAME_PICASSO:
-  case CODENAME_RAVENRIDGE:
-  case CODENAME_RAVENRIDGE2:
-    args.s.arg0 = 5;
-    fn = 0x3d;
-    break;
-  case CODENAME_SUMMITRIDGE:
-  case CODENAME_THREADRIPPER:
-  case CODENAME_NAPLES:
-  case CODENAME_CASTLEPEAK:
-  case CODENAME_MATISSE:
-  case CODENAME_VERMEER:
-  case CODENAME_MILAN:
-  case CODENAME_CEZANNE:
-  case CODENAME_RENOIR:
-  case CODENAME_LUCIENNE:
-  default:
-    return SMU_Return_Unsupported;
-  }
+  ret = smu_send_command(smu, ops->version_fn, &args, ops->mailbox);
+  *version = args.s.arg0;
 
-  return smu_send_command(dev, fn, &args, MAILBOX_TYPE_RSMU);
+  return ret;
 }
 
-enum smu_return_val smu_get_pm_table_version(struct pci_dev *dev,
-                                             u32 *version) {
-  enum smu_return_val ret;
-  smu_req_args_t args;
-  u32 fn;
+// Looks up the size of the table(s) reported under [version], including any
+//  table appended to it, zero if unknown.
+static u32 smu_pm_ops_size(const struct smu_pm_ops *ops, u32 version) {
+  u32 i, size = 0;
 
-  /**
-   * For some codenames, there are different PM tables for each chip.
-   * SMC Message corresponds to TableVersionId.
-   * Based on AGESA FW revision.
-   */
-  switch (g_smu.codename) {
-  case CODENAME_RAVENRIDGE:
-  case CODENAME_PICASSO:
-    fn = 0x0c;
-    break;
-  case CODENAME_CASTLEPEAK:
-  case CODENAME_MATISSE:
-  case CODENAME_VERMEER:
-  case CODENAME_MILAN:
-  case CODENAME_CHAGALL:
-    fn = 0x08;
-    break;
-  case CODENAME_RAPHAEL:
-  case CODENAME_GRANITERIDGE:
-    fn = 0x05;
-    break;
-  case CODENAME_RENOIR:
-  case CODENAME_LUCIENNE:
-  case CODENAME_CEZANNE:
-  case CODENAME_REMBRANDT:
-  case CODENAME_PHOENIX:
-  case CODENAME_STRIX:
-  case CODENAME_HAWKPOINT:
-    fn = 0x06;
-    break;
-  default:
-    return SMU_Return_Unsupported;
-  }
+  if (!ops->sizes)
+    size = ops->size;
 
-  smu_args_init(&args, 0);
+  for (i = 0; i < ops->size_count; i++)
+    if (ops->sizes[i].version == version)
+      size = ops->sizes[i].size;
 
-  ret = smu_send_command(dev, fn, &args, MAILBOX_TYPE_RSMU);
-  *version = args.s.arg0;
+  for (i = 0; size && i < ops->table_count; i++)
+    if (ops->tables[i].pm_append)
+      size += ops->tables[i].size;
 
-  return ret;
+  return size;
 }
 
-u32 smu_update_pmtable_size(u32 version) {
-  // These sizes are actually accurate and not just "guessed".
-  // Source: Ryzen Master.
-  switch (g_smu.codename) {
-  case CODENAME_CASTLEPEAK:
-  case CODENAME_MATISSE:
-    switch (version) {
-    case 0x240902:
-      g_smu.pm_dram_map_size = 0x514;
-      break;
-    case 0x240903:
-      g_smu.pm_dram_map_size = 0x518;
-      break;
-    case 0x240802:
-      g_smu.pm_dram_map_size = 0x7E0;
-      break;
-    case 0x240803:
-      g_smu.pm_dram_map_size = 0x7E4;
-      break;
-    default:
-    UNKNOWN_PM_TABLE_VERSION:
-      return SMU_Return_Unsupported;
-    }
-    break;
-  case CODENAME_VERMEER:
-  case CODENAME_CHAGALL:
-    switch (version) {
-    case 0x2D0903:
-      g_smu.pm_dram_map_size = 0x594;
-      break;
-    case 0x380904:
-      g_smu.pm_dram_map_size = 0x5A4;
-      break;
-    case 0x380005: // 64
-      g_smu.pm_dram_map_size = 0x1BB0;
-      break;
-    case 0x380505: // 32
-      g_smu.pm_dram_map_size = 0xF30;
-      break;
-    case 0x380605: // 24
-      g_smu.pm_dram_map_size = 0xC10;
-      break;
-    case 0x380705: // 16
-      g_smu.pm_dram_map_size = 0x8F0;
-      break;
-    case 0x380905: // 8
-      g_smu.pm_dram_map_size = 0x5D0;
-      break;
-    case 0x2D0803:
-      g_smu.pm_dram_map_size = 0x894;
-      break;
-    case 0x380804:
-      g_smu.pm_dram_map_size = 0x8A4;
-      break;
-    case 0x380805:
-      g_smu.pm_dram_map_size = 0x8F0;
-      break;
-    default:
-      goto UNKNOWN_PM_TABLE_VERSION;
-    }
-    break;
-  case CODENAME_MILAN:
-    switch (version) {
-    case 0x2D0008:
-      g_smu.pm_dram_map_size = 0x1AB0;
-      break;
-    default:
-      goto UNKNOWN_PM_TABLE_VERSION;
-    }
-    break;
-  case CODENAME_RENOIR:
-  case CODENAME_LUCIENNE:
-    switch (version) {
-    case 0x370000:
-      g_smu.pm_dram_map_size = 0x794;
-      break;
-    case 0x370001:
-      g_smu.pm_dram_map_size = 0x884;
-      break;
-    case 0x370002:
-    case 0x370003:
-      g_smu.pm_dram_map_size = 0x88C;
-      break;
-    case 0x370004:
-      g_smu.pm_dram_map_size = 0x8AC;
-      break;
-    case 0x370005:
-      g_smu.pm_dram_map_size = 0x8F0;
-      break;
-    default:
-      goto UNKNOWN_PM_TABLE_VERSION;
-    }
-    break;
-  case CODENAME_CEZANNE:
-    switch (version) {
-    case 0x400005:
-      g_smu.pm_dram_map_size = 0x944;
-      break;
-    default:
-      goto UNKNOWN_PM_TABLE_VERSION;
-    }
-    break;
-  case CODENAME_REMBRANDT:
-    switch (version) {
-    case 0x450004:
-    case 0x450005:
-      g_smu.pm_dram_map_size = 0xA44;
-      break;
-    default:
-      goto UNKNOWN_PM_TABLE_VERSION;
-    }
-    break;
-  case CODENAME_PICASSO:
-  case CODENAME_RAVENRIDGE:
-  case CODENAME_RAVENRIDGE2:
-    // These codenames have two PM tables, a larger (primary) one and a smaller
-    // one. The size is always fixed to 0x608 and 0xA4 bytes each. Source: Ryzen
-    // Master.
-    g_smu.pm_dram_map_size_alt = 0xA4;
-    g_smu.pm_dram_map_size = 0x608 + g_smu.pm_dram_map_size_alt;
-
-    // Split DRAM base into high/low values.
-    g_smu.pm_dram_base_alt = g_smu.pm_dram_base >> 32;
-    g_smu.pm_dram_base &= 0xFFFFFFFF;
-    break;
-  case CODENAME_RAPHAEL:
-    switch (version) {
-    case 0x540104:
-      g_smu.pm_dram_map_size = 0x6A8;
-      break;
-    case 0x000400:
-      g_smu.pm_dram_map_size = 0x948;
-      break;
-    default:
-      goto UNKNOWN_PM_TABLE_VERSION;
-    }
-    break;
-  case CODENAME_GRANITERIDGE:
-    g_smu.pm_dram_map_size = 0x948;
-    break;
-  case CODENAME_PHOENIX:
-    switch (version) {
-    case 0x4C0006:
-    case 0x4C0007:
-    case 0x4C0008:
-      g_smu.pm_dram_map_size = 0xAA0;
-      break;
-    default:
-      goto UNKNOWN_PM_TABLE_VERSION;
-    }
-    break;
-  case CODENAME_HAWKPOINT:
-    switch (version) {
-    case 0x4C0008:
-      g_smu.pm_dram_map_size = 0xA00;
-      break;
-    default:
-      goto UNKNOWN_PM_TABLE_VERSION;
-    }
-    break;
-  case CODENAME_STRIX:
-    g_smu.pm_dram_map_size = 0xAA0;
-    break;
-  default:
+u32 smu_get_pm_table_size(struct smu_dev *smu, u32 version) {
+  return smu->pm_ops ? smu_pm_ops_size(smu->pm_ops, version) : 0;
+}
+
+// Size of the PM table itself, without the table appended to it.
+static u32 smu_pm_table_primary_size(struct smu_dev *smu) {
+  return smu->pm_dram_map_size - (smu->pm_alt ? smu->pm_alt->desc->size : 0);
+}
+
+static u32 smu_update_pmtable_size(struct smu_dev *smu, u32 version) {
+  smu->pm_dram_map_size = smu_pm_ops_size(smu->pm_ops, version);
+
+  if (!smu->pm_dram_map_size)
     return SMU_Return_Unsupported;
+
+  // With an appended table, the DRAM base is split into high/low values, the
+  //  high one being the base of the appended table.
+  if (smu->pm_alt) {
+    mutex_lock(&smu->table_mutex);
+    if (!smu->pm_alt->dram_base)
+      smu->pm_alt->dram_base = smu->pm_dram_base >> 32;
+    mutex_unlock(&smu->table_mutex);
+
+    smu->pm_dram_base &= 0xFFFFFFFF;
   }
 
   return SMU_Return_OK;
 }
 
-enum smu_return_val smu_read_pm_table(struct pci_dev *dev, unsigned char *dst,
-                                      size_t *len) {
-  u32 ret, version, size;
+// Resolves the DRAM base(s) & size(s) of the table. Nothing is requested from
+//  the SMU until the table is first accessed.
+//
+// Callers must hold pm_mutex.
+static enum smu_return_val smu_pm_table_resolve(struct smu_dev *smu) {
+  u32 ret, version;
 
   // The DRAM base does not change after boot meaning it only needs to be
   //  fetched once.
   // From testing, it also seems they are always mapped to the same address as
   // well,
   //  at least when running the same AGESA version.
-  if (g_smu.pm_dram_base == 0 || g_smu.pm_dram_map_size == 0) {
-    g_smu.pm_dram_base = smu_get_dram_base_address(dev);
+  if (smu->pm_dram_base == 0 || smu->pm_dram_map_size == 0) {
+    smu->pm_dram_base = smu_get_dram_base_address(smu);
 
     // Verify returned value isn't an SMU return value.
-    if (g_smu.pm_dram_base < 0xFF && g_smu.pm_dram_base >= 0) {
+    if (smu->pm_dram_base < 0xFF && smu->pm_dram_base >= 0) {
       pr_err("Unable to receive the DRAM base address: %X",
-             (u8)g_smu.pm_dram_base);
-      return g_smu.pm_dram_base;
+             (u8)smu->pm_dram_base);
+      return smu->pm_dram_base;
     }
 
     // Should help us catch where we missed table version initialization in the
@@ -1071,20 +1334,8 @@ enum smu_return_val smu_read_pm_table(struct pci_dev *dev, unsigned char *dst,
     version = 0xDEADC0DE;
 
     // These models require finding the PM table version to determine its size.
-    if (g_smu.codename == CODENAME_VERMEER ||
-        g_smu.codename == CODENAME_MATISSE ||
-        g_smu.codename == CODENAME_RAPHAEL ||
-        g_smu.codename == CODENAME_GRANITERIDGE ||
-        g_smu.codename == CODENAME_RENOIR ||
-        g_smu.codename == CODENAME_LUCIENNE ||
-        g_smu.codename == CODENAME_REMBRANDT ||
-        g_smu.codename == CODENAME_PHOENIX ||
-        g_smu.codename == CODENAME_STRIX ||
-        g_smu.codename == CODENAME_CEZANNE ||
-        g_smu.codename == CODENAME_CHAGALL ||
-        g_smu.codename == CODENAME_MILAN ||
-        g_smu.codename == CODENAME_HAWKPOINT) {
-      ret = smu_get_pm_table_version(dev, &version);
+    if (smu->pm_ops->sizes) {
+      ret = smu_get_pm_table_version(smu, &version);
 
       if (ret != SMU_Return_OK) {
         pr_err("Failed to get PM Table version with error: %X\n", ret);
@@ -1092,84 +1343,692 @@ enum smu_return_val smu_read_pm_table(struct pci_dev *dev, unsigned char *dst,
       }
     }
 
-    ret = smu_update_pmtable_size(version);
+    ret = smu_update_pmtable_size(smu, version);
     if (ret != SMU_Return_OK) {
       pr_err("Unknown PM table version: 0x%08X", version);
       return ret;
     }
 
-    pr_debug("Determined PM mapping size as (%xh,%xh) bytes.",
-             g_smu.pm_dram_map_size, g_smu.pm_dram_map_size_alt);
+    pr_debug("Determined PM mapping size as %xh bytes.",
+             smu->pm_dram_map_size);
   }
 
-  // Validate output buffer size.
-  // N.B. In the case of Picasso/RavenRidge 2, we include the secondary PM Table
-  // size as well
-  if (*len < g_smu.pm_dram_map_size) {
-    pr_warn(
-        "Insufficient buffer size for PM table read: %lu < %d version: 0x%X",
-        *len, g_smu.pm_dram_map_size, version);
+  return SMU_Return_OK;
+}
 
-    *len = g_smu.pm_dram_map_size;
-    return SMU_Return_InsufficientSize;
+// Releases the mappings & copies of the table, leaving the resolved DRAM
+//  base(s) in place for them to be set up again.
+//
+// Callers must hold pm_mutex, unless the SMU is being freed.
+static void smu_pm_table_release(struct smu_dev *smu) {
+  if (smu->pm_table_virt_addr) {
+    iounmap(smu->pm_table_virt_addr);
+    smu->pm_table_virt_addr = NULL;
   }
 
-  // Clamp output size
-  *len = g_smu.pm_dram_map_size;
+  kfree(smu->pm_table_cur);
+  kfree(smu->pm_table_prev);
+  smu->pm_table_cur = smu->pm_table_prev = NULL;
 
-  // Check if we should tell the SMU to refresh the table via jiffies.
-  // Use a minimum interval of 1 ms.
-  if (!g_smu.pm_jiffies ||
-      time_after(jiffies, g_smu.pm_jiffies + msecs_to_jiffies(1))) {
-    g_smu.pm_jiffies = jiffies;
+  // There is no copy left to serve, so the next read must transfer a table.
+  smu->pm_last_transfer = 0;
+}
 
-    ret = smu_transfer_table_to_dram(dev);
-    if (ret != SMU_Return_OK)
-      return ret;
+// Releases whichever of the PM table & the other tables went unused for the
+//  idle timeout, checking back for the remainder of it while any is in use.
+static void smu_pm_table_idle(struct work_struct *work) {
+  struct smu_dev *smu =
+      container_of(to_delayed_work(work), struct smu_dev, pm_idle_work);
+  u32 timeout = smu->pm_idle_timeout_ms, next = timeout, i;
+  ktime_t now = ktime_get();
+  struct smu_table *t;
+  int in_use = 0;
+  s64 idle_ms;
+
+  mutex_lock(&smu->pm_mutex);
+
+  // Accesses don't push the work back, so it checks again for the remainder.
+  if (smu->pm_table_virt_addr) {
+    idle_ms = ktime_ms_delta(now, smu->pm_last_access);
+    if (idle_ms < timeout) {
+      next = min_t(u32, next, timeout - (u32)idle_ms);
+      in_use = 1;
+    } else {
+      pr_debug("Releasing the PM table after %lld ms idle.", idle_ms);
+      smu_pm_table_release(smu);
+    }
+  }
 
-    if (g_smu.pm_dram_map_size_alt) {
-      ret = smu_transfer_2nd_table_to_dram(dev);
-      if (ret != SMU_Return_OK)
-        return ret;
+  mutex_lock(&smu->table_mutex);
+
+  for (i = 0; i < smu->table_count; i++) {
+    t = &smu->tables[i];
+    if (!t->virt_addr)
+      continue;
+
+    idle_ms = ktime_ms_delta(now, t->last_access);
+    if (idle_ms < timeout) {
+      next = min_t(u32, next, timeout - (u32)idle_ms);
+      in_use = 1;
+    } else {
+      pr_debug("Releasing table %u after %lld ms idle.", t->desc->id, idle_ms);
+      smu_table_release(t);
     }
   }
 
+  mutex_unlock(&smu->table_mutex);
+  mutex_unlock(&smu->pm_mutex);
+
+  if (in_use)
+    schedule_delayed_work(&smu->pm_idle_work, msecs_to_jiffies(next));
+}
+
+// Marks a table as accessed, making sure the idle work will get to it.
+static void smu_pm_touch(struct smu_dev *smu, ktime_t *last_access) {
+  *last_access = ktime_get();
+
+  if (smu->pm_idle_timeout_ms && !delayed_work_pending(&smu->pm_idle_work))
+    schedule_delayed_work(&smu->pm_idle_work,
+                          msecs_to_jiffies(smu->pm_idle_timeout_ms));
+}
+
+// Maps the table & allocates its copies if not already done, marking it as
+//  accessed.
+//
+// Callers must hold pm_mutex.
+static enum smu_return_val smu_pm_table_setup(struct smu_dev *smu) {
+  u32 ret, size;
+
+  ret = smu_pm_table_resolve(smu);
+  if (ret != SMU_Return_OK)
+    return ret;
+
+  smu_pm_touch(smu, &smu->pm_last_access);
+
   // Primary PM Table size
-  size = g_smu.pm_dram_map_size - g_smu.pm_dram_map_size_alt;
+  size = smu_pm_table_primary_size(smu);
 
   // We only map the DRAM base(s) once for use.
-  if (g_smu.pm_table_virt_addr == NULL) {
+  if (smu->pm_table_virt_addr == NULL) {
     // From Linux documentation, it seems we should use _cache() for ioremap().
-    g_smu.pm_table_virt_addr = ioremap_cache(g_smu.pm_dram_base, size);
+    smu->pm_table_virt_addr = ioremap_cache(smu->pm_dram_base, size);
 
-    if (g_smu.pm_table_virt_addr == NULL) {
-      pr_err("Failed to map DRAM base: %llX (0x%X B)", g_smu.pm_dram_base,
+    if (smu->pm_table_virt_addr == NULL) {
+      pr_err("Failed to map DRAM base: %llX (0x%X B)", smu->pm_dram_base,
              size);
       return SMU_Return_MappedError;
     }
+  }
 
-    // In Picasso/RavenRidge 2, we map the secondary (high) address as well.
-    if (g_smu.pm_dram_map_size_alt) {
-      g_smu.pm_table_virt_addr_alt =
-          ioremap_cache(g_smu.pm_dram_base_alt, g_smu.pm_dram_map_size_alt);
+  if (smu->pm_table_cur == NULL) {
+    smu->pm_table_cur = kzalloc(smu->pm_dram_map_size, GFP_KERNEL);
+    smu->pm_table_prev = kzalloc(smu->pm_dram_map_size, GFP_KERNEL);
 
-      if (g_smu.pm_table_virt_addr_alt == NULL) {
-        pr_err("Failed to map DRAM alt base: %X (0x%X B)",
-               g_smu.pm_dram_base_alt, g_smu.pm_dram_map_size_alt);
-        return SMU_Return_MappedError;
-      }
+    if (!smu->pm_table_cur || !smu->pm_table_prev) {
+      kfree(smu->pm_table_cur);
+      kfree(smu->pm_table_prev);
+      smu->pm_table_cur = smu->pm_table_prev = NULL;
+      return SMU_Return_MappedError;
+    }
+  }
+
+  // In Picasso/RavenRidge 2, we map the secondary (high) address as well.
+  if (smu->pm_alt) {
+    mutex_lock(&smu->table_mutex);
+    ret = smu_table_setup(smu, smu->pm_alt);
+    mutex_unlock(&smu->table_mutex);
+  }
+
+  return ret;
+}
+
+// Takes a copy of the table just transferred, bumping the generation if it
+//  differs from the previous one.
+static void smu_pm_table_track(struct smu_dev *smu) {
+  u32 size = smu_pm_table_primary_size(smu);
+  u64 dirty[RYZEN_SMU_PM_TABLE_DIRTY_WORDS] = {0};
+  u32 i, len, changed = 0;
+  u8 *tmp;
+
+  // The previous copy is overwritten, becoming the current one.
+  tmp = smu->pm_table_prev;
+  smu->pm_table_prev = smu->pm_table_cur;
+  smu->pm_table_cur = tmp;
+
+  memcpy_fromio(smu->pm_table_cur, smu->pm_table_virt_addr, size);
+
+  // The appended table was just copied out of DRAM by its own tracking.
+  if (smu->pm_alt) {
+    mutex_lock(&smu->table_mutex);
+    if (smu->pm_alt->buf)
+      memcpy(smu->pm_table_cur + size, smu->pm_alt->buf,
+             smu->pm_alt->desc->size);
+    mutex_unlock(&smu->table_mutex);
+  }
+
+  for (i = 0; i * RYZEN_SMU_PM_TABLE_LINE_SIZE < smu->pm_dram_map_size; i++) {
+    len = min_t(u32, RYZEN_SMU_PM_TABLE_LINE_SIZE,
+                smu->pm_dram_map_size - i * RYZEN_SMU_PM_TABLE_LINE_SIZE);
+
+    // Every line is new the first time around.
+    if (!smu->pm_generation ||
+        memcmp(smu->pm_table_cur + i * RYZEN_SMU_PM_TABLE_LINE_SIZE,
+               smu->pm_table_prev + i * RYZEN_SMU_PM_TABLE_LINE_SIZE, len)) {
+      dirty[i / 64] |= 1ULL << (i % 64);
+      changed = 1;
+    }
+  }
+
+  if (!changed)
+    return;
+
+  smu->pm_generation++;
+  memcpy(smu->pm_dirty, dirty, sizeof(dirty));
+}
+
+// Whether a read may be served from the copy of the last transfer, at [now],
+//  rather than transferring the table again.
+static int smu_pm_cached(enum smu_pm_refresh_policy policy, u32 interval_us,
+                         ktime_t last_transfer, ktime_t now, int force) {
+  // The table is always transferred once so there is a copy to serve.
+  if (force || !last_transfer)
+    return 0;
+
+  switch (policy) {
+  case SMU_PM_REFRESH_ALWAYS:
+    return 0;
+  case SMU_PM_REFRESH_MANUAL:
+    return 1;
+  default:
+    return ktime_before(now, ktime_add_us(last_transfer, interval_us));
+  }
+}
+
+// Transfers the PM table along with the table appended to it, in a single
+//  mailbox session.
+//
+// Callers must hold pm_mutex.
+static enum smu_return_val smu_pm_table_transfer_with_alt(struct smu_dev *smu) {
+  const struct smu_pm_ops *ops = smu->pm_ops;
+  smu_req_args_t args[2];
+  u32 ret, rets[2];
+
+  if (!ops->transfer_fn)
+    return SMU_Return_Unsupported;
+
+  smu_args_init(&args[0], ops->transfer_arg);
+  smu_args_init(&args[1], smu->pm_alt->desc->id);
+
+  ret = smu_send_commands(smu, ops->transfer_fn, args, 2, ops->mailbox, rets);
+
+  if (rets[1] == SMU_Return_OK) {
+    mutex_lock(&smu->table_mutex);
+    smu_table_track(smu->pm_alt, ktime_get());
+    mutex_unlock(&smu->table_mutex);
+  }
+
+  return ret;
+}
+
+static enum smu_return_val smu_pm_table_transfer(struct smu_dev *smu,
+                                                 int force) {
+  ktime_t now = ktime_get();
+  int cached;
+  u32 ret;
+
+  cached = smu_pm_cached(smu->pm_refresh_policy, smu->pm_refresh_interval_us,
+                         smu->pm_last_transfer, now, force);
+
+  smu_stats_pm_refresh(smu->stats, smu->pm_refresh_policy, cached);
+  if (cached)
+    return SMU_Return_OK;
+
+  smu->pm_last_transfer = now;
+
+  if (smu->pm_alt)
+    ret = smu_pm_table_transfer_with_alt(smu);
+  else
+    ret = smu_transfer_table_to_dram(smu);
+
+  if (ret != SMU_Return_OK)
+    return ret;
+
+  smu_pm_table_track(smu);
+
+  return SMU_Return_OK;
+}
+
+enum smu_return_val smu_refresh_pm_table(struct smu_dev *smu, int force) {
+  u32 ret;
+
+  mutex_lock(&smu->pm_mutex);
+
+  ret = smu_pm_table_setup(smu);
+  if (ret == SMU_Return_OK)
+    ret = smu_pm_table_transfer(smu, force);
+
+  mutex_unlock(&smu->pm_mutex);
+
+  return ret;
+}
+
+enum smu_return_val smu_copy_pm_table(struct smu_dev *smu, unsigned char *dst,
+                                      size_t len) {
+  u32 ret = SMU_Return_OK;
+
+  mutex_lock(&smu->pm_mutex);
+
+  // Nothing was transferred yet or the table was released while idle.
+  if (!smu->pm_table_cur) {
+    ret = SMU_Return_Unsupported;
+    goto BREAK_OUT;
+  }
+
+  if (len < smu->pm_dram_map_size) {
+    ret = SMU_Return_InsufficientSize;
+    goto BREAK_OUT;
+  }
+
+  memcpy(dst, smu->pm_table_cur, smu->pm_dram_map_size);
+
+BREAK_OUT:
+  mutex_unlock(&smu->pm_mutex);
+
+  return ret;
+}
+
+enum smu_return_val smu_read_pm_table(struct smu_dev *smu, unsigned char *dst,
+                                      size_t *len) {
+  u32 ret;
+
+  mutex_lock(&smu->pm_mutex);
+
+  ret = smu_pm_table_setup(smu);
+  if (ret != SMU_Return_OK)
+    goto BREAK_OUT;
+
+  // Validate output buffer size.
+  // N.B. In the case of Picasso/RavenRidge 2, we include the secondary PM Table
+  // size as well
+  if (*len < smu->pm_dram_map_size) {
+    pr_warn("Insufficient buffer size for PM table read: %lu < %d", *len,
+            smu->pm_dram_map_size);
+
+    *len = smu->pm_dram_map_size;
+    ret = SMU_Return_InsufficientSize;
+    goto BREAK_OUT;
+  }
+
+  // Clamp output size
+  *len = smu->pm_dram_map_size;
+
+  ret = smu_pm_table_transfer(smu, 0);
+  if (ret != SMU_Return_OK)
+    goto BREAK_OUT;
+
+  // The table (including the secondary one if required) was already copied
+  //  out of DRAM when it was last transferred.
+  memcpy(dst, smu->pm_table_cur, smu->pm_dram_map_size);
+
+BREAK_OUT:
+  mutex_unlock(&smu->pm_mutex);
+
+  return ret;
+}
+
+void smu_set_pm_refresh_policy(struct smu_dev *smu,
+                               enum smu_pm_refresh_policy policy,
+                               u32 interval_us) {
+  mutex_lock(&smu->pm_mutex);
+  smu->pm_refresh_policy = policy;
+  smu->pm_refresh_interval_us = interval_us;
+  mutex_unlock(&smu->pm_mutex);
+}
+
+void smu_get_pm_refresh_policy(struct smu_dev *smu,
+                               enum smu_pm_refresh_policy *policy,
+                               u32 *interval_us) {
+  mutex_lock(&smu->pm_mutex);
+  *policy = smu->pm_refresh_policy;
+  *interval_us = smu->pm_refresh_interval_us;
+  mutex_unlock(&smu->pm_mutex);
+}
+
+const char *smu_get_pm_refresh_policy_name(enum smu_pm_refresh_policy policy) {
+  switch (policy) {
+  case SMU_PM_REFRESH_INTERVAL:
+    return "interval";
+  case SMU_PM_REFRESH_ALWAYS:
+    return "always";
+  case SMU_PM_REFRESH_MANUAL:
+    return "manual";
+  default:
+    return "undefined";
+  }
+}
+
+enum smu_return_val
+smu_get_pm_table_generation(struct smu_dev *smu,
+                            struct ryzen_smu_pm_table_gen *gen) {
+  u32 ret = SMU_Return_OK;
+
+  BUILD_BUG_ON(PM_TABLE_MAX_SIZE > RYZEN_SMU_PM_TABLE_LINE_SIZE * 64 *
+                                       RYZEN_SMU_PM_TABLE_DIRTY_WORDS);
+
+  mutex_lock(&smu->pm_mutex);
+
+  if (!smu->pm_table_cur)
+    ret = SMU_Return_Unsupported;
+  else {
+    gen->generation = smu->pm_generation;
+    memcpy(gen->dirty, smu->pm_dirty, sizeof(gen->dirty));
+  }
+
+  mutex_unlock(&smu->pm_mutex);
+
+  return ret;
+}
+
+enum smu_return_val smu_get_pm_table_region(struct smu_dev *smu, int alt,
+                                            u64 *base, u32 *size) {
+  u32 ret = SMU_Return_OK;
+
+  mutex_lock(&smu->pm_mutex);
+
+  // Resolving the region needs no mapping, so it stays valid while idle.
+  ret = smu_pm_table_resolve(smu);
+  if (ret != SMU_Return_OK)
+    goto BREAK_OUT;
+
+  if (alt && !smu->pm_alt)
+    ret = SMU_Return_Unsupported;
+  else if (alt) {
+    mutex_lock(&smu->table_mutex);
+    *base = smu->pm_alt->dram_base;
+    *size = smu->pm_alt->desc->size;
+    mutex_unlock(&smu->table_mutex);
+  } else {
+    *base = smu->pm_dram_base;
+    *size = smu_pm_table_primary_size(smu);
+  }
+
+BREAK_OUT:
+  mutex_unlock(&smu->pm_mutex);
+
+  return ret;
+}
+
+static struct smu_table *smu_table_find(struct smu_dev *smu, u32 id) {
+  u32 i;
+
+  for (i = 0; i < smu->table_count; i++)
+    if (smu->tables[i].desc->id == id)
+      return &smu->tables[i];
+
+  return NULL;
+}
+
+// Resolves the DRAM base of a table. Only tables appended to the PM table are
+//  known so far, their base being the high half of the one returned by the
+//  validated sequence resolving the PM table, so no other is requested by ID.
+//
+// Callers must not hold table_mutex.
+static enum smu_return_val smu_table_resolve(struct smu_dev *smu,
+                                             struct smu_table *t) {
+  u32 ret;
+
+  if (!t->desc->pm_append)
+    return SMU_Return_Unsupported;
+
+  mutex_lock(&smu->pm_mutex);
+  ret = smu_pm_table_resolve(smu);
+  mutex_unlock(&smu->pm_mutex);
+
+  return ret;
+}
+
+// Maps the table & allocates its copy if not already done, marking it as
+//  accessed. Its DRAM base must have been resolved by smu_table_resolve().
+//
+// Callers must hold table_mutex.
+static enum smu_return_val smu_table_setup(struct smu_dev *smu,
+                                           struct smu_table *t) {
+  if (!t->dram_base) {
+    pr_err("Unable to receive the DRAM base of table %u", t->desc->id);
+    return SMU_Return_Unsupported;
+  }
+
+  smu_pm_touch(smu, &t->last_access);
+
+  if (t->virt_addr == NULL) {
+    t->virt_addr = ioremap_cache(t->dram_base, t->desc->size);
+
+    if (t->virt_addr == NULL) {
+      pr_err("Failed to map DRAM base of table %u: %llX (0x%X B)",
+             t->desc->id, t->dram_base, t->desc->size);
+      return SMU_Return_MappedError;
+    }
+  }
+
+  if (t->buf == NULL) {
+    t->buf = kzalloc(t->desc->size * 2, GFP_KERNEL);
+    if (!t->buf)
+      return SMU_Return_MappedError;
+  }
+
+  return SMU_Return_OK;
+}
+
+// Releases the mapping & copy of a table, leaving its resolved DRAM base.
+//
+// Callers must hold table_mutex, unless the SMU is being freed.
+static void smu_table_release(struct smu_table *t) {
+  if (t->virt_addr) {
+    iounmap(t->virt_addr);
+    t->virt_addr = NULL;
+  }
+
+  kfree(t->buf);
+  t->buf = NULL;
+  t->last_transfer = 0;
+}
+
+// Takes a copy of the table just transferred at [now], bumping the generation
+//  if it differs from the previous one.
+//
+// Callers must hold table_mutex.
+static void smu_table_track(struct smu_table *t, ktime_t now) {
+  u8 *scratch;
+
+  if (!t->virt_addr || !t->buf)
+    return;
+
+  t->last_transfer = now;
+
+  scratch = t->buf + t->desc->size;
+  memcpy_fromio(scratch, t->virt_addr, t->desc->size);
+
+  // Every table is new the first time around.
+  if (t->generation && !memcmp(t->buf, scratch, t->desc->size))
+    return;
+
+  memcpy(t->buf, scratch, t->desc->size);
+  t->generation++;
+}
+
+u32 smu_get_table_ids(struct smu_dev *smu, u32 *ids, u32 max) {
+  u32 i;
+
+  for (i = 0; i < smu->table_count && i < max; i++)
+    ids[i] = smu->tables[i].desc->id;
+
+  return smu->table_count;
+}
+
+enum smu_return_val smu_get_table_info(struct smu_dev *smu, u32 id,
+                                       struct ryzen_smu_table_info *info) {
+  struct smu_table *t = smu_table_find(smu, id);
+
+  if (!t)
+    return SMU_Return_InvalidArgument;
+
+  mutex_lock(&smu->table_mutex);
+
+  info->id = t->desc->id;
+  info->size = t->desc->size;
+  info->offset = offset_in_page(t->dram_base);
+  info->flags = t->desc->pm_append ? RYZEN_SMU_TABLE_PM_APPENDED : 0;
+  info->refresh_policy = t->refresh_policy;
+  info->refresh_interval_us = t->refresh_interval_us;
+  info->generation = t->generation;
+
+  mutex_unlock(&smu->table_mutex);
+
+  return SMU_Return_OK;
+}
+
+enum smu_return_val smu_refresh_tables(struct smu_dev *smu, u64 ids, int force,
+                                       u64 *failed) {
+  const struct smu_pm_ops *ops = smu->pm_ops;
+  struct smu_table *batch[RYZEN_SMU_TABLE_MAX];
+  smu_req_args_t args[RYZEN_SMU_TABLE_MAX];
+  u32 i, count = 0, ret = SMU_Return_OK, tmp;
+  u32 rets[RYZEN_SMU_TABLE_MAX];
+  struct smu_table *t;
+  ktime_t now;
+
+  *failed = 0;
+
+  if (!ops || !ops->transfer_fn)
+    return SMU_Return_Unsupported;
+
+  // Bases are resolved through the PM table, whose lock is taken first.
+  for (i = 0; i < smu->table_count; i++) {
+    t = &smu->tables[i];
+    if (t->desc->id >= 64 || !(ids & BIT_ULL(t->desc->id)))
+      continue;
+
+    tmp = smu_table_resolve(smu, t);
+    if (tmp != SMU_Return_OK) {
+      *failed |= BIT_ULL(t->desc->id);
+      if (ret == SMU_Return_OK)
+        ret = tmp;
+    }
+  }
+
+  mutex_lock(&smu->table_mutex);
+
+  now = ktime_get();
+
+  for (i = 0; i < smu->table_count; i++) {
+    t = &smu->tables[i];
+    if (t->desc->id >= 64 || !(ids & BIT_ULL(t->desc->id)) ||
+        (*failed & BIT_ULL(t->desc->id)))
+      continue;
+
+    tmp = smu_table_setup(smu, t);
+    if (tmp != SMU_Return_OK) {
+      *failed |= BIT_ULL(t->desc->id);
+      if (ret == SMU_Return_OK)
+        ret = tmp;
+      continue;
+    }
+
+    if (smu_pm_cached(t->refresh_policy, t->refresh_interval_us,
+                      t->last_transfer, now, force))
+      continue;
+
+    smu_args_init(&args[count], t->desc->id);
+    batch[count++] = t;
+  }
+
+  // Every table due is transferred in one go, then copied out of DRAM.
+  if (count) {
+    tmp = smu_send_commands(smu, ops->transfer_fn, args, count, ops->mailbox,
+                            rets);
+    if (ret == SMU_Return_OK)
+      ret = tmp;
+
+    now = ktime_get();
+
+    for (i = 0; i < count; i++) {
+      if (rets[i] == SMU_Return_OK)
+        smu_table_track(batch[i], now);
+      else
+        *failed |= BIT_ULL(batch[i]->desc->id);
     }
   }
 
-  // memcpy() seems to work as well but according to Linux, for physically
-  // mapped addresses,
-  //  we should use _fromio().
-  memcpy_fromio(dst, g_smu.pm_table_virt_addr, size);
+  mutex_unlock(&smu->table_mutex);
+
+  return ret;
+}
+
+enum smu_return_val smu_read_table(struct smu_dev *smu, u32 id,
+                                   unsigned char *dst, size_t *len) {
+  struct smu_table *t = smu_table_find(smu, id);
+  u64 failed;
+  u32 ret;
+
+  if (!t || id >= 64)
+    return SMU_Return_InvalidArgument;
+
+  if (*len < t->desc->size) {
+    *len = t->desc->size;
+    return SMU_Return_InsufficientSize;
+  }
+
+  ret = smu_refresh_tables(smu, BIT_ULL(id), 0, &failed);
+  if (ret != SMU_Return_OK)
+    return ret;
+
+  mutex_lock(&smu->table_mutex);
+
+  // The table may have been released while idle since it was refreshed.
+  if (!t->buf)
+    ret = SMU_Return_Unsupported;
+  else {
+    memcpy(dst, t->buf, t->desc->size);
+    *len = t->desc->size;
+  }
+
+  mutex_unlock(&smu->table_mutex);
+
+  return ret;
+}
+
+enum smu_return_val smu_set_table_refresh_policy(
+    struct smu_dev *smu, u32 id, enum smu_pm_refresh_policy policy,
+    u32 interval_us) {
+  struct smu_table *t = smu_table_find(smu, id);
+
+  if (!t)
+    return SMU_Return_InvalidArgument;
+
+  mutex_lock(&smu->table_mutex);
+  t->refresh_policy = policy;
+  t->refresh_interval_us = interval_us;
+  mutex_unlock(&smu->table_mutex);
+
+  return SMU_Return_OK;
+}
+
+enum smu_return_val smu_get_table_region(struct smu_dev *smu, u32 id, u64 *base,
+                                         u32 *size) {
+  struct smu_table *t = smu_table_find(smu, id);
+  u32 ret;
+
+  if (!t)
+    return SMU_Return_InvalidArgument;
+
+  ret = smu_table_resolve(smu, t);
+  if (ret != SMU_Return_OK)
+    return ret;
 
-  // Append secondary table if required.
-  if (g_smu.pm_dram_map_size_alt)
-    memcpy_fromio(dst + size, g_smu.pm_table_virt_addr_alt,
-                  g_smu.pm_dram_map_size_alt);
+  mutex_lock(&smu->table_mutex);
+  *base = t->dram_base;
+  *size = t->desc->size;
+  mutex_unlock(&smu->table_mutex);
 
   return SMU_Return_OK;
 }
@@ -27,6 +27,23 @@
 #define SMU_RETRIES_MAX                               32768
 #define SMU_RETRIES_MIN                               500
 
+/**
+ * Bounds of the adaptive wait for a command response. The mailbox is spun on for twice the usual
+ *  completion time of the command, within the spin bounds, after which it is polled with a sleep
+ *  starting at the minimum and doubling up to the maximum.
+ */
+#define SMU_WAIT_SPIN_MIN_NS                          5000
+#define SMU_WAIT_SPIN_MAX_NS                          50000
+#define SMU_WAIT_SLEEP_MIN_US                         10
+#define SMU_WAIT_SLEEP_MAX_US                         250
+
+/**
+ * Worst-case duration of a single poll of the RSP register, a pair of PCI config accesses. Commands
+ *  time out once smu_timeout_attempts back to back polls would have taken, however long the wait
+ *  sleeps in between.
+ */
+#define SMU_WAIT_POLL_NS                              2000
+
 /* PCI Query Registers. [0x60, 0x64] & [0xB4, 0xB8] also work. These may be arch-specific. */
 #define SMU_PCI_ADDR_REG                              0xC4
 #define SMU_PCI_DATA_REG                              0xC8
@@ -116,6 +133,24 @@ enum smu_mailbox {
     MAILBOX_TYPE_COUNT
 };
 
+/**
+ * Determines when reading the PM table requests the SMU to transfer a new one, rather than serving
+ *  the last transferred copy. Explicit refresh requests always transfer the table.
+ */
+enum smu_pm_refresh_policy {
+    // Transfer only if the last transfer happened at least the refresh interval ago.
+    SMU_PM_REFRESH_INTERVAL,
+    // Transfer on every read.
+    SMU_PM_REFRESH_ALWAYS,
+    // Only transfer on explicit refresh requests.
+    SMU_PM_REFRESH_MANUAL,
+
+    SMU_PM_REFRESH_COUNT
+};
+
+/* Upper bound of the PM table refresh interval, in microseconds. */
+#define SMU_PM_REFRESH_INTERVAL_MAX_US                1000000
+
 /**
  * SMU Service Request Arguments
  */
@@ -134,22 +169,41 @@ typedef union {
 /* Parameters for SMU execution. */
 extern uint smu_timeout_attempts;
 
+/* Default PM table refresh policy & interval of newly initialized SMUs. */
+extern uint pm_refresh_policy;
+extern uint pm_refresh_interval_us;
+
+/* Time after which an unused PM table is unmapped, zero to keep it mapped. */
+extern uint pm_idle_timeout_ms;
+
+/* State of the SMU behind a single root complex. */
+struct smu_dev;
+
+/* Defined in stats.h. */
+struct smu_stats;
+
 /**
- * Initializes for SMU use. MUST be called before using any function.
+ * Initializes the SMU behind the root complex [dev] for use. MUST be called before using any
+ *  function, once for every root complex.
  *
- * Returns 0 on success, anything else on failure.
+ * Returns the SMU context or an ERR_PTR() on failure.
  */
-int smu_init(struct pci_dev* dev);
+struct smu_dev* smu_init(struct pci_dev* dev);
 
 /**
- * Cleans up the allocated objects after use.
+ * Cleans up the allocated objects after use and frees the context.
  */
-void smu_cleanup(void);
+void smu_cleanup(struct smu_dev* smu);
 
 /**
  * Returns the running processor's detected code name.
  */
-enum smu_processor_codename smu_get_codename(void);
+enum smu_processor_codename smu_get_codename(struct smu_dev* smu);
+
+/**
+ * Returns the command latency statistics of the SMU.
+ */
+struct smu_stats* smu_get_stats(struct smu_dev* smu);
 
 /**
  * Returns the running processor's detected code name as a fridnly string.
@@ -157,12 +211,23 @@ enum smu_processor_codename smu_get_codename(void);
 const char* getCodeName(enum smu_processor_codename codename);
 
 /**
- * Reads or writes 32 bit words to the SMU on the root NB PCI device.
+ * Reads or writes 32 bit words to the SMN through the root NB PCI device of the SMU.
  *
  * Returns an smu_return_val indicating the status of the operation.
  */
-enum smu_return_val smu_read_address(struct pci_dev* dev, u32 address, u32* value);
-enum smu_return_val smu_write_address(struct pci_dev* dev, u32 address, u32 value);
+enum smu_return_val smu_read_address(struct smu_dev* smu, u32 address, u32* value);
+enum smu_return_val smu_write_address(struct smu_dev* smu, u32 address, u32 value);
+
+/* Defined in drv.h as it is shared with userspace. */
+struct ryzen_smu_smn_op;
+
+/**
+ * Performs [count] SMN reads or writes back to back, without other SMN accesses interleaving, and
+ *  stores the result of each into its status.
+ *
+ * Returns the number of operations which failed.
+ */
+u32 smu_smn_rw_batch(struct smu_dev* smu, struct ryzen_smu_smn_op* ops, u32 count);
 
 /**
  * Initializes an SMU REQ ARG structure with zeros.
@@ -179,25 +244,25 @@ void smu_args_init(smu_req_args_t* args, u32 value);
  *
  * Returns an smu_return_val indicating the status of the operation.
  */
-enum smu_return_val smu_send_command(struct pci_dev* dev, u32 op, smu_req_args_t* args,
+enum smu_return_val smu_send_command(struct smu_dev* smu, u32 op, smu_req_args_t* args,
     enum smu_mailbox mailbox);
 
 /**
  * Returns the current SMU firmware version from the specified mailbox.
  */
-u32 smu_get_version(struct pci_dev* dev, enum smu_mailbox mb);
+u32 smu_get_version(struct smu_dev* smu, enum smu_mailbox mb);
 
 /**
  * Returns the interface version of the MP1 mailbox.
  */
-enum smu_if_version smu_get_mp1_if_version(void);
+enum smu_if_version smu_get_mp1_if_version(struct smu_dev* smu);
 
 /**
  * Commands the SMU to update the PM table mapped at the DRAM base address.
  *
  * Returns an smu_return_val indicating the status of the operation.
  */
-enum smu_return_val smu_transfer_table_to_dram(struct pci_dev* dev);
+enum smu_return_val smu_transfer_table_to_dram(struct smu_dev* smu);
 
 /**
  * For Matisse and Renoir processors, returns a numeric value indicating the format
@@ -205,13 +270,124 @@ enum smu_return_val smu_transfer_table_to_dram(struct pci_dev* dev);
  *
  * Returns an smu_return_val indicating the status of the operation.
  */
-enum smu_return_val smu_get_pm_table_version(struct pci_dev* dev, u32* version);
+enum smu_return_val smu_get_pm_table_version(struct smu_dev* smu, u32* version);
+
+/**
+ * Returns the size of the PM table(s) reported under [version], without accessing the table.
+ *
+ * Returns zero if the version is unknown or PM tables are unsupported.
+ */
+u32 smu_get_pm_table_size(struct smu_dev* smu, u32 version);
 
 /**
  * Reads the PM table for the current CPU, if supported, into the destination buffer.
  *
  * Returns an smu_return_val indicating the status of the operation.
  */
-enum smu_return_val smu_read_pm_table(struct pci_dev* dev, unsigned char* dst, size_t* len);
+enum smu_return_val smu_read_pm_table(struct smu_dev* smu, unsigned char* dst, size_t* len);
+
+/**
+ * Commands the SMU to update the PM table(s) at their DRAM base(s) without copying them out.
+ * Unless [force] is set, marking an explicit request, this is subject to the same refresh policy
+ *  as smu_read_pm_table().
+ *
+ * Returns an smu_return_val indicating the status of the operation.
+ */
+enum smu_return_val smu_refresh_pm_table(struct smu_dev* smu, int force);
+
+/**
+ * Copies the PM table(s) as last transferred by the SMU into the destination buffer, which must
+ *  be able to hold the full table. Does not request a transfer.
+ *
+ * Returns an smu_return_val indicating the status of the operation.
+ */
+enum smu_return_val smu_copy_pm_table(struct smu_dev* smu, unsigned char* dst, size_t len);
+
+/**
+ * Sets or retrieves the PM table refresh policy. [interval_us] only applies to
+ *  SMU_PM_REFRESH_INTERVAL.
+ */
+void smu_set_pm_refresh_policy(struct smu_dev* smu, enum smu_pm_refresh_policy policy,
+    u32 interval_us);
+void smu_get_pm_refresh_policy(struct smu_dev* smu, enum smu_pm_refresh_policy* policy,
+    u32* interval_us);
+
+/**
+ * Returns the name of a PM table refresh policy.
+ */
+const char* smu_get_pm_refresh_policy_name(enum smu_pm_refresh_policy policy);
+
+/* Defined in drv.h as it is shared with userspace. */
+struct ryzen_smu_pm_table_gen;
+
+/**
+ * Retrieves the change tracking state of the PM table as of its last transfer.
+ *
+ * Returns an smu_return_val indicating the status of the operation.
+ */
+enum smu_return_val smu_get_pm_table_generation(struct smu_dev* smu,
+    struct ryzen_smu_pm_table_gen* gen);
+
+/**
+ * Retrieves the physical DRAM region backing the primary PM table, or the table appended to it on
+ *  Picasso/RavenRidge 2 when [alt] is set. The DRAM base is requested from the SMU on the first
+ *  access to the table, whichever it is.
+ *
+ * Returns an smu_return_val indicating the status of the operation.
+ */
+enum smu_return_val smu_get_pm_table_region(struct smu_dev* smu, int alt, u64* base,
+    u32* size);
+
+/* Defined in drv.h as it is shared with userspace. */
+struct ryzen_smu_table_info;
+
+/**
+ * Tables other than the PM table, selected by the ID passed to TransferTableSmu2Dram. Each has its
+ *  own DRAM region, copy & refresh policy and is set up on first access, independently of the PM
+ *  table. Tables appended to the PM table are still read along with it.
+ *
+ * Stores the IDs of up to [max] tables in [ids] and returns how many the SMU has.
+ */
+u32 smu_get_table_ids(struct smu_dev* smu, u32* ids, u32 max);
+
+/**
+ * Retrieves the size, refresh policy & change tracking state of the table [id].
+ *
+ * Returns an smu_return_val indicating the status of the operation.
+ */
+enum smu_return_val smu_get_table_info(struct smu_dev* smu, u32 id,
+    struct ryzen_smu_table_info* info);
+
+/**
+ * Transfers every table whose bit is set in [ids], one after the other under a single acquisition
+ *  of the mailbox. Unless [force] is set, each table is subject to its own refresh policy. The bits
+ *  of the tables which failed are set in [failed].
+ *
+ * Returns SMU_Return_OK if every table is up to date, otherwise the first error.
+ */
+enum smu_return_val smu_refresh_tables(struct smu_dev* smu, u64 ids, int force, u64* failed);
+
+/**
+ * Reads the table [id] into the destination buffer, subject to its refresh policy.
+ *
+ * Returns an smu_return_val indicating the status of the operation.
+ */
+enum smu_return_val smu_read_table(struct smu_dev* smu, u32 id, unsigned char* dst, size_t* len);
+
+/**
+ * Sets the refresh policy of the table [id], as smu_set_pm_refresh_policy() does for the PM table.
+ *
+ * Returns an smu_return_val indicating the status of the operation.
+ */
+enum smu_return_val smu_set_table_refresh_policy(struct smu_dev* smu, u32 id,
+    enum smu_pm_refresh_policy policy, u32 interval_us);
+
+/**
+ * Retrieves the physical DRAM region backing the table [id], requesting it from the SMU if this
+ *  is the first access to the table.
+ *
+ * Returns an smu_return_val indicating the status of the operation.
+ */
+enum smu_return_val smu_get_table_region(struct smu_dev* smu, u32 id, u64* base, u32* size);
 
 #endif /* __SMU_H__ */
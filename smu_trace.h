@@ -0,0 +1,154 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com> */
+/* Ryzen SMU Tracepoints */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM ryzen_smu
+
+#if !defined(__SMU_TRACE_H__) || defined(TRACE_HEADER_MULTI_READ)
+#define __SMU_TRACE_H__
+
+#include <linux/tracepoint.h>
+
+#include "smu.h"
+
+TRACE_DEFINE_ENUM(MAILBOX_TYPE_RSMU);
+TRACE_DEFINE_ENUM(MAILBOX_TYPE_MP1);
+TRACE_DEFINE_ENUM(MAILBOX_TYPE_HSMP);
+
+#define show_smu_mailbox(mb)                                            \
+    __print_symbolic(mb,                                                \
+        { MAILBOX_TYPE_RSMU,    "RSMU" },                               \
+        { MAILBOX_TYPE_MP1,     "MP1" },                                \
+        { MAILBOX_TYPE_HSMP,    "HSMP" })
+
+/**
+ * Every event carries the PCI bus of the root complex, telling the sockets apart.
+ */
+TRACE_EVENT(smu_cmd_start,
+    TP_PROTO(u32 bus, enum smu_mailbox mailbox, u32 op, const smu_req_args_t* args),
+    TP_ARGS(bus, mailbox, op, args),
+
+    TP_STRUCT__entry(
+        __field(u32,    bus)
+        __field(u32,    mailbox)
+        __field(u32,    op)
+        __array(u32,    args, SMU_REQ_MAX_ARGS)
+    ),
+
+    TP_fast_assign(
+        __entry->bus = bus;
+        __entry->mailbox = mailbox;
+        __entry->op = op;
+        memcpy(__entry->args, args->args, sizeof(__entry->args));
+    ),
+
+    TP_printk("bus=%02x mailbox=%s op=0x%02x args=%08x,%08x,%08x,%08x,%08x,%08x",
+        __entry->bus, show_smu_mailbox(__entry->mailbox), __entry->op, __entry->args[0],
+        __entry->args[1], __entry->args[2], __entry->args[3], __entry->args[4], __entry->args[5])
+);
+
+/**
+ * Emitted for every command started, whatever its outcome. [args] holds the response of the SMU
+ *  when [ret] is SMU_Return_OK. [lock_ns] is the time spent waiting for other commands to the
+ *  mailbox & [duration_ns] the time from the command being written until the SMU responded.
+ */
+TRACE_EVENT(smu_cmd_complete,
+    TP_PROTO(u32 bus, enum smu_mailbox mailbox, u32 op, u32 ret, const smu_req_args_t* args,
+        u32 polls, u32 sleeps, u64 lock_ns, u64 duration_ns),
+    TP_ARGS(bus, mailbox, op, ret, args, polls, sleeps, lock_ns, duration_ns),
+
+    TP_STRUCT__entry(
+        __field(u32,    bus)
+        __field(u32,    mailbox)
+        __field(u32,    op)
+        __field(u32,    ret)
+        __array(u32,    args, SMU_REQ_MAX_ARGS)
+        __field(u32,    polls)
+        __field(u32,    sleeps)
+        __field(u64,    lock_ns)
+        __field(u64,    duration_ns)
+    ),
+
+    TP_fast_assign(
+        __entry->bus = bus;
+        __entry->mailbox = mailbox;
+        __entry->op = op;
+        __entry->ret = ret;
+        memcpy(__entry->args, args->args, sizeof(__entry->args));
+        __entry->polls = polls;
+        __entry->sleeps = sleeps;
+        __entry->lock_ns = lock_ns;
+        __entry->duration_ns = duration_ns;
+    ),
+
+    TP_printk("bus=%02x mailbox=%s op=0x%02x ret=0x%x args=%08x,%08x,%08x,%08x,%08x,%08x "
+        "polls=%u sleeps=%u lock_ns=%llu duration_ns=%llu", __entry->bus,
+        show_smu_mailbox(__entry->mailbox), __entry->op, __entry->ret, __entry->args[0],
+        __entry->args[1], __entry->args[2], __entry->args[3], __entry->args[4], __entry->args[5],
+        __entry->polls, __entry->sleeps, __entry->lock_ns, __entry->duration_ns)
+);
+
+/**
+ * [busy] is set when a previous command still occupied the mailbox so this one was never issued.
+ */
+TRACE_EVENT(smu_cmd_timeout,
+    TP_PROTO(u32 bus, enum smu_mailbox mailbox, u32 op, int busy, u32 polls, u64 duration_ns),
+    TP_ARGS(bus, mailbox, op, busy, polls, duration_ns),
+
+    TP_STRUCT__entry(
+        __field(u32,    bus)
+        __field(u32,    mailbox)
+        __field(u32,    op)
+        __field(int,    busy)
+        __field(u32,    polls)
+        __field(u64,    duration_ns)
+    ),
+
+    TP_fast_assign(
+        __entry->bus = bus;
+        __entry->mailbox = mailbox;
+        __entry->op = op;
+        __entry->busy = busy;
+        __entry->polls = polls;
+        __entry->duration_ns = duration_ns;
+    ),
+
+    TP_printk("bus=%02x mailbox=%s op=0x%02x busy=%d polls=%u duration_ns=%llu", __entry->bus,
+        show_smu_mailbox(__entry->mailbox), __entry->op, __entry->busy, __entry->polls,
+        __entry->duration_ns)
+);
+
+TRACE_EVENT(smu_smn_access,
+    TP_PROTO(u32 bus, u32 address, u32 value, int write, int err),
+    TP_ARGS(bus, address, value, write, err),
+
+    TP_STRUCT__entry(
+        __field(u32,    bus)
+        __field(u32,    address)
+        __field(u32,    value)
+        __field(int,    write)
+        __field(int,    err)
+    ),
+
+    TP_fast_assign(
+        __entry->bus = bus;
+        __entry->address = address;
+        __entry->value = value;
+        __entry->write = write;
+        __entry->err = err;
+    ),
+
+    TP_printk("bus=%02x %s address=0x%08x value=0x%08x err=%d", __entry->bus,
+        __entry->write ? "write" : "read", __entry->address, __entry->value, __entry->err)
+);
+
+#endif /* __SMU_TRACE_H__ */
+
+// The header lives next to the sources rather than under include/trace/events.
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE smu_trace
+
+#include <trace/define_trace.h>
@@ -0,0 +1,254 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com> */
+/* Ryzen SMU Command Statistics */
+
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#include "smu.h"
+#include "stats.h"
+
+struct smu_stats {
+    // The last entry of every mailbox holds all commands at or above SMU_STATS_MAX_OPS.
+    struct smu_cmd_stats            cmd[MAILBOX_TYPE_COUNT][SMU_STATS_MAX_OPS + 1];
+    struct smu_mailbox_stats        mailbox[MAILBOX_TYPE_COUNT];
+    struct smu_pm_refresh_stats     pm_refresh[SMU_PM_REFRESH_COUNT];
+};
+
+static const char* const g_mailbox_names[MAILBOX_TYPE_COUNT] = {
+    [MAILBOX_TYPE_RSMU] = "RSMU",
+    [MAILBOX_TYPE_MP1]  = "MP1",
+    [MAILBOX_TYPE_HSMP] = "HSMP",
+};
+
+struct smu_stats* smu_stats_alloc(void) {
+    return vzalloc(sizeof(struct smu_stats));
+}
+
+void smu_stats_free(struct smu_stats* stats) {
+    vfree(stats);
+}
+
+struct smu_cmd_stats* smu_stats_get(struct smu_stats* stats, enum smu_mailbox mb, u32 op) {
+    return &stats->cmd[mb][min_t(u32, op, SMU_STATS_MAX_OPS)];
+}
+
+void smu_stats_record(struct smu_cmd_stats* st, u64 ns, u32 polls, u32 sleeps,
+    enum smu_return_val ret) {
+    u64 us = div_u64(ns, NSEC_PER_USEC);
+    u32 bucket;
+
+    st->count++;
+    st->polls += polls;
+    st->sleeps += sleeps;
+
+    // A timed out command never completed so its duration says nothing about the command.
+    if (ret == SMU_Return_CommandTimeout) {
+        st->timeouts++;
+        return;
+    }
+
+    if (ret != SMU_Return_OK)
+        st->failed++;
+
+    st->total_ns += ns;
+    if (ns > st->max_ns)
+        st->max_ns = ns;
+
+    bucket = us ? fls64(us) : 0;
+    st->hist[min_t(u32, bucket, SMU_STATS_HIST_BUCKETS - 1)]++;
+
+    // Weight of 1/8 so a single outlier barely affects the wait strategy.
+    if (ret == SMU_Return_OK)
+        st->ewma_ns = st->ewma_ns ? st->ewma_ns - (st->ewma_ns >> 3) + (ns >> 3) : ns;
+}
+
+struct smu_mailbox_stats* smu_stats_get_mailbox(struct smu_stats* stats, enum smu_mailbox mb) {
+    return &stats->mailbox[mb];
+}
+
+void smu_stats_record_mailbox(struct smu_mailbox_stats* st, u64 lock_ns, u64 busy_ns,
+    u64 response_ns, int busy, enum smu_return_val ret) {
+    st->calls++;
+    st->lock_wait_ns += lock_ns;
+    st->busy_wait_ns += busy_ns;
+    st->response_wait_ns += response_ns;
+
+    if (ret == SMU_Return_PCIFailed)
+        st->pci_failures++;
+    else if (ret == SMU_Return_CommandTimeout) {
+        if (busy)
+            st->busy++;
+        else
+            st->timeouts++;
+    }
+}
+
+void smu_stats_pm_refresh(struct smu_stats* stats, enum smu_pm_refresh_policy policy, int cached) {
+    if (cached)
+        stats->pm_refresh[policy].cached++;
+    else
+        stats->pm_refresh[policy].issued++;
+}
+
+static int smu_stats_show(struct seq_file* m, void* v) {
+    struct smu_stats* stats = m->private;
+    struct smu_cmd_stats* st;
+    u32 mb, op, i;
+
+    seq_puts(m, "# mailbox op count failed timeouts avg_ns max_ns ewma_ns polls sleeps");
+    seq_puts(m, " hist[<1us");
+    for (i = 1; i < SMU_STATS_HIST_BUCKETS; i++) {
+        if (i == SMU_STATS_HIST_BUCKETS - 1)
+            seq_printf(m, " >=%uus", 1U << (i - 1));
+        else
+            seq_printf(m, " <%uus", 1U << i);
+    }
+    seq_puts(m, "]\n");
+
+    for (mb = 0; mb < MAILBOX_TYPE_COUNT; mb++) {
+        for (op = 0; op <= SMU_STATS_MAX_OPS; op++) {
+            st = &stats->cmd[mb][op];
+            if (!st->count)
+                continue;
+
+            if (op == SMU_STATS_MAX_OPS)
+                seq_printf(m, "%s other", g_mailbox_names[mb]);
+            else
+                seq_printf(m, "%s 0x%02x", g_mailbox_names[mb], op);
+
+            seq_printf(m, " %llu %llu %llu %llu %llu %llu %llu %llu",
+                st->count, st->failed, st->timeouts,
+                st->count > st->timeouts ? div64_u64(st->total_ns, st->count - st->timeouts) : 0,
+                st->max_ns, st->ewma_ns, st->polls, st->sleeps);
+
+            for (i = 0; i < SMU_STATS_HIST_BUCKETS; i++)
+                seq_printf(m, " %u", st->hist[i]);
+
+            seq_putc(m, '\n');
+        }
+    }
+
+    return 0;
+}
+
+static int smu_stats_open(struct inode* inode, struct file* filp) {
+    return single_open(filp, smu_stats_show, inode->i_private);
+}
+
+static ssize_t smu_stats_write(struct file* filp, const char __user* buf, size_t count,
+    loff_t* ppos) {
+    struct smu_stats* stats = ((struct seq_file*)filp->private_data)->private;
+    u32 mb, op;
+
+    // Any write clears the counters. The moving averages are kept as they drive the wait strategy.
+    for (mb = 0; mb < MAILBOX_TYPE_COUNT; mb++) {
+        for (op = 0; op <= SMU_STATS_MAX_OPS; op++) {
+            u64 ewma = stats->cmd[mb][op].ewma_ns;
+
+            memset(&stats->cmd[mb][op], 0, sizeof(stats->cmd[mb][op]));
+            stats->cmd[mb][op].ewma_ns = ewma;
+        }
+    }
+
+    return count;
+}
+
+static const struct file_operations smu_stats_fops = {
+    .owner      = THIS_MODULE,
+    .open       = smu_stats_open,
+    .read       = seq_read,
+    .write      = smu_stats_write,
+    .llseek     = seq_lseek,
+    .release    = single_release,
+};
+
+static int smu_stats_pm_refresh_show(struct seq_file* m, void* v) {
+    struct smu_stats* stats = m->private;
+    u32 policy;
+
+    seq_puts(m, "# policy issued cached\n");
+
+    for (policy = 0; policy < SMU_PM_REFRESH_COUNT; policy++)
+        seq_printf(m, "%s %llu %llu\n", smu_get_pm_refresh_policy_name(policy),
+            stats->pm_refresh[policy].issued, stats->pm_refresh[policy].cached);
+
+    return 0;
+}
+
+static int smu_stats_pm_refresh_open(struct inode* inode, struct file* filp) {
+    return single_open(filp, smu_stats_pm_refresh_show, inode->i_private);
+}
+
+static ssize_t smu_stats_pm_refresh_write(struct file* filp, const char __user* buf, size_t count,
+    loff_t* ppos) {
+    struct smu_stats* stats = ((struct seq_file*)filp->private_data)->private;
+
+    // Any write clears the counters.
+    memset(stats->pm_refresh, 0, sizeof(stats->pm_refresh));
+    return count;
+}
+
+static const struct file_operations smu_stats_pm_refresh_fops = {
+    .owner      = THIS_MODULE,
+    .open       = smu_stats_pm_refresh_open,
+    .read       = seq_read,
+    .write      = smu_stats_pm_refresh_write,
+    .llseek     = seq_lseek,
+    .release    = single_release,
+};
+
+static int smu_stats_mailbox_show(struct seq_file* m, void* v) {
+    struct smu_stats* stats = m->private;
+    struct smu_mailbox_stats* st;
+    u32 mb;
+
+    seq_puts(m, "# mailbox calls timeouts busy pci_failures lock_wait_ns busy_wait_ns"
+        " response_wait_ns\n");
+
+    for (mb = 0; mb < MAILBOX_TYPE_COUNT; mb++) {
+        st = &stats->mailbox[mb];
+
+        seq_printf(m, "%s %llu %llu %llu %llu %llu %llu %llu\n", g_mailbox_names[mb], st->calls,
+            st->timeouts, st->busy, st->pci_failures, st->lock_wait_ns, st->busy_wait_ns,
+            st->response_wait_ns);
+    }
+
+    return 0;
+}
+
+static int smu_stats_mailbox_open(struct inode* inode, struct file* filp) {
+    return single_open(filp, smu_stats_mailbox_show, inode->i_private);
+}
+
+static ssize_t smu_stats_mailbox_write(struct file* filp, const char __user* buf, size_t count,
+    loff_t* ppos) {
+    struct smu_stats* stats = ((struct seq_file*)filp->private_data)->private;
+
+    // Any write clears the counters.
+    memset(stats->mailbox, 0, sizeof(stats->mailbox));
+    return count;
+}
+
+static const struct file_operations smu_stats_mailbox_fops = {
+    .owner      = THIS_MODULE,
+    .open       = smu_stats_mailbox_open,
+    .read       = seq_read,
+    .write      = smu_stats_mailbox_write,
+    .llseek     = seq_lseek,
+    .release    = single_release,
+};
+
+void smu_stats_debugfs_init(struct smu_stats* stats, struct dentry* parent) {
+    debugfs_create_file("command_latency", S_IRUSR | S_IWUSR, parent, stats, &smu_stats_fops);
+    debugfs_create_file("pm_refresh", S_IRUSR | S_IWUSR, parent, stats,
+        &smu_stats_pm_refresh_fops);
+    debugfs_create_file("mailbox", S_IRUSR | S_IWUSR, parent, stats, &smu_stats_mailbox_fops);
+}
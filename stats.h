@@ -0,0 +1,116 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com> */
+/* Ryzen SMU Command Statistics */
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <linux/debugfs.h>
+
+#include "smu.h"
+
+/* Commands with an ID at or above this value share a single statistics entry. */
+#define SMU_STATS_MAX_OPS                             0x80
+
+/**
+ * Number of latency histogram buckets. Bucket 0 counts commands completing in under 1 us, bucket N
+ *  those completing in [2^(N-1), 2^N) us and the last bucket everything slower.
+ */
+#define SMU_STATS_HIST_BUCKETS                        24
+
+/**
+ * Statistics gathered for each command ID of each mailbox.
+ */
+struct smu_cmd_stats {
+    u64 count;
+    // Commands the SMU responded to with anything other than SMU_Return_OK.
+    u64 failed;
+    u64 timeouts;
+
+    // Time from issuing the command to the SMU responding, excluding timeouts.
+    u64 total_ns;
+    u64 max_ns;
+    // Exponentially weighted moving average of successful completion times, which the driver uses
+    //  to decide how long to spin before sleeping when waiting for a response.
+    u64 ewma_ns;
+
+    // RSP register reads & sleeps performed while waiting on the mailbox.
+    u64 polls;
+    u64 sleeps;
+
+    u32 hist[SMU_STATS_HIST_BUCKETS];
+};
+
+/**
+ * Totals of every transaction with one mailbox, whatever the command.
+ */
+struct smu_mailbox_stats {
+    u64 calls;
+    // Commands the SMU never responded to.
+    u64 timeouts;
+    // Commands not issued as the SMU was still processing a previous one.
+    u64 busy;
+    u64 pci_failures;
+
+    // Time spent waiting on other commands holding the mailbox lock, for the mailbox to become
+    //  available & for the SMU to respond, together being everything callers waited for.
+    u64 lock_wait_ns;
+    u64 busy_wait_ns;
+    u64 response_wait_ns;
+};
+
+/**
+ * PM table reads performed under a refresh policy.
+ */
+struct smu_pm_refresh_stats {
+    // Reads which caused the SMU to transfer a new table.
+    u64 issued;
+    // Reads served from the previously transferred table instead.
+    u64 cached;
+};
+
+/**
+ * Allocates zeroed statistics for every command of every mailbox of one SMU.
+ *
+ * Returns NULL on failure.
+ */
+struct smu_stats* smu_stats_alloc(void);
+void smu_stats_free(struct smu_stats* stats);
+
+/**
+ * Returns the statistics entry of command [op] sent to mailbox [mb].
+ *
+ * Callers must hold the lock serializing commands to the mailbox.
+ */
+struct smu_cmd_stats* smu_stats_get(struct smu_stats* stats, enum smu_mailbox mb, u32 op);
+
+/**
+ * Accounts a command which took [ns] nanoseconds to complete with result [ret].
+ */
+void smu_stats_record(struct smu_cmd_stats* st, u64 ns, u32 polls, u32 sleeps,
+    enum smu_return_val ret);
+
+/**
+ * Returns the totals of mailbox [mb], with the same locking requirements as smu_stats_get().
+ */
+struct smu_mailbox_stats* smu_stats_get_mailbox(struct smu_stats* stats, enum smu_mailbox mb);
+
+/**
+ * Accounts a transaction with result [ret], [busy] indicating it timed out before being issued.
+ */
+void smu_stats_record_mailbox(struct smu_mailbox_stats* st, u64 lock_ns, u64 busy_ns,
+    u64 response_ns, int busy, enum smu_return_val ret);
+
+/**
+ * Accounts a PM table read under [policy], [cached] indicating no transfer was issued.
+ *
+ * Callers must hold the lock serializing PM table accesses.
+ */
+void smu_stats_pm_refresh(struct smu_stats* stats, enum smu_pm_refresh_policy policy, int cached);
+
+/**
+ * Creates the files exposing [stats] under the debugfs directory [parent].
+ */
+void smu_stats_debugfs_init(struct smu_stats* stats, struct dentry* parent);
+
+#endif /* __STATS_H__ */
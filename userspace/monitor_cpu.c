@@ -20,7 +20,9 @@
 
 #include <math.h>
 #include <sched.h>
+#include <time.h>
 #include <ctype.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <cpuid.h>
 #include <stdio.h>
@@ -35,257 +37,68 @@
 #include <libsmu.h>
 
 #define PROGRAM_VERSION                 "1.0"
-#define PM_TABLE_SUPPORTED_VERSION      0x240903
 
-#define READ_SMN_V1(offs) { if (smu_read_smn_addr(&obj, offs + offset, &value1) != SMU_Return_OK) goto _READ_ERROR; }
-#define READ_SMN_V2(offs) { if (smu_read_smn_addr(&obj, offs + offset, &value2) != SMU_Return_OK) goto _READ_ERROR; }
+// Layout assumed when forcing an unknown PM table version to be displayed.
+#define PM_TABLE_FALLBACK_CODENAME      CODENAME_MATISSE
+#define PM_TABLE_FALLBACK_VERSION       0x240903
 
-// Ryzen 3700X/3800X
-typedef struct {
-    float PPT_LIMIT;
-    float PPT_VALUE;
-    float TDC_LIMIT;
-    float TDC_VALUE;
-    float THM_LIMIT;
-    float THM_VALUE;
-    float FIT_LIMIT;
-    float FIT_VALUE;
-    float EDC_LIMIT;
-    float EDC_VALUE;
-    float VID_LIMIT;
-    float VID_VALUE;
-    float PPT_WC;
-    float PPT_ACTUAL;
-    float TDC_WC;
-    float TDC_ACTUAL;
-    float THM_WC;
-    float THM_ACTUAL;
-    float FIT_WC;
-    float FIT_ACTUAL;
-    float EDC_WC;
-    float EDC_ACTUAL;
-    float VID_WC;
-    float VID_ACTUAL;
-    float VDDCR_CPU_POWER;
-    float VDDCR_SOC_POWER;
-    float VDDIO_MEM_POWER;
-    float VDD18_POWER;
-    float ROC_POWER;
-    float SOCKET_POWER;
-    float PPT_FREQUENCY;
-    float TDC_FREQUENCY;
-    float THM_FREQUENCY;
-    float PROCHOT_FREQUENCY;
-    float VOLTAGE_FREQUENCY;
-    float CCA_FREQUENCY;
-    float FIT_VOLTAGE;
-    float FIT_PRE_VOLTAGE;
-    float LATCHUP_VOLTAGE;
-    float CPU_SET_VOLTAGE;
-    float CPU_TELEMETRY_VOLTAGE;
-    float CPU_TELEMETRY_CURRENT;
-    float CPU_TELEMETRY_POWER;
-    float CPU_TELEMETRY_POWER_ALT;
-    float SOC_SET_VOLTAGE;
-    float SOC_TELEMETRY_VOLTAGE;
-    float SOC_TELEMETRY_CURRENT;
-    float SOC_TELEMETRY_POWER;
-    float FCLK_FREQ;
-    float FCLK_FREQ_EFF;
-    float UCLK_FREQ;
-    float MEMCLK_FREQ;
-    float FCLK_DRAM_SETPOINT;
-    float FCLK_DRAM_BUSY;
-    float FCLK_GMI_SETPOINT;
-    float FCLK_GMI_BUSY;
-    float FCLK_IOHC_SETPOINT;
-    float FCLK_IOHC_BUSY;
-    float FCLK_XGMI_SETPOINT;
-    float FCLK_XGMI_BUSY;
-    float CCM_READS;
-    float CCM_WRITES;
-    float IOMS;
-    float XGMI;
-    float CS_UMC_READS;
-    float CS_UMC_WRITES;
-    float FCLK_RESIDENCY[4];
-    float FCLK_FREQ_TABLE[4];
-    float UCLK_FREQ_TABLE[4];
-    float MEMCLK_FREQ_TABLE[4];
-    float FCLK_VOLTAGE[4];
-    float LCLK_SETPOINT_0;
-    float LCLK_BUSY_0;
-    float LCLK_FREQ_0;
-    float LCLK_FREQ_EFF_0;
-    float LCLK_MAX_DPM_0;
-    float LCLK_MIN_DPM_0;
-    float LCLK_SETPOINT_1;
-    float LCLK_BUSY_1;
-    float LCLK_FREQ_1;
-    float LCLK_FREQ_EFF_1;
-    float LCLK_MAX_DPM_1;
-    float LCLK_MIN_DPM_1;
-    float LCLK_SETPOINT_2;
-    float LCLK_BUSY_2;
-    float LCLK_FREQ_2;
-    float LCLK_FREQ_EFF_2;
-    float LCLK_MAX_DPM_2;
-    float LCLK_MIN_DPM_2;
-    float LCLK_SETPOINT_3;
-    float LCLK_BUSY_3;
-    float LCLK_FREQ_3;
-    float LCLK_FREQ_EFF_3;
-    float LCLK_MAX_DPM_3;
-    float LCLK_MIN_DPM_3;
-    float XGMI_SETPOINT;
-    float XGMI_BUSY;
-    float XGMI_LANE_WIDTH;
-    float XGMI_DATA_RATE;
-    float SOC_POWER;
-    float SOC_TEMP;
-    float DDR_VDDP_POWER;
-    float DDR_VDDIO_MEM_POWER;
-    float GMI2_VDDG_POWER;
-    float IO_VDDCR_SOC_POWER;
-    float IOD_VDDIO_MEM_POWER;
-    float IO_VDD18_POWER;
-    float TDP;
-    float DETERMINISM;
-    float V_VDDM;
-    float V_VDDP;
-    float V_VDDG;
-    float PEAK_TEMP;
-    float PEAK_VOLTAGE;
-    float AVG_CORE_COUNT;
-    float CCLK_LIMIT;
-    float MAX_VOLTAGE;
-    float DC_BTC;
-    float CSTATE_BOOST;
-    float PROCHOT;
-    float PC6;
-    float PWM;
-    float SOCCLK;
-    float SHUBCLK;
-    float MP0CLK;
-    float MP1CLK;
-    float MP5CLK;
-    float SMNCLK;
-    float TWIXCLK;
-    float WAFLCLK;
-    float DPM_BUSY;
-    float MP1_BUSY;
-    float CORE_POWER[8];
-    float CORE_VOLTAGE[8];
-    float CORE_TEMP[8];
-    float CORE_FIT[8];
-    float CORE_IDDMAX[8];
-    float CORE_FREQ[8];
-    float CORE_FREQEFF[8];
-    float CORE_C0[8];
-    float CORE_CC1[8];
-    float CORE_CC6[8];
-    float CORE_CKS_FDD[8];
-    float CORE_CI_FDD[8];
-    float CORE_IRM[8];
-    float CORE_PSTATE[8];
-    float CORE_CPPC_MAX[8];
-    float CORE_CPPC_MIN[8];
-    float CORE_SC_LIMIT[8];
-    float CORE_SC_CAC[8];
-    float CORE_SC_RESIDENCY[8];
-    float L3_LOGIC_POWER[2];
-    float L3_VDDM_POWER[2];
-    float L3_TEMP[2];
-    float L3_FIT[2];
-    float L3_IDDMAX[2];
-    float L3_FREQ[2];
-    float L3_CKS_FDD[2];
-    float L3_CCA_THRESHOLD[2];
-    float L3_CCA_CAC[2];
-    float L3_CCA_ACTIVATION[2];
-    float L3_EDC_LIMIT[2];
-    float L3_EDC_CAC[2];
-    float L3_EDC_RESIDENCY[2];
-    float MP5_BUSY[1];
-} pm_table_0x240903, *ppm_table_0x240903;
+// Fields of the PM table being monitored, see start_pm_monitor().
+#define PMV(field)                      smu_pm_get_f32(schema, pm_buf, PM_FIELD_##field, 0)
+#define PMA(field, i)                   smu_pm_get_f32(schema, pm_buf, PM_FIELD_##field, i)
+
+// Lines & columns of the largest frame drawn by start_pm_monitor().
+#define FRAME_MAX_LINES                 256
+#define FRAME_LINE_LEN                  512
+
+typedef enum {
+    OUTPUT_TERMINAL,
+    OUTPUT_CSV,
+    OUTPUT_JSON,
+} output_format_t;
 
 static smu_obj_t obj;
-static int update_time_s = 1;
+static unsigned int update_interval_ms = 1000;
+static output_format_t output_format = OUTPUT_TERMINAL;
 
 void print_memory_timings() {
     const char* bool_str[2] = { "Disabled", "Enabled" };
-    unsigned int value1, value2, offset;
-
-    READ_SMN_V1(0x50200);
-    offset = value1 == 0x300 ? 0x100000 : 0;
-
-    READ_SMN_V1(0x50050); READ_SMN_V2(0x50058);
-    fprintf(stdout, "BankGroupSwap: %s\n",
-        bool_str[!(value1 == value2 && value1 == 0x87654321)]);
-
-    READ_SMN_V1(0x500D0); READ_SMN_V2(0x500D4);
-    fprintf(stdout, "BankGroupSwapAlt: %s\n",
-        bool_str[(value1 >> 4 & 0x7F) != 0 || (value2 >> 4 & 0x7F) != 0]);
-
-    READ_SMN_V1(0x50200); READ_SMN_V2(0x50204);
-    fprintf(stdout, "Memory Clock: %.0f MHz\nGDM: %s\nCR: %s\nTcl: %d\nTras: %d\nTrcdrd: %d\nTrcdwr: %d\n",
-        (value1 & 0x7f) / 3.f * 100.f,
-        bool_str[((value1 >> 11) & 1) == 1],
-        ((value1 & 0x400) >> 10) != 0 ? "2T" : "1T",
-        value2 & 0x3f,
-        value2 >> 8 & 0x7f,
-        value2 >> 16 & 0x3f,
-        value2 >> 24 & 0x3f);
-
-    READ_SMN_V1(0x50208); READ_SMN_V2(0x5020C);
+    smu_dram_timings_t t;
+    unsigned int ch;
+
+    // Timings are shown for the first populated channel.
+    for (ch = 0; ch < SMU_UMC_CHANNELS; ch++) {
+        if (smu_get_dram_timings(&obj, ch, &t) != SMU_Return_OK) {
+            fprintf(stderr, "Unable to read SMN address space.");
+            exit(1);
+        }
+
+        if (t.populated)
+            break;
+    }
+
+    fprintf(stdout, "BankGroupSwap: %s\n", bool_str[t.bgs]);
+    fprintf(stdout, "BankGroupSwapAlt: %s\n", bool_str[t.bgs_alt]);
+
+    fprintf(stdout, "Memory Clock: %.0f MHz\nGDM: %s\nCR: %dT\nTcl: %d\nTras: %d\nTrcdrd: %d\nTrcdwr: %d\n",
+        t.mem_clock_mhz, bool_str[t.gdm], t.cmd_rate, t.tcl, t.tras, t.trcdrd, t.trcdwr);
+
     fprintf(stdout, "Trc: %d\nTrp: %d\nTrrds: %d\nTrrdl: %d\nTrtp: %d\n",
-        value1 & 0xff,
-        value1 >> 16 & 0x3f,
-        value2 & 0x1f,
-        value2 >> 8 & 0x1f,
-        value2 >> 24 & 0x1f);
+        t.trc, t.trp, t.trrds, t.trrdl, t.trtp);
 
-    READ_SMN_V1(0x50210); READ_SMN_V2(0x50214);
     fprintf(stdout, "Tfaw: %d\nTcwl: %d\nTwtrs: %d\nTwtrl: %d\n",
-        value1 & 0xff,
-        value2 & 0x3f,
-        value2 >> 8 & 0x1f,
-        value2 >> 16 & 0x3f);
+        t.tfaw, t.tcwl, t.twtrs, t.twtrl);
 
-    READ_SMN_V1(0x50218); READ_SMN_V2(0x50220);
     fprintf(stdout, "Twr: %d\nTrdrddd: %d\nTrdrdsd: %d\nTrdrdsc: %d\nTrdrdscl: %d\n",
-        value1 & 0xff,
-        value2 & 0xf,
-        value2 >> 8 & 0xf,
-        value2 >> 16 & 0xf,
-        value2 >> 24 & 0x3f);
+        t.twr, t.trdrddd, t.trdrdsd, t.trdrdsc, t.trdrdscl);
 
-    READ_SMN_V1(0x50224); READ_SMN_V2(0x50228);
     fprintf(stdout, "Twrwrdd: %d\nTwrwrsd: %d\nTwrwrsc: %d\nTwrwrscl: %d\nTwrrd: %d\nTrdwr: %d\n",
-        value1 & 0xf,
-        value1 >> 8 & 0xf,
-        value1 >> 16 & 0xf,
-        value1 >> 24 & 0x3f,
-        value2 & 0xf,
-        value2 >> 8 & 0x1f);
-
-    READ_SMN_V1(0x50254);
-    fprintf(stdout, "Tcke: %d\n", value1 >> 24 & 0x1f);
+        t.twrwrdd, t.twrwrsd, t.twrwrsc, t.twrwrscl, t.twrrd, t.trdwr);
 
-    READ_SMN_V1(0x50260); READ_SMN_V2(0x50264);
-    if (value1 != value2 && value1 == 0x21060138)
-        value1 = value2;
+    fprintf(stdout, "Tcke: %d\n", t.tcke);
 
-    fprintf(stdout, "Trfc: %d\nTrfc2: %d\nTrfc4: %d\n",
-        value1 & 0x3ff,
-        value1 >> 11 & 0x3ff,
-        value1 >> 22 & 0x3ff);
+    fprintf(stdout, "Trfc: %d\nTrfc2: %d\nTrfc4: %d\n", t.trfc, t.trfc2, t.trfc4);
 
     exit(0);
-
-_READ_ERROR:
-    fprintf(stderr, "Unable to read SMN address space.");
-    exit(1);
 }
 
 void append_u32_to_str(char* buffer, unsigned int val) {
@@ -339,65 +152,30 @@ unsigned int count_set_bits(unsigned int v) {
     return result;
 }
 
-void get_fuse_topology(int fam, int model, unsigned int* ccds_enabled, unsigned int* ccds_disabled,
-    unsigned int* cores_disabled, unsigned int* smt_enabled) {
-    unsigned int ccds_down, ccds_present, core_fuse, core_fuse_addr, ccd_fuse1, ccd_fuse2;
-
-    ccd_fuse1 = 0x5D218;
-    ccd_fuse2 = 0x5D21C;
-
-    if (fam == 0x17 && model != 0x71) {
-        ccd_fuse1 += 0x40;
-        ccd_fuse2 += 0x40;
-    }
-
-    if (smu_read_smn_addr(&obj, ccd_fuse1, &ccds_present) != SMU_Return_OK ||
-        smu_read_smn_addr(&obj, ccd_fuse2, &ccds_down) != SMU_Return_OK) {
-        perror("Failed to read CCD fuses");
-        exit(-1);
-    }
-
-    *ccds_disabled = ((ccds_down & 0x3F) << 2) | ((ccds_present >> 30) & 0x3);
-
-    ccds_present = (ccds_present >> 22) & 0xFF;
-    *ccds_enabled = ccds_present;
-
-    if (fam == 0x19)
-        core_fuse_addr = (0x30081800 + 0x598) |
-            ((((*ccds_disabled & ccds_present) & 1) == 1) ? 0x2000000 : 0);
-    else
-        core_fuse_addr = (0x30081800 + 0x238) | (((ccds_present & 1) == 0) ? 0x2000000 : 0);
-
-    if (smu_read_smn_addr(&obj, core_fuse_addr, &core_fuse) != SMU_Return_OK) {
-        perror("Failed to read core fuse");
-        exit(-1);
-    }
-
-    *cores_disabled = core_fuse & 0xFF;
-    *smt_enabled = (core_fuse & (1 << 8)) != 0;
-}
-
 void get_processor_topology(unsigned int* ccds, unsigned int *ccxs,
     unsigned int *cores_per_ccx, unsigned int* cores) {
-    unsigned int  ccds_enabled, ccds_disabled, core_disable_map, logical_cores,
-        smt, fam, model, eax, ebx, ecx, edx;
+    unsigned int logical_cores, smt, fam, eax, ebx, ecx, edx;
+    smu_fuse_topology_t topology;
 
     __get_cpuid(0x00000001, &eax, &ebx, &ecx, &edx);
     fam = ((eax & 0xf00) >> 8) + ((eax & 0xff00000) >> 20);
-    model = ((eax & 0xf0000) >> 12) + ((eax & 0xf0) >> 4);
     logical_cores = (ebx >> 16) & 0xFF;
 
-    get_fuse_topology(fam, model, &ccds_enabled, &ccds_disabled, &core_disable_map, &smt);
+    if (smu_get_fuse_topology(&obj, &topology) != SMU_Return_OK) {
+        fprintf(stderr, "Failed to read the CCD & core fuses.\n");
+        exit(-1);
+    }
 
-    *ccds = count_set_bits(ccds_enabled);
+    smt = topology.smt_enabled;
+    *ccds = count_set_bits(topology.ccds_enabled);
 
     if (fam == 0x19) {
         *ccxs = *ccds;
-        *cores_per_ccx = 8 - count_set_bits(core_disable_map);
+        *cores_per_ccx = 8 - count_set_bits(topology.cores_disabled);
     }
     else {
         *ccxs = *ccds * 2;
-        *cores_per_ccx = (8 - count_set_bits(core_disable_map)) / 2;
+        *cores_per_ccx = (8 - count_set_bits(topology.cores_disabled)) / 2;
     }
 
     *cores = logical_cores;
@@ -405,26 +183,49 @@ void get_processor_topology(unsigned int* ccds, unsigned int *ccxs,
         *cores /= 2;
 }
 
+/**
+ * Every frame is rendered into memory line by line & compared with the previous one, so that only
+ *  the lines which changed are rewritten on the terminal, with a single write per frame.
+ */
+typedef struct {
+    char lines[FRAME_MAX_LINES][FRAME_LINE_LEN];
+    unsigned int count;
+} frame_t;
+
+static frame_t frames[2];
+static frame_t* frame = &frames[0];
+static frame_t* prev_frame = &frames[1];
+static char frame_out[FRAME_MAX_LINES * (FRAME_LINE_LEN + 16)];
+
+void frame_puts(const char* line) {
+    if (frame->count == FRAME_MAX_LINES)
+        return;
+
+    snprintf(frame->lines[frame->count++], FRAME_LINE_LEN, "%s", line);
+}
+
 void print_line(const char* label, const char* value_format, ...) {
-    static char buffer[1024];
+    static char buffer[1024], line[FRAME_LINE_LEN];
     va_list list;
 
     va_start(list, value_format);
     vsnprintf(buffer, sizeof(buffer), value_format, list);
     va_end(list);
 
-    fprintf(stdout, "│ %46s │ %47s │\n", label, buffer);
+    snprintf(line, sizeof(line), "│ %46s │ %47s │", label, buffer);
+    frame_puts(line);
 }
 
 void _print_core_line(const char* label, const char* value_format, ...) {
-    static char buffer[1024];
+    static char buffer[1024], line[FRAME_LINE_LEN];
     va_list list;
 
     va_start(list, value_format);
     vsnprintf(buffer, sizeof(buffer), value_format, list);
     va_end(list);
 
-    fprintf(stdout, "│ %7s │ %86s │\n", label, buffer);
+    snprintf(line, sizeof(line), "│ %7s │ %86s │", label, buffer);
+    frame_puts(line);
 }
 
 #define core_print_line(core, value, ...) { \
@@ -434,11 +235,55 @@ void _print_core_line(const char* label, const char* value_format, ...) {
     _print_core_line(buffer, value, __VA_ARGS__); \
 }
 
+void write_all(const char* buf, size_t len) {
+    ssize_t ret;
+
+    while (len) {
+        ret = write(STDOUT_FILENO, buf, len);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+
+            return;
+        }
+
+        buf += ret;
+        len -= ret;
+    }
+}
+
+void flush_frame() {
+    frame_t* tmp;
+    size_t len = 0;
+    unsigned int i;
+    int full;
+
+    // The whole screen is redrawn the first time & whenever the layout changes.
+    full = frame->count != prev_frame->count;
+    if (full)
+        len += sprintf(frame_out + len, "\e[1;1H\e[2J\e[?25l");
+
+    for (i = 0; i < frame->count; i++) {
+        if (!full && !strcmp(frame->lines[i], prev_frame->lines[i]))
+            continue;
+
+        len += sprintf(frame_out + len, "\e[%u;1H%s\e[K", i + 1, frame->lines[i]);
+    }
+
+    if (len)
+        write_all(frame_out, len);
+
+    tmp = prev_frame;
+    prev_frame = frame;
+    frame = tmp;
+    frame->count = 0;
+}
+
 unsigned int get_max_cpu_freq(smu_obj_t* obj) {
     smu_arg_t args;
     smu_return_val err;
 
-    if (obj->codename != CODENAME_MATISSE)
+    if (SMU_CODENAME(obj) != CODENAME_MATISSE)
         return 0;
 
     memset(&args, 0, sizeof(args));
@@ -454,7 +299,7 @@ const char* get_pbo_scalar(smu_obj_t* obj) {
     smu_arg_t args;
     smu_return_val err;
 
-    if (obj->codename != CODENAME_MATISSE && obj->codename != CODENAME_VERMEER)
+    if (SMU_CODENAME(obj) != CODENAME_MATISSE && SMU_CODENAME(obj) != CODENAME_VERMEER)
         return 0;
 
     memset(&args, 0, sizeof(args));
@@ -465,13 +310,70 @@ const char* get_pbo_scalar(smu_obj_t* obj) {
     return buf;
 }
 
+void print_headless_header(unsigned int count) {
+    unsigned int i;
+
+    if (output_format != OUTPUT_CSV)
+        return;
+
+    fprintf(stdout, "time_ms,package_power_w,core_power_w,soc_power_w,peak_freq_mhz,peak_temp_c,"
+        "temp_c,avg_core_voltage_v,ppt_w,tdc_a,edc_a,fclk_mhz,package_c6");
+
+    for (i = 0; i < count; i++)
+        fprintf(stdout, ",core%u_freq_mhz,core%u_power_w,core%u_c0", i, i, i);
+
+    fprintf(stdout, "\n");
+    fflush(stdout);
+}
+
+/**
+ * Emits one CSV or JSON line per sample, [time_ms] being the time since monitoring started.
+ */
+void print_headless_sample(const smu_pm_schema_t* schema, const unsigned char* pm_buf,
+    const smu_core_metrics_t* metrics, float edc_value, double time_ms) {
+    unsigned int i;
+
+    if (output_format == OUTPUT_CSV) {
+        fprintf(stdout, "%.3f,%.4f,%.4f,%.4f,%.0f,%.2f,%.2f,%.6f,%.4f,%.4f,%.4f,%.0f,%.4f", time_ms,
+            PMV(SOCKET_POWER), PMV(VDDCR_CPU_POWER), PMV(SOC_TELEMETRY_POWER),
+            metrics->peak_frequency, PMV(PEAK_TEMP), PMV(THM_VALUE),
+            metrics->total_voltage / metrics->count, PMV(PPT_VALUE), PMV(TDC_VALUE), edc_value,
+            PMV(FCLK_FREQ_EFF), PMV(PC6));
+
+        for (i = 0; i < metrics->count; i++)
+            fprintf(stdout, ",%.0f,%.4f,%.2f", metrics->frequency[i], metrics->power[i],
+                metrics->c0[i]);
+    }
+    else {
+        fprintf(stdout, "{\"time_ms\":%.3f,\"package_power_w\":%.4f,\"core_power_w\":%.4f,"
+            "\"soc_power_w\":%.4f,\"peak_freq_mhz\":%.0f,\"peak_temp_c\":%.2f,\"temp_c\":%.2f,"
+            "\"avg_core_voltage_v\":%.6f,\"ppt_w\":%.4f,\"tdc_a\":%.4f,\"edc_a\":%.4f,"
+            "\"fclk_mhz\":%.0f,\"package_c6\":%.4f,\"cores\":[", time_ms,
+            PMV(SOCKET_POWER), PMV(VDDCR_CPU_POWER), PMV(SOC_TELEMETRY_POWER),
+            metrics->peak_frequency, PMV(PEAK_TEMP), PMV(THM_VALUE),
+            metrics->total_voltage / metrics->count, PMV(PPT_VALUE), PMV(TDC_VALUE), edc_value,
+            PMV(FCLK_FREQ_EFF), PMV(PC6));
+
+        for (i = 0; i < metrics->count; i++)
+            fprintf(stdout, "%s{\"freq_mhz\":%.0f,\"power_w\":%.4f,\"c0\":%.2f}", i ? "," : "",
+                metrics->frequency[i], metrics->power[i], metrics->c0[i]);
+
+        fprintf(stdout, "]}");
+    }
+
+    // Only ever a single write per sample, so consumers never see partial lines.
+    fprintf(stdout, "\n");
+    fflush(stdout);
+}
+
 void start_pm_monitor(int force) {
-    float total_usage, peak_core_frequency, core_voltage, core_frequency, total_core_voltage,
-        average_voltage, package_sleep_time, core_sleep_time, edc_value, total_core_C6;
+    float average_voltage, edc_value;
+    smu_core_metrics_t metrics;
 
     const char* name, *codename, *smu_fw_ver, *scalar;
     unsigned int cores, ccds, ccxs, cores_per_ccx, max_freq, if_ver, i;
-    ppm_table_0x240903 pmt;
+    const smu_pm_schema_t* schema;
+    unsigned long long start, next;
     unsigned char *pm_buf;
 
     if (!smu_pm_tables_supported(&obj)) {
@@ -479,9 +381,15 @@ void start_pm_monitor(int force) {
         exit(0);
     }
 
-    if (!force && obj.pm_table_version != PM_TABLE_SUPPORTED_VERSION) {
-        fprintf(stderr, "PM Table version is not currently suppported. Run with \"-f\" flag to ignore this.\n");
-        exit(0);
+    schema = smu_get_pm_schema(&obj);
+
+    if (!schema) {
+        if (!force) {
+            fprintf(stderr, "PM Table version is not currently suppported. Run with \"-f\" flag to ignore this.\n");
+            exit(0);
+        }
+
+        schema = smu_find_pm_schema(PM_TABLE_FALLBACK_CODENAME, PM_TABLE_FALLBACK_VERSION);
     }
 
     name        = get_processor_name();
@@ -492,8 +400,16 @@ void start_pm_monitor(int force) {
 
     get_processor_topology(&ccds, &ccxs, &cores_per_ccx, &cores);
 
-    pm_buf = calloc(obj.pm_table_size, sizeof(unsigned char));
-    pmt = (ppm_table_0x240903)pm_buf;
+    // A forced layout may extend past the end of the table, those fields simply read as zero.
+    pm_buf = calloc(obj.pm_table_size > schema->size ? obj.pm_table_size : schema->size,
+        sizeof(unsigned char));
+
+    // Tables hold as many per-core entries as the largest part sharing the layout.
+    if (smu_core_metrics_init(&metrics, cores < SMU_PM_FIELD(schema, PM_FIELD_CORE_C0)->count ?
+        cores : SMU_PM_FIELD(schema, PM_FIELD_CORE_C0)->count) != SMU_Return_OK) {
+        fprintf(stderr, "PM Table does not report any per-core metrics.\n");
+        exit(0);
+    }
 
     switch (obj.smu_if_version) {
         case IF_VERSION_9:
@@ -516,13 +432,36 @@ void start_pm_monitor(int force) {
             break;
     }
 
-    while(1) {
+    start = next = smu_now_ns();
+
+    // Large enough to hold any line in full, so each is emitted by a single write.
+    if (output_format != OUTPUT_TERMINAL)
+        setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+
+    print_headless_header(metrics.capacity);
+
+    // Falling behind, because the system is loaded or the terminal blocks, skips samples.
+    for (;; smu_wait_deadline(&next, update_interval_ms * 1000000ULL)) {
         if (smu_read_pm_table(&obj, pm_buf, obj.pm_table_size) != SMU_Return_OK)
             continue;
 
-        fprintf(stdout, "\e[1;1H\e[2J");
+        if (smu_decode_core_metrics(schema, pm_buf, metrics.capacity, &metrics) != SMU_Return_OK) {
+            fprintf(stderr, "PM Table does not report the metrics of every core.\n");
+            exit(0);
+        }
+
+        edc_value = PMV(EDC_VALUE) * (metrics.total_c0 / metrics.count / 100);
 
-        fprintf(stdout, "╭────────────────────────────────────────────────┬─────────────────────────────────────────────────╮\n");
+        if (edc_value < PMV(TDC_VALUE))
+            edc_value = PMV(TDC_VALUE);
+
+        if (output_format != OUTPUT_TERMINAL) {
+            print_headless_sample(schema, pm_buf, &metrics, edc_value,
+                (smu_now_ns() - start) / 1e6);
+            continue;
+        }
+
+        frame_puts("╭────────────────────────────────────────────────┬─────────────────────────────────────────────────╮");
         print_line("CPU Model", name);
         print_line("Processor Code Name", codename);
         print_line("Core Configuration", "%d (%d-%d-%d)", cores, ccds, ccxs, cores_per_ccx);
@@ -531,102 +470,71 @@ void start_pm_monitor(int force) {
         print_line("Overdrive Scalar", scalar);
         print_line("SMU FW Version", "v%s", smu_fw_ver);
         print_line("MP1 IF Version", "v%d", if_ver);
-        fprintf(stdout, "╰────────────────────────────────────────────────┴─────────────────────────────────────────────────╯\n");
-
-        total_core_C6 = total_usage = total_core_voltage = peak_core_frequency = 0;
-
-        package_sleep_time = pmt->PC6 / 100.f;
-        average_voltage = (pmt->CPU_TELEMETRY_VOLTAGE - (0.2 * package_sleep_time)) /
-            (1.0 - package_sleep_time);
-
-        fprintf(stdout, "╭─────────┬────────────────┬─────────┬─────────┬─────────┬─────────────┬─────────────┬─────────────╮\n");
-        for (i = 0; i < cores; i++) {
-            core_frequency = pmt->CORE_FREQEFF[i] * 1000.f;
-
-            if (peak_core_frequency < core_frequency)
-                peak_core_frequency = core_frequency;
-
-            total_usage += pmt->CORE_C0[i];
-            total_core_C6 += pmt->CORE_CC6[i];
-
-            // "Real core frequency" -- excluding gating
-            if (pmt->CORE_FREQ[i] != 0.f) {
-                core_sleep_time = pmt->CORE_CC6[i] / 100.f;
-                core_voltage = ((1.0 - core_sleep_time) * average_voltage) + (0.2 * core_sleep_time);
-                total_core_voltage += core_voltage;
-            }
+        frame_puts("╰────────────────────────────────────────────────┴─────────────────────────────────────────────────╯");
 
+        frame_puts("╭─────────┬────────────────┬─────────┬─────────┬─────────┬─────────────┬─────────────┬─────────────╮");
+        for (i = 0; i < metrics.count; i++) {
             // AMD denotes a sleeping core as having spent less than 6% of the time in C0.
             // Source: Ryzen Master
-            if (pmt->CORE_C0[i] >= 6.f) {
+            if (metrics.active[i / 64] & (1ULL << (i % 64))) {
                 core_print_line(i,
                     "%4.f MHz | %4.3f W | %1.3f V | %5.2f C | C0: %5.1f %% | C1: %5.1f %% | C6: %5.1f %%",
-                    core_frequency, pmt->CORE_POWER[i], core_voltage, pmt->CORE_TEMP[i],
-                    pmt->CORE_C0[i], pmt->CORE_CC1[i], pmt->CORE_CC6[i]);
+                    metrics.frequency[i], metrics.power[i], metrics.voltage[i],
+                    metrics.temperature[i], metrics.c0[i], metrics.c1[i], metrics.c6[i]);
             }
             else
                 core_print_line(i,
                     "Sleeping | %4.3f W | %1.3f V | %5.2f C | C0: %5.1f %% | C1: %5.1f %% | C6: %5.1f %%",
-                    pmt->CORE_POWER[i], core_voltage, pmt->CORE_TEMP[i], pmt->CORE_C0[i],
-                    pmt->CORE_CC1[i], pmt->CORE_CC6[i]);
+                    metrics.power[i], metrics.voltage[i], metrics.temperature[i], metrics.c0[i],
+                    metrics.c1[i], metrics.c6[i]);
         }
-        fprintf(stdout, "╰─────────┴────────────────┴─────────┴─────────┴─────────┴─────────────┴─────────────┴─────────────╯\n");
-
-        fprintf(stdout, "╭────────────────────────────────────────────────┬─────────────────────────────────────────────────╮\n");
-        average_voltage = total_core_voltage / cores;
-        edc_value = pmt->EDC_VALUE * (total_usage / cores / 100);
+        frame_puts("╰─────────┴────────────────┴─────────┴─────────┴─────────┴─────────────┴─────────────┴─────────────╯");
 
-        if (edc_value < pmt->TDC_VALUE)
-            edc_value = pmt->TDC_VALUE;
+        frame_puts("╭────────────────────────────────────────────────┬─────────────────────────────────────────────────╮");
+        average_voltage = metrics.total_voltage / metrics.count;
 
-        total_core_C6 /= cores;
-
-        print_line("Peak Core Frequency", "%8.0f MHz", peak_core_frequency);
-        print_line("Peak Temperature", "%8.2f C", pmt->PEAK_TEMP);
-        print_line("Package Power", "%8.4f W", pmt->SOCKET_POWER);
-        print_line("Peak Core(s) Voltage", "%2.6f V", pmt->CPU_TELEMETRY_VOLTAGE);
+        print_line("Peak Core Frequency", "%8.0f MHz", metrics.peak_frequency);
+        print_line("Peak Temperature", "%8.2f C", PMV(PEAK_TEMP));
+        print_line("Package Power", "%8.4f W", PMV(SOCKET_POWER));
+        print_line("Peak Core(s) Voltage", "%2.6f V", PMV(CPU_TELEMETRY_VOLTAGE));
         print_line("Average Core Voltage", "%2.6f V", average_voltage);
-        print_line("Package C6 Residency", "%3.6f %%", pmt->PC6);
-        print_line("Core C6 Residency", "%3.6f %%", total_core_C6);
-        fprintf(stdout, "╰────────────────────────────────────────────────┴─────────────────────────────────────────────────╯\n");
-
-        fprintf(stdout, "╭────────────────────────────────────────────────┬─────────────────────────────────────────────────╮\n");
-        print_line("Thermal Junction Limit", "%8.2f C", pmt->THM_LIMIT);
-        print_line("Current Temperature", "%8.2f C", pmt->THM_VALUE);
-        print_line("SoC Temperature", "%8.2f C", pmt->SOC_TEMP);
-        print_line("Core Power", "%8.4f W", pmt->VDDCR_CPU_POWER);
-        print_line("SoC Power", "%4.4f W | %8.4f A | %8.6f V", pmt->SOC_TELEMETRY_POWER,
-            pmt->SOC_TELEMETRY_CURRENT, pmt->SOC_TELEMETRY_VOLTAGE);
-        print_line("PPT", "%4.4f W | %7.0f  W | %8.2f %%", pmt->PPT_VALUE, pmt->PPT_LIMIT,
-            (pmt->PPT_VALUE / pmt->PPT_LIMIT * 100));
-        print_line("TDC", "%4.4f A | %7.0f  A | %8.2f %%", pmt->TDC_VALUE, pmt->TDC_LIMIT,
-            (pmt->TDC_VALUE / pmt->TDC_LIMIT * 100));
-        print_line("EDC", "%4.4f A | %7.0f  A | %8.2f %%", edc_value, pmt->EDC_LIMIT,
-            (edc_value / pmt->EDC_LIMIT * 100));
-        print_line("Frequency Limit", "%8.0f MHz", pmt->CCLK_LIMIT * 1000.f);
-        print_line("FIT Limit", "%f %%", (pmt->FIT_VALUE / pmt->FIT_LIMIT) * 100.f);
-        fprintf(stdout, "╰────────────────────────────────────────────────┴─────────────────────────────────────────────────╯\n");
-
-        fprintf(stdout, "╭────────────────────────────────────────────────┬─────────────────────────────────────────────────╮\n");
-        print_line("Coupled Mode", "%8s", pmt->UCLK_FREQ == pmt->MEMCLK_FREQ ? "ON" : "OFF");
-        print_line("Fabric Clock (Average)", "%5.f MHz", pmt->FCLK_FREQ_EFF);
-        print_line("Fabric Clock", "%5.f MHz", pmt->FCLK_FREQ);
-        print_line("Uncore Clock", "%5.f MHz", pmt->UCLK_FREQ);
-        print_line("Memory Clock", "%5.f MHz", pmt->MEMCLK_FREQ);
-        print_line("DRAM Read Bandwidth", "%3.3f GiB/s", pmt->CS_UMC_READS);
-        print_line("DRAM Write Bandwidth", "%3.3f GiB/s", pmt->CS_UMC_WRITES);
-        print_line("VDDIO_Mem", "%7.4f W", pmt->VDDIO_MEM_POWER);
-        print_line("VDDCR_SoC", "%7.4f V", pmt->SOC_SET_VOLTAGE);
-        print_line("cLDO_VDDM", "%7.4f V", pmt->V_VDDM);
-        print_line("cLDO_VDDP", "%7.4f V", pmt->V_VDDP);
-        print_line("cLDO_VDDG", "%7.4f V", pmt->V_VDDG);
-        fprintf(stdout, "╰────────────────────────────────────────────────┴─────────────────────────────────────────────────╯\n");
-
-        // Hide Cursor
-        fprintf(stdout, "\e[?25l");
-
-        fflush(stdout);
-        sleep(update_time_s);
+        print_line("Package C6 Residency", "%3.6f %%", PMV(PC6));
+        print_line("Core C6 Residency", "%3.6f %%", metrics.total_c6 / metrics.count);
+        frame_puts("╰────────────────────────────────────────────────┴─────────────────────────────────────────────────╯");
+
+        frame_puts("╭────────────────────────────────────────────────┬─────────────────────────────────────────────────╮");
+        print_line("Thermal Junction Limit", "%8.2f C", PMV(THM_LIMIT));
+        print_line("Current Temperature", "%8.2f C", PMV(THM_VALUE));
+        print_line("SoC Temperature", "%8.2f C", PMV(SOC_TEMP));
+        print_line("Core Power", "%8.4f W", PMV(VDDCR_CPU_POWER));
+        print_line("SoC Power", "%4.4f W | %8.4f A | %8.6f V", PMV(SOC_TELEMETRY_POWER),
+            PMV(SOC_TELEMETRY_CURRENT), PMV(SOC_TELEMETRY_VOLTAGE));
+        print_line("PPT", "%4.4f W | %7.0f  W | %8.2f %%", PMV(PPT_VALUE), PMV(PPT_LIMIT),
+            (PMV(PPT_VALUE) / PMV(PPT_LIMIT) * 100));
+        print_line("TDC", "%4.4f A | %7.0f  A | %8.2f %%", PMV(TDC_VALUE), PMV(TDC_LIMIT),
+            (PMV(TDC_VALUE) / PMV(TDC_LIMIT) * 100));
+        print_line("EDC", "%4.4f A | %7.0f  A | %8.2f %%", edc_value, PMV(EDC_LIMIT),
+            (edc_value / PMV(EDC_LIMIT) * 100));
+        print_line("Frequency Limit", "%8.0f MHz", PMV(CCLK_LIMIT) * 1000.f);
+        print_line("FIT Limit", "%f %%", (PMV(FIT_VALUE) / PMV(FIT_LIMIT)) * 100.f);
+        frame_puts("╰────────────────────────────────────────────────┴─────────────────────────────────────────────────╯");
+
+        frame_puts("╭────────────────────────────────────────────────┬─────────────────────────────────────────────────╮");
+        print_line("Coupled Mode", "%8s", PMV(UCLK_FREQ) == PMV(MEMCLK_FREQ) ? "ON" : "OFF");
+        print_line("Fabric Clock (Average)", "%5.f MHz", PMV(FCLK_FREQ_EFF));
+        print_line("Fabric Clock", "%5.f MHz", PMV(FCLK_FREQ));
+        print_line("Uncore Clock", "%5.f MHz", PMV(UCLK_FREQ));
+        print_line("Memory Clock", "%5.f MHz", PMV(MEMCLK_FREQ));
+        print_line("DRAM Read Bandwidth", "%3.3f GiB/s", PMV(CS_UMC_READS));
+        print_line("DRAM Write Bandwidth", "%3.3f GiB/s", PMV(CS_UMC_WRITES));
+        print_line("VDDIO_Mem", "%7.4f W", PMV(VDDIO_MEM_POWER));
+        print_line("VDDCR_SoC", "%7.4f V", PMV(SOC_SET_VOLTAGE));
+        print_line("cLDO_VDDM", "%7.4f V", PMV(V_VDDM));
+        print_line("cLDO_VDDP", "%7.4f V", PMV(V_VDDP));
+        print_line("cLDO_VDDG", "%7.4f V", PMV(V_VDDG));
+        frame_puts("╰────────────────────────────────────────────────┴─────────────────────────────────────────────────╯");
+
+        flush_frame();
     }
 }
 
@@ -646,18 +554,21 @@ void show_help(char* program) {
             "\t-v - Show program version.\n"
             "\t-m - Print DRAM Timings and exit.\n"
             "\t-f - Force PM table monitoring even if the PM table version is not supported.\n"
-            "\t-u<seconds> - Update the monitoring only after this number of second(s) have passed. Defaults to 1.\n",
+            "\t-u<seconds> - Update the monitoring only after this number of second(s) have passed. Defaults to 1.\n"
+            "\t-i<milliseconds> - Update the monitoring every this many milliseconds instead, from 1 to 60000.\n"
+            "\t-o<csv|json> - Print one line per update in this format instead of drawing the monitor.\n",
         program
     );
 }
 
 void parse_args(int argc, char** argv) {
-    int c = 0, force, core;
+    unsigned long val;
+    int c = 0, force;
+    char* end;
 
-    core = 0;
     force = 0;
 
-    while ((c = getopt(argc, argv, "vmfuh:")) != -1) {
+    while ((c = getopt(argc, argv, "vmfhu:i:o:")) != -1) {
         switch (c) {
             case 'v':
                 print_version();
@@ -669,7 +580,26 @@ void parse_args(int argc, char** argv) {
                 force = 1;
                 break;
             case 'u':
-                // TODO
+            case 'i':
+                val = strtoul(optarg, &end, 0);
+                if (c == 'u')
+                    val *= 1000;
+
+                if (*end || val < 1 || val > 60000) {
+                    fprintf(stderr, "The update interval must be between 1 ms and 60 seconds.\n");
+                    exit(-1);
+                }
+                update_interval_ms = val;
+                break;
+            case 'o':
+                if (!strcmp(optarg, "csv"))
+                    output_format = OUTPUT_CSV;
+                else if (!strcmp(optarg, "json"))
+                    output_format = OUTPUT_JSON;
+                else {
+                    fprintf(stderr, "Unknown output format: %s\n", optarg);
+                    exit(-1);
+                }
                 break;
             case 'h':
                 show_help(argv[0]);
@@ -689,8 +619,9 @@ void signal_interrupt(int sig) {
         case SIGINT:
         case SIGABRT:
         case SIGTERM:
-            // Re-enable the cursor.
-            fprintf(stdout, "\e[?25h");
+            // Re-enable the cursor, headless output is left untouched.
+            if (output_format == OUTPUT_TERMINAL)
+                fprintf(stdout, "\e[?25h");
             exit(0);
         default:
             break;
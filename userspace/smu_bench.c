@@ -0,0 +1,398 @@
+/**
+ * Ryzen SMU Latency Benchmark
+ * Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com>
+ *
+ * This program is free software: you can redistribute it &&/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#define _GNU_SOURCE
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <libsmu.h>
+
+#define PROGRAM_VERSION                 "1.0"
+
+// Register read by default, as used by the library's own examples.
+#define DEFAULT_SMN_ADDRESS             0x50200
+
+// GetSmuVersion, which has the same ID on every mailbox & has no side effects.
+#define BENCH_SMU_OP                    0x02
+
+typedef enum {
+    CASE_SMN_READ,
+    CASE_RSMU_CMD,
+    CASE_MP1_CMD,
+    CASE_HSMP_CMD,
+    CASE_PM_TABLE_READ,
+    CASE_COUNT
+} bench_case;
+
+static const char* const case_names[CASE_COUNT] = {
+    [CASE_SMN_READ]         = "smn_read",
+    [CASE_RSMU_CMD]         = "rsmu_cmd",
+    [CASE_MP1_CMD]          = "mp1_cmd",
+    [CASE_HSMP_CMD]         = "hsmp_cmd",
+    [CASE_PM_TABLE_READ]    = "pm_table_read",
+};
+
+typedef struct {
+    bench_case                  which;
+    unsigned int                ops;
+    unsigned long long*         samples;
+    unsigned int                errors;
+    unsigned char*              pm_buf;
+} bench_thread_t;
+
+typedef struct {
+    unsigned int                threads;
+    unsigned long long          ops;
+    unsigned long long          errors;
+    double                      ops_per_sec;
+    unsigned long long          mean_ns;
+    unsigned long long          p50_ns;
+    unsigned long long          p99_ns;
+    unsigned long long          p999_ns;
+    unsigned long long          max_ns;
+} bench_result_t;
+
+static smu_obj_t obj;
+static pthread_barrier_t start_barrier;
+
+static unsigned int smn_address = DEFAULT_SMN_ADDRESS;
+static unsigned int iterations = 10000;
+static unsigned int contending_threads = 4;
+static unsigned int case_mask = (1 << CASE_COUNT) - 1;
+static int json_output;
+
+smu_return_val run_op(bench_thread_t* t) {
+    smu_arg_t args;
+
+    switch (t->which) {
+        case CASE_SMN_READ:
+            return smu_read_smn_addr(&obj, smn_address, &args.args[0]);
+        case CASE_RSMU_CMD:
+        case CASE_MP1_CMD:
+        case CASE_HSMP_CMD:
+            memset(&args, 0, sizeof(args));
+            args.args[0] = 1;
+
+            return smu_send_command(&obj, BENCH_SMU_OP, &args,
+                t->which == CASE_RSMU_CMD ? TYPE_RSMU :
+                t->which == CASE_MP1_CMD ? TYPE_MP1 : TYPE_HSMP);
+        case CASE_PM_TABLE_READ:
+            return smu_read_pm_table(&obj, t->pm_buf, obj.pm_table_size);
+        default:
+            return SMU_Return_Unsupported;
+    }
+}
+
+void* bench_thread(void* arg) {
+    bench_thread_t* t = arg;
+    unsigned long long start;
+    unsigned int i;
+
+    // All threads contend from the first operation onwards.
+    pthread_barrier_wait(&start_barrier);
+
+    for (i = 0; i < t->ops; i++) {
+        start = smu_now_ns();
+
+        if (run_op(t) != SMU_Return_OK)
+            t->errors++;
+
+        t->samples[i] = smu_now_ns() - start;
+    }
+
+    return NULL;
+}
+
+int compare_u64(const void* a, const void* b) {
+    unsigned long long x = *(const unsigned long long*)a, y = *(const unsigned long long*)b;
+
+    return (x > y) - (x < y);
+}
+
+unsigned long long percentile(const unsigned long long* sorted, unsigned long long count, double p) {
+    unsigned long long idx = (unsigned long long)(p * (count - 1) + 0.5);
+
+    return sorted[idx < count ? idx : count - 1];
+}
+
+/**
+ * Runs [ops] operations of [which] in every one of [threads] threads, all at once.
+ * Returns zero on failure to set the run up.
+ */
+int run_case(bench_case which, unsigned int threads, unsigned int ops, bench_result_t* res) {
+    bench_thread_t* ctx;
+    pthread_t* tids;
+    unsigned long long* all, start, elapsed, total = 0, n;
+    unsigned int i;
+    int ok = 0;
+
+    memset(res, 0, sizeof(*res));
+    res->threads = threads;
+
+    n = (unsigned long long)threads * ops;
+
+    ctx = calloc(threads, sizeof(*ctx));
+    tids = calloc(threads, sizeof(*tids));
+    all = calloc(n, sizeof(*all));
+
+    if (!ctx || !tids || !all)
+        goto BREAK_OUT;
+
+    for (i = 0; i < threads; i++) {
+        ctx[i].which = which;
+        ctx[i].ops = ops;
+        ctx[i].samples = all + (unsigned long long)i * ops;
+
+        if (which == CASE_PM_TABLE_READ && !(ctx[i].pm_buf = malloc(obj.pm_table_size)))
+            goto BREAK_OUT;
+    }
+
+    pthread_barrier_init(&start_barrier, NULL, threads + 1);
+
+    for (i = 0; i < threads; i++) {
+        if (pthread_create(&tids[i], NULL, bench_thread, &ctx[i])) {
+            fprintf(stderr, "Failed to create thread %u.\n", i);
+            exit(-3);
+        }
+    }
+
+    start = smu_now_ns();
+    pthread_barrier_wait(&start_barrier);
+
+    for (i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+        res->errors += ctx[i].errors;
+    }
+
+    elapsed = smu_now_ns() - start;
+    pthread_barrier_destroy(&start_barrier);
+
+    qsort(all, n, sizeof(*all), compare_u64);
+
+    for (i = 0; i < n; i++)
+        total += all[i];
+
+    res->ops = n;
+    res->ops_per_sec = elapsed ? n * 1e9 / elapsed : 0;
+    res->mean_ns = total / n;
+    res->p50_ns = percentile(all, n, 0.50);
+    res->p99_ns = percentile(all, n, 0.99);
+    res->p999_ns = percentile(all, n, 0.999);
+    res->max_ns = all[n - 1];
+
+    ok = 1;
+
+BREAK_OUT:
+    if (ctx)
+        for (i = 0; i < threads; i++)
+            free(ctx[i].pm_buf);
+
+    free(ctx);
+    free(tids);
+    free(all);
+
+    return ok;
+}
+
+void print_header() {
+    if (json_output)
+        return;
+
+    fprintf(stdout, "%-14s %7s %9s %12s %10s %10s %10s %10s %10s %7s\n",
+        "case", "threads", "ops", "ops/s", "mean(us)", "p50(us)", "p99(us)", "p99.9(us)",
+        "max(us)", "errors");
+}
+
+void print_result(bench_case which, const bench_result_t* r) {
+    if (json_output) {
+        fprintf(stdout,
+            "{\"case\":\"%s\",\"threads\":%u,\"ops\":%llu,\"errors\":%llu,\"ops_per_sec\":%.1f,"
+            "\"mean_ns\":%llu,\"p50_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu}\n",
+            case_names[which], r->threads, r->ops, r->errors, r->ops_per_sec, r->mean_ns,
+            r->p50_ns, r->p99_ns, r->p999_ns, r->max_ns);
+        return;
+    }
+
+    fprintf(stdout, "%-14s %7u %9llu %12.1f %10.2f %10.2f %10.2f %10.2f %10.2f %7llu\n",
+        case_names[which], r->threads, r->ops, r->ops_per_sec, r->mean_ns / 1e3, r->p50_ns / 1e3,
+        r->p99_ns / 1e3, r->p999_ns / 1e3, r->max_ns / 1e3, r->errors);
+}
+
+/**
+ * Cases are skipped where the processor doesn't support them, rather than reporting only errors.
+ */
+int case_supported(bench_case which) {
+    smu_arg_t args;
+
+    switch (which) {
+        case CASE_RSMU_CMD:
+            return obj.fd_rsmu_cmd != 0;
+        case CASE_HSMP_CMD:
+            memset(&args, 0, sizeof(args));
+            args.args[0] = 1;
+            return smu_send_command(&obj, BENCH_SMU_OP, &args, TYPE_HSMP) == SMU_Return_OK;
+        case CASE_PM_TABLE_READ:
+            return smu_pm_tables_supported(&obj);
+        default:
+            return 1;
+    }
+}
+
+void run_benchmarks() {
+    unsigned int ops;
+    bench_result_t res;
+    bench_case c;
+
+    print_header();
+
+    for (c = 0; c < CASE_COUNT; c++) {
+        if (!(case_mask & (1 << c)) || !case_supported(c))
+            continue;
+
+        // The PM table & mailboxes are far slower than SMN accesses.
+        ops = c == CASE_SMN_READ ? iterations : (iterations + 9) / 10;
+
+        if (run_case(c, 1, ops, &res))
+            print_result(c, &res);
+
+        if (contending_threads > 1 && run_case(c, contending_threads, ops, &res))
+            print_result(c, &res);
+    }
+}
+
+void print_version() {
+    fprintf(stdout, "SMU Latency Benchmark " PROGRAM_VERSION "\n");
+    exit(0);
+}
+
+void show_help(char* program) {
+    fprintf(stdout,
+        "SMU Latency Benchmark " PROGRAM_VERSION "\n\n"
+
+        "Usage: %s <option(s)>\n\n"
+
+        "Options:\n"
+            "\t-h - Show this help screen.\n"
+            "\t-v - Show program version.\n"
+            "\t-j - Print one JSON object per result instead of a table.\n"
+            "\t-n<count> - Operations per thread for SMN reads, a tenth of it for the others.\n"
+            "\t            Defaults to 10000.\n"
+            "\t-t<threads> - Threads contending in the second run of each case, 1 to skip it.\n"
+            "\t              Defaults to 4.\n"
+            "\t-a<address> - SMN address to read. Defaults to 0x%X.\n"
+            "\t-c<case> - Only run this case, may be repeated. One of: smn_read, rsmu_cmd, mp1_cmd,\n"
+            "\t           hsmp_cmd, pm_table_read.\n",
+        program, DEFAULT_SMN_ADDRESS
+    );
+}
+
+void parse_args(int argc, char** argv) {
+    unsigned long val;
+    unsigned int i;
+    char* end;
+    int c = 0, selected = 0;
+
+    while ((c = getopt(argc, argv, "vhjn:t:a:c:")) != -1) {
+        switch (c) {
+            case 'v':
+                print_version();
+                exit(0);
+            case 'j':
+                json_output = 1;
+                break;
+            case 'n':
+                val = strtoul(optarg, &end, 0);
+                if (*end || val < 10 || val > 100000000) {
+                    fprintf(stderr, "The operation count must be between 10 and 100000000.\n");
+                    exit(-1);
+                }
+                iterations = val;
+                break;
+            case 't':
+                val = strtoul(optarg, &end, 0);
+                if (*end || val < 1 || val > 256) {
+                    fprintf(stderr, "The thread count must be between 1 and 256.\n");
+                    exit(-1);
+                }
+                contending_threads = val;
+                break;
+            case 'a':
+                val = strtoul(optarg, &end, 0);
+                if (*end || val > 0xFFFFFFFF) {
+                    fprintf(stderr, "Invalid SMN address.\n");
+                    exit(-1);
+                }
+                smn_address = val;
+                break;
+            case 'c':
+                for (i = 0; i < CASE_COUNT; i++)
+                    if (!strcmp(optarg, case_names[i]))
+                        break;
+
+                if (i == CASE_COUNT) {
+                    fprintf(stderr, "Unknown case: %s\n", optarg);
+                    exit(-1);
+                }
+
+                // The first selection replaces the default of running everything.
+                if (!selected++)
+                    case_mask = 0;
+
+                case_mask |= 1 << i;
+                break;
+            case 'h':
+                show_help(argv[0]);
+                exit(0);
+            case '?':
+                exit(-1);
+            default:
+                break;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    smu_return_val ret;
+
+    parse_args(argc, argv);
+
+    if (geteuid() != 0) {
+        fprintf(stderr, "Program must be run as root.\n");
+        exit(-2);
+    }
+
+    ret = smu_init(&obj);
+    if (ret != SMU_Return_OK) {
+        fprintf(stderr, "%s\n", smu_return_to_str(ret));
+        exit(-2);
+    }
+
+    if (!json_output)
+        fprintf(stdout, "CPU Codename: %s, SMU v%s\n\n", smu_codename_to_str(&obj),
+            smu_get_fw_version(&obj));
+
+    run_benchmarks();
+    smu_free(&obj);
+
+    return 0;
+}
@@ -0,0 +1,545 @@
+/**
+ * Ryzen SMU PM Table Capture
+ * Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com>
+ *
+ * This program is free software: you can redistribute it &&/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#define _GNU_SOURCE
+
+#include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <libsmu.h>
+
+#define PROGRAM_VERSION                 "1.0"
+
+// Longest the flushing thread sleeps once it has drained the arena, shortened for arenas filling
+// up any faster than in four of these.
+#define FLUSH_INTERVAL_NS               50000000L
+
+// Slots are padded to whole cache lines so the sampler & flusher never share one.
+#define SLOT_ALIGN                      64
+
+#define SLOT_SAMPLE                     0
+#define SLOT_EVENT                      1
+
+/**
+ * An entry of the arena, followed by the PM table for samples.
+ */
+typedef struct {
+    unsigned long long          timestamp_ns;
+    unsigned int                kind;
+    smu_rec_event_type          event;
+    char                        label[SMU_REC_MAX_LABEL + 1];
+} slot_t;
+
+/**
+ * Ring of preallocated slots, filled by the sampling thread & drained by the flushing thread.
+ *  Each index is only ever written by one of them.
+ */
+typedef struct {
+    unsigned char*              slots;
+    size_t                      stride;
+    size_t                      len;
+    unsigned long long          capacity;
+
+    unsigned long long          head __attribute__((aligned(SLOT_ALIGN)));
+    unsigned long long          tail __attribute__((aligned(SLOT_ALIGN)));
+} arena_t;
+
+static smu_obj_t obj;
+static arena_t arena;
+static smu_rec_writer_t writer;
+
+static const char* output_path = "capture.smurec";
+static unsigned int interval_us = 1000;
+static unsigned int idle_seconds = 0;
+static unsigned int duration_seconds = 0;
+static unsigned int keyframe_interval = 100;
+static unsigned int arena_samples = 8192;
+static smu_rec_compression compression = SMU_REC_COMPRESS_NONE;
+static int housekeeping_cpu = 0;
+static int realtime = 0;
+static char** workload;
+
+static volatile sig_atomic_t running = 1;
+static volatile sig_atomic_t mark_requested = 0;
+static volatile sig_atomic_t child_exited = 0;
+static volatile int flusher_stop = 0;
+
+static unsigned long long missed_deadlines, dropped, failed_reads, write_errors;
+
+/**
+ * Maps the arena & faults every page in up front, so that sampling never takes a page fault.
+ */
+int arena_init(unsigned long long capacity) {
+    size_t len = sizeof(slot_t) + obj.pm_table_size;
+
+    arena.stride = (len + SLOT_ALIGN - 1) & ~(size_t)(SLOT_ALIGN - 1);
+    arena.capacity = capacity;
+    arena.len = arena.stride * capacity;
+
+    arena.slots = mmap(NULL, arena.len, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (arena.slots == MAP_FAILED) {
+        perror("mmap");
+        return 0;
+    }
+
+    // The workload is forked off the sampler, which would otherwise write protect the whole arena.
+    madvise(arena.slots, arena.len, MADV_DONTFORK);
+
+    if (mlock(arena.slots, arena.len))
+        fprintf(stderr, "Warning: Can't lock the arena in memory: %s\n", strerror(errno));
+
+    return 1;
+}
+
+slot_t* arena_slot(unsigned long long n) {
+    return (slot_t*)(arena.slots + (n % arena.capacity) * arena.stride);
+}
+
+/**
+ * Returns the next free slot or NULL if the flusher has fallen a whole arena behind.
+ */
+slot_t* arena_reserve() {
+    unsigned long long tail = __atomic_load_n(&arena.tail, __ATOMIC_ACQUIRE);
+
+    if (arena.head - tail == arena.capacity) {
+        dropped++;
+        return NULL;
+    }
+
+    return arena_slot(arena.head);
+}
+
+void arena_publish() {
+    __atomic_store_n(&arena.head, arena.head + 1, __ATOMIC_RELEASE);
+}
+
+void mark_event(smu_rec_event_type type, const char* label) {
+    slot_t* slot = arena_reserve();
+
+    if (!slot)
+        return;
+
+    slot->timestamp_ns = smu_now_ns();
+    slot->kind = SLOT_EVENT;
+    slot->event = type;
+    snprintf(slot->label, sizeof(slot->label), "%s", label ? label : "");
+
+    arena_publish();
+}
+
+void take_sample() {
+    slot_t* slot = arena_reserve();
+
+    if (!slot)
+        return;
+
+    // Tables are read straight into the arena, never copied on this thread.
+    if (smu_read_pm_table(&obj, (unsigned char*)(slot + 1), obj.pm_table_size) != SMU_Return_OK) {
+        failed_reads++;
+        return;
+    }
+
+    slot->timestamp_ns = smu_now_ns();
+    slot->kind = SLOT_SAMPLE;
+
+    arena_publish();
+}
+
+/**
+ * Writes out everything published to the arena, sleeping whenever it is drained. The disk I/O &
+ *  encoding of the recording thereby stay off the sampling thread.
+ */
+void* flush_thread(void* unused) {
+    unsigned long long head, tail = 0, delay_ns = arena.capacity * interval_us * 1000ULL / 4;
+    struct timespec delay;
+    smu_return_val ret;
+    slot_t* slot;
+    int stop;
+
+    delay.tv_sec = 0;
+    delay.tv_nsec = delay_ns < FLUSH_INTERVAL_NS ? delay_ns : FLUSH_INTERVAL_NS;
+
+    for (;;) {
+        // Read first, so a stop request is only honoured after draining what preceded it.
+        stop = __atomic_load_n(&flusher_stop, __ATOMIC_ACQUIRE);
+        head = __atomic_load_n(&arena.head, __ATOMIC_ACQUIRE);
+
+        for (; tail != head; tail++) {
+            slot = arena_slot(tail);
+
+            if (slot->kind == SLOT_SAMPLE)
+                ret = smu_rec_write(&writer, slot + 1, slot->timestamp_ns);
+            else
+                ret = smu_rec_write_event(&writer, slot->event, slot->label, slot->timestamp_ns);
+
+            if (ret != SMU_Return_OK)
+                write_errors++;
+
+            __atomic_store_n(&arena.tail, tail + 1, __ATOMIC_RELEASE);
+        }
+
+        if (stop)
+            break;
+
+        nanosleep(&delay, NULL);
+    }
+
+    return NULL;
+}
+
+/**
+ * Runs the workload with the affinity & scheduling the capture started with.
+ */
+pid_t start_workload(const cpu_set_t* affinity) {
+    pid_t pid = fork();
+
+    if (pid == -1) {
+        perror("fork");
+        return -1;
+    }
+
+    if (!pid) {
+        sched_setaffinity(0, sizeof(*affinity), affinity);
+        execvp(workload[0], workload);
+
+        perror("execvp");
+        _exit(127);
+    }
+
+    return pid;
+}
+
+/**
+ * Samples until the capture is over, marking every phase of it in the recording. With a workload,
+ *  the capture is idle for [idle_seconds], runs the workload to completion & is idle again.
+ */
+void run_capture(const cpu_set_t* affinity) {
+    unsigned long long start, next, phase_end = 0, deadline = 0;
+    enum { PHASE_IDLE_BEFORE, PHASE_WORKLOAD, PHASE_IDLE_AFTER } phase = PHASE_IDLE_BEFORE;
+    char label[SMU_REC_MAX_LABEL + 1];
+    pid_t pid = -1;
+    long long missed;
+    int status;
+
+    start = next = smu_now_ns();
+
+    if (duration_seconds)
+        deadline = start + duration_seconds * 1000000000ULL;
+
+    if (workload)
+        phase_end = start + idle_seconds * 1000000000ULL;
+
+    while (running) {
+        take_sample();
+
+        if (mark_requested) {
+            mark_requested = 0;
+            mark_event(SMU_REC_EVENT_MARK, "signal");
+        }
+
+        if (workload && phase == PHASE_IDLE_BEFORE && smu_now_ns() >= phase_end) {
+            pid = start_workload(affinity);
+            if (pid == -1)
+                break;
+
+            snprintf(label, sizeof(label), "%s", workload[0]);
+            mark_event(SMU_REC_EVENT_WORKLOAD_START, label);
+            phase = PHASE_WORKLOAD;
+        }
+
+        if (phase == PHASE_WORKLOAD && child_exited && waitpid(pid, &status, WNOHANG) == pid) {
+            if (WIFEXITED(status))
+                snprintf(label, sizeof(label), "exit %d", WEXITSTATUS(status));
+            else
+                snprintf(label, sizeof(label), "signal %d", WTERMSIG(status));
+
+            mark_event(SMU_REC_EVENT_WORKLOAD_STOP, label);
+
+            pid = -1;
+            phase = PHASE_IDLE_AFTER;
+            phase_end = smu_now_ns() + idle_seconds * 1000000000ULL;
+        }
+
+        if (phase == PHASE_IDLE_AFTER && smu_now_ns() >= phase_end)
+            break;
+
+        if (deadline && smu_now_ns() >= deadline)
+            break;
+
+        // Signals only set flags, which are checked after the next sample.
+        while ((missed = smu_wait_deadline(&next, interval_us * 1000ULL)) < 0)
+            ;
+
+        missed_deadlines += missed;
+    }
+
+    // Interrupted or out of time with the workload still running, which is stopped along with us.
+    if (pid != -1) {
+        kill(pid, SIGTERM);
+        waitpid(pid, &status, 0);
+        mark_event(SMU_REC_EVENT_WORKLOAD_STOP, "interrupted");
+    }
+}
+
+/**
+ * Pins the capture to the housekeeping core, so it only disturbs the workload from a single core.
+ *  The original affinity is kept for the workload.
+ */
+int pin_to_housekeeping(cpu_set_t* affinity) {
+    cpu_set_t set;
+
+    if (sched_getaffinity(0, sizeof(*affinity), affinity)) {
+        perror("sched_getaffinity");
+        return 0;
+    }
+
+    CPU_ZERO(&set);
+    CPU_SET(housekeeping_cpu, &set);
+
+    if (sched_setaffinity(0, sizeof(set), &set)) {
+        fprintf(stderr, "Can't pin to CPU %d: %s\n", housekeeping_cpu, strerror(errno));
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Raises the priority of the sampling thread only. The flusher, created beforehand, stays a normal
+ *  thread & the workload is reset to normal scheduling when forked.
+ */
+void raise_priority() {
+    struct sched_param param = { .sched_priority = 1 };
+
+    if (sched_setscheduler(0, SCHED_FIFO | SCHED_RESET_ON_FORK, &param))
+        fprintf(stderr, "Warning: Can't sample with real-time priority: %s\n", strerror(errno));
+}
+
+void print_version() {
+    fprintf(stdout, "SMU PM Table Capture " PROGRAM_VERSION "\n");
+    exit(0);
+}
+
+void show_help(char* program) {
+    fprintf(stdout,
+        "SMU PM Table Capture " PROGRAM_VERSION "\n\n"
+
+        "Usage: %s <option(s)> [-- <workload> [arguments]]\n\n"
+
+        "Options:\n"
+            "\t-h - Show this help screen.\n"
+            "\t-v - Show program version.\n"
+            "\t-o<path> - Recording to write. Defaults to capture.smurec.\n"
+            "\t-i<microseconds> - Interval between samples. Defaults to 1000.\n"
+            "\t-c<cpu> - Housekeeping core the capture is pinned to. Defaults to 0.\n"
+            "\t-w<seconds> - Time captured idle before & after the workload. Defaults to 0.\n"
+            "\t-t<seconds> - Stop after this long, 0 to capture until interrupted or the workload\n"
+            "\t              is done. Defaults to 0.\n"
+            "\t-n<samples> - Samples the in-memory arena holds. Defaults to 8192.\n"
+            "\t-k<samples> - Samples between keyframes. Defaults to 100.\n"
+            "\t-z<method> - Compress frames with none, lz4 or zstd. Defaults to none.\n"
+            "\t-r - Sample with real-time priority.\n\n"
+
+        "Sending SIGUSR1 marks an event in the recording.\n",
+        program
+    );
+}
+
+void parse_args(int argc, char** argv) {
+    unsigned long val;
+    char* end;
+    int c = 0;
+
+    // Stop at the first non-option so the arguments of the workload are left alone.
+    while ((c = getopt(argc, argv, "+vho:i:c:w:t:n:k:z:r")) != -1) {
+        switch (c) {
+            case 'v':
+                print_version();
+                exit(0);
+            case 'o':
+                output_path = optarg;
+                break;
+            case 'i':
+                val = strtoul(optarg, &end, 0);
+                if (*end || val < 100 || val > 60000000) {
+                    fprintf(stderr, "The interval must be between 100 and 60000000 us.\n");
+                    exit(-1);
+                }
+                interval_us = val;
+                break;
+            case 'c':
+                val = strtoul(optarg, &end, 0);
+                if (*end || val >= CPU_SETSIZE) {
+                    fprintf(stderr, "Invalid housekeeping core.\n");
+                    exit(-1);
+                }
+                housekeeping_cpu = val;
+                break;
+            case 'w':
+            case 't':
+                val = strtoul(optarg, &end, 0);
+                if (*end || val > 86400) {
+                    fprintf(stderr, "Durations must be at most 86400 seconds.\n");
+                    exit(-1);
+                }
+                *(c == 'w' ? &idle_seconds : &duration_seconds) = val;
+                break;
+            case 'n':
+                val = strtoul(optarg, &end, 0);
+                if (*end || val < 16 || val > 16777216) {
+                    fprintf(stderr, "The arena must hold between 16 and 16777216 samples.\n");
+                    exit(-1);
+                }
+                arena_samples = val;
+                break;
+            case 'k':
+                val = strtoul(optarg, &end, 0);
+                if (*end || !val || val > 0xFFFFFFFF) {
+                    fprintf(stderr, "Invalid keyframe interval.\n");
+                    exit(-1);
+                }
+                keyframe_interval = val;
+                break;
+            case 'z':
+                if (!strcmp(optarg, "none"))
+                    compression = SMU_REC_COMPRESS_NONE;
+                else if (!strcmp(optarg, "lz4"))
+                    compression = SMU_REC_COMPRESS_LZ4;
+                else if (!strcmp(optarg, "zstd"))
+                    compression = SMU_REC_COMPRESS_ZSTD;
+                else {
+                    fprintf(stderr, "Unknown compression method: %s\n", optarg);
+                    exit(-1);
+                }
+                break;
+            case 'r':
+                realtime = 1;
+                break;
+            case 'h':
+                show_help(argv[0]);
+                exit(0);
+            case '?':
+                exit(-1);
+            default:
+                break;
+        }
+    }
+
+    if (optind < argc)
+        workload = argv + optind;
+}
+
+void signal_interrupt(int sig) {
+    if (sig == SIGUSR1)
+        mark_requested = 1;
+    else if (sig == SIGCHLD)
+        child_exited = 1;
+    else
+        running = 0;
+}
+
+int main(int argc, char** argv) {
+    smu_rec_info_t info;
+    cpu_set_t affinity;
+    struct sigaction sa;
+    smu_return_val ret;
+    pthread_t flusher;
+
+    parse_args(argc, argv);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_interrupt;
+
+    if (sigaction(SIGINT, &sa, NULL) || sigaction(SIGTERM, &sa, NULL) ||
+        sigaction(SIGUSR1, &sa, NULL) || sigaction(SIGCHLD, &sa, NULL)) {
+        fprintf(stderr, "Can't set up signal hooks.\n");
+        exit(-1);
+    }
+
+    if (geteuid() != 0) {
+        fprintf(stderr, "Program must be run as root.\n");
+        exit(-2);
+    }
+
+    ret = smu_init(&obj);
+    if (ret != SMU_Return_OK) {
+        fprintf(stderr, "%s\n", smu_return_to_str(ret));
+        exit(-2);
+    }
+
+    if (!smu_pm_tables_supported(&obj)) {
+        fprintf(stderr, "PM Tables are not supported on this processor.\n");
+        exit(-3);
+    }
+
+    if (!pin_to_housekeeping(&affinity) || !arena_init(arena_samples))
+        exit(-4);
+
+    info.codename = obj.codename;
+    info.pm_table_version = obj.pm_table_version;
+    info.pm_table_size = obj.pm_table_size;
+    info.keyframe_interval = keyframe_interval;
+    info.compression = compression;
+
+    ret = smu_rec_writer_open(&writer, output_path, &info);
+    if (ret != SMU_Return_OK) {
+        fprintf(stderr, "Can't create %s: %s\n", output_path, smu_return_to_str(ret));
+        exit(-5);
+    }
+
+    if (pthread_create(&flusher, NULL, flush_thread, NULL)) {
+        fprintf(stderr, "Can't create the flushing thread.\n");
+        exit(-5);
+    }
+
+    if (realtime)
+        raise_priority();
+
+    fprintf(stdout, "Capturing the PM table to %s every %u us on CPU %d.\n", output_path,
+        interval_us, housekeeping_cpu);
+
+    run_capture(&affinity);
+
+    __atomic_store_n(&flusher_stop, 1, __ATOMIC_RELEASE);
+    pthread_join(flusher, NULL);
+
+    fprintf(stdout, "Captured %llu samples & %llu events.\n", writer.count, writer.event_count);
+
+    if (smu_rec_writer_close(&writer) != SMU_Return_OK)
+        write_errors++;
+
+    if (missed_deadlines || dropped || failed_reads || write_errors)
+        fprintf(stderr, "Missed %llu deadlines, dropped %llu entries with the arena full, "
+            "%llu reads failed & %llu writes failed.\n", missed_deadlines, dropped, failed_reads,
+            write_errors);
+
+    munmap(arena.slots, arena.len);
+    smu_free(&obj);
+
+    return write_errors ? -6 : 0;
+}
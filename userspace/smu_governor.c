@@ -0,0 +1,660 @@
+/**
+ * Ryzen SMU Power & Thermal Governor
+ * Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com>
+ *
+ * This program is free software: you can redistribute it &&/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <libsmu.h>
+
+#define PROGRAM_VERSION                 "1.0"
+
+// SetPPTLimit, SetTDCLimit & SetEDCLimit on the RSMU mailbox, taking milliwatts & milliamps.
+#ifdef LIBSMU_FAMILY
+#define RSMU_SET_PPT_LIMIT              LIBSMU_FAMILY_OP_SET_PPT_LIMIT
+#define RSMU_SET_TDC_LIMIT              LIBSMU_FAMILY_OP_SET_TDC_LIMIT
+#define RSMU_SET_EDC_LIMIT              LIBSMU_FAMILY_OP_SET_EDC_LIMIT
+#else
+#define RSMU_SET_PPT_LIMIT              0x53
+#define RSMU_SET_TDC_LIMIT              0x54
+#define RSMU_SET_EDC_LIMIT              0x55
+#endif
+
+// Share of the PPT limit the thermal loop removes per degree above its target.
+#define THERMAL_PPT_PER_DEGREE          0.02f
+
+// Changes of the limit smaller than this share of its ceiling aren't worth an SMU write.
+#define MIN_WRITE_DELTA                 0.005f
+
+#define STATS_INTERVAL_NS               1000000000ULL
+
+typedef enum {
+    ACT_PPT,
+    ACT_TDC,
+    ACT_EDC,
+    ACT_COUNT
+} actuator_id;
+
+typedef enum {
+    LOOP_POWER,
+    LOOP_THERMAL,
+    LOOP_TDC,
+    LOOP_EDC,
+    LOOP_COUNT
+} loop_id;
+
+/**
+ * A limit of the SMU the governor writes, in watts or amps.
+ */
+typedef struct {
+    const char*                 name;
+    unsigned int                op;
+    // Field reporting the limit in effect, the one found at start being restored on exit.
+    smu_pm_field                field;
+    float                       original;
+    int                         applied;
+    // Limits are never raised past the ceiling nor lowered past the floor.
+    float                       ceiling;
+    float                       floor;
+    float                       limit;
+    float                       written;
+    float                       requested;
+    int                         pending;
+    unsigned long long          last_write_ns;
+    // Start of the excursion which the pending write reacts to, if it lowered the limit.
+    unsigned long long          trigger_ns;
+
+    unsigned long long          writes;
+    unsigned long long          failed;
+    unsigned long long          suppressed;
+    unsigned long long          reactions;
+    unsigned long long          reaction_total_ns;
+    unsigned long long          reaction_max_ns;
+} actuator_t;
+
+/**
+ * Keeps a metric of the PM table below its target by moving the limit of an actuator. During an
+ *  excursion, the limit is lowered below the ceiling in proportion to the largest excess seen, so
+ *  that samples still predating the effect of a write don't lower it any further. Once back under
+ *  target, it is raised again at a fixed rate.
+ */
+typedef struct {
+    const char*                 name;
+    smu_pm_field                field;
+    actuator_id                 actuator;
+    float                       target;
+    // Limit units removed per unit of excess.
+    float                       scale;
+    float                       limit;
+    float                       value;
+    int                         over;
+    // Time of the first sample of the excursion no lower limit was written for yet.
+    unsigned long long          trigger_ns;
+
+    unsigned long long          excursions;
+    unsigned long long          over_ns;
+    float                       peak_excess;
+} loop_t;
+
+static actuator_t actuators[ACT_COUNT] = {
+    [ACT_PPT] = { .name = "ppt", .op = RSMU_SET_PPT_LIMIT, .field = PM_FIELD_PPT_LIMIT },
+    [ACT_TDC] = { .name = "tdc", .op = RSMU_SET_TDC_LIMIT, .field = PM_FIELD_TDC_LIMIT },
+    [ACT_EDC] = { .name = "edc", .op = RSMU_SET_EDC_LIMIT, .field = PM_FIELD_EDC_LIMIT },
+};
+
+static loop_t loops[LOOP_COUNT] = {
+    [LOOP_POWER]    = { .name = "power",   .field = PM_FIELD_PPT_VALUE, .actuator = ACT_PPT },
+    [LOOP_THERMAL]  = { .name = "thermal", .field = PM_FIELD_THM_VALUE, .actuator = ACT_PPT },
+    [LOOP_TDC]      = { .name = "tdc",     .field = PM_FIELD_TDC_VALUE, .actuator = ACT_TDC },
+    [LOOP_EDC]      = { .name = "edc",     .field = PM_FIELD_EDC_VALUE, .actuator = ACT_EDC },
+};
+
+static smu_obj_t obj;
+static const smu_pm_schema_t* schema;
+
+static unsigned int interval_us = 1000;
+static float hysteresis = 0.02f;
+static float gain = 1.0f;
+static float ramp_per_sec = 0.1f;
+static float floor_share = 0.5f;
+static unsigned int min_write_interval_us = 5000;
+static const char* stats_path;
+
+static volatile sig_atomic_t running = 1;
+
+static unsigned long long ticks, stale, missed_deadlines, start_ns;
+
+int actuator_enabled(const actuator_t* act) {
+    return act->ceiling > 0;
+}
+
+int loop_enabled(const loop_t* loop) {
+    return loop->target > 0 && actuator_enabled(&actuators[loop->actuator]);
+}
+
+smu_return_val write_limit_sync(actuator_t* act, float limit) {
+    smu_arg_t args;
+
+    memset(&args, 0, sizeof(args));
+    args.args[0] = (unsigned int)(limit * 1000.f);
+
+    return smu_send_command(&obj, act->op, &args, TYPE_RSMU);
+}
+
+/**
+ * Puts back the limits which were in effect before the governor changed them.
+ */
+void restore_limits() {
+    unsigned int i;
+
+    for (i = 0; i < ACT_COUNT; i++) {
+        if (actuators[i].applied &&
+            write_limit_sync(&actuators[i], actuators[i].original) != SMU_Return_OK)
+            fprintf(stderr, "Can't restore the %s limit.\n", actuators[i].name);
+    }
+}
+
+/**
+ * Updates a loop with a new sample taken at [ts], [dt] nanoseconds after the previous one.
+ */
+void update_loop(loop_t* loop, const unsigned char* table, unsigned long long ts,
+    unsigned long long dt) {
+    actuator_t* act = &actuators[loop->actuator];
+    float excess, band = loop->target * hysteresis;
+
+    loop->value = smu_pm_get_f32(schema, table, loop->field, 0);
+    if (isnan(loop->value))
+        return;
+
+    excess = loop->value - loop->target;
+
+    // Excursions only end once the metric is back below the hysteresis band.
+    if (excess > band && !loop->over) {
+        loop->over = 1;
+        loop->trigger_ns = ts;
+        loop->excursions++;
+    }
+    else if (excess < -band)
+        loop->over = 0;
+
+    if (loop->over) {
+        loop->over_ns += dt;
+        if (excess > loop->peak_excess)
+            loop->peak_excess = excess;
+    }
+
+    if (excess > band)
+        loop->limit = fminf(loop->limit, act->ceiling - gain * loop->scale * excess);
+    else if (excess < -band)
+        loop->limit += ramp_per_sec * act->ceiling * dt / 1e9f;
+
+    loop->limit = fminf(fmaxf(loop->limit, act->floor), act->ceiling);
+}
+
+/**
+ * Writes the most restrictive limit of the loops driving [act], unless a write is still pending,
+ *  the change is negligible or the last write was too recent.
+ */
+void update_actuator(actuator_t* act, actuator_id id) {
+    unsigned long long now = smu_now_ns();
+    smu_arg_t args;
+    unsigned int i;
+
+    act->limit = act->ceiling;
+    for (i = 0; i < LOOP_COUNT; i++) {
+        if (loops[i].actuator == id && loop_enabled(&loops[i]))
+            act->limit = fminf(act->limit, loops[i].limit);
+    }
+
+    // Small steps are still taken to get back to the ceiling exactly.
+    if (act->limit == act->written ||
+        (fabsf(act->limit - act->written) < act->ceiling * MIN_WRITE_DELTA &&
+        act->limit < act->ceiling))
+        return;
+
+    if (act->pending || now - act->last_write_ns < min_write_interval_us * 1000ULL) {
+        act->suppressed++;
+        return;
+    }
+
+    memset(&args, 0, sizeof(args));
+    args.args[0] = (unsigned int)(act->limit * 1000.f);
+
+    if (smu_send_command_async(&obj, id, act->op, &args, TYPE_RSMU) != SMU_Return_OK) {
+        act->failed++;
+        return;
+    }
+
+    act->pending = 1;
+    act->requested = act->limit;
+    act->last_write_ns = now;
+    act->trigger_ns = 0;
+
+    // Suppressed writes don't delay the trigger, the reaction is timed from the excursion start.
+    if (act->limit < act->written) {
+        for (i = 0; i < LOOP_COUNT; i++) {
+            if (loops[i].actuator != id || !loops[i].trigger_ns)
+                continue;
+
+            if (!act->trigger_ns || loops[i].trigger_ns < act->trigger_ns)
+                act->trigger_ns = loops[i].trigger_ns;
+            loops[i].trigger_ns = 0;
+        }
+    }
+}
+
+int writes_pending() {
+    unsigned int i;
+
+    for (i = 0; i < ACT_COUNT; i++) {
+        if (actuators[i].pending)
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Retrieves the results of writes, waiting at most [timeout_ms] for one to complete.
+ */
+void retrieve_completions(int timeout_ms) {
+    smu_completion_t completions[ACT_COUNT];
+    unsigned long long now;
+    actuator_t* act;
+    int n, i;
+
+    n = smu_poll_completions(&obj, completions, ACT_COUNT, timeout_ms);
+    if (n <= 0)
+        return;
+
+    now = smu_now_ns();
+
+    for (i = 0; i < n; i++) {
+        if (completions[i].cookie >= ACT_COUNT)
+            continue;
+
+        act = &actuators[completions[i].cookie];
+        act->pending = 0;
+
+        if (completions[i].status != SMU_Return_OK) {
+            act->failed++;
+            continue;
+        }
+
+        act->written = act->requested;
+        act->writes++;
+
+        // Time from the sample showing an excursion until the SMU applied the lower limit.
+        if (act->trigger_ns) {
+            act->reactions++;
+            act->reaction_total_ns += now - act->trigger_ns;
+            if (now - act->trigger_ns > act->reaction_max_ns)
+                act->reaction_max_ns = now - act->trigger_ns;
+        }
+    }
+}
+
+/**
+ * Prints every statistic in the Prometheus text format.
+ */
+void print_stats(FILE* fp) {
+    const actuator_t* act;
+    const loop_t* loop;
+    unsigned int i;
+
+    fprintf(fp, "ryzen_smu_governor_uptime_seconds %.3f\n", (smu_now_ns() - start_ns) / 1e9);
+    fprintf(fp, "ryzen_smu_governor_ticks_total %llu\n", ticks);
+    fprintf(fp, "ryzen_smu_governor_stale_samples_total %llu\n", stale);
+    fprintf(fp, "ryzen_smu_governor_missed_deadlines_total %llu\n", missed_deadlines);
+
+    for (i = 0; i < LOOP_COUNT; i++) {
+        loop = &loops[i];
+        if (!loop_enabled(loop))
+            continue;
+
+        fprintf(fp, "ryzen_smu_governor_value{loop=\"%s\"} %.3f\n", loop->name, loop->value);
+        fprintf(fp, "ryzen_smu_governor_target{loop=\"%s\"} %.3f\n", loop->name, loop->target);
+        fprintf(fp, "ryzen_smu_governor_excursions_total{loop=\"%s\"} %llu\n", loop->name,
+            loop->excursions);
+        fprintf(fp, "ryzen_smu_governor_over_target_seconds_total{loop=\"%s\"} %.6f\n",
+            loop->name, loop->over_ns / 1e9);
+        fprintf(fp, "ryzen_smu_governor_peak_excess{loop=\"%s\"} %.3f\n", loop->name,
+            loop->peak_excess);
+    }
+
+    for (i = 0; i < ACT_COUNT; i++) {
+        act = &actuators[i];
+        if (!actuator_enabled(act))
+            continue;
+
+        fprintf(fp, "ryzen_smu_governor_limit{actuator=\"%s\"} %.3f\n", act->name, act->written);
+        fprintf(fp, "ryzen_smu_governor_writes_total{actuator=\"%s\"} %llu\n", act->name,
+            act->writes);
+        fprintf(fp, "ryzen_smu_governor_failed_writes_total{actuator=\"%s\"} %llu\n", act->name,
+            act->failed);
+        fprintf(fp, "ryzen_smu_governor_suppressed_writes_total{actuator=\"%s\"} %llu\n",
+            act->name, act->suppressed);
+        fprintf(fp, "ryzen_smu_governor_reaction_seconds_mean{actuator=\"%s\"} %.6f\n",
+            act->name, act->reactions ? act->reaction_total_ns / 1e9 / act->reactions : 0);
+        fprintf(fp, "ryzen_smu_governor_reaction_seconds_max{actuator=\"%s\"} %.6f\n",
+            act->name, act->reaction_max_ns / 1e9);
+    }
+}
+
+/**
+ * Replaces the statistics file at once, so that readers never see it partially written.
+ */
+void write_stats() {
+    char tmp[4096];
+    FILE* fp;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", stats_path);
+
+    fp = fopen(tmp, "w");
+    if (!fp)
+        return;
+
+    print_stats(fp);
+
+    if (fclose(fp) || rename(tmp, stats_path))
+        unlink(tmp);
+}
+
+void run_governor() {
+    unsigned long long next, last_ts = 0, next_stats;
+    smu_snapshot_info_t info = { 0 };
+    unsigned char* table;
+    smu_snapshot_t snap;
+    smu_return_val ret;
+    long long missed;
+    unsigned int i;
+
+    table = calloc(1, obj.pm_table_size);
+    if (!table) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(-3);
+    }
+
+    // The snapshot thread refreshes the table at the same rate the loop runs at.
+    ret = smu_snapshot_start(&snap, &obj, interval_us);
+    if (ret != SMU_Return_OK) {
+        fprintf(stderr, "Can't start sampling the PM table: %s\n", smu_return_to_str(ret));
+        exit(-4);
+    }
+
+    // The first snapshot is always in place once sampling started.
+    smu_snapshot_read(&snap, table, obj.pm_table_size, &info);
+
+    // Without a power target, the thermal loop lowers the PPT limit currently in effect.
+    if (loops[LOOP_THERMAL].target > 0 && !actuator_enabled(&actuators[ACT_PPT])) {
+        actuators[ACT_PPT].ceiling = smu_pm_get_f32(schema, table, PM_FIELD_PPT_LIMIT, 0);
+        if (!(actuators[ACT_PPT].ceiling > 0)) {
+            fprintf(stderr, "Can't read the PPT limit, give a power target instead.\n");
+            exit(-4);
+        }
+    }
+
+    // Limits which can't be read couldn't be put back on exit, so they are left alone.
+    for (i = 0; i < ACT_COUNT; i++) {
+        if (!actuator_enabled(&actuators[i]))
+            continue;
+
+        actuators[i].original = smu_pm_get_f32(schema, table, actuators[i].field, 0);
+        if (!(actuators[i].original > 0)) {
+            fprintf(stderr, "Can't read the current %s limit to restore it on exit.\n",
+                actuators[i].name);
+            exit(-4);
+        }
+    }
+
+    for (i = 0; i < ACT_COUNT; i++) {
+        if (!actuator_enabled(&actuators[i]))
+            continue;
+
+        // Start from a known state, every loop at the ceiling of its actuator.
+        actuators[i].floor = actuators[i].ceiling * floor_share;
+        actuators[i].limit = actuators[i].written = actuators[i].ceiling;
+
+        if (write_limit_sync(&actuators[i], actuators[i].ceiling) != SMU_Return_OK) {
+            fprintf(stderr, "Can't set the %s limit.\n", actuators[i].name);
+            restore_limits();
+            exit(-5);
+        }
+
+        actuators[i].applied = 1;
+    }
+
+    for (i = 0; i < LOOP_COUNT; i++) {
+        loops[i].limit = actuators[loops[i].actuator].ceiling;
+        loops[i].scale = 1;
+    }
+
+    loops[LOOP_THERMAL].scale = actuators[ACT_PPT].ceiling * THERMAL_PPT_PER_DEGREE;
+
+    fprintf(stdout, "Governing every %u us.\n", interval_us);
+
+    start_ns = next = smu_now_ns();
+    next_stats = start_ns + STATS_INTERVAL_NS;
+
+    while (running) {
+        ticks++;
+
+        retrieve_completions(0);
+
+        ret = smu_snapshot_read(&snap, table, obj.pm_table_size, &info);
+        if (ret == SMU_Return_OK) {
+            for (i = 0; i < LOOP_COUNT; i++) {
+                if (loop_enabled(&loops[i]))
+                    update_loop(&loops[i], table, info.timestamp_ns,
+                        last_ts ? info.timestamp_ns - last_ts : 0);
+            }
+
+            for (i = 0; i < ACT_COUNT; i++) {
+                if (actuator_enabled(&actuators[i]))
+                    update_actuator(&actuators[i], i);
+            }
+
+            last_ts = info.timestamp_ns;
+        }
+        else
+            stale++;
+
+        if (stats_path && smu_now_ns() >= next_stats) {
+            write_stats();
+            next_stats += STATS_INTERVAL_NS;
+        }
+
+        // Interrupted by a signal, which is checked before sleeping again.
+        missed = smu_wait_deadline(&next, interval_us * 1000ULL);
+        if (missed > 0)
+            missed_deadlines += missed;
+    }
+
+    // Writes still in flight could otherwise be applied after the limits are restored.
+    for (i = 0; i < ACT_COUNT && writes_pending(); i++)
+        retrieve_completions(100);
+
+    restore_limits();
+
+    smu_snapshot_stop(&snap);
+    free(table);
+
+    if (stats_path)
+        write_stats();
+
+    print_stats(stdout);
+}
+
+void print_version() {
+    fprintf(stdout, "SMU Governor " PROGRAM_VERSION "\n");
+    exit(0);
+}
+
+void show_help(char* program) {
+    fprintf(stdout,
+        "SMU Governor " PROGRAM_VERSION "\n\n"
+
+        "Usage: %s <option(s)>\n\n"
+
+        "Options:\n"
+            "\t-h - Show this help screen.\n"
+            "\t-v - Show program version.\n"
+            "\t-p<watts> - Keep the package power below this, also the highest PPT limit.\n"
+            "\t-t<amps> - Keep the current below this, also the highest TDC limit.\n"
+            "\t-e<amps> - Keep the peak current below this, also the highest EDC limit.\n"
+            "\t-T<celsius> - Lower the PPT limit while the temperature exceeds this.\n"
+            "\t-i<microseconds> - Interval of the control loop. Defaults to 1000.\n"
+            "\t-H<percent> - Hysteresis band around every target. Defaults to 2.\n"
+            "\t-g<gain> - Share of an excess removed from the limit per step. Defaults to 1.\n"
+            "\t-r<percent> - Share of the highest limit restored per second once under target.\n"
+            "\t              Defaults to 10.\n"
+            "\t-m<percent> - Lowest limit, as a share of the highest. Defaults to 50.\n"
+            "\t-w<microseconds> - Least time between two writes of a limit. Defaults to 5000.\n"
+            "\t-s<path> - Write statistics to this file every second.\n",
+        program
+    );
+}
+
+float parse_float(const char* arg, float min, float max, const char* what) {
+    char* end;
+    float val;
+
+    val = strtof(arg, &end);
+    if (*end || !(val >= min && val <= max)) {
+        fprintf(stderr, "%s must be between %g and %g.\n", what, min, max);
+        exit(-1);
+    }
+
+    return val;
+}
+
+void parse_args(int argc, char** argv) {
+    int c = 0;
+
+    while ((c = getopt(argc, argv, "vhp:t:e:T:i:H:g:r:m:w:s:")) != -1) {
+        switch (c) {
+            case 'v':
+                print_version();
+                exit(0);
+            case 'p':
+                actuators[ACT_PPT].ceiling = parse_float(optarg, 1, 1000, "The power target");
+                loops[LOOP_POWER].target = actuators[ACT_PPT].ceiling;
+                break;
+            case 't':
+                actuators[ACT_TDC].ceiling = parse_float(optarg, 1, 1000, "The current target");
+                loops[LOOP_TDC].target = actuators[ACT_TDC].ceiling;
+                break;
+            case 'e':
+                actuators[ACT_EDC].ceiling = parse_float(optarg, 1, 1000, "The current target");
+                loops[LOOP_EDC].target = actuators[ACT_EDC].ceiling;
+                break;
+            case 'T':
+                loops[LOOP_THERMAL].target = parse_float(optarg, 40, 115, "The temperature target");
+                break;
+            case 'i':
+                interval_us = parse_float(optarg, 100, 1000000, "The interval");
+                break;
+            case 'H':
+                hysteresis = parse_float(optarg, 0, 50, "The hysteresis") / 100.f;
+                break;
+            case 'g':
+                gain = parse_float(optarg, 0.01f, 10, "The gain");
+                break;
+            case 'r':
+                ramp_per_sec = parse_float(optarg, 0.1f, 1000, "The ramp rate") / 100.f;
+                break;
+            case 'm':
+                floor_share = parse_float(optarg, 1, 100, "The lowest limit") / 100.f;
+                break;
+            case 'w':
+                min_write_interval_us = parse_float(optarg, 0, 10000000, "The write interval");
+                break;
+            case 's':
+                stats_path = optarg;
+                break;
+            case 'h':
+                show_help(argv[0]);
+                exit(0);
+            case '?':
+                exit(-1);
+            default:
+                break;
+        }
+    }
+
+    if (!loops[LOOP_POWER].target && !loops[LOOP_THERMAL].target && !loops[LOOP_TDC].target &&
+        !loops[LOOP_EDC].target) {
+        fprintf(stderr, "Nothing to govern, give at least one target.\n");
+        exit(-1);
+    }
+}
+
+void signal_interrupt(int sig) {
+    running = 0;
+}
+
+int main(int argc, char** argv) {
+    struct sigaction sa;
+    smu_return_val ret;
+
+    parse_args(argc, argv);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_interrupt;
+
+    if (sigaction(SIGINT, &sa, NULL) || sigaction(SIGTERM, &sa, NULL)) {
+        fprintf(stderr, "Can't set up signal hooks.\n");
+        exit(-1);
+    }
+
+    if (geteuid() != 0) {
+        fprintf(stderr, "Program must be run as root.\n");
+        exit(-2);
+    }
+
+    ret = smu_init(&obj);
+    if (ret != SMU_Return_OK) {
+        fprintf(stderr, "%s\n", smu_return_to_str(ret));
+        exit(-2);
+    }
+
+    // The limit commands are only known on these.
+    if (SMU_CODENAME(&obj) != CODENAME_MATISSE && SMU_CODENAME(&obj) != CODENAME_VERMEER) {
+        fprintf(stderr, "Setting limits is not supported on this processor.\n");
+        exit(-3);
+    }
+
+    schema = smu_get_pm_schema(&obj);
+    if (!schema) {
+        fprintf(stderr, "The layout of PM table version 0x%08X is not known.\n",
+            obj.pm_table_version);
+        exit(-3);
+    }
+
+    run_governor();
+    smu_free(&obj);
+
+    return 0;
+}
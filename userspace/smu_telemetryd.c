@@ -0,0 +1,280 @@
+/**
+ * Ryzen SMU Shared Memory Telemetry Daemon
+ * Copyright (C) 2020 Leonardo Gates <leogatesx9r@protonmail.com>
+ *
+ * This program is free software: you can redistribute it &&/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#define _GNU_SOURCE
+
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <libsmu.h>
+
+#define PROGRAM_VERSION                 "1.0"
+
+// Segments are readable by everyone so that clients need no privileges.
+#define SHM_MODE                        0644
+
+static smu_obj_t obj;
+static const char* shm_name = SMU_SHM_DEFAULT_NAME;
+static unsigned int interval_us = 1000000;
+static unsigned int smn_addresses[SMU_SHM_MAX_SMN], smn_count;
+static volatile sig_atomic_t running = 1;
+
+smu_shm_header_t* create_segment(size_t* len) {
+    size_t table_offset = (sizeof(smu_shm_header_t) + 63) & ~(size_t)63;
+    smu_shm_header_t* hdr;
+    int fd;
+
+    *len = table_offset + obj.pm_table_size;
+
+    // Replace the segment of a previous instance which was killed, clients re-attach to the new one.
+    shm_unlink(shm_name);
+
+    fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, SHM_MODE);
+    if (fd == -1) {
+        perror("shm_open");
+        return NULL;
+    }
+
+    // The mode requested is subject to the umask.
+    if (fchmod(fd, SHM_MODE) || ftruncate(fd, *len)) {
+        perror("ftruncate");
+        close(fd);
+        shm_unlink(shm_name);
+        return NULL;
+    }
+
+    hdr = mmap(NULL, *len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (hdr == MAP_FAILED) {
+        perror("mmap");
+        shm_unlink(shm_name);
+        return NULL;
+    }
+
+    hdr->version = SMU_SHM_VERSION;
+    hdr->size = *len;
+    hdr->table_offset = table_offset;
+    hdr->codename = obj.codename;
+    hdr->smu_if_version = obj.smu_if_version;
+    hdr->smu_version = obj.smu_version;
+    hdr->driver_version = obj.driver_version;
+    hdr->pm_table_version = obj.pm_table_version;
+    hdr->pm_table_size = obj.pm_table_size;
+    hdr->interval_us = interval_us;
+    hdr->pid = getpid();
+    hdr->smn_count = smn_count;
+    memcpy(hdr->smn_addresses, smn_addresses, smn_count * sizeof(smn_addresses[0]));
+
+    return hdr;
+}
+
+/**
+ * Samples everything into private buffers first, so the seqlock is only held for the copy.
+ */
+void take_sample(smu_shm_header_t* hdr, unsigned char* table, smu_smn_op_t* ops,
+    smu_pm_table_gen_t* gen) {
+    smu_return_val ret = SMU_Return_Unchanged;
+    unsigned long long now;
+    unsigned int i;
+
+    if (obj.pm_table_size)
+        ret = smu_read_pm_table_if_changed(&obj, table, obj.pm_table_size, gen);
+
+    for (i = 0; i < smn_count; i++) {
+        ops[i].address = smn_addresses[i];
+        ops[i].op = SMU_SMN_OP_READ;
+    }
+
+    // Each failed access is reported through its status instead.
+    smu_smn_batch(&obj, ops, smn_count);
+
+    now = smu_now_ns();
+
+    __atomic_store_n(&hdr->seq, hdr->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (ret == SMU_Return_OK) {
+        memcpy((unsigned char*)hdr + hdr->table_offset, table, obj.pm_table_size);
+
+        // Without change tracking in the driver every sample counts as a change.
+        hdr->generation = gen->generation ? gen->generation : hdr->generation + 1;
+    }
+    else if (ret != SMU_Return_Unchanged)
+        hdr->failed++;
+
+    for (i = 0; i < smn_count; i++) {
+        hdr->smn[i].value = ops[i].value;
+        hdr->smn[i].status = ops[i].status;
+    }
+
+    hdr->timestamp_ns = now;
+
+    __atomic_store_n(&hdr->seq, hdr->seq + 1, __ATOMIC_RELEASE);
+}
+
+void run_daemon() {
+    unsigned long long interval = interval_us * 1000ULL, next;
+    smu_pm_table_gen_t gen = { 0 };
+    smu_shm_header_t* hdr;
+    unsigned char* table;
+    smu_smn_op_t* ops;
+    size_t len;
+
+    table = calloc(obj.pm_table_size ? obj.pm_table_size : 1, 1);
+    ops = calloc(SMU_SHM_MAX_SMN, sizeof(*ops));
+    if (!table || !ops) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(-3);
+    }
+
+    hdr = create_segment(&len);
+    if (!hdr)
+        exit(-4);
+
+    take_sample(hdr, table, ops, &gen);
+
+    // Clients only attach once the first sample is in place.
+    __atomic_store_n(&hdr->magic, SMU_SHM_MAGIC, __ATOMIC_RELEASE);
+
+    fprintf(stdout, "Publishing telemetry to %s every %u us.\n", shm_name, interval_us);
+
+    next = smu_now_ns() + interval;
+
+    while (running) {
+        if (smu_wait_deadline(&next, interval) < 0)
+            continue;
+
+        take_sample(hdr, table, ops, &gen);
+    }
+
+    shm_unlink(shm_name);
+    munmap(hdr, len);
+    free(table);
+    free(ops);
+}
+
+void print_version() {
+    fprintf(stdout, "SMU Telemetry Daemon " PROGRAM_VERSION "\n");
+    exit(0);
+}
+
+void show_help(char* program) {
+    fprintf(stdout,
+        "SMU Telemetry Daemon " PROGRAM_VERSION "\n\n"
+
+        "Usage: %s <option(s)>\n\n"
+
+        "Options:\n"
+            "\t-h - Show this help screen.\n"
+            "\t-v - Show program version.\n"
+            "\t-n<name> - Name of the shared memory segment. Defaults to " SMU_SHM_DEFAULT_NAME ".\n"
+            "\t-i<microseconds> - Interval between samples. Defaults to 1000000.\n"
+            "\t-a<address> - Also sample this SMN address, may be repeated up to %d times.\n",
+        program, SMU_SHM_MAX_SMN
+    );
+}
+
+void parse_args(int argc, char** argv) {
+    unsigned long val;
+    char* end;
+    int c = 0;
+
+    while ((c = getopt(argc, argv, "vhn:i:a:")) != -1) {
+        switch (c) {
+            case 'v':
+                print_version();
+                exit(0);
+            case 'n':
+                // POSIX requires portable names to start with a slash.
+                if (optarg[0] != '/' || strchr(optarg + 1, '/')) {
+                    fprintf(stderr, "Segment names must start with and contain a single '/'.\n");
+                    exit(-1);
+                }
+                shm_name = optarg;
+                break;
+            case 'i':
+                val = strtoul(optarg, &end, 0);
+                if (*end || val < 100 || val > 60000000) {
+                    fprintf(stderr, "The interval must be between 100 and 60000000 us.\n");
+                    exit(-1);
+                }
+                interval_us = val;
+                break;
+            case 'a':
+                val = strtoul(optarg, &end, 0);
+                if (*end || val > 0xFFFFFFFF || smn_count == SMU_SHM_MAX_SMN) {
+                    fprintf(stderr, "Invalid or too many SMN addresses.\n");
+                    exit(-1);
+                }
+                smn_addresses[smn_count++] = val;
+                break;
+            case 'h':
+                show_help(argv[0]);
+                exit(0);
+            case '?':
+                exit(-1);
+            default:
+                break;
+        }
+    }
+}
+
+void signal_interrupt(int sig) {
+    running = 0;
+}
+
+int main(int argc, char** argv) {
+    struct sigaction sa;
+    smu_return_val ret;
+
+    parse_args(argc, argv);
+
+    // Without SA_RESTART, the pending sleep is interrupted so the daemon exits promptly.
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_interrupt;
+
+    if (sigaction(SIGINT, &sa, NULL) || sigaction(SIGTERM, &sa, NULL)) {
+        fprintf(stderr, "Can't set up signal hooks.\n");
+        exit(-1);
+    }
+
+    if (geteuid() != 0) {
+        fprintf(stderr, "Program must be run as root.\n");
+        exit(-2);
+    }
+
+    ret = smu_init(&obj);
+    if (ret != SMU_Return_OK) {
+        fprintf(stderr, "%s\n", smu_return_to_str(ret));
+        exit(-2);
+    }
+
+    run_daemon();
+    smu_free(&obj);
+
+    return 0;
+}